@@ -0,0 +1,99 @@
+/*
+ * aa_encode.c
+ *
+ *  Makes anti-aliased fonts from GRLIB fonts, see aa_encode.h.
+ */
+#include <string.h>
+#include "aa_encode.h"
+
+// Largest glyph of the GRLIB font, in pixels
+#define AA_ENCODE_MAX_PIXELS (256*256)
+
+// Decode a GRLIB glyph into one byte per pixel, 1 for on, the same way as
+// glyphRasterise in GlyphCache.c.
+static void glyphDecode(uint8_t *pui8Pixels, const uint8_t *pui8Glyph, uint32_t ui32NumPixels,
+                        bool bCompressed){
+    uint32_t ui32Pos = 0;
+    uint32_t ui32Index = 2;
+    uint32_t ui32Bits, ui32Bit, ui32On;
+
+    memset(pui8Pixels, 0, ui32NumPixels);
+    while((ui32Index < pui8Glyph[0]) && (ui32Pos < ui32NumPixels)){
+        if(bCompressed && (pui8Glyph[ui32Index] != 0)){
+            ui32Pos += pui8Glyph[ui32Index] >> 4;
+            ui32On = pui8Glyph[ui32Index] & 0x0F;
+            while(ui32On-- && (ui32Pos < ui32NumPixels)){
+                pui8Pixels[ui32Pos++] = 1;
+            }
+            ui32Index++;
+            continue;
+        }
+        if(bCompressed){
+            ui32Bits = (pui8Glyph[ui32Index + 1] & 0x7F)*8;
+            ui32Index += 2;
+        }
+        else {
+            ui32Bits = (pui8Glyph[0] - ui32Index)*8;
+        }
+        for(ui32Bit = 0 ; (ui32Bit < ui32Bits) && (ui32Pos < ui32NumPixels) ; ui32Bit++, ui32Pos++){
+            pui8Pixels[ui32Pos] = (pui8Glyph[ui32Index + ui32Bit/8] >> (7 - (ui32Bit & 7))) & 1;
+        }
+        ui32Index += ui32Bits/8;
+    }
+}
+
+uint32_t AaEncode_font(const tFont *psFont, uint32_t ui32Scale, uint32_t ui32Bpp,
+                       uint8_t *pui8Data, uint32_t ui32Size, tGlyphAaFont *psAaFont){
+    static uint8_t pui8Pixels[AA_ENCODE_MAX_PIXELS];
+    const uint8_t *pui8Glyph;
+    uint32_t ui32Max = (1 << ui32Bpp) - 1;
+    uint32_t ui32Bytes = 0;
+    uint32_t ui32Char, ui32Width, ui32Height, ui32Row, ui32Col, ui32X, ui32Y, ui32On, ui32Bit;
+
+    if(((psFont->ui8Format != FONT_FMT_UNCOMPRESSED) && (psFont->ui8Format != FONT_FMT_PIXEL_RLE)) ||
+       ((ui32Bpp != 2) && (ui32Bpp != 4)) || (ui32Scale == 0)){
+        return 0;
+    }
+    ui32Height = (psFont->ui8Height + ui32Scale - 1)/ui32Scale;
+    psAaFont->ui8Bpp = ui32Bpp;
+    psAaFont->ui8Height = ui32Height;
+    psAaFont->ui8Baseline = (psFont->ui8Baseline + ui32Scale/2)/ui32Scale;
+    psAaFont->ui8MaxWidth = (psFont->ui8MaxWidth + ui32Scale - 1)/ui32Scale;
+    psAaFont->pui8Data = pui8Data;
+    for(ui32Char = 0 ; ui32Char < 95 ; ui32Char++){
+        pui8Glyph = psFont->pui8Data + psFont->pui16Offset[ui32Char];
+        if(pui8Glyph[1]*psFont->ui8Height > AA_ENCODE_MAX_PIXELS){
+            return 0;
+        }
+        glyphDecode(pui8Pixels, pui8Glyph, pui8Glyph[1]*psFont->ui8Height,
+                    psFont->ui8Format == FONT_FMT_PIXEL_RLE);
+        ui32Width = (pui8Glyph[1] + ui32Scale - 1)/ui32Scale;
+        if((ui32Bytes > 0xFFFF) || (ui32Bytes + 1 + (ui32Width*ui32Height*ui32Bpp + 7)/8 > ui32Size)){
+            return 0;
+        }
+        psAaFont->pui16Offset[ui32Char] = ui32Bytes;
+        pui8Data[ui32Bytes++] = ui32Width;
+        ui32Bit = 0;
+        for(ui32Row = 0 ; ui32Row < ui32Height ; ui32Row++){
+            for(ui32Col = 0 ; ui32Col < ui32Width ; ui32Col++){
+                // Pixels of the block that are outside of the glyph count as off.
+                ui32On = 0;
+                for(ui32Y = ui32Row*ui32Scale ; (ui32Y < (ui32Row + 1)*ui32Scale) && (ui32Y < psFont->ui8Height) ;
+                    ui32Y++){
+                    for(ui32X = ui32Col*ui32Scale ; (ui32X < (ui32Col + 1)*ui32Scale) && (ui32X < pui8Glyph[1]) ;
+                        ui32X++){
+                        ui32On += pui8Pixels[ui32Y*pui8Glyph[1] + ui32X];
+                    }
+                }
+                ui32On = (ui32On*ui32Max + ui32Scale*ui32Scale/2)/(ui32Scale*ui32Scale);
+                if((ui32Bit & 7) == 0){
+                    pui8Data[ui32Bytes + ui32Bit/8] = 0;
+                }
+                pui8Data[ui32Bytes + ui32Bit/8] |= ui32On << (8 - ui32Bpp - (ui32Bit & 7));
+                ui32Bit += ui32Bpp;
+            }
+        }
+        ui32Bytes += (ui32Bit + 7)/8;
+    }
+    return ui32Bytes;
+}
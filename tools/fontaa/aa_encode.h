@@ -0,0 +1,25 @@
+/*
+ * aa_encode.h
+ *
+ *  Makes anti-aliased fonts, drawn by GlyphCache_aaStringDraw (see tGlyphAaFont in
+ *  GlyphCache.h), from GRLIB fonts. Used by fontaa, and by the benchmark in
+ *  tools/hx8357_emu.
+ *
+ */
+
+#ifndef AA_ENCODE_H_
+#define AA_ENCODE_H_
+#include <stdint.h>
+#include <grlib/grlib.h>
+#include "GlyphCache.h"
+
+// Make an anti-aliased font with ui32Bpp (2 or 4) bits per pixel from psFont, a
+// classic tFont that is ui32Scale times larger. Each pixel of the new font covers
+// ui32Scale*ui32Scale pixels of psFont, and its coverage is the part of them that is
+// on, rounded to the nearest level. The glyphs are written to pui8Data, which has
+// room for ui32Size bytes, and psAaFont->pui8Data is set to it. Returns the number
+// of bytes, or 0 if they don't fit or the font isn't supported.
+uint32_t AaEncode_font(const tFont *psFont, uint32_t ui32Scale, uint32_t ui32Bpp,
+                       uint8_t *pui8Data, uint32_t ui32Size, tGlyphAaFont *psAaFont);
+
+#endif /* AA_ENCODE_H_ */
@@ -0,0 +1,98 @@
+/*
+ * fontaa.c
+ *
+ *  Makes an anti-aliased font, drawn by GlyphCache_aaStringDraw, from a GRLIB
+ *  font, as a C file with a const tGlyphAaFont that ends up in flash.
+ *
+ *  Usage: fontaa [-b bpp] [-s scale] [-n name] file.c
+ *  -b  bits per pixel, 2 or 4 (default)
+ *  -s  how many times larger the GRLIB font is, 2 by default
+ *  -n  name of the font, g_sFontAa by default
+ *
+ *  The GRLIB font is built in, FONTAA_FONT (g_sFontCmss48 by default) from the
+ *  font file given to gcc.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aa_encode.h"
+
+#ifndef FONTAA_FONT
+#define FONTAA_FONT g_sFontCmss48
+#endif
+#define FONTAA_STRING(x) FONTAA_NAME(x)
+#define FONTAA_NAME(x) #x
+
+extern const tFont FONTAA_FONT;
+
+static const char *baseName(const char *pcPath){
+    const char *pcSlash = strrchr(pcPath, '/');
+    return pcSlash ? pcSlash + 1 : pcPath;
+}
+
+static void usage(void){
+    fprintf(stderr, "Usage: fontaa [-b bpp] [-s scale] [-n name] file.c\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]){
+    static uint8_t pui8Data[0x10000];
+    const char *pcName = "g_sFontAa";
+    const char *pcFileName = NULL;
+    uint32_t ui32Bpp = 4, ui32Scale = 2;
+    uint32_t ui32Bytes, ui32Index;
+    tGlyphAaFont sFont;
+    FILE *pFile;
+    int i;
+
+    for(i = 1 ; i < argc ; i++){
+        if((strcmp(argv[i], "-b") == 0) && (i + 1 < argc)){
+            ui32Bpp = atoi(argv[++i]);
+        }
+        else if((strcmp(argv[i], "-s") == 0) && (i + 1 < argc)){
+            ui32Scale = atoi(argv[++i]);
+        }
+        else if((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)){
+            pcName = argv[++i];
+        }
+        else if((argv[i][0] == '-') || (pcFileName != NULL)){
+            usage();
+        }
+        else {
+            pcFileName = argv[i];
+        }
+    }
+    if((pcFileName == NULL) || ((ui32Bpp != 2) && (ui32Bpp != 4)) || (ui32Scale < 1) || (ui32Scale > 8)){
+        usage();
+    }
+
+    ui32Bytes = AaEncode_font(&FONTAA_FONT, ui32Scale, ui32Bpp, pui8Data, sizeof(pui8Data), &sFont);
+    if(ui32Bytes == 0){
+        fprintf(stderr, "%s isn't supported, or too large\n", FONTAA_STRING(FONTAA_FONT));
+        return 1;
+    }
+
+    pFile = fopen(pcFileName, "w");
+    if(pFile == NULL){
+        fprintf(stderr, "Couldn't write %s\n", pcFileName);
+        return 2;
+    }
+    fprintf(pFile, "/*\n * %s\n *\n *  Made with tools/fontaa from %s, %u times smaller, %u bits per pixel.\n"
+            " *  Drawn with GlyphCache_aaStringDraw.\n */\n#include \"GlyphCache.h\"\n\n"
+            "static const uint8_t pui8Data[%u] = {",
+            baseName(pcFileName), FONTAA_STRING(FONTAA_FONT), (unsigned)ui32Scale, (unsigned)ui32Bpp,
+            (unsigned)ui32Bytes);
+    for(ui32Index = 0 ; ui32Index < ui32Bytes ; ui32Index++){
+        fprintf(pFile, "%s0x%02X,", (ui32Index % 16) ? " " : "\n    ", pui8Data[ui32Index]);
+    }
+    fprintf(pFile, "\n};\n\nconst tGlyphAaFont %s = {\n    %u, %u, %u, %u,\n    {", pcName,
+            (unsigned)sFont.ui8Bpp, (unsigned)sFont.ui8Height, (unsigned)sFont.ui8Baseline,
+            (unsigned)sFont.ui8MaxWidth);
+    for(ui32Index = 0 ; ui32Index < 95 ; ui32Index++){
+        fprintf(pFile, "%s%u,", (ui32Index % 12) ? " " : "\n        ", (unsigned)sFont.pui16Offset[ui32Index]);
+    }
+    fprintf(pFile, "\n    },\n    pui8Data\n};\n");
+    fclose(pFile);
+    printf("%s: %u pixels high, %u bytes\n", pcName, (unsigned)sFont.ui8Height, (unsigned)ui32Bytes);
+    return 0;
+}
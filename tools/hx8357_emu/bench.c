@@ -0,0 +1,1234 @@
+/*
+ * bench.c
+ *
+ *  Benchmark of the GRLIB functions of the HX8357 driver, run against the
+ *  emulated screen. Each case draws a fixed set of primitives through the
+ *  tDisplay function table, set up the same way as in taskFxn, and reports what
+ *  was sent to the screen and an estimate of how long it takes on the target.
+ *  The results are printed as JSON, so that runs can be compared.
+ *
+ *  Usage: bench [-m direct|fb|queue] [-r bitrate] [-t transfer_ns] [-g gpio_ns]
+ *  -m  how GRLIB draws: straight to the screen (default), through the off-screen
+ *      band (FrameBuffer.c) or through the command queue (DisplayQueue.c)
+ *  -r  SPI bit rate in Hz, default 20 MHz as in initSpi
+ *  -t  time each SPI_transfer takes on top of the bits on the wire, in ns
+ *  -g  time each CS or D/C pin change takes, in ns
+ *
+ *  The estimate is: bits/bitrate + transfers*transfer_ns + (CS + D/C changes)*gpio_ns.
+ *  The two overheads default to rough values for TI-RTOS 2.16 at 80 MHz, measure
+ *  them on the target to get better estimates.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xdc/std.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/drivers/SPI.h>
+#include <grlib/grlib.h>
+#include <ti/sysbios/BIOS.h>
+#include "ADAFRUIT_2050.h"
+#include "ByteRing.h"
+#include "DisplayList.h"
+#include "DisplayQueue.h"
+#include "Fills.h"
+#include "FrameBuffer.h"
+#include "GlyphCache.h"
+#include "RleImage.h"
+#include "Shapes.h"
+#include "Sprites.h"
+#include "Terminal.h"
+#include "hx8357_emu.h"
+#include "../fontaa/aa_encode.h"
+#include "../img2rle/rle_encode.h"
+
+#define BENCH_BITRATE     20000000
+#define BENCH_TRANSFER_NS 5000
+#define BENCH_GPIO_NS     250
+// Baud rate of the UART in uartFxn
+#define BENCH_UART_BAUD   115200
+
+typedef enum
+{
+    MODE_DIRECT,
+    MODE_FRAME_BUFFER,
+    MODE_QUEUE
+}
+tBenchMode;
+
+static const char *modeNames[] = {"direct", "fb", "queue"};
+
+static tBenchMode benchMode;
+static tDisplayData displayData;
+static tFrameBuffer frameBuffer;
+static tDisplayQueue displayQueue;
+static Task_Struct renderTaskStruct;
+static tDisplay display;
+static tContext grlibContext;
+static tGlyphCache glyphCache;
+static tTerminal terminal;
+static tByteRing uartRing;
+static tDisplayList displayList;
+static tRleImage rleImage;
+static tSprites sprites;
+static uint32_t ui32BitRate = BENCH_BITRATE;
+static uint32_t ui32TransferNs = BENCH_TRANSFER_NS;
+static uint32_t ui32GpioNs = BENCH_GPIO_NS;
+
+// Number of GRLIB calls made, and characters drawn, by the case being run
+static uint32_t ui32Calls;
+static uint32_t ui32Chars;
+// Size of the compressed image drawn by the case being run, if any
+static uint32_t ui32ImageBytes;
+// Sprite moves made by the case being run, if any
+static uint32_t ui32Moves;
+// Bytes written to the terminal, and GlyphCache_stringDraw calls it made, by the
+// case being run, if any
+static uint32_t ui32TermBytes, ui32TermDraws;
+// Fill rates measured by fill_kernel, in millions of pixels per second on the host
+static uint32_t ui32FillKernelRate, ui32FillLoopRate, ui32FillMemsetRate;
+// The screen as drawn by GRLIB, to compare the shapes of Shapes.c with
+static uint32_t pui32Snapshot[480*320];
+
+// Estimated time on the target to send everything counted in g_sEmuStats, in us,
+// see the top of this file.
+static uint32_t estUsGet(void){
+    uint32_t ui32Toggles = 2*g_sEmuStats.ui32CsSessions + g_sEmuStats.ui32DcToggles;
+    return Emu_wireTimeUs(ui32BitRate) +
+           (uint32_t)(((uint64_t)g_sEmuStats.ui32Transfers*ui32TransferNs +
+                       (uint64_t)ui32Toggles*ui32GpioNs)/1000);
+}
+
+static void caseFrame(void){
+    tRectangle rect;
+    rect.i16XMin = 0;
+    rect.i16XMax = 480-1;
+    rect.i16YMin = 0;
+    rect.i16YMax = 320-1;
+    display.pfnRectFill(display.pvDisplayData, &rect, HX8357_BLACK);
+    ui32Calls++;
+}
+
+static void casePixelDraw(void){
+    int32_t i32Index;
+    for(i32Index = 0 ; i32Index < 1000 ; i32Index++){
+        display.pfnPixelDraw(display.pvDisplayData, (i32Index*7) % 480, (i32Index*3) % 320,
+                             HX8357_BLUE);
+        ui32Calls++;
+    }
+}
+
+static void caseLineDrawH(void){
+    int32_t i32Y;
+    for(i32Y = 0 ; i32Y < 320 ; i32Y++){
+        display.pfnLineDrawH(display.pvDisplayData, 0, 480-1, i32Y, HX8357_YELLOW);
+        ui32Calls++;
+    }
+}
+
+static void caseLineDrawV(void){
+    int32_t i32X;
+    for(i32X = 0 ; i32X < 480 ; i32X++){
+        display.pfnLineDrawV(display.pvDisplayData, i32X, 0, 320-1, HX8357_YELLOW);
+        ui32Calls++;
+    }
+}
+
+// The moving rectangle of DRAW_RECTANGLE_TEST, 50x50 pixels
+static void caseRectFillSmall(void){
+    tRectangle rect;
+    int32_t i32Index;
+    for(i32Index = 0 ; i32Index < 100 ; i32Index++){
+        rect.i16XMin = (i32Index*5) % (480-50);
+        rect.i16XMax = rect.i16XMin + 50-1;
+        rect.i16YMin = (i32Index*4) % (320-50);
+        rect.i16YMax = rect.i16YMin + 50-1;
+        display.pfnRectFill(display.pvDisplayData, &rect, HX8357_RED);
+        ui32Calls++;
+    }
+}
+
+static void caseRectFillFull(void){
+    int32_t i32Index;
+    for(i32Index = 0 ; i32Index < 4 ; i32Index++){
+        caseFrame();
+    }
+}
+
+// The fill kernel (HX8357_fillColor) against the two ways the driver filled before
+// it: a loop storing two bytes per pixel, and memset, which RectFill used and which
+// only repeats the low byte. Each fills a row of 480 pixels over and over, every
+// other time starting on an odd pixel, and is timed on the host. Nothing is sent.
+#define FILL_ROWS 20000
+
+static uint64_t hostNsGet(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+// Millions of pixels per second, for FILL_ROWS rows since ui64Start
+static uint32_t fillRateGet(uint64_t ui64Start){
+    uint64_t ui64Ns = hostNsGet() - ui64Start;
+    return (uint32_t)(ui64Ns ? (uint64_t)FILL_ROWS*480*1000/ui64Ns : 0);
+}
+
+static void caseFillKernel(void){
+    static uint16_t pui16Row[480 + 1];
+    volatile uint32_t ui32Sink = 0;
+    uint32_t ui32Row, ui32Index, ui32Color;
+    uint8_t *pui8Row;
+    uint64_t ui64Start;
+
+    ui64Start = hostNsGet();
+    for(ui32Row = 0 ; ui32Row < FILL_ROWS ; ui32Row++){
+        HX8357_fillColor(&pui16Row[ui32Row & 1], 0x1234 + ui32Row, 480);
+        ui32Sink += pui16Row[ui32Row % 480];
+    }
+    ui32FillKernelRate = fillRateGet(ui64Start);
+
+    ui64Start = hostNsGet();
+    for(ui32Row = 0 ; ui32Row < FILL_ROWS ; ui32Row++){
+        pui8Row = (uint8_t *)&pui16Row[ui32Row & 1];
+        ui32Color = 0x1234 + ui32Row;
+        for(ui32Index = 0 ; ui32Index < 480 ; ui32Index++){
+            pui8Row[2*ui32Index] = ui32Color >> 8;
+            pui8Row[2*ui32Index + 1] = ui32Color & 0xFF;
+        }
+        ui32Sink += pui16Row[ui32Row % 480];
+    }
+    ui32FillLoopRate = fillRateGet(ui64Start);
+
+    ui64Start = hostNsGet();
+    for(ui32Row = 0 ; ui32Row < FILL_ROWS ; ui32Row++){
+        memset(&pui16Row[ui32Row & 1], (0x1234 + ui32Row) & 0xFF, 2*480);
+        ui32Sink += pui16Row[ui32Row % 480];
+    }
+    ui32FillMemsetRate = fillRateGet(ui64Start);
+    ui32Calls = 3*FILL_ROWS;
+}
+
+// Draw with pfnDraw(false) (GRLIB), keep the screen, and draw the same with
+// pfnDraw(true) on a cleared screen. Only the second is counted, and every pixel of
+// it is checked against the first.
+static void shapesCompare(const char *pcName, void (*pfnDraw)(bool)){
+    uint32_t ui32X, ui32Y, ui32Mismatches = 0;
+
+    pfnDraw(false);
+    display.pfnFlush(display.pvDisplayData);
+    for(ui32Y = 0 ; ui32Y < 320 ; ui32Y++){
+        for(ui32X = 0 ; ui32X < 480 ; ui32X++){
+            pui32Snapshot[ui32Y*480 + ui32X] = Emu_pixelGet(ui32X, ui32Y);
+        }
+    }
+    caseFrame();
+    display.pfnFlush(display.pvDisplayData);
+
+    Emu_statsClear();
+    ui32Calls = 0;
+    ui32Chars = 0;
+    pfnDraw(true);
+    for(ui32Y = 0 ; ui32Y < 320 ; ui32Y++){
+        for(ui32X = 0 ; ui32X < 480 ; ui32X++){
+            if(Emu_pixelGet(ui32X, ui32Y) != pui32Snapshot[ui32Y*480 + ui32X]){
+                ui32Mismatches++;
+            }
+        }
+    }
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+    if(ui32Mismatches){
+        fprintf(stderr, "%s: %u pixels came out different\n", pcName, (unsigned)ui32Mismatches);
+        g_sEmuStats.ui32Errors += ui32Mismatches;
+    }
+}
+
+// The strings of TEXT_TEST
+static void caseStringDraw(void){
+    int32_t i32Index;
+    for(i32Index = 0 ; i32Index < 7 ; i32Index++){
+        GrStringDraw(&grlibContext, "Hello world", 11, 100, 20+40*i32Index, false);
+        ui32Calls++;
+        ui32Chars += 11;
+    }
+}
+
+// The strings of TEXT_TEST with their background, through the glyph cache if bCached
+// is set, otherwise with GrStringDraw.
+static void stringsDraw(bool bCached){
+    int32_t i32Index;
+    for(i32Index = 0 ; i32Index < 7 ; i32Index++){
+        if(bCached){
+            GlyphCache_stringDraw(&glyphCache, &grlibContext, "Hello world", 11, 100, 20+40*i32Index);
+        }
+        else {
+            GrStringDraw(&grlibContext, "Hello world", 11, 100, 20+40*i32Index, true);
+        }
+        ui32Calls++;
+        ui32Chars += 11;
+    }
+}
+
+// The same strings through the glyph cache, checked against GRLIB
+static void caseStringDrawCached(void){
+    shapesCompare("string_draw_cached", stringsDraw);
+}
+
+// Anti-aliased text, from g_sFontCmtt38 at half the size, in 4 bpp
+static tGlyphAaFont aaFont;
+static uint8_t pui8AaFontData[0x10000];
+
+// Where the strings of caseStringDrawAa go. The last one is partly off the screen.
+static const int16_t pi16AaStringX[8] = {100, 100, 100, 100, 100, 100, 100, -5};
+static const int16_t pi16AaStringY[8] = {20, 60, 100, 140, 180, 220, 260, -7};
+
+// Blend two RGB565 colors with a coverage of 0 to 15, one pixel at a time.
+static uint16_t aaBlend(uint16_t ui16Foreground, uint16_t ui16Background, uint32_t ui32Coverage){
+    uint32_t ui32Shift, ui32Mask;
+    uint16_t ui16Color = 0;
+    for(ui32Shift = 0 ; ui32Shift < 16 ; ui32Shift += (ui32Shift == 5) ? 6 : 5){
+        ui32Mask = (ui32Shift == 5) ? 0x3F : 0x1F;
+        ui16Color |= ((((ui16Foreground >> ui32Shift) & ui32Mask)*ui32Coverage +
+                       ((ui16Background >> ui32Shift) & ui32Mask)*(15 - ui32Coverage) + 7)/15) << ui32Shift;
+    }
+    return ui16Color;
+}
+
+static uint32_t emuColorGet(uint16_t ui16Color);
+
+// The strings of TEXT_TEST in an anti-aliased font through the glyph cache, in
+// orange on dark blue, and a check of every pixel of them.
+static void caseStringDrawAa(void){
+    const uint8_t *pui8Glyph;
+    uint32_t ui32Index, ui32Char, ui32Pos, ui32Width, ui32Coverage, ui32Mismatches = 0;
+    int32_t i32X, i32Y;
+    uint16_t ui16Foreground, ui16Background;
+
+    if(aaFont.pui8Data == NULL){
+        AaEncode_font(&g_sFontCmtt38, 2, 4, pui8AaFontData, sizeof(pui8AaFontData), &aaFont);
+    }
+    GrContextForegroundSet(&grlibContext, ClrOrange);
+    GrContextBackgroundSet(&grlibContext, ClrDarkBlue);
+    ui16Foreground = grlibContext.ui32Foreground;
+    ui16Background = grlibContext.ui32Background;
+    for(ui32Index = 0 ; ui32Index < 8 ; ui32Index++){
+        GlyphCache_aaStringDraw(&glyphCache, &grlibContext, &aaFont, "Hello world", 11,
+                                pi16AaStringX[ui32Index], pi16AaStringY[ui32Index]);
+        ui32Calls++;
+        ui32Chars += 11;
+    }
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+    GrContextBackgroundSet(&grlibContext, 0);
+
+    display.pfnFlush(display.pvDisplayData);
+    for(ui32Index = 0 ; ui32Index < 8 ; ui32Index++){
+        i32X = pi16AaStringX[ui32Index];
+        for(ui32Char = 0 ; ui32Char < 11 ; ui32Char++){
+            pui8Glyph = aaFont.pui8Data + aaFont.pui16Offset["Hello world"[ui32Char] - ' '];
+            ui32Width = pui8Glyph[0];
+            for(ui32Pos = 0 ; ui32Pos < ui32Width*aaFont.ui8Height ; ui32Pos++){
+                ui32Coverage = (pui8Glyph[1 + ui32Pos/2] >> ((ui32Pos & 1) ? 0 : 4)) & 0x0F;
+                if((i32X + (int32_t)(ui32Pos % ui32Width) >= 0) &&
+                   (pi16AaStringY[ui32Index] + (int32_t)(ui32Pos/ui32Width) >= 0)){
+                    i32Y = pi16AaStringY[ui32Index] + ui32Pos/ui32Width;
+                    if(Emu_pixelGet(i32X + ui32Pos % ui32Width, i32Y) !=
+                       emuColorGet(aaBlend(ui16Foreground, ui16Background, ui32Coverage))){
+                        ui32Mismatches++;
+                    }
+                }
+            }
+            i32X += ui32Width;
+        }
+    }
+    if(ui32Mismatches){
+        fprintf(stderr, "string_draw_aa: %u pixels came out different\n", (unsigned)ui32Mismatches);
+        g_sEmuStats.ui32Errors += ui32Mismatches;
+    }
+}
+
+static void screenSizeSet(uint16_t ui16Width, uint16_t ui16Height);
+
+// Set up the terminal of USE_SCROLL_TERMINAL, in portrait.
+static void terminalBegin(void){
+    HX8357_orientationSet(&displayData, HX8357_PORTRAIT);
+    screenSizeSet(HX8357_TFTWIDTH, HX8357_TFTHEIGHT);
+    Terminal_init(&terminal, &grlibContext, &glyphCache, &displayData, 0,
+                  HX8357_TFTHEIGHT/grlibContext.psFont->ui8Height);
+}
+
+// Back to landscape for the other cases
+static void terminalEnd(void){
+    display.pfnFlush(display.pvDisplayData);
+    HX8357_scrollAreaSet(&displayData, 0, HX8357_TFTHEIGHT);
+    HX8357_scrollStartSet(&displayData, 0);
+    HX8357_orientationSet(&displayData, HX8357_LANDSCAPE);
+    screenSizeSet(480, 320);
+}
+
+// UART_SCREEN_TEST with USE_SCROLL_TERMINAL: lines of text, three screens full, so
+// that most line feeds scroll the screen.
+static void caseTerminalScroll(void){
+    uint32_t ui32Index;
+
+    terminalBegin();
+    for(ui32Index = 0 ; ui32Index < 3*terminal.ui16NumLines ; ui32Index++){
+        Terminal_write(&terminal, "Hello world\r", 12);
+        ui32Calls++;
+        ui32Chars += 11;
+    }
+    ui32TermBytes = 12*ui32Index;
+    ui32TermDraws = terminal.ui32NumDraws;
+    terminalEnd();
+}
+
+// The same terminal, fed by the UART through the ring buffer like in uartFxn. A burst
+// of text comes in at BENCH_UART_BAUD while the screen task draws, and each time the
+// screen task takes everything that has come in so far. Time goes by as estimated
+// from what is sent to the screen, and the screen task waits when nothing has come in.
+// calls is the number of batches the screen task took, which was one per byte with the
+// mailbox. Each batch draws every run of characters on a line with one call.
+static void caseUartBurst(void){
+    static const char pcText[] = "The quick brown fox jumps over the lazy dog\r";
+    uint32_t ui32Bytes = 10*(sizeof(pcText) - 1);
+    uint32_t ui32ByteNs = 10*1000000000ull/BENCH_UART_BAUD; // Start, 8 data and a stop bit
+    uint32_t ui32StartUs, ui32IdleUs = 0, ui32NowUs;
+    uint32_t ui32Arrived, ui32Sent = 0, ui32Count;
+    char pcBuf[64];
+    char cChar;
+
+    terminalBegin();
+    ByteRing_init(&uartRing);
+    ui32StartUs = estUsGet();
+    while(1){
+        // What the UART task has got by now goes in the ring, as far as it fits.
+        ui32NowUs = estUsGet() - ui32StartUs + ui32IdleUs;
+        ui32Arrived = (uint64_t)ui32NowUs*1000/ui32ByteNs;
+        if(ui32Arrived > ui32Bytes){
+            ui32Arrived = ui32Bytes;
+        }
+        while(ui32Sent < ui32Arrived){
+            cChar = pcText[ui32Sent % (sizeof(pcText) - 1)];
+            if(ByteRing_write(&uartRing, &cChar, 1, BIOS_NO_WAIT) == 0){
+                break;
+            }
+            ui32Sent++;
+        }
+        ui32Count = ByteRing_read(&uartRing, pcBuf, sizeof(pcBuf), BIOS_NO_WAIT);
+        if(ui32Count == 0){
+            if(ui32Sent == ui32Bytes){
+                break;
+            }
+            // Wait for the next byte
+            ui32IdleUs += ((uint64_t)(ui32Sent + 1)*ui32ByteNs + 999)/1000 - ui32NowUs;
+            continue;
+        }
+        Terminal_write(&terminal, pcBuf, ui32Count);
+        display.pfnFlush(display.pvDisplayData);
+        ui32Calls++;
+        ui32Chars += ui32Count;
+    }
+    ui32TermBytes = ui32Bytes;
+    ui32TermDraws = terminal.ui32NumDraws;
+    terminalEnd();
+}
+
+// DRAW_RECTANGLE_TEST: the rectangle bouncing around the screen, and the frame
+// counter, through the display list. Only what changes is repainted, the trail of
+// the rectangle included. calls is the number of node updates, two per frame.
+static void caseDisplayListBounce(void){
+    tRectangle rect;
+    char pcFrame[12];
+    int16_t i16X = 0, i16Y = 0;
+    int16_t i16SpeedX = 5, i16SpeedY = 4;
+    uint16_t ui16Color = HX8357_BLACK;
+    uint32_t ui32Frame;
+
+    DisplayList_init(&displayList, &display, HX8357_BLACK);
+    for(ui32Frame = 0 ; ui32Frame < 100 ; ui32Frame++){
+        // Turn around where the rectangle would go off the screen, like in main.c
+        if((i16X + i16SpeedX < 0) || (i16X + i16SpeedX + 50 >= 480 - 1)){
+            i16SpeedX = -i16SpeedX;
+        }
+        else {
+            i16X += i16SpeedX;
+        }
+        if((i16Y + i16SpeedY < 0) || (i16Y + i16SpeedY + 50 >= 320 - 1)){
+            i16SpeedY = -i16SpeedY;
+        }
+        else {
+            i16Y += i16SpeedY;
+        }
+        rect.i16XMin = i16X;
+        rect.i16XMax = i16X + 50;
+        rect.i16YMin = i16Y;
+        rect.i16YMax = i16Y + 50;
+        DisplayList_rectSet(&displayList, 1, &rect, ui16Color);
+        ui16Color += 5;
+        sprintf(pcFrame, "%u", (unsigned)ui32Frame);
+        DisplayList_textSet(&displayList, 0, &g_sFontCmtt38, pcFrame, -1,
+                            0, 320 - GrFontHeightGet(&g_sFontCmtt38), HX8357_WHITE);
+        DisplayList_render(&displayList);
+        display.pfnFlush(display.pvDisplayData);
+        ui32Calls += 2;
+    }
+}
+
+// A full screen of user interface, compressed with tools/img2rle and drawn with
+// RleImage.c. The screen is first drawn with GRLIB, a gradient behind a title bar,
+// buttons and text, and read back from the emulator as the image. Only drawing the
+// compressed image is counted, and every pixel must come out the same.
+static void caseRleImage(void){
+    static uint16_t pui16Pixels[480*320];
+    static uint8_t pui8Image[RLE_ENCODE_MAX_BYTES(480, 320)];
+    static const char *ppcButtons[] = {"Start", "Stop", "Menu"};
+    uint32_t ui32X, ui32Y, ui32Color, ui32Mismatches = 0;
+    tRectangle rect;
+
+    for(ui32Y = 0 ; ui32Y < 320 ; ui32Y++){
+        display.pfnLineDrawH(display.pvDisplayData, 0, 480 - 1, ui32Y, ((ui32Y/11) << 11) | 0x0214);
+    }
+    rect.i16XMin = 0;
+    rect.i16XMax = 480 - 1;
+    rect.i16YMin = 0;
+    rect.i16YMax = 49;
+    display.pfnRectFill(display.pvDisplayData, &rect, 0x2104);
+    GrStringDraw(&grlibContext, "HX8357D", -1, 10, 6, false);
+    for(ui32X = 0 ; ui32X < 3 ; ui32X++){
+        rect.i16XMin = 20 + 155*ui32X;
+        rect.i16XMax = rect.i16XMin + 130;
+        rect.i16YMin = 240;
+        rect.i16YMax = 300;
+        display.pfnRectFill(display.pvDisplayData, &rect, 0xC618);
+        display.pfnLineDrawH(display.pvDisplayData, rect.i16XMin, rect.i16XMax, rect.i16YMin, HX8357_BLACK);
+        display.pfnLineDrawH(display.pvDisplayData, rect.i16XMin, rect.i16XMax, rect.i16YMax, HX8357_BLACK);
+        display.pfnLineDrawV(display.pvDisplayData, rect.i16XMin, rect.i16YMin, rect.i16YMax, HX8357_BLACK);
+        display.pfnLineDrawV(display.pvDisplayData, rect.i16XMax, rect.i16YMin, rect.i16YMax, HX8357_BLACK);
+        GrStringDraw(&grlibContext, ppcButtons[ui32X], -1, rect.i16XMin + 10, 250, false);
+    }
+    GrStringDraw(&grlibContext, "Temperature 21.5", -1, 20, 100, false);
+    GrStringDraw(&grlibContext, "Humidity 40 %", -1, 20, 150, false);
+    display.pfnFlush(display.pvDisplayData);
+    // The emulator expands each color from RGB565, and cutting it down gives it back.
+    for(ui32Y = 0 ; ui32Y < 320 ; ui32Y++){
+        for(ui32X = 0 ; ui32X < 480 ; ui32X++){
+            ui32Color = Emu_pixelGet(ui32X, ui32Y);
+            pui16Pixels[ui32Y*480 + ui32X] = (((ui32Color >> 19) & 0x1F) << 11) |
+                                             (((ui32Color >> 10) & 0x3F) << 5) | ((ui32Color >> 3) & 0x1F);
+        }
+    }
+    ui32ImageBytes = RleEncode_image(pui16Pixels, 480, 320, pui8Image);
+    caseFrame();
+    display.pfnFlush(display.pvDisplayData);
+
+    Emu_statsClear();
+    RleImage_draw(&rleImage, &displayData, pui8Image, 0, 0);
+    ui32Calls = 1;
+    for(ui32Y = 0 ; ui32Y < 320 ; ui32Y++){
+        for(ui32X = 0 ; ui32X < 480 ; ui32X++){
+            ui32Color = pui16Pixels[ui32Y*480 + ui32X];
+            if(Emu_pixelGet(ui32X, ui32Y) != (((((ui32Color >> 11) & 0x1F)*255/31) << 16) |
+                                              ((((ui32Color >> 5) & 0x3F)*255/63) << 8) |
+                                              ((ui32Color & 0x1F)*255/31))){
+                ui32Mismatches++;
+            }
+        }
+    }
+    if(ui32Mismatches){
+        // Counted with what the screen didn't accept, so that the bench fails.
+        fprintf(stderr, "rle_image: %u pixels came out different\n", (unsigned)ui32Mismatches);
+        g_sEmuStats.ui32Errors += ui32Mismatches;
+    }
+}
+
+// Shapes drawn with GRLIB, and with the spans of Shapes.c. circles, lines and
+// round_rects come out the same both ways: the _spans cases draw the shapes with
+// GRLIB first, and every pixel must be the same. The colors change from shape to
+// shape, so that overlapping shapes are drawn in order.
+static void shapeColorSet(uint32_t ui32Index){
+    static const uint32_t pui32Colors[] = {0xFFFFFF, 0xFF4000, 0x00C0FF, 0x40FF40, 0xFFE000};
+    GrContextForegroundSet(&grlibContext, pui32Colors[ui32Index % 5]);
+}
+
+static void circlesDraw(bool bSpans){
+    uint32_t ui32Index;
+    for(ui32Index = 0 ; ui32Index < 20 ; ui32Index++){
+        shapeColorSet(ui32Index);
+        if(bSpans){
+            Shapes_circleFill(&displayData, &grlibContext, 40 + (ui32Index*97) % 400,
+                              40 + (ui32Index*61) % 240, 5 + 5*ui32Index);
+        }
+        else {
+            GrCircleFill(&grlibContext, 40 + (ui32Index*97) % 400, 40 + (ui32Index*61) % 240,
+                         5 + 5*ui32Index);
+        }
+        ui32Calls++;
+    }
+}
+
+static void linesDraw(bool bSpans){
+    uint32_t ui32Index;
+    for(ui32Index = 0 ; ui32Index < 100 ; ui32Index++){
+        shapeColorSet(ui32Index);
+        if(bSpans){
+            Shapes_lineDraw(&displayData, &grlibContext, (ui32Index*37) % 480, (ui32Index*23) % 320,
+                            (ui32Index*53 + 100) % 480, (ui32Index*71 + 50) % 320, 1);
+        }
+        else {
+            GrLineDraw(&grlibContext, (ui32Index*37) % 480, (ui32Index*23) % 320,
+                       (ui32Index*53 + 100) % 480, (ui32Index*71 + 50) % 320);
+        }
+        ui32Calls++;
+    }
+}
+
+// Twelve buttons with rounded corners. GRLIB has no rounded rectangle, so they are
+// drawn as two crossing rectangles and a circle in each corner.
+static void roundRectsDraw(bool bSpans){
+    uint32_t ui32Index;
+    tRectangle rect, part;
+    for(ui32Index = 0 ; ui32Index < 12 ; ui32Index++){
+        shapeColorSet(ui32Index);
+        rect.i16XMin = 10 + 118*(ui32Index % 4);
+        rect.i16XMax = rect.i16XMin + 100 - 1;
+        rect.i16YMin = 20 + 100*(ui32Index/4);
+        rect.i16YMax = rect.i16YMin + 60 - 1;
+        if(bSpans){
+            Shapes_roundRectFill(&displayData, &grlibContext, &rect, 12);
+            ui32Calls++;
+            continue;
+        }
+        part = rect;
+        part.i16YMin += 12;
+        part.i16YMax -= 12;
+        GrRectFill(&grlibContext, &part);
+        part = rect;
+        part.i16XMin += 12;
+        part.i16XMax -= 12;
+        GrRectFill(&grlibContext, &part);
+        GrCircleFill(&grlibContext, rect.i16XMin + 12, rect.i16YMin + 12, 12);
+        GrCircleFill(&grlibContext, rect.i16XMax - 12, rect.i16YMin + 12, 12);
+        GrCircleFill(&grlibContext, rect.i16XMin + 12, rect.i16YMax - 12, 12);
+        GrCircleFill(&grlibContext, rect.i16XMax - 12, rect.i16YMax - 12, 12);
+        ui32Calls += 6;
+    }
+}
+
+static void caseCirclesGrlib(void){
+    circlesDraw(false);
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+}
+
+static void caseCirclesSpans(void){
+    shapesCompare("circles_spans", circlesDraw);
+}
+
+static void caseLinesGrlib(void){
+    linesDraw(false);
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+}
+
+static void caseLinesSpans(void){
+    shapesCompare("lines_spans", linesDraw);
+}
+
+static void caseRoundRectsGrlib(void){
+    roundRectsDraw(false);
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+}
+
+static void caseRoundRectsSpans(void){
+    shapesCompare("round_rects_spans", roundRectsDraw);
+}
+
+// Lines 2 to 12 pixels wide, and the arcs of six gauges. GRLIB has neither, so the
+// _grlib cases draw the same pixels the best way it can: one GrLineDrawH for each
+// run of pixels on a row of each shape, read back from what Shapes.c drew.
+static void thickLineDraw(uint32_t ui32Index){
+    Shapes_lineDraw(&displayData, &grlibContext, 20 + (ui32Index*37) % 440, 20 + (ui32Index*23) % 280,
+                    20 + (ui32Index*53 + 100) % 440, 20 + (ui32Index*71 + 50) % 280, 2 + ui32Index % 11);
+}
+
+static void arcDraw(uint32_t ui32Index){
+    Shapes_arcFill(&displayData, &grlibContext, 80 + 160*(ui32Index % 3), 85 + 150*(ui32Index/3),
+                   70, 14, 135, 135 + 45*(ui32Index + 1));
+}
+
+static void spansDraw(void (*pfnDraw)(uint32_t), uint32_t ui32Count){
+    uint32_t ui32Index;
+    for(ui32Index = 0 ; ui32Index < ui32Count ; ui32Index++){
+        shapeColorSet(ui32Index);
+        pfnDraw(ui32Index);
+        ui32Calls++;
+    }
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+}
+
+static void rowRunsDraw(void (*pfnDraw)(uint32_t), uint32_t ui32Count){
+    static struct
+    {
+        uint16_t ui16Shape, ui16Y, ui16X1, ui16X2;
+    }
+    psRuns[16384];
+    uint32_t ui32NumRuns = 0, ui32Index, ui32X, ui32Y;
+
+    // Each shape on its own, to find its runs
+    for(ui32Index = 0 ; ui32Index < ui32Count ; ui32Index++){
+        caseFrame();
+        display.pfnFlush(display.pvDisplayData);
+        pfnDraw(ui32Index);
+        for(ui32Y = 0 ; ui32Y < 320 ; ui32Y++){
+            for(ui32X = 0 ; ui32X < 480 ; ui32X++){
+                if((Emu_pixelGet(ui32X, ui32Y) == 0) || (ui32NumRuns == 16384)){
+                    continue;
+                }
+                psRuns[ui32NumRuns].ui16Shape = ui32Index;
+                psRuns[ui32NumRuns].ui16Y = ui32Y;
+                psRuns[ui32NumRuns].ui16X1 = ui32X;
+                while((ui32X + 1 < 480) && Emu_pixelGet(ui32X + 1, ui32Y)){
+                    ui32X++;
+                }
+                psRuns[ui32NumRuns++].ui16X2 = ui32X;
+            }
+        }
+    }
+    caseFrame();
+    display.pfnFlush(display.pvDisplayData);
+
+    Emu_statsClear();
+    ui32Calls = 0;
+    for(ui32Index = 0 ; ui32Index < ui32NumRuns ; ui32Index++){
+        shapeColorSet(psRuns[ui32Index].ui16Shape);
+        GrLineDrawH(&grlibContext, psRuns[ui32Index].ui16X1, psRuns[ui32Index].ui16X2,
+                    psRuns[ui32Index].ui16Y);
+        ui32Calls++;
+    }
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+}
+
+static void caseThickLinesGrlib(void){
+    rowRunsDraw(thickLineDraw, 40);
+}
+
+static void caseThickLinesSpans(void){
+    spansDraw(thickLineDraw, 40);
+}
+
+static void caseArcsGrlib(void){
+    rowRunsDraw(arcDraw, 6);
+}
+
+static void caseArcsSpans(void){
+    spansDraw(arcDraw, 6);
+}
+
+// The background of a dashboard: gradients from top to bottom and from left to
+// right, and hatched panels, one of them clipped. The _lines cases draw them the way
+// it is done with GRLIB, one LineDrawH per row or LineDrawV per column of a gradient,
+// and a RectFill and one LineDrawH per run of a pattern. The _fill cases draw the same
+// pixels with Fills.c, and check every pixel against the _lines drawing.
+static const struct
+{
+    tRectangle sRect;
+    uint32_t ui32Color0;
+    uint32_t ui32Color1;
+    uint32_t ui32Direction;
+}
+benchGradients[] = {
+    {{0, 0, 479, 99}, 0x102040, 0x4080FF, FILLS_TOP_TO_BOTTOM},
+    {{0, 100, 479, 219}, 0xFF2000, 0x20FF40, FILLS_LEFT_TO_RIGHT},
+    {{20, 230, 459, 309}, 0xE0E0E0, 0x606060, FILLS_TOP_TO_BOTTOM},
+    {{470, 230, 470, 309}, 0xFF8000, 0x0000FF, FILLS_TOP_TO_BOTTOM}, // One pixel wide
+};
+
+static const uint8_t pui8Diagonal[8] = {0xC0, 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x81};
+static const uint8_t pui8Grid[8] = {0xFF, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80};
+
+// Channels of a gradient at position ui32Pos of ui32Length, the nearest to the exact
+// blend, see Fills.c.
+static uint32_t gradientColorGet(uint32_t ui32Color0, uint32_t ui32Color1, uint32_t ui32Length,
+                                 uint32_t ui32Pos){
+    uint32_t ui32Den = ui32Length > 1 ? ui32Length - 1 : 1;
+    uint32_t ui32Shift, ui32Color = 0;
+    for(ui32Shift = 0 ; ui32Shift < 24 ; ui32Shift += 8){
+        ui32Color |= ((((ui32Color0 >> ui32Shift) & 0xFF)*(ui32Den - ui32Pos) +
+                       ((ui32Color1 >> ui32Shift) & 0xFF)*ui32Pos + ui32Den/2)/ui32Den) << ui32Shift;
+    }
+    return ui32Color;
+}
+
+static void gradientsDraw(bool bFill){
+    const tRectangle *psRect;
+    uint32_t ui32Index;
+    int32_t i32Pos;
+
+    for(ui32Index = 0 ; ui32Index < sizeof(benchGradients)/sizeof(benchGradients[0]) ; ui32Index++){
+        psRect = &benchGradients[ui32Index].sRect;
+        if(bFill){
+            Fills_gradientFill(&displayData, &grlibContext, psRect, benchGradients[ui32Index].ui32Color0,
+                               benchGradients[ui32Index].ui32Color1, benchGradients[ui32Index].ui32Direction);
+            ui32Calls++;
+        }
+        else if(benchGradients[ui32Index].ui32Direction == FILLS_TOP_TO_BOTTOM){
+            for(i32Pos = psRect->i16YMin ; i32Pos <= psRect->i16YMax ; i32Pos++){
+                GrContextForegroundSet(&grlibContext,
+                                       gradientColorGet(benchGradients[ui32Index].ui32Color0,
+                                                        benchGradients[ui32Index].ui32Color1,
+                                                        psRect->i16YMax - psRect->i16YMin + 1,
+                                                        i32Pos - psRect->i16YMin));
+                GrLineDrawH(&grlibContext, psRect->i16XMin, psRect->i16XMax, i32Pos);
+                ui32Calls++;
+            }
+        }
+        else {
+            for(i32Pos = psRect->i16XMin ; i32Pos <= psRect->i16XMax ; i32Pos++){
+                GrContextForegroundSet(&grlibContext,
+                                       gradientColorGet(benchGradients[ui32Index].ui32Color0,
+                                                        benchGradients[ui32Index].ui32Color1,
+                                                        psRect->i16XMax - psRect->i16XMin + 1,
+                                                        i32Pos - psRect->i16XMin));
+                GrLineDrawV(&grlibContext, i32Pos, psRect->i16YMin, psRect->i16YMax);
+                ui32Calls++;
+            }
+        }
+    }
+}
+
+// A pattern in the colors of the context, lined up with the screen
+static void patternDraw(bool bFill, const tRectangle *psRect, const uint8_t *pui8Pattern){
+    uint32_t ui32Foreground = grlibContext.ui32Foreground;
+    int32_t i32X, i32Y, i32Run;
+
+    if(bFill){
+        Fills_patternFill(&displayData, &grlibContext, psRect, pui8Pattern);
+        ui32Calls++;
+        return;
+    }
+    grlibContext.ui32Foreground = grlibContext.ui32Background;
+    GrRectFill(&grlibContext, psRect);
+    grlibContext.ui32Foreground = ui32Foreground;
+    ui32Calls++;
+    for(i32Y = psRect->i16YMin ; i32Y <= psRect->i16YMax ; i32Y++){
+        for(i32X = psRect->i16XMin ; i32X <= psRect->i16XMax ; i32X += i32Run + 1){
+            for(i32Run = 0 ; (i32X + i32Run <= psRect->i16XMax) &&
+                             (pui8Pattern[i32Y & 7] & (0x80 >> ((i32X + i32Run) & 7))) ; i32Run++){
+            }
+            if(i32Run){
+                GrLineDrawH(&grlibContext, i32X, i32X + i32Run - 1, i32Y);
+                ui32Calls++;
+            }
+        }
+    }
+}
+
+static void hatchDraw(bool bFill){
+    tRectangle sRect = {0, 0, 479, 319};
+    tRectangle sClip = {200, 250, 300, 300};
+
+    GrContextForegroundSet(&grlibContext, 0x505860);
+    GrContextBackgroundSet(&grlibContext, 0x202428);
+    patternDraw(bFill, &sRect, pui8Diagonal);
+    GrContextForegroundSet(&grlibContext, 0x80C0FF);
+    GrContextBackgroundSet(&grlibContext, 0x003060);
+    sRect.i16XMin = 100;
+    sRect.i16YMin = 80;
+    sRect.i16XMax = 379;
+    sRect.i16YMax = 239;
+    patternDraw(bFill, &sRect, pui8Grid);
+    sRect.i16XMin = 390;
+    sRect.i16XMax = 390;
+    patternDraw(bFill, &sRect, pui8Diagonal);
+    sRect.i16XMin = 150;
+    sRect.i16YMin = 240;
+    sRect.i16XMax = 470;
+    sRect.i16YMax = 319;
+    GrContextClipRegionSet(&grlibContext, &sClip);
+    patternDraw(bFill, &sRect, pui8Diagonal);
+    sRect.i16XMin = 0;
+    sRect.i16YMin = 0;
+    sRect.i16XMax = 479;
+    sRect.i16YMax = 319;
+    GrContextClipRegionSet(&grlibContext, &sRect);
+    GrContextBackgroundSet(&grlibContext, 0);
+}
+
+static void caseGradientsLines(void){
+    gradientsDraw(false);
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+}
+
+static void caseGradientsFill(void){
+    shapesCompare("gradients_fill", gradientsDraw);
+}
+
+static void caseHatchLines(void){
+    hatchDraw(false);
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+}
+
+static void caseHatchFill(void){
+    shapesCompare("hatch_fill", hatchDraw);
+}
+
+// A 50x50 ball with a save-under, bouncing like the rectangle of DRAW_RECTANGLE_TEST,
+// and a 32x32 ring without one, moving the other way under it, over a checkerboard.
+// calls is the number of moves, and every pixel is checked after each of them.
+#define BALL_SIZE 50
+#define RING_SIZE 32
+#define SPRITE_KEY 0xF81F
+
+static uint16_t checkerGet(int32_t i32X, int32_t i32Y){
+    return ((i32X/20 + i32Y/20) & 1) ? 0x2945 : 0x5AEB;
+}
+
+static void checkerRow(void *pvArg, int32_t i32X, int32_t i32Y, uint32_t ui32Count,
+                       uint16_t *pui16Pixels){
+    uint16_t ui16Color;
+    while(ui32Count--){
+        ui16Color = checkerGet(i32X++, i32Y);
+        *pui16Pixels++ = HX8357_SWAP16(ui16Color);
+    }
+}
+
+// Color the emulator returns for an RGB565 color
+static uint32_t emuColorGet(uint16_t ui16Color){
+    return (((((ui16Color >> 11) & 0x1F)*255/31) << 16) | ((((ui16Color >> 5) & 0x3F)*255/63) << 8) |
+            ((ui16Color & 0x1F)*255/31));
+}
+
+// Compare the screen with the checkerboard and the sprites on top of it.
+static uint32_t spritesCheck(void){
+    const tSprite *psSprite;
+    uint32_t ui32X, ui32Y, ui32Id, ui32Mismatches = 0;
+    uint16_t ui16Color, ui16Pixel;
+
+    for(ui32Y = 0 ; ui32Y < 320 ; ui32Y++){
+        for(ui32X = 0 ; ui32X < 480 ; ui32X++){
+            ui16Color = checkerGet(ui32X, ui32Y);
+            for(ui32Id = 0 ; ui32Id < SPRITES_COUNT ; ui32Id++){
+                psSprite = &sprites.psSprites[ui32Id];
+                if(!psSprite->bVisible || ((int32_t)ui32X < psSprite->i16X) ||
+                   ((int32_t)ui32Y < psSprite->i16Y) ||
+                   ((int32_t)ui32X >= psSprite->i16X + psSprite->ui16Width) ||
+                   ((int32_t)ui32Y >= psSprite->i16Y + psSprite->ui16Height)){
+                    continue;
+                }
+                ui16Pixel = psSprite->pui16Bitmap[(ui32Y - psSprite->i16Y)*psSprite->ui16Width +
+                                                  ui32X - psSprite->i16X];
+                if(ui16Pixel != psSprite->ui16Key){
+                    ui16Color = ui16Pixel;
+                }
+            }
+            if(Emu_pixelGet(ui32X, ui32Y) != emuColorGet(ui16Color)){
+                ui32Mismatches++;
+            }
+        }
+    }
+    return ui32Mismatches;
+}
+
+static void caseSpriteMove(void){
+    static uint16_t pui16Ball[BALL_SIZE*BALL_SIZE], pui16BallUnder[BALL_SIZE*BALL_SIZE];
+    static uint16_t pui16Ring[RING_SIZE*RING_SIZE];
+    int16_t i16X = 0, i16Y = 0, i16SpeedX = 5, i16SpeedY = 4;
+    int16_t i16RingX = 400, i16RingY = 20, i16RingSpeedX = -3, i16RingSpeedY = 2;
+    int32_t i32X, i32Y, i32Dist;
+    uint32_t ui32Frame, ui32Mismatches = 0;
+    uint32_t pui32Chunks[2] = {0, 0};
+    uint16_t pui16Row[2][480];
+    tRectangle rect;
+
+    for(i32Y = 0 ; i32Y < BALL_SIZE ; i32Y++){
+        for(i32X = 0 ; i32X < BALL_SIZE ; i32X++){
+            i32Dist = (2*i32X + 1 - BALL_SIZE)*(2*i32X + 1 - BALL_SIZE) +
+                      (2*i32Y + 1 - BALL_SIZE)*(2*i32Y + 1 - BALL_SIZE);
+            pui16Ball[i32Y*BALL_SIZE + i32X] = (i32Dist <= BALL_SIZE*BALL_SIZE) ?
+                                               (0xF800 | ((63 - i32Y) << 5) | (i32X/2)) : SPRITE_KEY;
+        }
+    }
+    for(i32Y = 0 ; i32Y < RING_SIZE ; i32Y++){
+        for(i32X = 0 ; i32X < RING_SIZE ; i32X++){
+            i32Dist = (2*i32X + 1 - RING_SIZE)*(2*i32X + 1 - RING_SIZE) +
+                      (2*i32Y + 1 - RING_SIZE)*(2*i32Y + 1 - RING_SIZE);
+            pui16Ring[i32Y*RING_SIZE + i32X] = ((i32Dist <= RING_SIZE*RING_SIZE) && (i32Dist >= 20*20)) ?
+                                               0x07FF : SPRITE_KEY;
+        }
+    }
+
+    // The screen must show the background first.
+    rect.i16XMin = 0;
+    rect.i16XMax = 480 - 1;
+    rect.i16YMin = 0;
+    rect.i16YMax = 320 - 1;
+    HX8357_streamBegin(&displayData, &rect);
+    for(i32Y = 0 ; i32Y < 320 ; i32Y++){
+        HX8357_streamWait(&displayData, pui32Chunks[i32Y & 1]);
+        checkerRow(NULL, 0, i32Y, 480, pui16Row[i32Y & 1]);
+        pui32Chunks[i32Y & 1] = 0;
+        pui32Chunks[(i32Y & 1) ^ 1] += HX8357_streamWrite(&displayData, pui16Row[i32Y & 1], 2*480);
+    }
+    HX8357_streamEnd(&displayData);
+
+    Sprites_init(&sprites, &displayData, 480, 320, 0);
+    Sprites_backgroundSet(&sprites, checkerRow, NULL);
+    Sprites_set(&sprites, 0, pui16Ring, RING_SIZE, RING_SIZE, SPRITE_KEY, NULL);
+    Sprites_set(&sprites, 1, pui16Ball, BALL_SIZE, BALL_SIZE, SPRITE_KEY, pui16BallUnder);
+    Emu_statsClear();
+    for(ui32Frame = 0 ; ui32Frame < 100 ; ui32Frame++){
+        // Turn around where the ball would go off the screen, like in main.c
+        if((i16X + i16SpeedX < 0) || (i16X + i16SpeedX + BALL_SIZE >= 480 - 1)){
+            i16SpeedX = -i16SpeedX;
+        }
+        else {
+            i16X += i16SpeedX;
+        }
+        if((i16Y + i16SpeedY < 0) || (i16Y + i16SpeedY + BALL_SIZE >= 320 - 1)){
+            i16SpeedY = -i16SpeedY;
+        }
+        else {
+            i16Y += i16SpeedY;
+        }
+        Sprites_move(&sprites, 1, i16X, i16Y);
+        // The ring goes partly off the screen at the edges.
+        if((i16RingX + i16RingSpeedX < -RING_SIZE/2) || (i16RingX + i16RingSpeedX > 480 - RING_SIZE/2)){
+            i16RingSpeedX = -i16RingSpeedX;
+        }
+        if((i16RingY + i16RingSpeedY < -RING_SIZE/2) || (i16RingY + i16RingSpeedY > 320 - RING_SIZE/2)){
+            i16RingSpeedY = -i16RingSpeedY;
+        }
+        i16RingX += i16RingSpeedX;
+        i16RingY += i16RingSpeedY*9;
+        Sprites_move(&sprites, 0, i16RingX, i16RingY);
+        ui32Calls += 2;
+        ui32Mismatches += spritesCheck();
+    }
+    // Moving up with the save-under, and hiding
+    for(ui32Frame = 0 ; ui32Frame < 20 ; ui32Frame++){
+        Sprites_move(&sprites, 1, i16X - ui32Frame, i16Y - 3*ui32Frame);
+        ui32Calls++;
+        ui32Mismatches += spritesCheck();
+    }
+    Sprites_hide(&sprites, 1);
+    Sprites_hide(&sprites, 0);
+    ui32Calls += 2;
+    ui32Mismatches += spritesCheck();
+    ui32Moves = ui32Calls;
+    if(ui32Mismatches){
+        fprintf(stderr, "sprite_move: %u pixels came out different\n", (unsigned)ui32Mismatches);
+        g_sEmuStats.ui32Errors += ui32Mismatches;
+    }
+}
+
+static const struct
+{
+    const char *pcName;
+    void (*pfnRun)(void);
+}
+benchCases[] = {
+    {"frame_clear", caseFrame},
+    {"pixel_draw", casePixelDraw},
+    {"line_draw_h", caseLineDrawH},
+    {"line_draw_v", caseLineDrawV},
+    {"rect_fill_50x50", caseRectFillSmall},
+    {"rect_fill_full", caseRectFillFull},
+    {"fill_kernel", caseFillKernel},
+    {"string_draw_cmtt38", caseStringDraw},
+    {"string_draw_cached", caseStringDrawCached},
+    {"string_draw_aa", caseStringDrawAa},
+    {"terminal_scroll", caseTerminalScroll},
+    {"uart_burst", caseUartBurst},
+    {"display_list_bounce", caseDisplayListBounce},
+    {"rle_image", caseRleImage},
+    {"circles_grlib", caseCirclesGrlib},
+    {"circles_spans", caseCirclesSpans},
+    {"lines_grlib", caseLinesGrlib},
+    {"lines_spans", caseLinesSpans},
+    {"round_rects_grlib", caseRoundRectsGrlib},
+    {"round_rects_spans", caseRoundRectsSpans},
+    {"thick_lines_grlib", caseThickLinesGrlib},
+    {"thick_lines_spans", caseThickLinesSpans},
+    {"arcs_grlib", caseArcsGrlib},
+    {"arcs_spans", caseArcsSpans},
+    {"gradients_lines", caseGradientsLines},
+    {"gradients_fill", caseGradientsFill},
+    {"hatch_lines", caseHatchLines},
+    {"hatch_fill", caseHatchFill},
+    {"sprite_move", caseSpriteMove},
+};
+
+// Set the size of the screen, and set up what depends on it again.
+static void screenSizeSet(uint16_t ui16Width, uint16_t ui16Height){
+    display.ui16Width = ui16Width;
+    display.ui16Height = ui16Height;
+    if(benchMode == MODE_FRAME_BUFFER){
+        FrameBuffer_init(&frameBuffer, &displayData, ui16Width, ui16Height);
+    }
+    GrContextInit(&grlibContext, &display);
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+    GrContextBackgroundSet(&grlibContext, 0);
+    GrContextFontSet(&grlibContext, &g_sFontCmtt38);
+    GrStringCodepageSet(&grlibContext, CODEPAGE_ISO8859_1);
+}
+
+static void displaySetup(tBenchMode mode, SPI_Handle spi){
+    Task_Params renderTaskParams;
+
+    benchMode = mode;
+    HX8357_initDisplayData(&displayData, spi);
+    display.i32Size = sizeof(tDisplay);
+    switch(mode){
+    case MODE_QUEUE:
+        DisplayQueue_init(&displayQueue, &displayData);
+        Task_Params_init(&renderTaskParams);
+        renderTaskParams.arg0 = (UArg)&displayQueue;
+        Task_construct(&renderTaskStruct, (Task_FuncPtr)DisplayQueue_renderTask,
+                       &renderTaskParams, NULL);
+        display.pvDisplayData = &displayQueue;
+        display.pfnPixelDraw = &QueuedPixelDraw;
+        display.pfnPixelDrawMultiple = &QueuedPixelDrawMultiple;
+        display.pfnLineDrawV = &QueuedLineDrawV;
+        display.pfnLineDrawH = &QueuedLineDrawH;
+        display.pfnRectFill = &QueuedRectFill;
+        display.pfnColorTranslate = &QueuedColorTranslate;
+        display.pfnFlush = &QueuedFlush;
+        break;
+    case MODE_FRAME_BUFFER:
+        display.pvDisplayData = &frameBuffer;
+        display.pfnPixelDraw = &FbPixelDraw;
+        display.pfnPixelDrawMultiple = &FbPixelDrawMultiple;
+        display.pfnLineDrawV = &FbLineDrawV;
+        display.pfnLineDrawH = &FbLineDrawH;
+        display.pfnRectFill = &FbRectFill;
+        display.pfnColorTranslate = &FbColorTranslate;
+        display.pfnFlush = &FbFlush;
+        break;
+    default:
+        display.pvDisplayData = &displayData;
+        display.pfnPixelDraw = &PixelDraw;
+        display.pfnPixelDrawMultiple = &PixelDrawMultiple;
+        display.pfnLineDrawV = &LineDrawV;
+        display.pfnLineDrawH = &LineDrawH;
+        display.pfnRectFill = &RectFill;
+        display.pfnColorTranslate = &ColorTranslate;
+        display.pfnFlush = &Flush;
+        break;
+    }
+    screenSizeSet(480, 320);
+    GlyphCache_init(&glyphCache, &displayData);
+}
+
+static void usage(void){
+    fprintf(stderr, "Usage: bench [-m direct|fb|queue] [-r bitrate] [-t transfer_ns] [-g gpio_ns]\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]){
+    tBenchMode mode = MODE_DIRECT;
+    uint32_t ui32Case, ui32WireUs, ui32EstUs;
+    uint32_t ui32TotalErrors = 0;
+    SPI_Params spiParams;
+    SPI_Handle spi;
+    int i;
+
+    for(i = 1 ; i < argc ; i++){
+        if((argv[i][0] != '-') || (i + 1 >= argc)){
+            usage();
+        }
+        switch(argv[i][1]){
+        case 'm':
+            i++;
+            for(mode = MODE_DIRECT ; mode <= MODE_QUEUE ; mode++){
+                if(strcmp(argv[i], modeNames[mode]) == 0){
+                    break;
+                }
+            }
+            if(mode > MODE_QUEUE){
+                usage();
+            }
+            break;
+        case 'r':
+            ui32BitRate = strtoul(argv[++i], NULL, 0);
+            break;
+        case 't':
+            ui32TransferNs = strtoul(argv[++i], NULL, 0);
+            break;
+        case 'g':
+            ui32GpioNs = strtoul(argv[++i], NULL, 0);
+            break;
+        default:
+            usage();
+        }
+    }
+    if(ui32BitRate == 0){
+        usage();
+    }
+
+    Emu_reset();
+    SPI_Params_init(&spiParams);
+    spiParams.bitRate = ui32BitRate;
+#if HX8357_SPI_STREAMING
+    spiParams.transferMode = SPI_MODE_CALLBACK;
+    spiParams.transferCallbackFxn = HX8357_spiCallback;
+#endif
+    spi = SPI_open(0, &spiParams);
+    HX8357_init(spi);
+    displaySetup(mode, spi);
+
+    printf("{\n  \"mode\": \"%s\",\n  \"spi_streaming\": %d,\n  \"bit_rate\": %u,\n",
+           modeNames[mode], HX8357_SPI_STREAMING, (unsigned)ui32BitRate);
+    printf("  \"transfer_ns\": %u,\n  \"gpio_ns\": %u,\n  \"cases\": [\n",
+           (unsigned)ui32TransferNs, (unsigned)ui32GpioNs);
+    for(ui32Case = 0 ; ui32Case < sizeof(benchCases)/sizeof(benchCases[0]) ; ui32Case++){
+        // Start each case from a cleared screen, so they don't depend on each other.
+        caseFrame();
+        display.pfnFlush(display.pvDisplayData);
+        Emu_statsClear();
+        ui32Calls = 0;
+        ui32Chars = 0;
+        ui32ImageBytes = 0;
+        ui32Moves = 0;
+        ui32TermBytes = 0;
+        ui32FillKernelRate = 0;
+        benchCases[ui32Case].pfnRun();
+        display.pfnFlush(display.pvDisplayData);
+
+        ui32WireUs = Emu_wireTimeUs(ui32BitRate);
+        ui32EstUs = estUsGet();
+        ui32TotalErrors += g_sEmuStats.ui32Errors;
+        printf("    {\"name\": \"%s\", \"calls\": %u, \"pixels\": %llu, \"bytes\": %llu, "
+               "\"spi_transfers\": %u, \"commands\": %u, \"cs_toggles\": %u, \"dc_toggles\": %u, "
+               "\"wire_us\": %u, \"est_us\": %u, \"chars_per_s\": %u, \"errors\": %u",
+               benchCases[ui32Case].pcName, (unsigned)ui32Calls,
+               (unsigned long long)g_sEmuStats.ui64Pixels,
+               (unsigned long long)g_sEmuStats.ui64Bytes,
+               (unsigned)g_sEmuStats.ui32Transfers, (unsigned)g_sEmuStats.ui32Commands,
+               (unsigned)(2*g_sEmuStats.ui32CsSessions), (unsigned)g_sEmuStats.ui32DcToggles,
+               (unsigned)ui32WireUs, (unsigned)ui32EstUs,
+               (unsigned)(ui32EstUs ? (uint64_t)ui32Chars*1000000/ui32EstUs : 0),
+               (unsigned)g_sEmuStats.ui32Errors);
+        if(ui32ImageBytes){
+            // Compression of the image, and pixels drawn per second on the target
+            printf(", \"image_bytes\": %u, \"compression\": %.1f, \"pixels_per_s\": %u",
+                   (unsigned)ui32ImageBytes, 2.0*g_sEmuStats.ui64Pixels/ui32ImageBytes,
+                   (unsigned)(ui32EstUs ? g_sEmuStats.ui64Pixels*1000000/ui32EstUs : 0));
+        }
+        if(ui32FillKernelRate){
+            // Measured on the host, unlike everything else
+            printf(", \"fill_kernel_mpixels_per_s\": %u, \"fill_loop_mpixels_per_s\": %u, "
+                   "\"fill_memset_mpixels_per_s\": %u", (unsigned)ui32FillKernelRate,
+                   (unsigned)ui32FillLoopRate, (unsigned)ui32FillMemsetRate);
+        }
+        if(ui32TermBytes){
+            // Draw calls and CS toggles per byte written to the terminal
+            printf(", \"draws_per_byte\": %.3f, \"cs_toggles_per_byte\": %.2f",
+                   (double)ui32TermDraws/ui32TermBytes, 2.0*g_sEmuStats.ui32CsSessions/ui32TermBytes);
+        }
+        if(ui32Moves){
+            printf(", \"moves_per_s\": %u", (unsigned)(ui32EstUs ? (uint64_t)ui32Moves*1000000/ui32EstUs : 0));
+        }
+        printf("}%s\n", ui32Case + 1 < sizeof(benchCases)/sizeof(benchCases[0]) ? "," : "");
+    }
+    printf("  ]\n}\n");
+    if(ui32TotalErrors){
+        fprintf(stderr, "%u errors, last: %s\n", (unsigned)ui32TotalErrors, Emu_lastError());
+    }
+    return ui32TotalErrors ? 1 : 0;
+}
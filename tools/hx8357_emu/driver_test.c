@@ -0,0 +1,921 @@
+/*
+ * driver_test.c
+ *
+ *  Tests of the HX8357 driver against the emulated screen. Each test draws
+ *  something known, and checks the bytes sent to the screen, the commands
+ *  counted by the emulator or the pixels that end up on it. What doesn't match
+ *  is printed on stderr.
+ *
+ *  Usage: driver_test [test ...]
+ *  Runs the tests named, or all of them. The exit code is 1 if any check failed.
+ */
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <xdc/std.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/drivers/SPI.h>
+#include "ADAFRUIT_2050.h"
+#include "DisplayList.h"
+#include "DisplayQueue.h"
+#include "FrameBuffer.h"
+#include "hx8357_emu.h"
+
+// Bit rate the SPI is opened with in main.c
+#define TEST_SPI_BITRATE 20000000
+// Longest byte stream a test checks
+#define TEST_LOG_BYTES 4096
+
+static tDisplayData displayData;
+static const char *pcTestName;
+static uint32_t ui32Failures;
+
+// Bytes sent to the screen, and the bytes they should be, see Emu_logStart.
+static uint16_t pui16Log[TEST_LOG_BYTES];
+static uint16_t pui16Expected[TEST_LOG_BYTES];
+static uint32_t ui32NumExpected;
+
+// Command counts when commandsMark was last called
+static uint32_t pui32Marked[256];
+
+// Pixel data and palettes for PixelDrawMultiple, filled with made-up values by main.
+static uint8_t pui8Bitmap[512];
+static uint8_t pui8Palette[256*3];
+
+// Count a failed check and print what went wrong. Returns bOk.
+static bool check(bool bOk, const char *pcFormat, ...){
+    va_list args;
+    if(!bOk){
+        ui32Failures++;
+        fprintf(stderr, "%s: ", pcTestName);
+        va_start(args, pcFormat);
+        vfprintf(stderr, pcFormat, args);
+        va_end(args);
+        fputc('\n', stderr);
+    }
+    return bOk;
+}
+
+// RGB565 of a 24-bit color, worked out here and not with ColorTranslate so that
+// the driver is checked against something else.
+static uint16_t rgb565(uint32_t ui32Red, uint32_t ui32Green, uint32_t ui32Blue){
+    return ((ui32Red >> 3) << 11) | ((ui32Green >> 2) << 5) | (ui32Blue >> 3);
+}
+
+// RGB565 of entry ui32Index of a GRLIB palette (blue, green and red bytes).
+static uint16_t paletteGet(const uint8_t *pui8Pal, uint32_t ui32Index){
+    return rgb565(pui8Pal[3*ui32Index + 2], pui8Pal[3*ui32Index + 1], pui8Pal[3*ui32Index]);
+}
+
+// The 24-bit color the emulator shows for an RGB565 pixel
+static uint32_t rgb24(uint16_t ui16Color){
+    return ((((ui16Color >> 11) & 0x1F)*255/31) << 16) | ((((ui16Color >> 5) & 0x3F)*255/63) << 8) |
+           ((ui16Color & 0x1F)*255/31);
+}
+
+// Build the expected byte stream
+static void expectCommand(uint8_t ui8Command){
+    if(ui32NumExpected < TEST_LOG_BYTES){
+        pui16Expected[ui32NumExpected] = EMU_LOG_COMMAND | ui8Command;
+    }
+    ui32NumExpected++;
+}
+
+static void expectByte(uint8_t ui8Byte){
+    if(ui32NumExpected < TEST_LOG_BYTES){
+        pui16Expected[ui32NumExpected] = ui8Byte;
+    }
+    ui32NumExpected++;
+}
+
+static void expectPixel(uint16_t ui16Color){
+    expectByte(ui16Color >> 8);
+    expectByte(ui16Color & 0xFF);
+}
+
+// CASET and PASET for columns ui32X1..ui32X2 and rows ui32Y1..ui32Y2
+static void expectWindow(uint32_t ui32X1, uint32_t ui32X2, uint32_t ui32Y1, uint32_t ui32Y2){
+    expectCommand(HX8357_CASET);
+    expectPixel(ui32X1);
+    expectPixel(ui32X2);
+    expectCommand(HX8357_PASET);
+    expectPixel(ui32Y1);
+    expectPixel(ui32Y2);
+}
+
+static void commandsMark(void){
+    memcpy(pui32Marked, g_sEmuStats.pui32CommandCount, sizeof(pui32Marked));
+}
+
+// Times ui8Command was sent since commandsMark
+static uint32_t commandsGet(uint8_t ui8Command){
+    return g_sEmuStats.pui32CommandCount[ui8Command] - pui32Marked[ui8Command];
+}
+
+// Check the CASET, PASET and RAMWR sent since commandsMark.
+static void commandsCheck(const char *pcWhat, uint32_t ui32Caset, uint32_t ui32Paset,
+                          uint32_t ui32Ramwr){
+    check((commandsGet(HX8357_CASET) == ui32Caset) && (commandsGet(HX8357_PASET) == ui32Paset) &&
+          (commandsGet(HX8357_RAMWR) == ui32Ramwr),
+          "%s: %u CASET, %u PASET and %u RAMWR instead of %u, %u and %u", pcWhat,
+          (unsigned)commandsGet(HX8357_CASET), (unsigned)commandsGet(HX8357_PASET),
+          (unsigned)commandsGet(HX8357_RAMWR), (unsigned)ui32Caset, (unsigned)ui32Paset,
+          (unsigned)ui32Ramwr);
+}
+
+static void logStart(void){
+    ui32NumExpected = 0;
+    Emu_logStart(pui16Log, TEST_LOG_BYTES);
+}
+
+// Stop the log and compare it with the expected bytes.
+static void logCheck(const char *pcWhat){
+    uint32_t ui32Sent = Emu_logStop();
+    uint32_t ui32Index;
+
+    if(!check(ui32Sent == ui32NumExpected, "%s: %u bytes sent instead of %u", pcWhat,
+              (unsigned)ui32Sent, (unsigned)ui32NumExpected)){
+        return;
+    }
+    for(ui32Index = 0 ; (ui32Index < ui32Sent) && (ui32Index < TEST_LOG_BYTES) ; ui32Index++){
+        if(!check(pui16Log[ui32Index] == pui16Expected[ui32Index], "%s: byte %u is %03X, not %03X",
+                  pcWhat, (unsigned)ui32Index, pui16Log[ui32Index], pui16Expected[ui32Index])){
+            return;
+        }
+    }
+}
+
+// One run of PixelDrawMultiple: the address window, RAMWR and the pixels, in one CS
+// session, with the window not known beforehand.
+static void pixelsCheck(int32_t i32X, int32_t i32Y, int32_t i32X0, int32_t i32Count, int32_t i32BPP){
+    uint32_t pui32Palette1[2];
+    uint32_t ui32Sessions = g_sEmuStats.ui32CsSessions;
+    uint32_t ui32Pixel, ui32Index;
+    char pcWhat[64];
+
+    // Two colors with different bytes, already translated for 1 bpp
+    pui32Palette1[0] = 0x1234;
+    pui32Palette1[1] = 0xF81F;
+
+    displayData.bWindowValid = false;
+    logStart();
+    PixelDrawMultiple(&displayData, i32X, i32Y, i32X0, i32Count, i32BPP, pui8Bitmap,
+                      i32BPP == 1 ? (const uint8_t *)pui32Palette1 : pui8Palette);
+    expectWindow(i32X, i32X + i32Count - 1, i32Y, i32Y);
+    expectCommand(HX8357_RAMWR);
+    for(ui32Index = 0 ; ui32Index < (uint32_t)i32Count ; ui32Index++){
+        // Position in the pixel data, counted in pixels from the first byte
+        ui32Pixel = i32X0 + ui32Index;
+        switch(i32BPP){
+        case 1:
+            expectPixel(pui32Palette1[(pui8Bitmap[ui32Pixel/8] >> (7 - ui32Pixel%8)) & 1]);
+            break;
+        case 4:
+            expectPixel(paletteGet(pui8Palette, (pui8Bitmap[ui32Pixel/2] >> ((ui32Pixel & 1) ? 0 : 4)) & 0xF));
+            break;
+        default:
+            expectPixel(paletteGet(pui8Palette, pui8Bitmap[ui32Pixel]));
+            break;
+        }
+    }
+    snprintf(pcWhat, sizeof(pcWhat), "%d bpp at (%d, %d) from %d, %d pixels", (int)i32BPP,
+             (int)i32X, (int)i32Y, (int)i32X0, (int)i32Count);
+    logCheck(pcWhat);
+    check(g_sEmuStats.ui32CsSessions == ui32Sessions + 1, "%s: %u CS sessions", pcWhat,
+          (unsigned)(g_sEmuStats.ui32CsSessions - ui32Sessions));
+}
+
+// PixelDrawMultiple: 1, 4 and 8 bpp, with the run starting inside a byte, odd counts,
+// and runs longer than the row buffer, both from the scratch pool and on the stack.
+static void testPixelDrawMultiple(void){
+    uint32_t ui32Granted;
+    char *pBuf;
+
+    pixelsCheck(10, 5, 0, 8, 1);
+    pixelsCheck(10, 6, 3, 13, 1);
+    pixelsCheck(0, 7, 7, 1, 1);
+    pixelsCheck(100, 8, 5, 37, 1);
+    pixelsCheck(20, 10, 0, 10, 4);
+    pixelsCheck(20, 11, 1, 7, 4);
+    pixelsCheck(479, 12, 1, 1, 4);
+    pixelsCheck(30, 20, 0, 9, 8);
+    pixelsCheck(0, 21, 0, 480, 8);
+
+    // Leave 40 bytes in the pool, i.e. two halves of 10 pixels.
+    pBuf = HX8357_scratchBorrow(&displayData, HX8357_SCRATCH_BYTES - 40, &ui32Granted);
+    pixelsCheck(5, 30, 3, 101, 1);
+    pixelsCheck(5, 31, 1, 101, 4);
+    pixelsCheck(5, 32, 0, 101, 8);
+    // And nothing, so that the stack buffer is used.
+    HX8357_scratchBorrow(&displayData, 40, &ui32Granted);
+    pixelsCheck(5, 33, 6, 57, 1);
+    pixelsCheck(5, 34, 1, 57, 4);
+    pixelsCheck(5, 35, 0, 57, 8);
+    HX8357_scratchReturn(&displayData, pBuf);
+}
+
+// The address window cache: CASET and PASET are only sent when the columns or rows
+// change, and both are sent again after MADCTL or the scroll area is set.
+static void testAddressWindow(void){
+    int32_t i32Index;
+
+    displayData.bWindowValid = false;
+    // A column of pixels: one CASET, and a PASET for each
+    commandsMark();
+    logStart();
+    for(i32Index = 0 ; i32Index < 10 ; i32Index++){
+        PixelDraw(&displayData, 40, 50 + i32Index, 0xF81F);
+        if(i32Index == 0){
+            expectWindow(40, 40, 50, 50);
+        }
+        else {
+            expectCommand(HX8357_PASET);
+            expectPixel(50 + i32Index);
+            expectPixel(50 + i32Index);
+        }
+        expectCommand(HX8357_RAMWR);
+        expectPixel(0xF81F);
+    }
+    logCheck("column of pixels");
+    commandsCheck("column of pixels", 1, 10, 10);
+    for(i32Index = 0 ; i32Index < 10 ; i32Index++){
+        check(Emu_pixelGet(40, 50 + i32Index) == 0xFF00FF, "pixel (40, %d) is %06X", 50 + i32Index,
+              (unsigned)Emu_pixelGet(40, 50 + i32Index));
+    }
+
+    // A row of pixels: a CASET for each, and one PASET
+    commandsMark();
+    for(i32Index = 0 ; i32Index < 10 ; i32Index++){
+        PixelDraw(&displayData, 41 + i32Index, 60, 0x07E0);
+    }
+    commandsCheck("row of pixels", 10, 1, 10);
+
+    // The same pixel again and again
+    commandsMark();
+    for(i32Index = 0 ; i32Index < 10 ; i32Index++){
+        PixelDraw(&displayData, 50, 60, 0x001F);
+    }
+    commandsCheck("same pixel", 0, 0, 10);
+
+    // Lines in the same column, of the same length
+    commandsMark();
+    for(i32Index = 0 ; i32Index < 4 ; i32Index++){
+        LineDrawV(&displayData, 70, 100, 139, 0xFFE0);
+    }
+    commandsCheck("same vertical line", 1, 1, 4);
+
+    // MADCTL and the scroll area make the screen window unknown.
+    HX8357_orientationSet(&displayData, HX8357_LANDSCAPE);
+    commandsMark();
+    PixelDraw(&displayData, 50, 60, 0x001F);
+    commandsCheck("pixel after MADCTL", 1, 1, 1);
+    HX8357_scrollAreaSet(&displayData, 0, HX8357_TFTHEIGHT);
+    commandsMark();
+    PixelDraw(&displayData, 50, 60, 0x001F);
+    commandsCheck("pixel after VSCRDEF", 1, 1, 1);
+    check(Emu_pixelGet(50, 60) == 0x0000FF, "pixel (50, 60) is %06X", (unsigned)Emu_pixelGet(50, 60));
+}
+
+// Check that the pixels in psRect are ui16Color and the ones around it ui16Around.
+static void rectCheck(const char *pcWhat, const tRectangle *psRect, uint16_t ui16Color,
+                      uint16_t ui16Around){
+    int32_t i32X, i32Y;
+    uint32_t ui32Expected;
+    bool bInside;
+
+    for(i32Y = psRect->i16YMin - 1 ; i32Y <= psRect->i16YMax + 1 ; i32Y++){
+        for(i32X = psRect->i16XMin - 1 ; i32X <= psRect->i16XMax + 1 ; i32X++){
+            if((i32X < 0) || (i32X >= 480) || (i32Y < 0) || (i32Y >= 320)){
+                continue;
+            }
+            bInside = (i32X >= psRect->i16XMin) && (i32X <= psRect->i16XMax) &&
+                      (i32Y >= psRect->i16YMin) && (i32Y <= psRect->i16YMax);
+            ui32Expected = rgb24(bInside ? ui16Color : ui16Around);
+            if(!check(Emu_pixelGet(i32X, i32Y) == ui32Expected, "%s: pixel (%d, %d) is %06X, not %06X",
+                      pcWhat, (int)i32X, (int)i32Y, (unsigned)Emu_pixelGet(i32X, i32Y),
+                      (unsigned)ui32Expected)){
+                return;
+            }
+        }
+    }
+}
+
+// The fill kernel and the drawing functions built on it, with colors whose two bytes
+// differ (which memset got wrong), odd lengths and starts that aren't word aligned.
+static void testFillColor(void){
+    static const uint16_t pui16Colors[] = {0x1234, 0xF81F, 0x07E0, 0xA5C3};
+    static const int32_t pi32Sizes[] = {1, 2, 3, 7, 8, 9, 17, 33, 479};
+    uint16_t pui16Buf[80];
+    uint8_t *pui8Buf = (uint8_t *)pui16Buf;
+    uint32_t ui32Color, ui32Offset, ui32Count, ui32Index;
+    tRectangle sRect;
+    char pcWhat[64];
+    bool bOk;
+
+    for(ui32Color = 0 ; ui32Color < sizeof(pui16Colors)/sizeof(pui16Colors[0]) ; ui32Color++){
+        for(ui32Offset = 0 ; ui32Offset < 4 ; ui32Offset++){
+            for(ui32Count = 0 ; ui32Count <= 64 ; ui32Count++){
+                memset(pui16Buf, 0xEE, sizeof(pui16Buf));
+                HX8357_fillColor(&pui16Buf[ui32Offset], pui16Colors[ui32Color], ui32Count);
+                for(ui32Index = 0 ; ui32Index < sizeof(pui16Buf)/2 ; ui32Index++){
+                    if((ui32Index >= ui32Offset) && (ui32Index < ui32Offset + ui32Count)){
+                        // In the byte order of the screen, most significant first
+                        bOk = (pui8Buf[2*ui32Index] == pui16Colors[ui32Color] >> 8) &&
+                              (pui8Buf[2*ui32Index + 1] == (pui16Colors[ui32Color] & 0xFF));
+                    }
+                    else {
+                        bOk = pui16Buf[ui32Index] == 0xEEEE;
+                    }
+                    if(!check(bOk, "fillColor %04X at %u, %u pixels: pixel %u is %02X%02X",
+                              pui16Colors[ui32Color], (unsigned)ui32Offset, (unsigned)ui32Count,
+                              (unsigned)ui32Index, pui8Buf[2*ui32Index], pui8Buf[2*ui32Index + 1])){
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    sRect.i16XMin = 0;
+    sRect.i16YMin = 0;
+    sRect.i16XMax = 479;
+    sRect.i16YMax = 319;
+    RectFill(&displayData, &sRect, 0);
+    for(ui32Index = 0 ; ui32Index < sizeof(pi32Sizes)/sizeof(pi32Sizes[0]) ; ui32Index++){
+        ui32Color = pui16Colors[ui32Index % 4];
+        // Rectangles of odd and even sizes, starting on odd columns
+        sRect.i16XMin = 1 + (ui32Index & 1);
+        sRect.i16YMin = 5 + 30*(ui32Index % 5);
+        sRect.i16XMax = sRect.i16XMin + pi32Sizes[ui32Index] - 1;
+        sRect.i16YMax = sRect.i16YMin + ui32Index*3;
+        RectFill(&displayData, &sRect, ui32Color);
+        snprintf(pcWhat, sizeof(pcWhat), "RectFill %d wide", (int)pi32Sizes[ui32Index]);
+        rectCheck(pcWhat, &sRect, ui32Color, 0);
+        RectFill(&displayData, &sRect, 0);
+
+        // And lines of the same lengths
+        LineDrawH(&displayData, sRect.i16XMin, sRect.i16XMax, 300, ui32Color);
+        sRect.i16YMin = sRect.i16YMax = 300;
+        snprintf(pcWhat, sizeof(pcWhat), "LineDrawH %d long", (int)pi32Sizes[ui32Index]);
+        rectCheck(pcWhat, &sRect, ui32Color, 0);
+        RectFill(&displayData, &sRect, 0);
+        if(pi32Sizes[ui32Index] < 300){
+            LineDrawV(&displayData, 470, 3, 3 + pi32Sizes[ui32Index] - 1, ui32Color);
+            sRect.i16XMin = sRect.i16XMax = 470;
+            sRect.i16YMin = 3;
+            sRect.i16YMax = 3 + pi32Sizes[ui32Index] - 1;
+            snprintf(pcWhat, sizeof(pcWhat), "LineDrawV %d long", (int)pi32Sizes[ui32Index]);
+            rectCheck(pcWhat, &sRect, ui32Color, 0);
+            RectFill(&displayData, &sRect, 0);
+        }
+    }
+}
+
+// Pattern of the stream test, different for every pixel of a row and every row.
+static uint16_t streamPixel(int32_t i32X, int32_t i32Y){
+    return (uint16_t)(i32X*37 + i32Y*1031 + 0x5A5A);
+}
+
+// Rows streamed from two line buffers, each filled again as soon as streamWait says
+// it has been sent. The SPI of the emulator reads a buffer when the transfer is done,
+// so filling one too early shows up as wrong pixels. Then a rectangle with rectWrite,
+// which queues all rows back to back and must wait for them before returning.
+static void testStream(void){
+    static uint16_t pui16Rect[480*8];
+    uint8_t *pui8Rect = (uint8_t *)pui16Rect;
+    uint8_t pui8Lines[2][480*2];
+    uint32_t pui32After[2] = {0, 0};
+    uint32_t ui32Chunks;
+    int32_t i32X, i32Y;
+    tRectangle sRect;
+    uint16_t ui16Color;
+
+    sRect.i16XMin = 0;
+    sRect.i16XMax = 479;
+    sRect.i16YMin = 20;
+    sRect.i16YMax = 59;
+    HX8357_streamBegin(&displayData, &sRect);
+    for(i32Y = sRect.i16YMin ; i32Y <= sRect.i16YMax ; i32Y++){
+        // Wait until the chunks of the row last in this buffer are sent, which is
+        // when no more than the ones queued after it are pending.
+        HX8357_streamWait(&displayData, pui32After[i32Y & 1]);
+        for(i32X = 0 ; i32X < 480 ; i32X++){
+            ui16Color = streamPixel(i32X, i32Y);
+            pui8Lines[i32Y & 1][2*i32X] = ui16Color >> 8;
+            pui8Lines[i32Y & 1][2*i32X + 1] = ui16Color & 0xFF;
+        }
+        ui32Chunks = HX8357_streamWrite(&displayData, pui8Lines[i32Y & 1], sizeof(pui8Lines[0]));
+        pui32After[i32Y & 1] = 0;
+        pui32After[(i32Y & 1) ^ 1] += ui32Chunks;
+    }
+    HX8357_streamEnd(&displayData);
+
+    for(i32Y = 0 ; i32Y < 8 ; i32Y++){
+        for(i32X = 0 ; i32X < 480 ; i32X++){
+            // In the byte order of the screen
+            ui16Color = streamPixel(i32X, i32Y + 100);
+            pui8Rect[2*(480*i32Y + i32X)] = ui16Color >> 8;
+            pui8Rect[2*(480*i32Y + i32X) + 1] = ui16Color & 0xFF;
+        }
+    }
+    sRect.i16YMin = 100;
+    sRect.i16YMax = 107;
+    HX8357_rectWrite(&displayData, &sRect, pui16Rect, 480);
+
+    for(i32Y = 20 ; i32Y <= 107 ; i32Y++){
+        if((i32Y >= 60) && (i32Y < 100)){
+            continue;
+        }
+        for(i32X = 0 ; i32X < 480 ; i32X++){
+            ui16Color = streamPixel(i32X, i32Y);
+            if(!check(Emu_pixelGet(i32X, i32Y) == rgb24(ui16Color), "pixel (%d, %d) is %06X, not %06X",
+                      (int)i32X, (int)i32Y, (unsigned)Emu_pixelGet(i32X, i32Y),
+                      (unsigned)rgb24(ui16Color))){
+                return;
+            }
+        }
+    }
+}
+
+// The TE thread of the vsync test pulses TE every refresh while bTeOn is set.
+static volatile bool bTeOn;
+static volatile bool bTeThreadRun;
+
+static void *teThread(void *pvArg){
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    while(bTeThreadRun){
+        ts.tv_nsec += HX8357_REFRESH_US*1000;
+        if(ts.tv_nsec >= 1000000000){
+            ts.tv_nsec -= 1000000000;
+            ts.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        if(bTeOn){
+            Emu_teTick();
+        }
+    }
+    return NULL;
+}
+
+// Wait for ui32Frames refreshes ui32Count times, and return the time it took in us.
+static uint32_t vsyncRun(uint32_t ui32Count, uint32_t ui32Frames){
+    struct timespec ts0, ts1;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts0);
+    while(ui32Count--){
+        HX8357_vsyncWait(ui32Frames);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts1);
+    return (ts1.tv_sec - ts0.tv_sec)*1000000 + (ts1.tv_nsec - ts0.tv_nsec)/1000;
+}
+
+// Vsync with TE pulsing, then a frame that takes too long, then without TE, where the
+// refreshes are estimated, and with TE again. The host isn't real time, so the times
+// are only checked to within a few ms.
+static void testVsync(void){
+    pthread_t thread;
+    tFrameStats sStats;
+    uint32_t ui32Us, ui32NumTe, ui32Missed;
+
+    bTeOn = true;
+    bTeThreadRun = true;
+    pthread_create(&thread, NULL, teThread, NULL);
+    HX8357_vsyncInit();
+
+    ui32Us = vsyncRun(20, 1);
+    HX8357_frameStatsGet(&sStats);
+    check(sStats.bTeActive, "TE not used while pulsing");
+    check(sStats.ui32NumFrames == 20, "%u frames, not 20", (unsigned)sStats.ui32NumFrames);
+    check(sStats.ui32NumTe >= 20, "%u TE pulses for 20 frames", (unsigned)sStats.ui32NumTe);
+    check((sStats.ui32RefreshUs > HX8357_REFRESH_US - 1000) && (sStats.ui32RefreshUs < HX8357_REFRESH_US + 1000),
+          "refresh measured as %u us", (unsigned)sStats.ui32RefreshUs);
+    check((ui32Us > 19*HX8357_REFRESH_US) && (ui32Us < 21*HX8357_REFRESH_US + 5000),
+          "20 frames with TE took %u us", (unsigned)ui32Us);
+    ui32Us = vsyncRun(5, 2);
+    check((ui32Us > 9*HX8357_REFRESH_US) && (ui32Us < 10*HX8357_REFRESH_US + 5000),
+          "5 frames of 2 refreshes took %u us", (unsigned)ui32Us);
+
+    // A frame three refreshes long, when one was asked for
+    HX8357_frameStatsGet(&sStats);
+    ui32Missed = sStats.ui32NumMissed;
+    usleep(3*HX8357_REFRESH_US);
+    HX8357_vsyncWait(1);
+    HX8357_frameStatsGet(&sStats);
+    check(sStats.ui32NumMissed >= ui32Missed + 2, "%u refreshes missed by a slow frame",
+          (unsigned)(sStats.ui32NumMissed - ui32Missed));
+    check(sStats.ui32LastFrameUs > 3*HX8357_REFRESH_US, "slow frame took %u us",
+          (unsigned)sStats.ui32LastFrameUs);
+
+    // Without TE, the first wait times out and the rest are paced by the estimate.
+    bTeOn = false;
+    HX8357_vsyncWait(1);
+    HX8357_frameStatsGet(&sStats);
+    check(!sStats.bTeActive, "TE still used without pulses");
+    ui32NumTe = sStats.ui32NumTe;
+    ui32Us = vsyncRun(20, 1);
+    HX8357_frameStatsGet(&sStats);
+    check(!sStats.bTeActive, "TE used again without pulses");
+    check(sStats.ui32NumTe == ui32NumTe, "%u TE pulses without pulsing",
+          (unsigned)(sStats.ui32NumTe - ui32NumTe));
+    check((ui32Us > 19*HX8357_REFRESH_US) && (ui32Us < 21*HX8357_REFRESH_US + 5000),
+          "20 estimated frames took %u us", (unsigned)ui32Us);
+    check((sStats.ui32LastFrameUs > HX8357_REFRESH_US - 3000) && (sStats.ui32LastFrameUs < HX8357_REFRESH_US + 3000),
+          "estimated frame took %u us", (unsigned)sStats.ui32LastFrameUs);
+
+    // Two pulses a refresh apart are enough for TE to be used again.
+    bTeOn = true;
+    vsyncRun(5, 1);
+    HX8357_frameStatsGet(&sStats);
+    check(sStats.bTeActive, "TE not used again when pulsing");
+    check(sStats.ui32NumFrames == 52, "%u frames, not 52", (unsigned)sStats.ui32NumFrames);
+    ui32Us = vsyncRun(10, 1);
+    check((ui32Us > 9*HX8357_REFRESH_US) && (ui32Us < 11*HX8357_REFRESH_US + 5000),
+          "10 frames with TE again took %u us", (unsigned)ui32Us);
+
+    bTeThreadRun = false;
+    pthread_join(thread, NULL);
+}
+
+// The display queue and its render task, shared by the tests that use them.
+static tDisplayQueue displayQueue;
+static Task_Struct renderTaskStruct;
+static bool bQueueStarted;
+
+// Set up the display queue and start its render task, the first time only.
+static void queueStart(void){
+    Task_Params renderTaskParams;
+
+    if(bQueueStarted){
+        return;
+    }
+    DisplayQueue_init(&displayQueue, &displayData);
+    Task_Params_init(&renderTaskParams);
+    renderTaskParams.arg0 = (UArg)&displayQueue;
+    Task_construct(&renderTaskStruct, (Task_FuncPtr)DisplayQueue_renderTask,
+                   &renderTaskParams, NULL);
+    bQueueStarted = true;
+}
+
+// Rows of the dither test
+#define DITHER_Y    200
+#define DITHER_ROWS 6
+
+// Draw the 8 bpp runs of the dither test with pfnDraw, on cleared rows, and copy what
+// ends up on the screen to pui32Pixels. pfnFlush, if any, is called before reading.
+static void ditherDraw(void *pvDraw, void (*pfnDraw)(void *, int32_t, int32_t, int32_t, int32_t,
+                                                   int32_t, const uint8_t *, const uint8_t *),
+                       void (*pfnFlush)(void *), uint32_t pui32Pixels[DITHER_ROWS][480]){
+    tRectangle sRect;
+    int32_t i32X, i32Row;
+
+    sRect.i16XMin = 0;
+    sRect.i16YMin = DITHER_Y;
+    sRect.i16XMax = 479;
+    sRect.i16YMax = DITHER_Y + DITHER_ROWS - 1;
+    RectFill(&displayData, &sRect, 0);
+    for(i32Row = 0 ; i32Row < DITHER_ROWS ; i32Row++){
+        // Longer than a run of the display queue, and starting at odd and even columns
+        pfnDraw(pvDraw, 3 + 17*i32Row, DITHER_Y + i32Row, 0, 300 + 13*i32Row, 8,
+                &pui8Bitmap[i32Row], pui8Palette);
+    }
+    if(pfnFlush != NULL){
+        pfnFlush(pvDraw);
+    }
+    for(i32Row = 0 ; i32Row < DITHER_ROWS ; i32Row++){
+        for(i32X = 0 ; i32X < 480 ; i32X++){
+            pui32Pixels[i32Row][i32X] = Emu_pixelGet(i32X, DITHER_Y + i32Row);
+        }
+    }
+}
+
+// Compare the pixels of the dither test drawn one way with the direct ones.
+static void ditherCheck(const char *pcWhat, uint32_t pui32Pixels[DITHER_ROWS][480],
+                        uint32_t pui32Direct[DITHER_ROWS][480]){
+    int32_t i32X, i32Row;
+
+    for(i32Row = 0 ; i32Row < DITHER_ROWS ; i32Row++){
+        for(i32X = 0 ; i32X < 480 ; i32X++){
+            if(!check(pui32Pixels[i32Row][i32X] == pui32Direct[i32Row][i32X],
+                      "%s: pixel (%d, %d) is %06X, not %06X as drawn directly", pcWhat,
+                      (int)i32X, (int)(DITHER_Y + i32Row), (unsigned)pui32Pixels[i32Row][i32X],
+                      (unsigned)pui32Direct[i32Row][i32X])){
+                return;
+            }
+        }
+    }
+}
+
+// 8 bpp images with dithering on, drawn through the frame buffer and the display
+// queue, must come out the same as drawn directly by PixelDrawMultiple.
+static void testDither(void){
+    static tFrameBuffer frameBuffer;
+    static uint32_t pui32Direct[DITHER_ROWS][480];
+    static uint32_t pui32Pixels[DITHER_ROWS][480];
+    uint32_t ui32Differ = 0;
+    int32_t i32X, i32Row;
+
+    FrameBuffer_init(&frameBuffer, &displayData, 480, 320);
+    queueStart();
+
+    // Without dithering first, to make sure the dither changes something.
+    ditherDraw(&displayData, PixelDrawMultiple, NULL, pui32Pixels);
+    HX8357_ditherSet(&displayData, true);
+    ditherDraw(&displayData, PixelDrawMultiple, NULL, pui32Direct);
+    for(i32Row = 0 ; i32Row < DITHER_ROWS ; i32Row++){
+        for(i32X = 0 ; i32X < 480 ; i32X++){
+            ui32Differ += pui32Pixels[i32Row][i32X] != pui32Direct[i32Row][i32X];
+        }
+    }
+    check(ui32Differ > 0, "dithering changes no pixels");
+
+    ditherDraw(&frameBuffer, FbPixelDrawMultiple, FbFlush, pui32Pixels);
+    ditherCheck("frame buffer", pui32Pixels, pui32Direct);
+    ditherDraw(&displayQueue, QueuedPixelDrawMultiple, QueuedFlush, pui32Pixels);
+    ditherCheck("display queue", pui32Pixels, pui32Direct);
+    HX8357_ditherSet(&displayData, false);
+}
+
+// Rows of the payload part of the display queue test
+#define QUEUE_Y    100
+#define QUEUE_ROWS 16
+
+// Expected color of pixel ui32Pixel of the payload part of the display queue test,
+// counted from the first byte of pui8Data.
+static uint16_t queuePixel(const uint8_t *pui8Data, int32_t i32BPP, uint32_t ui32Pixel){
+    if(i32BPP == 4){
+        return paletteGet(pui8Palette, (pui8Data[ui32Pixel/2] >> ((ui32Pixel & 1) ? 0 : 4)) & 0xF);
+    }
+    return paletteGet(pui8Palette, pui8Data[ui32Pixel]);
+}
+
+// The display queue with its render task: fills next to each other are merged into
+// one command, a fence is only passed once everything before it is on the screen, and
+// PixelDrawMultiple runs come out right when the payload buffer wraps around.
+static void testDisplayQueue(void){
+    static const uint16_t pui16Colors[] = {0x1234, 0xF81F};
+    tRectangle sRect, sFull;
+    uint32_t ui32Queued, ui32Coalesced, ui32Fence, ui32Index;
+    const uint8_t *pui8Data;
+    int32_t i32X, i32X0, i32Count, i32BPP, i32Row, i32Pixel;
+    uint32_t ui32Expected;
+    UInt key;
+
+    queueStart();
+    HX8357_ditherSet(&displayData, false);
+
+    sFull.i16XMin = 0;
+    sFull.i16YMin = 0;
+    sFull.i16XMax = 479;
+    sFull.i16YMax = 319;
+    RectFill(&displayData, &sFull, 0);
+
+    // Coalescing. The render task can't take commands while the tasks are disabled,
+    // so every fill after the first is merged into the last command.
+    DisplayQueue_sync(&displayQueue);
+    ui32Queued = displayQueue.ui32NumQueued;
+    ui32Coalesced = displayQueue.ui32NumCoalesced;
+    key = Task_disable();
+    for(i32Row = 0 ; i32Row < 10 ; i32Row++){
+        QueuedLineDrawH(&displayQueue, 20, 119, 30 + i32Row, 0x1234);
+    }
+    for(i32X = 0 ; i32X < 8 ; i32X++){
+        QueuedPixelDraw(&displayQueue, 200 + i32X, 50, 0xF81F);
+    }
+    Task_restore(key);
+    DisplayQueue_sync(&displayQueue);
+    // Plus one for the fence of DisplayQueue_sync
+    check(displayQueue.ui32NumQueued - ui32Queued == 3, "%u commands queued, not 3",
+          (unsigned)(displayQueue.ui32NumQueued - ui32Queued));
+    check(displayQueue.ui32NumCoalesced - ui32Coalesced == 16, "%u fills merged, not 16",
+          (unsigned)(displayQueue.ui32NumCoalesced - ui32Coalesced));
+    sRect.i16XMin = 20;
+    sRect.i16YMin = 30;
+    sRect.i16XMax = 119;
+    sRect.i16YMax = 39;
+    rectCheck("merged lines", &sRect, 0x1234, 0);
+    sRect.i16XMin = 200;
+    sRect.i16YMin = 50;
+    sRect.i16XMax = 207;
+    sRect.i16YMax = 50;
+    rectCheck("merged pixels", &sRect, 0xF81F, 0);
+
+    // Fences. Whole screen fills in different colors, so none of them are merged and
+    // the render task still has plenty to draw when the fence is waited for.
+    key = Task_disable();
+    for(ui32Index = 0 ; ui32Index < 8 ; ui32Index++){
+        QueuedRectFill(&displayQueue, &sFull, pui16Colors[ui32Index & 1]);
+    }
+    ui32Fence = DisplayQueue_fenceInsert(&displayQueue);
+    check(!DisplayQueue_fencePassed(&displayQueue, ui32Fence), "fence passed before drawing");
+    Task_restore(key);
+    DisplayQueue_fenceWait(&displayQueue, ui32Fence);
+    sRect.i16XMin = 1;
+    sRect.i16YMin = 1;
+    sRect.i16XMax = 478;
+    sRect.i16YMax = 318;
+    rectCheck("after the fence", &sRect, pui16Colors[1], pui16Colors[1]);
+
+    // Payload wrap around. Run lengths that don't divide the payload buffer, some of
+    // them longer than half of it so they are split, at 8 and 4 bpp.
+    sRect.i16XMin = 0;
+    sRect.i16YMin = QUEUE_Y;
+    sRect.i16XMax = 479;
+    sRect.i16YMax = QUEUE_Y + QUEUE_ROWS - 1;
+    RectFill(&displayData, &sRect, 0);
+    for(i32Row = 0 ; i32Row < QUEUE_ROWS ; i32Row++){
+        i32BPP = i32Row < 12 ? 8 : 4;
+        i32X0 = i32BPP == 4 ? i32Row & 1 : 0;
+        i32Count = i32BPP == 4 ? 301 : 200 + (i32Row*37) % 90;
+        QueuedPixelDrawMultiple(&displayQueue, 7*i32Row, QUEUE_Y + i32Row, i32X0, i32Count,
+                                i32BPP, &pui8Bitmap[17*i32Row], pui8Palette);
+    }
+    DisplayQueue_sync(&displayQueue);
+    for(i32Row = 0 ; i32Row < QUEUE_ROWS ; i32Row++){
+        i32BPP = i32Row < 12 ? 8 : 4;
+        i32X0 = i32BPP == 4 ? i32Row & 1 : 0;
+        i32Count = i32BPP == 4 ? 301 : 200 + (i32Row*37) % 90;
+        pui8Data = &pui8Bitmap[17*i32Row];
+        for(i32Pixel = 0 ; i32Pixel < i32Count ; i32Pixel++){
+            i32X = 7*i32Row + i32Pixel;
+            ui32Expected = rgb24(queuePixel(pui8Data, i32BPP, i32X0 + i32Pixel));
+            if(!check(Emu_pixelGet(i32X, QUEUE_Y + i32Row) == ui32Expected,
+                      "%d bpp: pixel (%d, %d) is %06X, not %06X", (int)i32BPP, (int)i32X,
+                      (int)(QUEUE_Y + i32Row), (unsigned)Emu_pixelGet(i32X, QUEUE_Y + i32Row),
+                      (unsigned)ui32Expected)){
+                break;
+            }
+        }
+    }
+}
+
+// Frames of the display list test, and how often the screen is checked
+#define LIST_FRAMES 400
+#define LIST_CHECK  50
+
+// Next number of the display list test, from the same LCG as main.
+static uint32_t listRandom(uint32_t *pui32Seed, uint32_t ui32Range){
+    *pui32Seed = *pui32Seed*1103515245 + 12345;
+    return (*pui32Seed >> 16) % ui32Range;
+}
+
+// The display list repaints only the damage: random nodes (rectangles and lines at
+// any angle, some partly off the screen, and removes) are updated for LIST_FRAMES frames,
+// and every LIST_CHECK frames the screen must match a full repaint pixel for pixel.
+static void testDisplayList(void){
+    static tDisplayList displayList;
+    static uint32_t pui32Screen[320][480];
+    tDisplay sDisplay;
+    tRectangle sRect, sFull;
+    uint32_t ui32Seed = 1, ui32Frame, ui32Update, ui32Updates, ui32Id;
+    int32_t i32X, i32Y;
+    bool bSame;
+
+    memset(&sDisplay, 0, sizeof(sDisplay));
+    sDisplay.i32Size = sizeof(tDisplay);
+    sDisplay.pvDisplayData = &displayData;
+    sDisplay.ui16Width = 480;
+    sDisplay.ui16Height = 320;
+    sDisplay.pfnPixelDraw = PixelDraw;
+    sDisplay.pfnPixelDrawMultiple = PixelDrawMultiple;
+    sDisplay.pfnLineDrawH = LineDrawH;
+    sDisplay.pfnLineDrawV = LineDrawV;
+    sDisplay.pfnRectFill = RectFill;
+    sDisplay.pfnColorTranslate = ColorTranslate;
+    sDisplay.pfnFlush = Flush;
+    sFull.i16XMin = 0;
+    sFull.i16YMin = 0;
+    sFull.i16XMax = 479;
+    sFull.i16YMax = 319;
+
+    DisplayList_init(&displayList, &sDisplay, 0x0841);
+    DisplayList_damage(&displayList, &sFull);
+    DisplayList_render(&displayList);
+    for(ui32Frame = 1 ; ui32Frame <= LIST_FRAMES ; ui32Frame++){
+        // Up to 12 updates, so that the damage is merged now and then
+        ui32Updates = 1 + listRandom(&ui32Seed, 12);
+        for(ui32Update = 0 ; ui32Update < ui32Updates ; ui32Update++){
+            ui32Id = listRandom(&ui32Seed, DISPLAYLIST_NODES);
+            switch(listRandom(&ui32Seed, 5)){
+            case 0:
+                DisplayList_remove(&displayList, ui32Id);
+                break;
+            case 1:
+            case 2:
+                // Short, as lines at an angle are drawn a pixel at a time
+                i32X = listRandom(&ui32Seed, 480);
+                i32Y = listRandom(&ui32Seed, 320);
+                DisplayList_lineSet(&displayList, ui32Id, i32X, i32Y,
+                                    i32X + (int32_t)listRandom(&ui32Seed, 81) - 40,
+                                    i32Y + (int32_t)listRandom(&ui32Seed, 81) - 40,
+                                    listRandom(&ui32Seed, 0x10000));
+                break;
+            default:
+                sRect.i16XMin = (int32_t)listRandom(&ui32Seed, 520) - 20;
+                sRect.i16YMin = (int32_t)listRandom(&ui32Seed, 360) - 20;
+                sRect.i16XMax = sRect.i16XMin + listRandom(&ui32Seed, 100);
+                sRect.i16YMax = sRect.i16YMin + listRandom(&ui32Seed, 80);
+                DisplayList_rectSet(&displayList, ui32Id, &sRect, listRandom(&ui32Seed, 0x10000));
+                break;
+            }
+        }
+        DisplayList_render(&displayList);
+        if(ui32Frame % LIST_CHECK != 0){
+            continue;
+        }
+        for(i32Y = 0 ; i32Y < 320 ; i32Y++){
+            for(i32X = 0 ; i32X < 480 ; i32X++){
+                pui32Screen[i32Y][i32X] = Emu_pixelGet(i32X, i32Y);
+            }
+        }
+        DisplayList_damage(&displayList, &sFull);
+        DisplayList_render(&displayList);
+        bSame = true;
+        for(i32Y = 0 ; bSame && (i32Y < 320) ; i32Y++){
+            for(i32X = 0 ; bSame && (i32X < 480) ; i32X++){
+                bSame = check(pui32Screen[i32Y][i32X] == Emu_pixelGet(i32X, i32Y),
+                              "frame %u: pixel (%d, %d) is %06X, not %06X as repainted",
+                              (unsigned)ui32Frame, (int)i32X, (int)i32Y,
+                              (unsigned)pui32Screen[i32Y][i32X], (unsigned)Emu_pixelGet(i32X, i32Y));
+            }
+        }
+    }
+    // Both ways of adding damage must have been used.
+    check(displayList.ui32NumMerges > 0, "the damage was never merged");
+    check(displayList.ui32NumRects > displayList.ui32NumRenders,
+          "%u rectangles repainted in %u renders, the damage was never cut up",
+          (unsigned)displayList.ui32NumRects, (unsigned)displayList.ui32NumRenders);
+}
+
+static const struct
+{
+    const char *pcName;
+    void (*pfnRun)(void);
+}
+testCases[] = {
+    {"pixel_draw_multiple", testPixelDrawMultiple},
+    {"address_window", testAddressWindow},
+    {"fill_color", testFillColor},
+    {"stream", testStream},
+    {"vsync", testVsync},
+    {"dither", testDither},
+    {"display_queue", testDisplayQueue},
+    {"display_list", testDisplayList},
+};
+
+int main(int argc, char *argv[]){
+    uint32_t ui32Case, ui32Index, ui32Seed = 1;
+    uint32_t ui32Failed = 0, ui32Run = 0;
+    SPI_Params spiParams;
+    SPI_Handle spi;
+    bool bRun;
+    int i;
+
+    for(ui32Index = 0 ; ui32Index < sizeof(pui8Bitmap) ; ui32Index++){
+        ui32Seed = ui32Seed*1103515245 + 12345;
+        pui8Bitmap[ui32Index] = ui32Seed >> 16;
+    }
+    for(ui32Index = 0 ; ui32Index < sizeof(pui8Palette) ; ui32Index++){
+        ui32Seed = ui32Seed*1103515245 + 12345;
+        pui8Palette[ui32Index] = ui32Seed >> 16;
+    }
+
+    Emu_reset();
+    SPI_Params_init(&spiParams);
+    spiParams.bitRate = TEST_SPI_BITRATE;
+#if HX8357_SPI_STREAMING
+    spiParams.transferMode = SPI_MODE_CALLBACK;
+    spiParams.transferCallbackFxn = HX8357_spiCallback;
+#endif
+    spi = SPI_open(0, &spiParams);
+    HX8357_init(spi);
+    HX8357_initDisplayData(&displayData, spi);
+    HX8357_orientationSet(&displayData, HX8357_LANDSCAPE);
+
+    for(ui32Case = 0 ; ui32Case < sizeof(testCases)/sizeof(testCases[0]) ; ui32Case++){
+        bRun = argc < 2;
+        for(i = 1 ; i < argc ; i++){
+            if(strcmp(argv[i], testCases[ui32Case].pcName) == 0){
+                bRun = true;
+            }
+        }
+        if(!bRun){
+            continue;
+        }
+        pcTestName = testCases[ui32Case].pcName;
+        ui32Failures = 0;
+        Emu_statsClear();
+        testCases[ui32Case].pfnRun();
+        check(g_sEmuStats.ui32Errors == 0, "%u errors on the screen, last: %s",
+              (unsigned)g_sEmuStats.ui32Errors, Emu_lastError());
+        printf("%s: %s\n", pcTestName, ui32Failures ? "FAILED" : "ok");
+        ui32Failed += ui32Failures ? 1 : 0;
+        ui32Run++;
+    }
+    printf("%u of %u tests failed\n", (unsigned)ui32Failed, (unsigned)ui32Run);
+    return ui32Failed ? 1 : 0;
+}
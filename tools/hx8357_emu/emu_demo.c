@@ -0,0 +1,177 @@
+/*
+ * emu_demo.c
+ *
+ *  Runs the HX8357 driver against the emulated screen: init, then the same kind
+ *  of drawing as the demos in main.c, and writes the result as a PPM file
+ *  together with what was sent to the screen.
+ *
+ *  Usage: emu_demo [-fb] [file.ppm]
+ *  -fb draws through the off-screen band in FrameBuffer.c instead of directly,
+ *  which must give exactly the same picture.
+ *  Built with -DHX8357_TRACE=1 (and Trace.c), the driver trace of the drawing is
+ *  written on stderr.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <xdc/std.h>
+#include <ti/drivers/SPI.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+#include "FrameBuffer.h"
+#include "Trace.h"
+#include "hx8357_emu.h"
+
+// Bit rate the SPI is opened with in main.c, for the wire time estimate
+#define EMU_SPI_BITRATE 20000000
+
+static tDisplayData displayData;
+static tFrameBuffer frameBuffer;
+static tDisplay display;
+
+// 1 bpp test pattern for PixelDrawMultiple, an arrow pointing right.
+static const uint8_t arrow[8][2] = {
+    {0x01, 0x80}, {0x01, 0xE0}, {0x01, 0xF8}, {0xFF, 0xFE},
+    {0xFF, 0xFE}, {0x01, 0xF8}, {0x01, 0xE0}, {0x01, 0x80}
+};
+
+#if HX8357_TRACE
+static void traceWrite(void *pvArg, const char *pcText, uint32_t ui32Length){
+    fwrite(pcText, 1, ui32Length, (FILE *)pvArg);
+}
+#endif
+
+static void displaySetup(bool bFrameBuffer){
+    display.i32Size = sizeof(tDisplay);
+    display.ui16Width = 480;
+    display.ui16Height = 320;
+    if(bFrameBuffer){
+        FrameBuffer_init(&frameBuffer, &displayData, 480, 320);
+        display.pvDisplayData = &frameBuffer;
+        display.pfnPixelDraw = &FbPixelDraw;
+        display.pfnPixelDrawMultiple = &FbPixelDrawMultiple;
+        display.pfnLineDrawV = &FbLineDrawV;
+        display.pfnLineDrawH = &FbLineDrawH;
+        display.pfnRectFill = &FbRectFill;
+        display.pfnColorTranslate = &FbColorTranslate;
+        display.pfnFlush = &FbFlush;
+    }
+    else {
+        display.pvDisplayData = &displayData;
+        display.pfnPixelDraw = &PixelDraw;
+        display.pfnPixelDrawMultiple = &PixelDrawMultiple;
+        display.pfnLineDrawV = &LineDrawV;
+        display.pfnLineDrawH = &LineDrawH;
+        display.pfnRectFill = &RectFill;
+        display.pfnColorTranslate = &ColorTranslate;
+        display.pfnFlush = &Flush;
+    }
+}
+
+static void draw(void){
+    tRectangle rect;
+    uint32_t pui32Palette[2];
+    int32_t i32Index;
+
+    // Blackout
+    rect.i16XMin = 0;
+    rect.i16XMax = 480-1;
+    rect.i16YMin = 0;
+    rect.i16YMax = 320-1;
+    display.pfnRectFill(display.pvDisplayData, &rect, HX8357_BLACK);
+
+    // A row of rectangles in the primary colors
+    static const uint16_t colors[] = {HX8357_RED, HX8357_GREEN, HX8357_BLUE,
+                                      HX8357_CYAN, HX8357_MAGENTA, HX8357_YELLOW};
+    for(i32Index = 0 ; i32Index < 6 ; i32Index++){
+        rect.i16XMin = 20 + 75*i32Index;
+        rect.i16XMax = rect.i16XMin + 49;
+        rect.i16YMin = 20;
+        rect.i16YMax = 69;
+        display.pfnRectFill(display.pvDisplayData, &rect, colors[i32Index]);
+    }
+
+    // Lines and single pixels
+    display.pfnLineDrawH(display.pvDisplayData, 100, 380, 100, HX8357_YELLOW);
+    display.pfnLineDrawV(display.pvDisplayData, 100, 100, 220, HX8357_YELLOW);
+    for(i32Index = 0 ; i32Index < 280 ; i32Index += 2){
+        display.pfnPixelDraw(display.pvDisplayData, 100 + i32Index, 100 + i32Index*120/280,
+                             HX8357_WHITE);
+    }
+
+    // 1 bpp pixels, the way GRLIB draws text, in a gradient of colors
+    for(i32Index = 0 ; i32Index < 16 ; i32Index++){
+        int32_t i32Row;
+        pui32Palette[0] = display.pfnColorTranslate(display.pvDisplayData, 0x000000);
+        pui32Palette[1] = display.pfnColorTranslate(display.pvDisplayData,
+                                                    (i32Index*17) << 16 | 0x00FF00 >> (i32Index/4));
+        for(i32Row = 0 ; i32Row < 8 ; i32Row++){
+            display.pfnPixelDrawMultiple(display.pvDisplayData, 20 + 24*i32Index, 260 + i32Row,
+                                         0, 16, 1, arrow[i32Row], (const uint8_t *)pui32Palette);
+        }
+    }
+
+    display.pfnFlush(display.pvDisplayData);
+}
+
+int main(int argc, char *argv[]){
+    const char *pcFileName = "emu_demo.ppm";
+    bool bFrameBuffer = false;
+    SPI_Params spiParams;
+    SPI_Handle spi;
+    int i;
+
+    for(i = 1 ; i < argc ; i++){
+        if(strcmp(argv[i], "-fb") == 0){
+            bFrameBuffer = true;
+        }
+        else {
+            pcFileName = argv[i];
+        }
+    }
+
+    Emu_reset();
+    SPI_Params_init(&spiParams);
+    spiParams.bitRate = EMU_SPI_BITRATE;
+#if HX8357_SPI_STREAMING
+    spiParams.transferMode = SPI_MODE_CALLBACK;
+    spiParams.transferCallbackFxn = HX8357_spiCallback;
+#endif
+    spi = SPI_open(0, &spiParams);
+
+    HX8357_init(spi);
+    printf("Init: %u bytes, %u commands\n", (unsigned)g_sEmuStats.ui64Bytes,
+           (unsigned)g_sEmuStats.ui32Commands);
+
+    HX8357_initDisplayData(&displayData, spi);
+    displaySetup(bFrameBuffer);
+    Emu_statsClear();
+    Trace_init();
+    draw();
+#if HX8357_TRACE
+    Trace_dump(traceWrite, stderr);
+#endif
+
+    printf("Drawing%s:\n", bFrameBuffer ? " (frame buffer)" : "");
+    printf("  %u transfers, %llu bytes, %llu pixels\n", (unsigned)g_sEmuStats.ui32Transfers,
+           (unsigned long long)g_sEmuStats.ui64Bytes, (unsigned long long)g_sEmuStats.ui64Pixels);
+    printf("  %u commands: %u CASET, %u PASET, %u RAMWR\n", (unsigned)g_sEmuStats.ui32Commands,
+           (unsigned)g_sEmuStats.pui32CommandCount[HX8357_CASET],
+           (unsigned)g_sEmuStats.pui32CommandCount[HX8357_PASET],
+           (unsigned)g_sEmuStats.pui32CommandCount[HX8357_RAMWR]);
+    printf("  %u CS sessions, %u D/C toggles\n", (unsigned)g_sEmuStats.ui32CsSessions,
+           (unsigned)g_sEmuStats.ui32DcToggles);
+    printf("  %u us on the wire at %u Hz\n", (unsigned)Emu_wireTimeUs(EMU_SPI_BITRATE),
+           (unsigned)EMU_SPI_BITRATE);
+    if(!Emu_displayOn()){
+        printf("The display was never turned on\n");
+    }
+    if(g_sEmuStats.ui32Errors){
+        printf("%u errors, last: %s\n", (unsigned)g_sEmuStats.ui32Errors, Emu_lastError());
+    }
+    if(!Emu_ppmWrite(pcFileName)){
+        printf("Couldn't write %s\n", pcFileName);
+        return 1;
+    }
+    printf("Wrote %s\n", pcFileName);
+    return g_sEmuStats.ui32Errors ? 1 : 0;
+}
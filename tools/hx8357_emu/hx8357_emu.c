@@ -0,0 +1,387 @@
+/*
+ * hx8357_emu.c
+ *
+ *  Host emulator of the HX8357D screen, see hx8357_emu.h.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "hx8357_emu.h"
+
+// Commands that are decoded
+#define CMD_SWRESET 0x01
+#define CMD_SLPIN   0x10
+#define CMD_SLPOUT  0x11
+#define CMD_DISPOFF 0x28
+#define CMD_DISPON  0x29
+#define CMD_CASET   0x2A
+#define CMD_PASET   0x2B
+#define CMD_RAMWR   0x2C
+#define CMD_VSCRDEF 0x33
+#define CMD_MADCTL  0x36
+#define CMD_VSCRSADD 0x37
+#define CMD_COLMOD  0x3A
+#define CMD_RAMWRC  0x3C
+
+// MADCTL bits
+#define MADCTL_MY 0x80
+#define MADCTL_MX 0x40
+#define MADCTL_MV 0x20
+
+tEmuStats g_sEmuStats;
+
+// State of the emulated screen
+static struct
+{
+    uint32_t pui32Ram[EMU_PANEL_HEIGHT][EMU_PANEL_WIDTH]; // 24-bit RGB
+    bool bCsHigh;
+    bool bDcHigh;
+    uint8_t ui8Command;         // Command being received, 0 if none
+    uint32_t ui32NumParams;     // Parameter bytes received for it
+    uint8_t pui8Params[6];
+    // Registers
+    uint8_t ui8Madctl;
+    uint8_t ui8Colmod;
+    uint16_t ui16ColStart, ui16ColEnd;
+    uint16_t ui16PageStart, ui16PageEnd;
+    // Vertical scrolling, in panel rows
+    uint16_t ui16ScrollTop, ui16ScrollHeight, ui16ScrollStart;
+    bool bSleeping;
+    bool bDisplayOn;
+    // Memory write position, in the MADCTL orientation
+    uint16_t ui16Col, ui16Page;
+    uint8_t pui8Pixel[3];       // Bytes of a pixel being received
+    uint32_t ui32PixelBytes;
+    const char *pcLastError;
+    // Byte log, see Emu_logStart
+    uint16_t *pui16Log;
+    uint32_t ui32LogSize;
+    uint32_t ui32LogCount;
+} emu;
+
+static void emuError(const char *pcError){
+    g_sEmuStats.ui32Errors++;
+    emu.pcLastError = pcError;
+}
+
+void Emu_reset(void){
+    memset(emu.pui32Ram, 0, sizeof(emu.pui32Ram));
+    emu.bCsHigh = true;
+    emu.bDcHigh = true;
+    emu.ui8Command = 0;
+    emu.ui32NumParams = 0;
+    emu.ui8Madctl = 0;
+    emu.ui8Colmod = 0x66;
+    emu.ui16ColStart = 0;
+    emu.ui16ColEnd = EMU_PANEL_WIDTH - 1;
+    emu.ui16PageStart = 0;
+    emu.ui16PageEnd = EMU_PANEL_HEIGHT - 1;
+    emu.ui16ScrollTop = 0;
+    emu.ui16ScrollHeight = EMU_PANEL_HEIGHT;
+    emu.ui16ScrollStart = 0;
+    emu.bSleeping = true;
+    emu.bDisplayOn = false;
+    emu.ui32PixelBytes = 0;
+    emu.pcLastError = NULL;
+}
+
+void Emu_statsClear(void){
+    memset(&g_sEmuStats, 0, sizeof(g_sEmuStats));
+}
+
+const char *Emu_lastError(void){
+    return emu.pcLastError ? emu.pcLastError : "none";
+}
+
+int32_t Emu_widthGet(void){
+    return (emu.ui8Madctl & MADCTL_MV) ? EMU_PANEL_HEIGHT : EMU_PANEL_WIDTH;
+}
+
+int32_t Emu_heightGet(void){
+    return (emu.ui8Madctl & MADCTL_MV) ? EMU_PANEL_WIDTH : EMU_PANEL_HEIGHT;
+}
+
+bool Emu_displayOn(void){
+    return emu.bDisplayOn && !emu.bSleeping;
+}
+
+// Screen memory location of (column, page) in the MADCTL orientation, or NULL if
+// outside. MV swaps rows and columns, then MX/MY mirror the panel columns/rows.
+// With bShown, the location shown there is returned instead, i.e. with the vertical
+// scrolling applied to the panel row.
+static uint32_t *ramLocate(int32_t i32Col, int32_t i32Page, bool bShown){
+    int32_t i32X = i32Col;
+    int32_t i32Y = i32Page;
+    if(emu.ui8Madctl & MADCTL_MV){
+        i32X = i32Page;
+        i32Y = i32Col;
+    }
+    if((i32X < 0) || (i32X >= EMU_PANEL_WIDTH) || (i32Y < 0) || (i32Y >= EMU_PANEL_HEIGHT)){
+        return NULL;
+    }
+    if(emu.ui8Madctl & MADCTL_MX){
+        i32X = EMU_PANEL_WIDTH - 1 - i32X;
+    }
+    if(emu.ui8Madctl & MADCTL_MY){
+        i32Y = EMU_PANEL_HEIGHT - 1 - i32Y;
+    }
+    if(bShown && (i32Y >= emu.ui16ScrollTop) && (i32Y < emu.ui16ScrollTop + emu.ui16ScrollHeight)){
+        // The top of the scroll area shows the start line, and the rest follows,
+        // wrapping around inside the scroll area.
+        i32Y = emu.ui16ScrollTop + (i32Y - emu.ui16ScrollTop + emu.ui16ScrollStart -
+               emu.ui16ScrollTop) % emu.ui16ScrollHeight;
+    }
+    return &emu.pui32Ram[i32Y][i32X];
+}
+
+static uint32_t *ramGet(int32_t i32Col, int32_t i32Page){
+    return ramLocate(i32Col, i32Page, false);
+}
+
+uint32_t Emu_pixelGet(int32_t i32X, int32_t i32Y){
+    uint32_t *pui32Ram = ramGet(i32X, i32Y);
+    return pui32Ram ? *pui32Ram : 0;
+}
+
+uint32_t Emu_shownGet(int32_t i32X, int32_t i32Y){
+    uint32_t *pui32Ram = ramLocate(i32X, i32Y, true);
+    return pui32Ram ? *pui32Ram : 0;
+}
+
+bool Emu_ppmWrite(const char *pcFileName){
+    FILE *pFile = fopen(pcFileName, "wb");
+    int32_t i32X, i32Y;
+    uint32_t ui32Color;
+
+    if(pFile == NULL){
+        return false;
+    }
+    fprintf(pFile, "P6\n%d %d\n255\n", (int)Emu_widthGet(), (int)Emu_heightGet());
+    for(i32Y = 0 ; i32Y < Emu_heightGet() ; i32Y++){
+        for(i32X = 0 ; i32X < Emu_widthGet() ; i32X++){
+            ui32Color = Emu_shownGet(i32X, i32Y);
+            fputc((ui32Color >> 16) & 0xFF, pFile);
+            fputc((ui32Color >> 8) & 0xFF, pFile);
+            fputc(ui32Color & 0xFF, pFile);
+        }
+    }
+    return fclose(pFile) == 0;
+}
+
+void Emu_logStart(uint16_t *pui16Log, uint32_t ui32Size){
+    emu.ui32LogCount = 0;
+    emu.ui32LogSize = ui32Size;
+    emu.pui16Log = pui16Log;
+}
+
+uint32_t Emu_logStop(void){
+    emu.pui16Log = NULL;
+    return emu.ui32LogCount;
+}
+
+uint32_t Emu_wireTimeUs(uint32_t ui32BitRate){
+    return (uint32_t)((g_sEmuStats.ui64Bytes*8*1000000)/ui32BitRate);
+}
+
+// Write one pixel at the memory write position and move on, wrapping around
+// inside the address window the way the screen does.
+static void pixelWrite(uint32_t ui32Color){
+    uint32_t *pui32Ram = ramGet(emu.ui16Col, emu.ui16Page);
+    if(pui32Ram != NULL){
+        *pui32Ram = ui32Color;
+        g_sEmuStats.ui64Pixels++;
+    }
+    else {
+        emuError("pixel written outside of the screen");
+    }
+    if(emu.ui16Col < emu.ui16ColEnd){
+        emu.ui16Col++;
+        return;
+    }
+    emu.ui16Col = emu.ui16ColStart;
+    if(emu.ui16Page < emu.ui16PageEnd){
+        emu.ui16Page++;
+    }
+    else {
+        emu.ui16Page = emu.ui16PageStart;
+    }
+}
+
+// One byte of pixel data after RAMWR.
+static void pixelByte(uint8_t ui8Byte){
+    uint32_t ui32Color;
+    emu.pui8Pixel[emu.ui32PixelBytes++] = ui8Byte;
+    if((emu.ui8Colmod & 0x07) == 0x05){
+        // 16 bit RGB565, most significant byte first
+        if(emu.ui32PixelBytes == 2){
+            ui32Color = ((uint32_t)emu.pui8Pixel[0] << 8) | emu.pui8Pixel[1];
+            pixelWrite(((((ui32Color >> 11) & 0x1F)*255/31) << 16) |
+                       ((((ui32Color >> 5) & 0x3F)*255/63) << 8) |
+                       ((ui32Color & 0x1F)*255/31));
+            emu.ui32PixelBytes = 0;
+        }
+    }
+    else if(emu.ui32PixelBytes == 3){
+        // 18 bit, 6 bits in the top of each byte
+        pixelWrite(((uint32_t)(emu.pui8Pixel[0] & 0xFC) << 16) |
+                   ((uint32_t)(emu.pui8Pixel[1] & 0xFC) << 8) |
+                   (emu.pui8Pixel[2] & 0xFC));
+        emu.ui32PixelBytes = 0;
+    }
+}
+
+static void commandStart(uint8_t ui8Command){
+    g_sEmuStats.ui32Commands++;
+    g_sEmuStats.pui32CommandCount[ui8Command]++;
+    emu.ui8Command = ui8Command;
+    emu.ui32NumParams = 0;
+    emu.ui32PixelBytes = 0;
+    switch(ui8Command){
+    case CMD_SWRESET:
+        // Registers back to default, the memory is kept
+        emu.ui8Madctl = 0;
+        emu.ui8Colmod = 0x66;
+        emu.ui16ColStart = 0;
+        emu.ui16ColEnd = EMU_PANEL_WIDTH - 1;
+        emu.ui16PageStart = 0;
+        emu.ui16PageEnd = EMU_PANEL_HEIGHT - 1;
+        emu.ui16ScrollTop = 0;
+        emu.ui16ScrollHeight = EMU_PANEL_HEIGHT;
+        emu.ui16ScrollStart = 0;
+        emu.bSleeping = true;
+        emu.bDisplayOn = false;
+        break;
+    case CMD_SLPIN:
+        emu.bSleeping = true;
+        break;
+    case CMD_SLPOUT:
+        emu.bSleeping = false;
+        break;
+    case CMD_DISPOFF:
+        emu.bDisplayOn = false;
+        break;
+    case CMD_DISPON:
+        emu.bDisplayOn = true;
+        break;
+    case CMD_RAMWR:
+        emu.ui16Col = emu.ui16ColStart;
+        emu.ui16Page = emu.ui16PageStart;
+        break;
+    }
+}
+
+static void paramByte(uint8_t ui8Byte){
+    uint32_t ui32Index = emu.ui32NumParams++;
+    switch(emu.ui8Command){
+    case CMD_CASET:
+    case CMD_PASET:
+        if(ui32Index < 4){
+            emu.pui8Params[ui32Index] = ui8Byte;
+        }
+        if(ui32Index == 3){
+            uint16_t ui16Start = ((uint16_t)emu.pui8Params[0] << 8) | emu.pui8Params[1];
+            uint16_t ui16End = ((uint16_t)emu.pui8Params[2] << 8) | emu.pui8Params[3];
+            if(ui16End < ui16Start){
+                emuError("address window end before start");
+            }
+            if(emu.ui8Command == CMD_CASET){
+                emu.ui16ColStart = ui16Start;
+                emu.ui16ColEnd = ui16End;
+            }
+            else {
+                emu.ui16PageStart = ui16Start;
+                emu.ui16PageEnd = ui16End;
+            }
+        }
+        break;
+    case CMD_VSCRDEF:
+        if(ui32Index < 6){
+            emu.pui8Params[ui32Index] = ui8Byte;
+        }
+        if(ui32Index == 5){
+            uint16_t ui16Top = ((uint16_t)emu.pui8Params[0] << 8) | emu.pui8Params[1];
+            uint16_t ui16Height = ((uint16_t)emu.pui8Params[2] << 8) | emu.pui8Params[3];
+            uint16_t ui16Bottom = ((uint16_t)emu.pui8Params[4] << 8) | emu.pui8Params[5];
+            if((ui16Height == 0) || (ui16Top + ui16Height + ui16Bottom != EMU_PANEL_HEIGHT)){
+                emuError("scroll areas don't add up to the panel height");
+                break;
+            }
+            emu.ui16ScrollTop = ui16Top;
+            emu.ui16ScrollHeight = ui16Height;
+        }
+        break;
+    case CMD_VSCRSADD:
+        if(ui32Index < 2){
+            emu.pui8Params[ui32Index] = ui8Byte;
+        }
+        if(ui32Index == 1){
+            uint16_t ui16Start = ((uint16_t)emu.pui8Params[0] << 8) | emu.pui8Params[1];
+            if((ui16Start < emu.ui16ScrollTop) || (ui16Start >= emu.ui16ScrollTop + emu.ui16ScrollHeight)){
+                emuError("scroll start outside of the scroll area");
+                break;
+            }
+            emu.ui16ScrollStart = ui16Start;
+        }
+        break;
+    case CMD_MADCTL:
+        if(ui32Index == 0){
+            emu.ui8Madctl = ui8Byte;
+        }
+        break;
+    case CMD_COLMOD:
+        if(ui32Index == 0){
+            emu.ui8Colmod = ui8Byte;
+        }
+        break;
+    case CMD_RAMWR:
+    case CMD_RAMWRC:
+        pixelByte(ui8Byte);
+        break;
+    case 0:
+        emuError("data without a command");
+        break;
+    }
+}
+
+void Emu_csWrite(bool bHigh){
+    if(!bHigh && emu.bCsHigh){
+        g_sEmuStats.ui32CsSessions++;
+    }
+    if(bHigh && !emu.bCsHigh){
+        // CS high ends whatever command was going on.
+        if(emu.ui32PixelBytes != 0){
+            emuError("CS high in the middle of a pixel");
+        }
+        emu.ui8Command = 0;
+    }
+    emu.bCsHigh = bHigh;
+}
+
+void Emu_dcWrite(bool bHigh){
+    if(bHigh != emu.bDcHigh){
+        g_sEmuStats.ui32DcToggles++;
+    }
+    emu.bDcHigh = bHigh;
+}
+
+void Emu_spiWrite(const uint8_t *pui8Data, uint32_t ui32Count){
+    g_sEmuStats.ui32Transfers++;
+    g_sEmuStats.ui64Bytes += ui32Count;
+    if(emu.bCsHigh){
+        emuError("SPI transfer with CS high");
+        return;
+    }
+    while(ui32Count--){
+        if(emu.pui16Log != NULL){
+            if(emu.ui32LogCount < emu.ui32LogSize){
+                emu.pui16Log[emu.ui32LogCount] = *pui8Data | (emu.bDcHigh ? 0 : EMU_LOG_COMMAND);
+            }
+            emu.ui32LogCount++;
+        }
+        if(emu.bDcHigh){
+            paramByte(*pui8Data++);
+        }
+        else {
+            commandStart(*pui8Data++);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * hx8357_emu.h
+ *
+ *  Host emulator of the HX8357D screen, as driven by ADAFRUIT_2050.c. The
+ *  SPI and GPIO replacements in ti_shim.c feed everything the driver sends to
+ *  the emulator, which decodes the command stream into the screen memory and
+ *  counts what was sent. Only the commands that change what ends up on the
+ *  screen are decoded, everything else is counted and ignored.
+ *
+ */
+
+#ifndef HX8357_EMU_H_
+#define HX8357_EMU_H_
+#include <stdint.h>
+#include <stdbool.h>
+
+// Size of the panel, in its native (portrait) orientation
+#define EMU_PANEL_WIDTH  320
+#define EMU_PANEL_HEIGHT 480
+
+// What has been sent to the screen. Cleared by Emu_statsClear.
+typedef struct
+{
+    uint32_t ui32Transfers;             // SPI transfers
+    uint64_t ui64Bytes;                 // Bytes sent, commands and data
+    uint32_t ui32Commands;              // Command bytes sent (D/C low)
+    uint32_t pui32CommandCount[256];    // Command bytes sent, per command
+    uint32_t ui32CsSessions;            // Times CS went low
+    uint32_t ui32DcToggles;             // Times D/C changed
+    uint64_t ui64Pixels;                // Pixels written to the screen memory
+    uint32_t ui32Errors;                // Anything the screen wouldn't accept, see Emu_lastError
+}
+tEmuStats;
+
+extern tEmuStats g_sEmuStats;
+
+// Hardware reset: clears the screen memory and all registers, but not the statistics.
+void Emu_reset(void);
+void Emu_statsClear(void);
+const char *Emu_lastError(void);
+
+// Pixel at (i32X, i32Y) as 24-bit RGB, in the orientation set by MADCTL, i.e. the
+// coordinates used by the driver. Returns 0 outside of the screen.
+uint32_t Emu_pixelGet(int32_t i32X, int32_t i32Y);
+// Pixel shown at (i32X, i32Y), like Emu_pixelGet but with the vertical scrolling
+// (VSCRDEF/VSCRSADD) applied, i.e. what is seen on the screen.
+uint32_t Emu_shownGet(int32_t i32X, int32_t i32Y);
+// Size of the screen in the orientation set by MADCTL
+int32_t Emu_widthGet(void);
+int32_t Emu_heightGet(void);
+// Write what is shown on the screen, in the orientation set by MADCTL, as a binary
+// PPM file.
+// Returns false if the file couldn't be written.
+bool Emu_ppmWrite(const char *pcFileName);
+bool Emu_displayOn(void);
+
+// Time it takes to send everything counted in g_sEmuStats at ui32BitRate, in us,
+// ignoring the time between transfers.
+uint32_t Emu_wireTimeUs(uint32_t ui32BitRate);
+
+// Keep a copy of every byte sent to the screen from now on in pui16Log, at most
+// ui32Size of them, with EMU_LOG_COMMAND set on command bytes (D/C low).
+// Emu_logStop stops it and returns the number of bytes sent, which can be more
+// than ui32Size.
+#define EMU_LOG_COMMAND 0x100
+void Emu_logStart(uint16_t *pui16Log, uint32_t ui32Size);
+uint32_t Emu_logStop(void);
+
+// Simulate a tear effect pulse from the screen, calling the GPIO callback of the
+// TE pin if its interrupt is enabled.
+void Emu_teTick(void);
+
+// Called by the SPI and GPIO replacements
+void Emu_csWrite(bool bHigh);
+void Emu_dcWrite(bool bHigh);
+void Emu_spiWrite(const uint8_t *pui8Data, uint32_t ui32Count);
+
+#endif /* HX8357_EMU_H_ */
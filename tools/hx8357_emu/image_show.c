@@ -0,0 +1,233 @@
+/*
+ * image_show.c
+ *
+ *  Draws an image file on the emulated screen with ImageStream.c, the way
+ *  IMAGE_TEST in main.c draws splash.bmp from the SD card, but read from a file
+ *  on the PC with fread. Every pixel on the screen is then compared with the file,
+ *  read again one pixel at a time. Prints the counters as JSON and writes what is
+ *  on the screen as a PPM file.
+ *
+ *  Usage: image_show [-r WxH] [-x X] [-y Y] [-l] [-D] [-d read_us] image [file.ppm]
+ *  -r  the image is raw RGB565 of W*H pixels (see ImageStream.h), not a BMP
+ *  -x, -y  top left corner on the screen, 0 by default
+ *  -l  landscape, portrait by default
+ *  -D  dither 24-bit images (HX8357_ditherSet)
+ *  -d  time each read takes, in us, to see how much of it is hidden behind the
+ *      SPI. 0 by default.
+ *
+ *  The exit code is 1 if the image couldn't be drawn, if any pixel came out
+ *  different, or if the emulated screen saw anything wrong.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <xdc/std.h>
+#include <ti/drivers/SPI.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+#include "ImageStream.h"
+#include "hx8357_emu.h"
+
+// Bit rate the SPI is opened with in main.c
+#define SHOW_SPI_BITRATE 20000000
+
+static tDisplayData displayData;
+static tImageStream imageStream;
+static uint32_t ui32ReadUs;
+static bool bDither;
+
+// 4x4 ordered dither thresholds, the same as in ADAFRUIT_2050.c
+static const uint8_t pui8Bayer[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5}
+};
+
+// Cut an 8-bit channel down to ui32Bits bits, after adding the dither threshold of
+// (ui32X, ui32Y) on the screen if dithering.
+static uint32_t channelGet(uint32_t ui32Value, uint32_t ui32Bits, uint32_t ui32X, uint32_t ui32Y){
+    if(bDither){
+        ui32Value += pui8Bayer[ui32Y & 3][ui32X & 3] >> (ui32Bits == 6 ? 2 : 1);
+        if(ui32Value > 255){
+            ui32Value = 255;
+        }
+    }
+    return ui32Value >> (8 - ui32Bits);
+}
+
+// The read function of the image, as the FatFs one in main.c but with fread.
+static uint32_t fileRead(void *pvSource, uint32_t ui32Offset, void *pvBuf, uint32_t ui32Count){
+    FILE *pFile = pvSource;
+    if(ui32ReadUs){
+        usleep(ui32ReadUs);
+    }
+    if(fseek(pFile, ui32Offset, SEEK_SET) != 0){
+        return 0;
+    }
+    return fread(pvBuf, 1, ui32Count, pFile);
+}
+
+// The pixel at (ui32X, ui32Y) in the image, from the top left, as RGB565. Reads
+// the file again without ImageStream.c, so that the two can be compared. The image
+// is at (i32Left, i32Top) on the screen, which is where dithering goes from.
+static uint32_t filePixelGet(FILE *pFile, uint32_t ui32X, uint32_t ui32Y, int32_t i32Left, int32_t i32Top){
+    uint32_t ui32Row = imageStream.bBottomUp ? imageStream.ui16Height - 1 - ui32Y : ui32Y;
+    uint32_t ui32Bytes = (imageStream.ui8Format == IMAGESTREAM_BMP24) ? 3 : 2;
+    uint8_t pui8Pixel[3];
+
+    fseek(pFile, imageStream.ui32DataOffset + ui32Row*imageStream.ui32Stride + ui32X*ui32Bytes, SEEK_SET);
+    if(fread(pui8Pixel, 1, ui32Bytes, pFile) != ui32Bytes){
+        return 0;
+    }
+    switch(imageStream.ui8Format){
+    case IMAGESTREAM_BMP24:
+        return (channelGet(pui8Pixel[2], 5, i32Left + ui32X, i32Top + ui32Y) << 11) |
+               (channelGet(pui8Pixel[1], 6, i32Left + ui32X, i32Top + ui32Y) << 5) |
+               channelGet(pui8Pixel[0], 5, i32Left + ui32X, i32Top + ui32Y);
+    case IMAGESTREAM_BMP16:
+        return pui8Pixel[0] | (pui8Pixel[1] << 8);
+    default:
+        return (pui8Pixel[0] << 8) | pui8Pixel[1];
+    }
+}
+
+// RGB565 as the emulator stores it
+static uint32_t rgb565Expand(uint32_t ui32Color){
+    return ((((ui32Color >> 11) & 0x1F)*255/31) << 16) |
+           ((((ui32Color >> 5) & 0x3F)*255/63) << 8) |
+           ((ui32Color & 0x1F)*255/31);
+}
+
+static void usage(void){
+    fprintf(stderr, "Usage: image_show [-r WxH] [-x X] [-y Y] [-l] [-D] [-d read_us] image [file.ppm]\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]){
+    const char *pcImageName = NULL;
+    const char *pcFileName = "image_show.ppm";
+    uint32_t ui32RawWidth = 0, ui32RawHeight = 0;
+    int32_t i32X = 0, i32Y = 0;
+    uint8_t ui8Orientation = HX8357_PORTRAIT;
+    uint32_t ui32PixelX, ui32PixelY, ui32Mismatches = 0;
+    struct timespec sStart, sEnd;
+    uint32_t ui32ElapsedUs;
+    SPI_Params spiParams;
+    SPI_Handle spi;
+    FILE *pFile;
+    bool bOk;
+    int i;
+
+    for(i = 1 ; i < argc ; i++){
+        if(argv[i][0] != '-'){
+            if(pcImageName == NULL){
+                pcImageName = argv[i];
+            }
+            else {
+                pcFileName = argv[i];
+            }
+            continue;
+        }
+        if(argv[i][1] == 'l'){
+            ui8Orientation = HX8357_LANDSCAPE;
+            continue;
+        }
+        if(argv[i][1] == 'D'){
+            bDither = true;
+            continue;
+        }
+        if(i + 1 >= argc){
+            usage();
+        }
+        switch(argv[i][1]){
+        case 'r':
+            if(sscanf(argv[++i], "%ux%u", &ui32RawWidth, &ui32RawHeight) != 2){
+                usage();
+            }
+            break;
+        case 'x':
+            i32X = strtol(argv[++i], NULL, 0);
+            break;
+        case 'y':
+            i32Y = strtol(argv[++i], NULL, 0);
+            break;
+        case 'd':
+            ui32ReadUs = strtoul(argv[++i], NULL, 0);
+            break;
+        default:
+            usage();
+        }
+    }
+    if(pcImageName == NULL){
+        usage();
+    }
+    pFile = fopen(pcImageName, "rb");
+    if(pFile == NULL){
+        fprintf(stderr, "Couldn't open %s\n", pcImageName);
+        return 2;
+    }
+
+    Emu_reset();
+    SPI_Params_init(&spiParams);
+    spiParams.bitRate = SHOW_SPI_BITRATE;
+#if HX8357_SPI_STREAMING
+    spiParams.transferMode = SPI_MODE_CALLBACK;
+    spiParams.transferCallbackFxn = HX8357_spiCallback;
+#endif
+    spi = SPI_open(0, &spiParams);
+    HX8357_init(spi);
+    HX8357_initDisplayData(&displayData, spi);
+    HX8357_orientationSet(&displayData, ui8Orientation);
+    HX8357_ditherSet(&displayData, bDither);
+
+    bOk = ui32RawWidth ? ImageStream_openRaw(&imageStream, fileRead, pFile, ui32RawWidth, ui32RawHeight) :
+                         ImageStream_open(&imageStream, fileRead, pFile);
+    if(!bOk){
+        fprintf(stderr, "%s isn't a supported image\n", pcImageName);
+        return 1;
+    }
+    if((i32X < 0) || (i32Y < 0) || (i32X + imageStream.ui16Width > Emu_widthGet()) ||
+       (i32Y + imageStream.ui16Height > Emu_heightGet())){
+        fprintf(stderr, "%ux%u at (%d, %d) doesn't fit on the screen\n", imageStream.ui16Width,
+                imageStream.ui16Height, (int)i32X, (int)i32Y);
+        return 1;
+    }
+
+    Emu_statsClear();
+    clock_gettime(CLOCK_MONOTONIC, &sStart);
+    bOk = ImageStream_draw(&imageStream, &displayData, i32X, i32Y);
+    clock_gettime(CLOCK_MONOTONIC, &sEnd);
+    ui32ElapsedUs = (sEnd.tv_sec - sStart.tv_sec)*1000000 + (sEnd.tv_nsec - sStart.tv_nsec)/1000;
+
+    for(ui32PixelY = 0 ; ui32PixelY < imageStream.ui16Height ; ui32PixelY++){
+        for(ui32PixelX = 0 ; ui32PixelX < imageStream.ui16Width ; ui32PixelX++){
+            if(Emu_pixelGet(i32X + ui32PixelX, i32Y + ui32PixelY) !=
+               rgb565Expand(filePixelGet(pFile, ui32PixelX, ui32PixelY, i32X, i32Y))){
+                ui32Mismatches++;
+            }
+        }
+    }
+    fclose(pFile);
+
+    if(!Emu_ppmWrite(pcFileName)){
+        fprintf(stderr, "Couldn't write %s\n", pcFileName);
+    }
+    printf("{\n  \"width\": %u,\n  \"height\": %u,\n  \"format\": %u,\n  \"bottom_up\": %s,\n",
+           imageStream.ui16Width, imageStream.ui16Height, imageStream.ui8Format,
+           imageStream.bBottomUp ? "true" : "false");
+    printf("  \"reads\": %u,\n  \"bytes_read\": %u,\n  \"spi_transfers\": %u,\n  \"ramwr\": %u,\n",
+           (unsigned)imageStream.ui32NumReads, (unsigned)imageStream.ui32NumBytes,
+           (unsigned)g_sEmuStats.ui32Transfers, (unsigned)g_sEmuStats.pui32CommandCount[HX8357_RAMWR]);
+    printf("  \"wire_us\": %u,\n  \"elapsed_us\": %u,\n  \"read_us\": %u,\n",
+           (unsigned)Emu_wireTimeUs(SHOW_SPI_BITRATE), (unsigned)ui32ElapsedUs,
+           (unsigned)(imageStream.ui32NumReads*ui32ReadUs));
+    printf("  \"complete\": %s,\n  \"mismatches\": %u,\n  \"errors\": %u\n}\n", bOk ? "true" : "false",
+           (unsigned)ui32Mismatches, (unsigned)g_sEmuStats.ui32Errors);
+    if(g_sEmuStats.ui32Errors){
+        fprintf(stderr, "%u errors, last: %s\n", (unsigned)g_sEmuStats.ui32Errors, Emu_lastError());
+    }
+    return (bOk && (ui32Mismatches == 0) && (g_sEmuStats.ui32Errors == 0)) ? 0 : 1;
+}
@@ -0,0 +1,7 @@
+/*
+ * board.h
+ *
+ *  The display driver includes "board.h", which CCS on Windows resolves to
+ *  Board.h in the project. Linux file names are case sensitive.
+ */
+#include "Board.h"
@@ -0,0 +1,19 @@
+/*
+ * driverlib/uart.h
+ *
+ *  Host replacement for the TivaWare UART driverlib functions, for the HX8357
+ *  emulator. Only the receive error flags of the loopback UART in ti_shim.c.
+ */
+#ifndef DRIVERLIB_UART_H_
+#define DRIVERLIB_UART_H_
+#include <stdint.h>
+
+#define UART_RXERROR_OVERRUN    0x00000008
+#define UART_RXERROR_BREAK      0x00000004
+#define UART_RXERROR_PARITY     0x00000002
+#define UART_RXERROR_FRAMING    0x00000001
+
+uint32_t UARTRxErrorGet(uint32_t ui32Base);
+void UARTRxErrorClear(uint32_t ui32Base);
+
+#endif /* DRIVERLIB_UART_H_ */
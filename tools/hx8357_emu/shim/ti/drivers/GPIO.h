@@ -0,0 +1,23 @@
+/*
+ * ti/drivers/GPIO.h
+ *
+ *  Host replacement for the TI-RTOS GPIO driver, for the HX8357 emulator.
+ *  The CS, D/C and reset pins of the screen are fed to the emulated screen.
+ */
+#ifndef TI_DRIVERS_GPIO_H_
+#define TI_DRIVERS_GPIO_H_
+#include <stdint.h>
+
+typedef uint32_t GPIO_PinConfig;
+typedef void (*GPIO_CallbackFxn)(unsigned int index);
+
+void GPIO_init(void);
+void GPIO_write(unsigned int index, unsigned int value);
+unsigned int GPIO_read(unsigned int index);
+void GPIO_toggle(unsigned int index);
+void GPIO_setCallback(unsigned int index, GPIO_CallbackFxn callback);
+void GPIO_enableInt(unsigned int index);
+void GPIO_disableInt(unsigned int index);
+void GPIO_clearInt(unsigned int index);
+
+#endif /* TI_DRIVERS_GPIO_H_ */
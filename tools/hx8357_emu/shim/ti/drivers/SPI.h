@@ -0,0 +1,99 @@
+/*
+ * ti/drivers/SPI.h
+ *
+ *  Host replacement for the TI-RTOS SPI driver, for the HX8357 emulator.
+ *  Everything written is fed to the emulated screen. In callback mode, the
+ *  transfer is done by a thread once the bits would be on the wire, and the
+ *  callback is called from there, see ti_shim.c.
+ */
+#ifndef TI_DRIVERS_SPI_H_
+#define TI_DRIVERS_SPI_H_
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct SPI_Config *SPI_Handle;
+
+typedef enum
+{
+    SPI_TRANSFER_COMPLETED = 0,
+    SPI_TRANSFER_STARTED,
+    SPI_TRANSFER_CANCELED,
+    SPI_TRANSFER_FAILED,
+    SPI_TRANSFER_CSN_DEASSERT
+}
+SPI_Status;
+
+typedef struct
+{
+    size_t count;
+    void *txBuf;
+    void *rxBuf;
+    void *arg;
+    SPI_Status status;
+}
+SPI_Transaction;
+
+typedef void (*SPI_CallbackFxn)(SPI_Handle handle, SPI_Transaction *transaction);
+
+typedef enum
+{
+    SPI_MASTER = 0,
+    SPI_SLAVE = 1
+}
+SPI_Mode;
+
+typedef enum
+{
+    SPI_POL0_PHA0 = 0,
+    SPI_POL0_PHA1 = 1,
+    SPI_POL1_PHA0 = 2,
+    SPI_POL1_PHA1 = 3,
+    SPI_TI = 4,
+    SPI_MW = 5
+}
+SPI_FrameFormat;
+
+typedef enum
+{
+    SPI_MODE_BLOCKING,
+    SPI_MODE_CALLBACK
+}
+SPI_TransferMode;
+
+typedef struct
+{
+    SPI_TransferMode transferMode;
+    uint32_t transferTimeout;
+    SPI_CallbackFxn transferCallbackFxn;
+    SPI_Mode mode;
+    uint32_t bitRate;
+    uint32_t dataSize;
+    SPI_FrameFormat frameFormat;
+    void *custom;
+}
+SPI_Params;
+
+typedef struct SPI_Config
+{
+    SPI_Params params;
+    bool bOpen;
+    // The transfer thread of callback mode, and the transfer it is doing, protected
+    // by mutex
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    SPI_Transaction *pActive;
+    uint64_t ui64DoneNs;        // When the active transfer is done
+}
+SPI_Config;
+
+void SPI_init(void);
+void SPI_Params_init(SPI_Params *params);
+SPI_Handle SPI_open(unsigned int index, SPI_Params *params);
+void SPI_close(SPI_Handle handle);
+bool SPI_transfer(SPI_Handle handle, SPI_Transaction *transaction);
+void SPI_transferCancel(SPI_Handle handle);
+
+#endif /* TI_DRIVERS_SPI_H_ */
@@ -0,0 +1,80 @@
+/*
+ * ti/drivers/UART.h
+ *
+ *  Host replacement for the TI-RTOS UART driver, for the HX8357 emulator.
+ *  There is one UART, with TX wired to RX (loopback). Written bytes come back
+ *  at the baud rate, into the pending callback mode read, or into the receive
+ *  FIFO while no read is pending. Bytes that don't fit in the FIFO are lost
+ *  and set the overrun flag (driverlib/uart.h). The callbacks are called with
+ *  the Hwi_disable lock taken, like from the UART interrupt.
+ */
+#ifndef TI_DRIVERS_UART_H_
+#define TI_DRIVERS_UART_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define UART_ERROR (-1)
+
+typedef struct UART_Config *UART_Handle;
+
+typedef void (*UART_Callback)(UART_Handle handle, void *buf, size_t count);
+
+typedef enum
+{
+    UART_MODE_BLOCKING,
+    UART_MODE_CALLBACK
+}
+UART_Mode;
+
+typedef enum
+{
+    UART_RETURN_FULL,
+    UART_RETURN_NEWLINE
+}
+UART_ReturnMode;
+
+typedef enum
+{
+    UART_DATA_BINARY = 0,
+    UART_DATA_TEXT = 1
+}
+UART_DataMode;
+
+typedef enum
+{
+    UART_ECHO_OFF = 0,
+    UART_ECHO_ON = 1
+}
+UART_Echo;
+
+typedef struct
+{
+    UART_Mode readMode;
+    UART_Mode writeMode;
+    uint32_t readTimeout;
+    uint32_t writeTimeout;
+    UART_Callback readCallback;
+    UART_Callback writeCallback;
+    UART_ReturnMode readReturnMode;
+    UART_DataMode readDataMode;
+    UART_DataMode writeDataMode;
+    UART_Echo readEcho;
+    uint32_t baudRate;
+    void *custom;
+}
+UART_Params;
+
+void UART_init(void);
+void UART_Params_init(UART_Params *params);
+UART_Handle UART_open(unsigned int index, UART_Params *params);
+void UART_close(UART_Handle handle);
+int UART_read(UART_Handle handle, void *buffer, size_t size);
+int UART_write(UART_Handle handle, const void *buffer, size_t size);
+void UART_readCancel(UART_Handle handle);
+
+// Host only: bytes lost in the receive FIFO so far, since the overrun flag
+// doesn't say how many.
+uint32_t UART_lostGet(void);
+
+#endif /* TI_DRIVERS_UART_H_ */
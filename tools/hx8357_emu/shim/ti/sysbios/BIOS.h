@@ -0,0 +1,13 @@
+/*
+ * ti/sysbios/BIOS.h
+ *
+ *  Host replacement for the SYS/BIOS BIOS module, for the HX8357 emulator.
+ */
+#ifndef TI_SYSBIOS_BIOS_H_
+#define TI_SYSBIOS_BIOS_H_
+#include <xdc/std.h>
+
+#define BIOS_WAIT_FOREVER (~(UInt32)0)
+#define BIOS_NO_WAIT      ((UInt32)0)
+
+#endif /* TI_SYSBIOS_BIOS_H_ */
@@ -0,0 +1,14 @@
+/*
+ * ti/sysbios/hal/Hwi.h
+ *
+ *  Host replacement for the SYS/BIOS Hwi module, for the HX8357 emulator.
+ *  Hwi_disable takes the same lock as Task_disable.
+ */
+#ifndef TI_SYSBIOS_HAL_HWI_H_
+#define TI_SYSBIOS_HAL_HWI_H_
+#include <xdc/std.h>
+
+UInt Hwi_disable(void);
+void Hwi_restore(UInt key);
+
+#endif /* TI_SYSBIOS_HAL_HWI_H_ */
@@ -0,0 +1,44 @@
+/*
+ * ti/sysbios/knl/Clock.h
+ *
+ *  Host replacement for the SYS/BIOS Clock module, for the HX8357 emulator.
+ *  The tick counter ticks every Clock_tickPeriod us. Clock objects are
+ *  pthreads that sleep between calls, so their functions run at the same time
+ *  as the tasks, and must use Hwi_disable like they would on the target.
+ */
+#ifndef TI_SYSBIOS_KNL_CLOCK_H_
+#define TI_SYSBIOS_KNL_CLOCK_H_
+#include <pthread.h>
+#include <xdc/std.h>
+
+typedef void (*Clock_FuncPtr)(UArg arg0);
+
+typedef struct
+{
+    UInt32 period;
+    Bool startFlag;
+    UArg arg;
+}
+Clock_Params;
+
+typedef struct
+{
+    pthread_t thread;
+    Clock_FuncPtr fxn;
+    UInt32 timeout;
+    UInt32 period;
+    UArg arg;
+    volatile Bool bRunning;
+}
+Clock_Struct;
+typedef Clock_Struct *Clock_Handle;
+
+extern const UInt32 Clock_tickPeriod;
+UInt32 Clock_getTicks(void);
+void Clock_Params_init(Clock_Params *params);
+void Clock_construct(Clock_Struct *obj, Clock_FuncPtr fxn, UInt32 timeout, const Clock_Params *params);
+Clock_Handle Clock_handle(Clock_Struct *obj);
+void Clock_start(Clock_Handle handle);
+void Clock_stop(Clock_Handle handle);
+
+#endif /* TI_SYSBIOS_KNL_CLOCK_H_ */
@@ -0,0 +1,43 @@
+/*
+ * ti/sysbios/knl/Semaphore.h
+ *
+ *  Host replacement for the SYS/BIOS Semaphore module, for the HX8357 emulator.
+ *  Built on pthreads, see ti_shim.c.
+ */
+#ifndef TI_SYSBIOS_KNL_SEMAPHORE_H_
+#define TI_SYSBIOS_KNL_SEMAPHORE_H_
+#include <pthread.h>
+#include <xdc/std.h>
+
+typedef enum
+{
+    Semaphore_Mode_COUNTING,
+    Semaphore_Mode_BINARY
+}
+Semaphore_Mode;
+
+typedef struct
+{
+    Semaphore_Mode mode;
+}
+Semaphore_Params;
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    Int count;
+    Semaphore_Mode mode;
+}
+Semaphore_Struct;
+typedef Semaphore_Struct *Semaphore_Handle;
+
+void Semaphore_Params_init(Semaphore_Params *params);
+void Semaphore_construct(Semaphore_Struct *obj, Int count, const Semaphore_Params *params);
+Semaphore_Handle Semaphore_handle(Semaphore_Struct *obj);
+Bool Semaphore_pend(Semaphore_Handle handle, UInt32 timeout);
+void Semaphore_post(Semaphore_Handle handle);
+void Semaphore_reset(Semaphore_Handle handle, Int count);
+Int Semaphore_getCount(Semaphore_Handle handle);
+
+#endif /* TI_SYSBIOS_KNL_SEMAPHORE_H_ */
@@ -0,0 +1,43 @@
+/*
+ * ti/sysbios/knl/Task.h
+ *
+ *  Host replacement for the SYS/BIOS Task module, for the HX8357 emulator.
+ *  Every task is a pthread, and priorities are ignored. Task_disable is a
+ *  lock shared with Hwi_disable, which is enough for the critical sections
+ *  in the display code.
+ */
+#ifndef TI_SYSBIOS_KNL_TASK_H_
+#define TI_SYSBIOS_KNL_TASK_H_
+#include <pthread.h>
+#include <xdc/std.h>
+
+typedef void (*Task_FuncPtr)(UArg arg0, UArg arg1);
+
+typedef struct
+{
+    UArg arg0;
+    UArg arg1;
+    Int priority;
+    Ptr stack;
+    size_t stackSize;
+}
+Task_Params;
+
+typedef struct
+{
+    pthread_t thread;
+    Task_FuncPtr fxn;
+    UArg arg0;
+    UArg arg1;
+}
+Task_Struct;
+typedef Task_Struct *Task_Handle;
+
+void Task_Params_init(Task_Params *params);
+Task_Handle Task_construct(Task_Struct *obj, Task_FuncPtr fxn, const Task_Params *params, void *eb);
+UInt Task_disable(void);
+void Task_restore(UInt key);
+void Task_sleep(UInt32 ticks);
+void Task_yield(void);
+
+#endif /* TI_SYSBIOS_KNL_TASK_H_ */
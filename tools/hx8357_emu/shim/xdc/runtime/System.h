@@ -0,0 +1,16 @@
+/*
+ * xdc/runtime/System.h
+ *
+ *  Host replacement for the XDCtools System module, for the HX8357 emulator.
+ *  Everything is printed on stderr.
+ */
+#ifndef XDC_RUNTIME_SYSTEM_H_
+#define XDC_RUNTIME_SYSTEM_H_
+#include <xdc/std.h>
+
+Int System_printf(const char *pcFormat, ...);
+Int System_snprintf(char *pcBuf, size_t n, const char *pcFormat, ...);
+void System_abort(const char *pcString);
+void System_flush(void);
+
+#endif /* XDC_RUNTIME_SYSTEM_H_ */
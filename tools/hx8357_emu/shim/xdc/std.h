@@ -0,0 +1,32 @@
+/*
+ * xdc/std.h
+ *
+ *  Host replacement for the XDCtools standard types, for the HX8357 emulator.
+ */
+#ifndef XDC_STD_H_
+#define XDC_STD_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uintptr_t UArg;
+typedef char Char;
+typedef unsigned char UChar;
+typedef int Int;
+typedef unsigned int UInt;
+typedef bool Bool;
+typedef void *Ptr;
+typedef int16_t Int16;
+typedef uint16_t UInt16;
+typedef int32_t Int32;
+typedef uint32_t UInt32;
+#define Void void
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#endif /* XDC_STD_H_ */
@@ -0,0 +1,649 @@
+/*
+ * ti_shim.c
+ *
+ *  Host implementations of the TI-RTOS drivers and SYS/BIOS modules used by the
+ *  display code, for the HX8357 emulator. SPI and the screen GPIOs go to the
+ *  emulated screen, the kernel objects are built on pthreads, and the UART is
+ *  a loopback paced at the baud rate.
+ */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/drivers/GPIO.h>
+#include <ti/drivers/SPI.h>
+#include <ti/drivers/UART.h>
+#include <driverlib/uart.h>
+#include "board.h"
+#include "hx8357_emu.h"
+
+// System, printed on stderr so that it doesn't mix with the output of the tools
+
+Int System_printf(const char *pcFormat, ...){
+    va_list args;
+    Int i32Ret;
+    va_start(args, pcFormat);
+    i32Ret = vfprintf(stderr, pcFormat, args);
+    va_end(args);
+    return i32Ret;
+}
+
+Int System_snprintf(char *pcBuf, size_t n, const char *pcFormat, ...){
+    va_list args;
+    Int i32Ret;
+    va_start(args, pcFormat);
+    i32Ret = vsnprintf(pcBuf, n, pcFormat, args);
+    va_end(args);
+    return i32Ret;
+}
+
+void System_abort(const char *pcString){
+    fprintf(stderr, "System_abort: %s", pcString);
+    exit(1);
+}
+
+void System_flush(void){
+    fflush(stderr);
+}
+
+// Clock, 1 ms ticks like the default SYS/BIOS configuration
+
+const UInt32 Clock_tickPeriod = 1000;
+
+UInt32 Clock_getTicks(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+void Clock_Params_init(Clock_Params *params){
+    params->period = 0;
+    params->startFlag = false;
+    params->arg = 0;
+}
+
+// Each clock object is a thread that sleeps between the calls. Clock_start and
+// Clock_stop only pause and resume the calls, the timing goes on.
+static void *clockThread(void *pvClock){
+    Clock_Struct *obj = (Clock_Struct *)pvClock;
+    usleep(obj->timeout*Clock_tickPeriod);
+    while(1){
+        if(obj->bRunning){
+            obj->fxn(obj->arg);
+        }
+        if(obj->period == 0){
+            return NULL;
+        }
+        usleep(obj->period*Clock_tickPeriod);
+    }
+}
+
+void Clock_construct(Clock_Struct *obj, Clock_FuncPtr fxn, UInt32 timeout, const Clock_Params *params){
+    obj->fxn = fxn;
+    obj->timeout = timeout;
+    obj->period = params->period;
+    obj->arg = params->arg;
+    obj->bRunning = params->startFlag;
+    if(pthread_create(&obj->thread, NULL, clockThread, obj) != 0){
+        System_abort("Clock_construct: pthread_create failed\n");
+    }
+    pthread_detach(obj->thread);
+}
+
+Clock_Handle Clock_handle(Clock_Struct *obj){
+    return obj;
+}
+
+void Clock_start(Clock_Handle handle){
+    handle->bRunning = true;
+}
+
+void Clock_stop(Clock_Handle handle){
+    handle->bRunning = false;
+}
+
+// Task_disable and Hwi_disable share one recursive lock.
+
+static pthread_mutex_t criticalMutex;
+static pthread_once_t criticalOnce = PTHREAD_ONCE_INIT;
+
+static void criticalInit(void){
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&criticalMutex, &attr);
+}
+
+static UInt criticalEnter(void){
+    pthread_once(&criticalOnce, criticalInit);
+    pthread_mutex_lock(&criticalMutex);
+    return 0;
+}
+
+static void criticalExit(void){
+    pthread_mutex_unlock(&criticalMutex);
+}
+
+UInt Hwi_disable(void){
+    return criticalEnter();
+}
+
+void Hwi_restore(UInt key){
+    criticalExit();
+}
+
+UInt Task_disable(void){
+    return criticalEnter();
+}
+
+void Task_restore(UInt key){
+    criticalExit();
+}
+
+// Task
+
+void Task_Params_init(Task_Params *params){
+    params->arg0 = 0;
+    params->arg1 = 0;
+    params->priority = 1;
+    params->stack = NULL;
+    params->stackSize = 0;
+}
+
+static void *taskThread(void *pvTask){
+    Task_Struct *obj = (Task_Struct *)pvTask;
+    obj->fxn(obj->arg0, obj->arg1);
+    return NULL;
+}
+
+Task_Handle Task_construct(Task_Struct *obj, Task_FuncPtr fxn, const Task_Params *params, void *eb){
+    obj->fxn = fxn;
+    obj->arg0 = params->arg0;
+    obj->arg1 = params->arg1;
+    if(pthread_create(&obj->thread, NULL, taskThread, obj) != 0){
+        System_abort("Task_construct: pthread_create failed\n");
+    }
+    pthread_detach(obj->thread);
+    return obj;
+}
+
+void Task_sleep(UInt32 ticks){
+    usleep(ticks*Clock_tickPeriod);
+}
+
+void Task_yield(void){
+    sched_yield();
+}
+
+// Semaphore
+
+void Semaphore_Params_init(Semaphore_Params *params){
+    params->mode = Semaphore_Mode_COUNTING;
+}
+
+void Semaphore_construct(Semaphore_Struct *obj, Int count, const Semaphore_Params *params){
+    pthread_mutex_init(&obj->mutex, NULL);
+    pthread_cond_init(&obj->cond, NULL);
+    obj->mode = params ? params->mode : Semaphore_Mode_COUNTING;
+    obj->count = (obj->mode == Semaphore_Mode_BINARY) && (count > 1) ? 1 : count;
+}
+
+Semaphore_Handle Semaphore_handle(Semaphore_Struct *obj){
+    return obj;
+}
+
+Bool Semaphore_pend(Semaphore_Handle handle, UInt32 timeout){
+    struct timespec ts;
+    int ret = 0;
+    Bool bTaken;
+
+    if((timeout != BIOS_WAIT_FOREVER) && (timeout != BIOS_NO_WAIT)){
+        uint64_t ui64Ns;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ui64Ns = ts.tv_nsec + (uint64_t)timeout*Clock_tickPeriod*1000;
+        ts.tv_sec += ui64Ns/1000000000;
+        ts.tv_nsec = ui64Ns%1000000000;
+    }
+    pthread_mutex_lock(&handle->mutex);
+    while((handle->count == 0) && (ret != ETIMEDOUT) && (timeout != BIOS_NO_WAIT)){
+        if(timeout == BIOS_WAIT_FOREVER){
+            pthread_cond_wait(&handle->cond, &handle->mutex);
+        }
+        else {
+            ret = pthread_cond_timedwait(&handle->cond, &handle->mutex, &ts);
+        }
+    }
+    bTaken = handle->count > 0;
+    if(bTaken){
+        handle->count--;
+    }
+    pthread_mutex_unlock(&handle->mutex);
+    return bTaken;
+}
+
+void Semaphore_post(Semaphore_Handle handle){
+    pthread_mutex_lock(&handle->mutex);
+    if((handle->mode == Semaphore_Mode_COUNTING) || (handle->count == 0)){
+        handle->count++;
+    }
+    pthread_cond_signal(&handle->cond);
+    pthread_mutex_unlock(&handle->mutex);
+}
+
+void Semaphore_reset(Semaphore_Handle handle, Int count){
+    pthread_mutex_lock(&handle->mutex);
+    handle->count = count;
+    pthread_mutex_unlock(&handle->mutex);
+}
+
+Int Semaphore_getCount(Semaphore_Handle handle){
+    Int count;
+    pthread_mutex_lock(&handle->mutex);
+    count = handle->count;
+    pthread_mutex_unlock(&handle->mutex);
+    return count;
+}
+
+// SPI, one instance that writes to the emulated screen. In callback mode, a transfer
+// takes the time its bits take on the wire at the bit rate. It's done by the SPI
+// thread, which only then reads the bytes from txBuf, so a buffer that is changed
+// before its transfer is done shows up on the screen. The callback is called from
+// the thread with the Hwi_disable lock taken, like from an interrupt. Like the TI
+// driver, one transfer can be active at a time, and a new one can be started from
+// the callback.
+
+static SPI_Config spiConfig;
+
+static uint64_t nsGet(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+static void *spiThread(void *pvSpi){
+    SPI_Config *spi = (SPI_Config *)pvSpi;
+    SPI_Transaction *transaction;
+    struct timespec ts;
+    UInt key;
+
+    pthread_mutex_lock(&spi->mutex);
+    while(1){
+        while(spi->bOpen && (spi->pActive == NULL)){
+            pthread_cond_wait(&spi->cond, &spi->mutex);
+        }
+        if(!spi->bOpen){
+            break;
+        }
+        transaction = spi->pActive;
+        pthread_mutex_unlock(&spi->mutex);
+        // Sleep rather than spin, the other threads may need the CPU meanwhile.
+        ts.tv_sec = spi->ui64DoneNs/1000000000;
+        ts.tv_nsec = spi->ui64DoneNs%1000000000;
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR){
+        }
+        Emu_spiWrite((const uint8_t *)transaction->txBuf, transaction->count);
+        transaction->status = SPI_TRANSFER_COMPLETED;
+        key = Hwi_disable();
+        pthread_mutex_lock(&spi->mutex);
+        spi->pActive = NULL;
+        pthread_mutex_unlock(&spi->mutex);
+        spi->params.transferCallbackFxn(spi, transaction);
+        Hwi_restore(key);
+        pthread_mutex_lock(&spi->mutex);
+    }
+    pthread_mutex_unlock(&spi->mutex);
+    return NULL;
+}
+
+void SPI_init(void){
+}
+
+void SPI_Params_init(SPI_Params *params){
+    params->transferMode = SPI_MODE_BLOCKING;
+    params->transferTimeout = ~0;
+    params->transferCallbackFxn = NULL;
+    params->mode = SPI_MASTER;
+    params->bitRate = 1000000;
+    params->dataSize = 8;
+    params->frameFormat = SPI_POL0_PHA0;
+    params->custom = NULL;
+}
+
+SPI_Handle SPI_open(unsigned int index, SPI_Params *params){
+    if(spiConfig.bOpen){
+        return NULL;
+    }
+    if(params == NULL){
+        SPI_Params_init(&spiConfig.params);
+    }
+    else {
+        spiConfig.params = *params;
+    }
+    spiConfig.bOpen = true;
+    spiConfig.pActive = NULL;
+    if((spiConfig.params.transferMode == SPI_MODE_CALLBACK) &&
+       (spiConfig.params.transferCallbackFxn != NULL)){
+        pthread_mutex_init(&spiConfig.mutex, NULL);
+        pthread_cond_init(&spiConfig.cond, NULL);
+        if(pthread_create(&spiConfig.thread, NULL, spiThread, &spiConfig) != 0){
+            System_abort("SPI_open: pthread_create failed\n");
+        }
+    }
+    return &spiConfig;
+}
+
+// Waits for the active transfer, if any.
+void SPI_close(SPI_Handle handle){
+    if((handle->params.transferMode == SPI_MODE_CALLBACK) &&
+       (handle->params.transferCallbackFxn != NULL)){
+        pthread_mutex_lock(&handle->mutex);
+        handle->bOpen = false;
+        pthread_cond_signal(&handle->cond);
+        pthread_mutex_unlock(&handle->mutex);
+        pthread_join(handle->thread, NULL);
+    }
+    handle->bOpen = false;
+}
+
+// In blocking mode, the data is on the screen when this returns. In callback mode
+// the transfer is started, and false is returned if one is already active.
+bool SPI_transfer(SPI_Handle handle, SPI_Transaction *transaction){
+    if((handle->params.transferMode != SPI_MODE_CALLBACK) ||
+       (handle->params.transferCallbackFxn == NULL)){
+        Emu_spiWrite((const uint8_t *)transaction->txBuf, transaction->count);
+        transaction->status = SPI_TRANSFER_COMPLETED;
+        return true;
+    }
+    pthread_mutex_lock(&handle->mutex);
+    if(handle->pActive != NULL){
+        pthread_mutex_unlock(&handle->mutex);
+        return false;
+    }
+    transaction->status = SPI_TRANSFER_STARTED;
+    handle->ui64DoneNs = nsGet() + (uint64_t)transaction->count*8*1000000000/handle->params.bitRate;
+    handle->pActive = transaction;
+    pthread_cond_signal(&handle->cond);
+    pthread_mutex_unlock(&handle->mutex);
+    return true;
+}
+
+void SPI_transferCancel(SPI_Handle handle){
+}
+
+// GPIO, the screen pins go to the emulator
+
+static unsigned int gpioValues[EK_TM4C123GXL_GPIOCOUNT];
+static GPIO_CallbackFxn gpioCallbacks[EK_TM4C123GXL_GPIOCOUNT];
+static bool gpioIntEnabled[EK_TM4C123GXL_GPIOCOUNT];
+
+void GPIO_init(void){
+}
+
+void GPIO_write(unsigned int index, unsigned int value){
+    if(index >= EK_TM4C123GXL_GPIOCOUNT){
+        return;
+    }
+    gpioValues[index] = value;
+    if(index == GPIO_CS_PIN){
+        Emu_csWrite(value != 0);
+    }
+    else if(index == GPIO_DC_PIN){
+        Emu_dcWrite(value != 0);
+    }
+    else if((index == GPIO_SCREEN_RESET) && (value == 0)){
+        Emu_reset();
+    }
+}
+
+unsigned int GPIO_read(unsigned int index){
+    return index < EK_TM4C123GXL_GPIOCOUNT ? gpioValues[index] : 0;
+}
+
+void GPIO_toggle(unsigned int index){
+    GPIO_write(index, !GPIO_read(index));
+}
+
+void GPIO_setCallback(unsigned int index, GPIO_CallbackFxn callback){
+    if(index < EK_TM4C123GXL_GPIOCOUNT){
+        gpioCallbacks[index] = callback;
+    }
+}
+
+void GPIO_enableInt(unsigned int index){
+    if(index < EK_TM4C123GXL_GPIOCOUNT){
+        gpioIntEnabled[index] = true;
+    }
+}
+
+void GPIO_disableInt(unsigned int index){
+    if(index < EK_TM4C123GXL_GPIOCOUNT){
+        gpioIntEnabled[index] = false;
+    }
+}
+
+void GPIO_clearInt(unsigned int index){
+}
+
+void Emu_teTick(void){
+    if(gpioIntEnabled[GPIO_TE_PIN] && (gpioCallbacks[GPIO_TE_PIN] != NULL)){
+        gpioCallbacks[GPIO_TE_PIN](GPIO_TE_PIN);
+    }
+}
+
+// UART, one instance with TX wired to RX. UART_write puts the bytes on the line,
+// and the line thread takes them off at the baud rate and receives them like the
+// UART interrupt would: into the pending read, or into the receive FIFO.
+
+// Bytes written but not yet sent
+#define UART_LINE_BYTES 4096
+// The hardware FIFO (16 bytes) together with the ring of the driver
+// (uartTivaRingBuffer in EK_TM4C123GXL.c, 32 bytes)
+#define UART_FIFO_BYTES 48
+// Most bytes the line thread receives in one go
+#define UART_BATCH_BYTES 256
+
+typedef struct UART_Config
+{
+    UART_Params params;
+    bool bOpen;
+    pthread_t lineThread;
+    // The line, protected by lineMutex
+    pthread_mutex_t lineMutex;
+    pthread_cond_t lineCond;
+    uint8_t pui8Line[UART_LINE_BYTES];
+    uint32_t ui32LineHead;
+    uint32_t ui32LineTail;
+    // The receiver, protected by the Hwi_disable lock
+    uint8_t pui8Fifo[UART_FIFO_BYTES];
+    uint32_t ui32FifoHead;
+    uint32_t ui32FifoTail;
+    uint8_t *pui8Read;
+    size_t readSize;
+    size_t readCount;
+    bool bReadPending;
+    uint32_t ui32RxErrors;
+    uint32_t ui32Lost;
+}
+UART_Config;
+
+static UART_Config uartConfig;
+
+// Receive one byte, with the Hwi_disable lock taken.
+static void uartReceive(UART_Config *uart, uint8_t ui8Byte){
+    if(uart->bReadPending){
+        uart->pui8Read[uart->readCount++] = ui8Byte;
+        if(uart->readCount == uart->readSize){
+            uart->bReadPending = false;
+            uart->params.readCallback(uart, uart->pui8Read, uart->readCount);
+        }
+    }
+    else if(uart->ui32FifoHead - uart->ui32FifoTail < UART_FIFO_BYTES){
+        uart->pui8Fifo[uart->ui32FifoHead++ % UART_FIFO_BYTES] = ui8Byte;
+    }
+    else {
+        uart->ui32RxErrors |= UART_RXERROR_OVERRUN;
+        uart->ui32Lost++;
+    }
+}
+
+// Takes the bytes off the line as they would come in at the baud rate, 10 bits
+// each (start, 8 data and a stop bit).
+static void *uartLineThread(void *pvUart){
+    UART_Config *uart = (UART_Config *)pvUart;
+    uint64_t ui64ByteNs = 10*1000000000ull/uart->params.baudRate;
+    uint64_t ui64Sent = nsGet();
+    uint64_t ui64Now;
+    uint8_t pui8Batch[UART_BATCH_BYTES];
+    uint32_t ui32Count, ui32Index;
+    UInt key;
+
+    while(uart->bOpen){
+        usleep(100);
+        ui64Now = nsGet();
+        ui32Count = 0;
+        pthread_mutex_lock(&uart->lineMutex);
+        if(uart->ui32LineHead == uart->ui32LineTail){
+            // The line is idle, so the next byte starts now.
+            ui64Sent = ui64Now;
+        }
+        while((uart->ui32LineHead != uart->ui32LineTail) && (ui64Now - ui64Sent >= ui64ByteNs) &&
+              (ui32Count < UART_BATCH_BYTES)){
+            pui8Batch[ui32Count++] = uart->pui8Line[uart->ui32LineTail++ % UART_LINE_BYTES];
+            ui64Sent += ui64ByteNs;
+        }
+        pthread_cond_signal(&uart->lineCond);
+        pthread_mutex_unlock(&uart->lineMutex);
+
+        key = Hwi_disable();
+        for(ui32Index = 0 ; ui32Index < ui32Count ; ui32Index++){
+            uartReceive(uart, pui8Batch[ui32Index]);
+        }
+        Hwi_restore(key);
+    }
+    return NULL;
+}
+
+void UART_init(void){
+}
+
+void UART_Params_init(UART_Params *params){
+    params->readMode = UART_MODE_BLOCKING;
+    params->writeMode = UART_MODE_BLOCKING;
+    params->readTimeout = BIOS_WAIT_FOREVER;
+    params->writeTimeout = BIOS_WAIT_FOREVER;
+    params->readCallback = NULL;
+    params->writeCallback = NULL;
+    params->readReturnMode = UART_RETURN_NEWLINE;
+    params->readDataMode = UART_DATA_TEXT;
+    params->writeDataMode = UART_DATA_TEXT;
+    params->readEcho = UART_ECHO_ON;
+    params->baudRate = 115200;
+    params->custom = NULL;
+}
+
+// Only binary callback mode reads and blocking writes are emulated, which is what
+// UartRx.c uses.
+UART_Handle UART_open(unsigned int index, UART_Params *params){
+    UART_Config *uart = &uartConfig;
+
+    if(uart->bOpen || (index != 0)){
+        return NULL;
+    }
+    if((params->readMode != UART_MODE_CALLBACK) || (params->readCallback == NULL) ||
+       (params->writeMode != UART_MODE_BLOCKING) || (params->baudRate == 0)){
+        System_abort("UART_open: only callback mode reads are emulated\n");
+    }
+    uart->params = *params;
+    pthread_mutex_init(&uart->lineMutex, NULL);
+    pthread_cond_init(&uart->lineCond, NULL);
+    uart->ui32LineHead = 0;
+    uart->ui32LineTail = 0;
+    uart->ui32FifoHead = 0;
+    uart->ui32FifoTail = 0;
+    uart->bReadPending = false;
+    uart->ui32RxErrors = 0;
+    uart->ui32Lost = 0;
+    uart->bOpen = true;
+    if(pthread_create(&uart->lineThread, NULL, uartLineThread, uart) != 0){
+        System_abort("UART_open: pthread_create failed\n");
+    }
+    return uart;
+}
+
+void UART_close(UART_Handle handle){
+    handle->bOpen = false;
+    pthread_join(handle->lineThread, NULL);
+}
+
+// Starts a read of size bytes. Whatever is in the FIFO is taken right away, and if
+// that fills the buffer the callback is called before this returns, like the
+// driver does.
+int UART_read(UART_Handle handle, void *buffer, size_t size){
+    UInt key = Hwi_disable();
+
+    if(handle->bReadPending){
+        Hwi_restore(key);
+        return UART_ERROR;
+    }
+    handle->pui8Read = (uint8_t *)buffer;
+    handle->readSize = size;
+    handle->readCount = 0;
+    while((handle->readCount < size) && (handle->ui32FifoHead != handle->ui32FifoTail)){
+        handle->pui8Read[handle->readCount++] = handle->pui8Fifo[handle->ui32FifoTail++ % UART_FIFO_BYTES];
+    }
+    if(handle->readCount == size){
+        handle->params.readCallback(handle, buffer, size);
+    }
+    else {
+        handle->bReadPending = true;
+    }
+    Hwi_restore(key);
+    return 0;
+}
+
+// Puts the bytes on the line, waiting for the line thread when it is full.
+int UART_write(UART_Handle handle, const void *buffer, size_t size){
+    const uint8_t *pui8Data = (const uint8_t *)buffer;
+    size_t written = 0;
+
+    pthread_mutex_lock(&handle->lineMutex);
+    while(written < size){
+        while(handle->ui32LineHead - handle->ui32LineTail == UART_LINE_BYTES){
+            pthread_cond_wait(&handle->lineCond, &handle->lineMutex);
+        }
+        handle->pui8Line[handle->ui32LineHead++ % UART_LINE_BYTES] = pui8Data[written++];
+    }
+    pthread_mutex_unlock(&handle->lineMutex);
+    return size;
+}
+
+// Ends the pending read, and calls the callback with what has come in so far.
+void UART_readCancel(UART_Handle handle){
+    UInt key = Hwi_disable();
+    if(handle->bReadPending){
+        handle->bReadPending = false;
+        handle->params.readCallback(handle, handle->pui8Read, handle->readCount);
+    }
+    Hwi_restore(key);
+}
+
+uint32_t UART_lostGet(void){
+    return uartConfig.ui32Lost;
+}
+
+uint32_t UARTRxErrorGet(uint32_t ui32Base){
+    return uartConfig.ui32RxErrors;
+}
+
+void UARTRxErrorClear(uint32_t ui32Base){
+    uartConfig.ui32RxErrors = 0;
+}
@@ -0,0 +1,222 @@
+/*
+ * uart_loopback.c
+ *
+ *  Runs the UART receive path of uartFxn (UartRx.c) against the loopback UART in
+ *  ti_shim.c, with the terminal of USE_SCROLL_TERMINAL drawing what comes in on
+ *  the emulated screen. Bursts of text are written at the baud rate, and come back
+ *  through the UART callback, the ring buffer (ByteRing.c) and the screen task.
+ *  Prints the counters as JSON, and checks that everything written was received
+ *  and drawn in order.
+ *
+ *  Usage: uart_loopback [-b baud] [-n bursts] [-s burst_bytes] [-p pause_ms] [file.ppm]
+ *  -b  baud rate, 921600 by default
+ *  -n  number of bursts, 20 by default
+ *  -s  bytes per burst, 200 by default. Up to BYTERING_SIZE bytes fit in the ring
+ *      while the screen task is drawing.
+ *  -p  pause between the bursts in ms, 500 by default, for the screen to catch up
+ *
+ *  The exit code is 1 if anything was lost or came out different, or if the
+ *  emulated screen saw anything wrong. The SPI transfers take as long as on the
+ *  target, but the rest of the drawing depends on the host, so bursts that only
+ *  just fit may pass on one host and not on another.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <xdc/std.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/drivers/SPI.h>
+#include <ti/drivers/UART.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+#include "ByteRing.h"
+#include "GlyphCache.h"
+#include "Terminal.h"
+#include "UartRx.h"
+#include "hx8357_emu.h"
+
+#define LOOPBACK_BAUD        921600
+#define LOOPBACK_BURSTS      20
+#define LOOPBACK_BURST_BYTES 200
+// A burst of 200 characters takes about 330 ms to draw at 20 MHz when the terminal
+// scrolls, see terminal_scroll of bench.c
+#define LOOPBACK_PAUSE_MS    500
+// Bit rate the SPI is opened with in main.c
+#define LOOPBACK_SPI_BITRATE 20000000
+// How long to wait for the last bytes after the last burst, in ms
+#define LOOPBACK_DRAIN_MS    2000
+
+static tDisplayData displayData;
+static tDisplay display;
+static tContext grlibContext;
+static tGlyphCache glyphCache;
+static tTerminal terminal;
+static tByteRing uartRing;
+static tUartRx uartRx;
+static Task_Struct screenTaskStruct;
+
+// What the screen task has drawn, to compare with what was written
+static char *pcReceived;
+static volatile uint32_t ui32Received;
+static uint32_t ui32Batches;
+
+// The screen task of UART_SCREEN_TEST: draws whatever has come in, in batches.
+static void screenTaskFxn(UArg arg0, UArg arg1){
+    char pcBuf[64];
+    uint32_t ui32Count;
+
+    while(1){
+        ui32Count = ByteRing_read(&uartRing, pcBuf, sizeof(pcBuf), BIOS_WAIT_FOREVER);
+        Terminal_write(&terminal, pcBuf, ui32Count);
+        display.pfnFlush(display.pvDisplayData);
+        memcpy(&pcReceived[ui32Received], pcBuf, ui32Count);
+        ui32Batches++;
+        ui32Received += ui32Count;
+    }
+}
+
+static void displaySetup(SPI_Handle spi){
+    HX8357_initDisplayData(&displayData, spi);
+    HX8357_orientationSet(&displayData, HX8357_PORTRAIT);
+    display.i32Size = sizeof(tDisplay);
+    display.ui16Width = HX8357_TFTWIDTH;
+    display.ui16Height = HX8357_TFTHEIGHT;
+    display.pvDisplayData = &displayData;
+    display.pfnPixelDraw = &PixelDraw;
+    display.pfnPixelDrawMultiple = &PixelDrawMultiple;
+    display.pfnLineDrawV = &LineDrawV;
+    display.pfnLineDrawH = &LineDrawH;
+    display.pfnRectFill = &RectFill;
+    display.pfnColorTranslate = &ColorTranslate;
+    display.pfnFlush = &Flush;
+    GrContextInit(&grlibContext, &display);
+    GrContextForegroundSet(&grlibContext, 0xFFFFFFFF);
+    GrContextBackgroundSet(&grlibContext, 0);
+    GrContextFontSet(&grlibContext, &g_sFontCmtt38);
+    GrStringCodepageSet(&grlibContext, CODEPAGE_ISO8859_1);
+    GlyphCache_init(&glyphCache, &displayData);
+    Terminal_init(&terminal, &grlibContext, &glyphCache, &displayData, 0,
+                  HX8357_TFTHEIGHT/grlibContext.psFont->ui8Height);
+}
+
+static void usage(void){
+    fprintf(stderr, "Usage: uart_loopback [-b baud] [-n bursts] [-s burst_bytes] [-p pause_ms] [file.ppm]\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]){
+    static const char pcText[] = "The quick brown fox jumps over the lazy dog\r";
+    const char *pcFileName = "uart_loopback.ppm";
+    uint32_t ui32Baud = LOOPBACK_BAUD;
+    uint32_t ui32Bursts = LOOPBACK_BURSTS;
+    uint32_t ui32BurstBytes = LOOPBACK_BURST_BYTES;
+    uint32_t ui32PauseMs = LOOPBACK_PAUSE_MS;
+    uint32_t ui32Sent, ui32Index, ui32Lost, ui32Waited;
+    char *pcSent;
+    bool bMatch;
+    SPI_Params spiParams;
+    SPI_Handle spi;
+    UART_Handle uart;
+    Task_Params taskParams;
+    int i;
+
+    for(i = 1 ; i < argc ; i++){
+        if(argv[i][0] != '-'){
+            pcFileName = argv[i];
+            continue;
+        }
+        if(i + 1 >= argc){
+            usage();
+        }
+        switch(argv[i][1]){
+        case 'b':
+            ui32Baud = strtoul(argv[++i], NULL, 0);
+            break;
+        case 'n':
+            ui32Bursts = strtoul(argv[++i], NULL, 0);
+            break;
+        case 's':
+            ui32BurstBytes = strtoul(argv[++i], NULL, 0);
+            break;
+        case 'p':
+            ui32PauseMs = strtoul(argv[++i], NULL, 0);
+            break;
+        default:
+            usage();
+        }
+    }
+    if((ui32Baud == 0) || (ui32BurstBytes == 0)){
+        usage();
+    }
+
+    ui32Sent = ui32Bursts*ui32BurstBytes;
+    pcSent = malloc(ui32Sent + 1);
+    pcReceived = malloc(ui32Sent + 1);
+    if((pcSent == NULL) || (pcReceived == NULL)){
+        fprintf(stderr, "Out of memory\n");
+        return 2;
+    }
+    for(ui32Index = 0 ; ui32Index < ui32Sent ; ui32Index++){
+        pcSent[ui32Index] = pcText[ui32Index % (sizeof(pcText) - 1)];
+    }
+
+    Emu_reset();
+    SPI_Params_init(&spiParams);
+    spiParams.bitRate = LOOPBACK_SPI_BITRATE;
+#if HX8357_SPI_STREAMING
+    spiParams.transferMode = SPI_MODE_CALLBACK;
+    spiParams.transferCallbackFxn = HX8357_spiCallback;
+#endif
+    spi = SPI_open(0, &spiParams);
+    HX8357_init(spi);
+    displaySetup(spi);
+
+    ByteRing_init(&uartRing);
+    Task_Params_init(&taskParams);
+    Task_construct(&screenTaskStruct, screenTaskFxn, &taskParams, NULL);
+    // The base address is only used for the error flags, which the loopback
+    // doesn't tell apart.
+    uart = UartRx_open(&uartRx, 0, 0, ui32Baud, &uartRing);
+    if(uart == NULL){
+        fprintf(stderr, "Couldn't open the UART\n");
+        return 2;
+    }
+
+    for(ui32Index = 0 ; ui32Index < ui32Bursts ; ui32Index++){
+        UART_write(uart, &pcSent[ui32Index*ui32BurstBytes], ui32BurstBytes);
+        usleep((uint64_t)ui32BurstBytes*10*1000000/ui32Baud + ui32PauseMs*1000);
+    }
+    // Wait for the last bytes, which only come out of the UART on the idle clock.
+    for(ui32Waited = 0 ; ui32Waited < LOOPBACK_DRAIN_MS ; ui32Waited++){
+        ui32Lost = uartRx.ui32NumDropped + UART_lostGet();
+        if(ui32Received + ui32Lost >= ui32Sent){
+            break;
+        }
+        usleep(1000);
+    }
+    // Let the screen task finish drawing before the screen is read.
+    usleep(10000);
+    UART_close(uart);
+    ui32Lost = uartRx.ui32NumDropped + UART_lostGet();
+    bMatch = (ui32Received == ui32Sent) && (memcmp(pcSent, pcReceived, ui32Sent) == 0);
+
+    if(!Emu_ppmWrite(pcFileName)){
+        fprintf(stderr, "Couldn't write %s\n", pcFileName);
+    }
+    printf("{\n  \"baud\": %u,\n  \"bursts\": %u,\n  \"burst_bytes\": %u,\n  \"pause_ms\": %u,\n",
+           (unsigned)ui32Baud, (unsigned)ui32Bursts, (unsigned)ui32BurstBytes, (unsigned)ui32PauseMs);
+    printf("  \"sent\": %u,\n  \"received\": %u,\n  \"buffers\": %u,\n  \"idle\": %u,\n",
+           (unsigned)ui32Sent, (unsigned)ui32Received, (unsigned)uartRx.ui32NumBuffers,
+           (unsigned)uartRx.ui32NumIdle);
+    printf("  \"dropped\": %u,\n  \"overruns\": %u,\n  \"fifo_lost\": %u,\n",
+           (unsigned)uartRx.ui32NumDropped, (unsigned)uartRx.ui32NumOverruns, (unsigned)UART_lostGet());
+    printf("  \"ring_max_fill\": %u,\n  \"batches\": %u,\n  \"match\": %s,\n  \"errors\": %u\n}\n",
+           (unsigned)uartRing.ui32MaxFill, (unsigned)ui32Batches, bMatch ? "true" : "false",
+           (unsigned)g_sEmuStats.ui32Errors);
+    if(g_sEmuStats.ui32Errors){
+        fprintf(stderr, "%u errors, last: %s\n", (unsigned)g_sEmuStats.ui32Errors, Emu_lastError());
+    }
+    return (bMatch && (g_sEmuStats.ui32Errors == 0)) ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+/*
+ * img2rle.c
+ *
+ *  Converts an image to the compressed format drawn by RleImage.c, as a C file
+ *  with a const array that ends up in flash. The image is read, compressed,
+ *  decompressed again and compared, and the sizes are printed.
+ *
+ *  Usage: img2rle [-n name] image file.c
+ *  -n  name of the array, g_pui8Image by default
+ *
+ *  The image can be a binary PPM (P6, 8 bits per color), or a BMP with 24 bits
+ *  per pixel or RGB565 (BI_BITFIELDS). Colors are cut down to RGB565 the same
+ *  way as the driver does.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rle_encode.h"
+
+static uint16_t *pui16Pixels;
+static uint32_t ui32Width, ui32Height;
+
+static uint32_t le32Get(const uint8_t *pui8Data){
+    return pui8Data[0] | (pui8Data[1] << 8) | (pui8Data[2] << 16) | ((uint32_t)pui8Data[3] << 24);
+}
+
+static uint16_t rgb565(uint8_t ui8Red, uint8_t ui8Green, uint8_t ui8Blue){
+    return ((ui8Red >> 3) << 11) | ((ui8Green >> 2) << 5) | (ui8Blue >> 3);
+}
+
+static bool pixelsAlloc(void){
+    if((ui32Width == 0) || (ui32Height == 0) || (ui32Width > 0xFFFF) || (ui32Height > 0xFFFF)){
+        return false;
+    }
+    pui16Pixels = malloc(2*ui32Width*ui32Height);
+    return pui16Pixels != NULL;
+}
+
+static bool ppmRead(FILE *pFile){
+    uint32_t ui32Max, ui32Index;
+    uint8_t pui8Rgb[3];
+
+    if((fscanf(pFile, "P6 %u %u %u", &ui32Width, &ui32Height, &ui32Max) != 3) || (ui32Max != 255) ||
+       (fgetc(pFile) == EOF) || !pixelsAlloc()){
+        return false;
+    }
+    for(ui32Index = 0 ; ui32Index < ui32Width*ui32Height ; ui32Index++){
+        if(fread(pui8Rgb, 1, 3, pFile) != 3){
+            return false;
+        }
+        pui16Pixels[ui32Index] = rgb565(pui8Rgb[0], pui8Rgb[1], pui8Rgb[2]);
+    }
+    return true;
+}
+
+static bool bmpRead(FILE *pFile){
+    uint8_t pui8Header[66], pui8Pixel[3];
+    uint32_t ui32Bpp, ui32Compression, ui32Stride, ui32Row, ui32Col;
+    int32_t i32Height;
+
+    if((fread(pui8Header, 1, sizeof(pui8Header), pFile) < 54) || (pui8Header[0] != 'B') ||
+       (pui8Header[1] != 'M')){
+        return false;
+    }
+    ui32Width = le32Get(&pui8Header[18]);
+    i32Height = (int32_t)le32Get(&pui8Header[22]);
+    ui32Height = i32Height < 0 ? -i32Height : i32Height;
+    ui32Bpp = pui8Header[28] | (pui8Header[29] << 8);
+    ui32Compression = le32Get(&pui8Header[30]);
+    if(!(((ui32Bpp == 24) && (ui32Compression == 0)) ||
+         ((ui32Bpp == 16) && (ui32Compression == 3) && (le32Get(&pui8Header[54]) == 0xF800) &&
+          (le32Get(&pui8Header[58]) == 0x07E0) && (le32Get(&pui8Header[62]) == 0x001F))) ||
+       !pixelsAlloc()){
+        return false;
+    }
+    ui32Stride = (ui32Width*ui32Bpp/8 + 3) & ~3;
+    for(ui32Row = 0 ; ui32Row < ui32Height ; ui32Row++){
+        // A positive height means that the rows are stored from the bottom up.
+        if(fseek(pFile, le32Get(&pui8Header[10]) +
+                 (i32Height > 0 ? ui32Height - 1 - ui32Row : ui32Row)*ui32Stride, SEEK_SET) != 0){
+            return false;
+        }
+        for(ui32Col = 0 ; ui32Col < ui32Width ; ui32Col++){
+            if(fread(pui8Pixel, 1, ui32Bpp/8, pFile) != ui32Bpp/8){
+                return false;
+            }
+            pui16Pixels[ui32Row*ui32Width + ui32Col] = (ui32Bpp == 24) ?
+                rgb565(pui8Pixel[2], pui8Pixel[1], pui8Pixel[0]) : pui8Pixel[0] | (pui8Pixel[1] << 8);
+        }
+    }
+    return true;
+}
+
+// Decompress pui8Image the simple way, and compare it with the pixels.
+static bool check(const uint8_t *pui8Image){
+    const uint8_t *pui8Data = pui8Image + RLEIMAGE_HEADER_SIZE;
+    uint32_t ui32Pos = 0, ui32Count, ui32Index;
+    uint16_t ui16Color;
+    uint8_t ui8Type;
+
+    while(ui32Pos < ui32Width*ui32Height){
+        ui8Type = *pui8Data & RLEIMAGE_TYPE_M;
+        ui32Count = (*pui8Data++ & RLEIMAGE_COUNT_M) + 1;
+        if(ui8Type == RLEIMAGE_LONG_RUN){
+            ui32Count = (((ui32Count - 1) << 8) | *pui8Data++) + 1;
+        }
+        for(ui32Index = 0 ; ui32Index < ui32Count ; ui32Index++){
+            if(ui8Type == RLEIMAGE_COPY){
+                ui16Color = pui16Pixels[ui32Pos - ui32Width];
+            }
+            else {
+                ui16Color = (pui8Data[0] << 8) | pui8Data[1];
+                if(ui8Type == RLEIMAGE_LITERAL){
+                    pui8Data += 2;
+                }
+            }
+            if(pui16Pixels[ui32Pos++] != ui16Color){
+                return false;
+            }
+        }
+        if((ui8Type == RLEIMAGE_RUN) || (ui8Type == RLEIMAGE_LONG_RUN)){
+            pui8Data += 2;
+        }
+    }
+    return ui32Pos == ui32Width*ui32Height;
+}
+
+static const char *baseName(const char *pcPath){
+    const char *pcSlash = strrchr(pcPath, '/');
+    return pcSlash ? pcSlash + 1 : pcPath;
+}
+
+static void usage(void){
+    fprintf(stderr, "Usage: img2rle [-n name] image file.c\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]){
+    const char *pcName = "g_pui8Image";
+    const char *pcImageName = NULL, *pcFileName = NULL;
+    uint8_t *pui8Image;
+    uint32_t ui32Bytes, ui32Index;
+    char pcMagic[2] = {0, 0};
+    FILE *pFile;
+    bool bOk;
+    int i;
+
+    for(i = 1 ; i < argc ; i++){
+        if((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)){
+            pcName = argv[++i];
+        }
+        else if(argv[i][0] == '-'){
+            usage();
+        }
+        else if(pcImageName == NULL){
+            pcImageName = argv[i];
+        }
+        else if(pcFileName == NULL){
+            pcFileName = argv[i];
+        }
+        else {
+            usage();
+        }
+    }
+    if(pcFileName == NULL){
+        usage();
+    }
+
+    pFile = fopen(pcImageName, "rb");
+    if(pFile == NULL){
+        fprintf(stderr, "Couldn't open %s\n", pcImageName);
+        return 2;
+    }
+    if(fread(pcMagic, 1, 2, pFile) != 2){
+        pcMagic[0] = 0;
+    }
+    rewind(pFile);
+    bOk = (pcMagic[0] == 'P') ? ppmRead(pFile) : bmpRead(pFile);
+    fclose(pFile);
+    if(!bOk){
+        fprintf(stderr, "%s isn't a supported image\n", pcImageName);
+        return 1;
+    }
+
+    pui8Image = malloc(RLE_ENCODE_MAX_BYTES(ui32Width, ui32Height));
+    if(pui8Image == NULL){
+        fprintf(stderr, "Out of memory\n");
+        return 2;
+    }
+    ui32Bytes = RleEncode_image(pui16Pixels, ui32Width, ui32Height, pui8Image);
+    if(!check(pui8Image)){
+        fprintf(stderr, "The compressed image came out different\n");
+        return 1;
+    }
+
+    pFile = fopen(pcFileName, "w");
+    if(pFile == NULL){
+        fprintf(stderr, "Couldn't write %s\n", pcFileName);
+        return 2;
+    }
+    fprintf(pFile, "/*\n * %s\n *\n *  Made with tools/img2rle from %s, %ux%u pixels, %u bytes instead of %u.\n"
+            " *  Drawn with RleImage_draw.\n */\n#include <stdint.h>\n\nconst uint8_t %s[%u] = {",
+            baseName(pcFileName), baseName(pcImageName), (unsigned)ui32Width, (unsigned)ui32Height,
+            (unsigned)ui32Bytes, (unsigned)(2*ui32Width*ui32Height), pcName, (unsigned)ui32Bytes);
+    for(ui32Index = 0 ; ui32Index < ui32Bytes ; ui32Index++){
+        fprintf(pFile, "%s0x%02X,", (ui32Index % 16) ? " " : "\n    ", pui8Image[ui32Index]);
+    }
+    fprintf(pFile, "\n};\n");
+    fclose(pFile);
+    printf("%ux%u, %u bytes instead of %u, %.1f times smaller\n", (unsigned)ui32Width,
+           (unsigned)ui32Height, (unsigned)ui32Bytes, (unsigned)(2*ui32Width*ui32Height),
+           2.0*ui32Width*ui32Height/ui32Bytes);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * rle_encode.c
+ *
+ *  Greedy compressor for the format in RleImage.h. At each pixel, whichever
+ *  packet covers the most pixels per byte is picked: a copy of the row above
+ *  (1 byte for up to 64 pixels), a run (3 bytes for up to 64 pixels, 4 bytes for
+ *  up to 16384) or, if neither covers enough, literal pixels up to where one does.
+ */
+#include "rle_encode.h"
+
+// A literal is ended for a run of at least this many pixels. A run of 2 takes as
+// many bytes as 2 literal pixels, once the new literal header after it is counted.
+#define RUN_MIN  3
+// A literal is ended for a copy of at least this many pixels.
+#define COPY_MIN 2
+
+#define COUNT_MAX    64
+#define LONG_RUN_MAX 16384
+
+// Number of pixels from ui32Pos that are the same as the one at ui32Pos, up to
+// LONG_RUN_MAX.
+static uint32_t runLength(const uint16_t *pui16Pixels, uint32_t ui32Pos, uint32_t ui32End){
+    uint32_t ui32Length = 1;
+    while((ui32Pos + ui32Length < ui32End) && (ui32Length < LONG_RUN_MAX) &&
+          (pui16Pixels[ui32Pos + ui32Length] == pui16Pixels[ui32Pos])){
+        ui32Length++;
+    }
+    return ui32Length;
+}
+
+// Number of pixels from ui32Pos that are the same as the ones in the row above, up
+// to COUNT_MAX.
+static uint32_t copyLength(const uint16_t *pui16Pixels, uint32_t ui32Pos, uint32_t ui32End,
+                           uint32_t ui32Width){
+    uint32_t ui32Length = 0;
+    if(ui32Pos < ui32Width){
+        return 0;
+    }
+    while((ui32Pos + ui32Length < ui32End) && (ui32Length < COUNT_MAX) &&
+          (pui16Pixels[ui32Pos + ui32Length] == pui16Pixels[ui32Pos + ui32Length - ui32Width])){
+        ui32Length++;
+    }
+    return ui32Length;
+}
+
+static uint8_t *colorPut(uint8_t *pui8Out, uint16_t ui16Color){
+    *pui8Out++ = ui16Color >> 8;
+    *pui8Out++ = ui16Color & 0xFF;
+    return pui8Out;
+}
+
+uint32_t RleEncode_image(const uint16_t *pui16Pixels, uint32_t ui32Width, uint32_t ui32Height,
+                         uint8_t *pui8Out){
+    uint32_t ui32End = ui32Width*ui32Height;
+    uint32_t ui32Pos = 0, ui32Run, ui32Copy, ui32Count;
+    uint8_t *pui8Start = pui8Out;
+
+    *pui8Out++ = RLEIMAGE_FORMAT;
+    *pui8Out++ = ui32Width & 0xFF;
+    *pui8Out++ = ui32Width >> 8;
+    *pui8Out++ = ui32Height & 0xFF;
+    *pui8Out++ = ui32Height >> 8;
+    while(ui32Pos < ui32End){
+        ui32Run = runLength(pui16Pixels, ui32Pos, ui32End);
+        ui32Copy = copyLength(pui16Pixels, ui32Pos, ui32End, ui32Width);
+        if((ui32Copy >= COPY_MIN) && (ui32Copy*(ui32Run > COUNT_MAX ? 4 : 3) >= ui32Run)){
+            *pui8Out++ = RLEIMAGE_COPY | (ui32Copy - 1);
+            ui32Pos += ui32Copy;
+        }
+        else if((ui32Run >= RUN_MIN) && (ui32Run > COUNT_MAX)){
+            *pui8Out++ = RLEIMAGE_LONG_RUN | ((ui32Run - 1) >> 8);
+            *pui8Out++ = (ui32Run - 1) & 0xFF;
+            pui8Out = colorPut(pui8Out, pui16Pixels[ui32Pos]);
+            ui32Pos += ui32Run;
+        }
+        else if(ui32Run >= RUN_MIN){
+            *pui8Out++ = RLEIMAGE_RUN | (ui32Run - 1);
+            pui8Out = colorPut(pui8Out, pui16Pixels[ui32Pos]);
+            ui32Pos += ui32Run;
+        }
+        else {
+            // Literal pixels, up to where a run or a copy starts
+            ui32Count = 1;
+            while((ui32Pos + ui32Count < ui32End) && (ui32Count < COUNT_MAX) &&
+                  (runLength(pui16Pixels, ui32Pos + ui32Count, ui32End) < RUN_MIN) &&
+                  (copyLength(pui16Pixels, ui32Pos + ui32Count, ui32End, ui32Width) < COPY_MIN)){
+                ui32Count++;
+            }
+            *pui8Out++ = RLEIMAGE_LITERAL | (ui32Count - 1);
+            while(ui32Count--){
+                pui8Out = colorPut(pui8Out, pui16Pixels[ui32Pos++]);
+            }
+        }
+    }
+    return pui8Out - pui8Start;
+}
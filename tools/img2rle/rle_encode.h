@@ -0,0 +1,25 @@
+/*
+ * rle_encode.h
+ *
+ *  Compresses RGB565 images into the format drawn by RleImage.c, see RleImage.h.
+ *  Used by img2rle, and by the benchmark in tools/hx8357_emu.
+ *
+ */
+
+#ifndef RLE_ENCODE_H_
+#define RLE_ENCODE_H_
+#include <stdint.h>
+#include "RleImage.h"
+
+// Most bytes an image of ui32Width*ui32Height pixels can take, when nothing can
+// be compressed
+#define RLE_ENCODE_MAX_BYTES(ui32Width, ui32Height) \
+    (RLEIMAGE_HEADER_SIZE + 2*(ui32Width)*(ui32Height) + ((ui32Width)*(ui32Height) + 63)/64)
+
+// Compress ui32Width*ui32Height pixels, RGB565 row after row from the top left,
+// into pui8Out, which must fit RLE_ENCODE_MAX_BYTES. Returns the number of bytes,
+// header included.
+uint32_t RleEncode_image(const uint16_t *pui16Pixels, uint32_t ui32Width, uint32_t ui32Height,
+                         uint8_t *pui8Out);
+
+#endif /* RLE_ENCODE_H_ */
@@ -7,64 +7,155 @@
 #include <pthread.h>
 #include <semaphore.h>
 #include <unistd.h>
-#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <xdc/std.h>
+#include <xdc/runtime/System.h>
 #include "ADAFRUIT_2050.h"
+#include "Trace.h"
 #include "board.h"
 #include <ti/drivers/GPIO.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#if HX8357_SPI_STREAMING
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#endif
 
-void sendLcdCommand(SPI_Handle spiHandle, char command, char* pData, uint32_t numData, uint32_t delayUs){
+// The DMA can transfer at most 1024 frames at a time, so larger transfers are
+// broken up into chunks of this size.
+#define SPI_CHUNK_BYTES 1024
+
+// SPI_transfer, traced if HX8357_TRACE is set.
+static bool spiTransfer(SPI_Handle spiHandle, SPI_Transaction *pTransaction){
+#if HX8357_TRACE
+    uint32_t ui32Count = pTransaction->count;
+    bool bOk;
+    TRACE_IN(TRACE_SPI_TRANSFER, ui32Count);
+    bOk = SPI_transfer(spiHandle, pTransaction);
+    TRACE_OUT(TRACE_SPI_TRANSFER, ui32Count);
+    return bOk;
+#else
+    return SPI_transfer(spiHandle, pTransaction);
+#endif
+}
+
+#if HX8357_SPI_STREAMING
+// State of the ping-pong transfer stream. The SPI is opened in callback mode, and
+// two transaction descriptors are used in turn: while one chunk is transferred by
+// the DMA the next one is queued, and the callback starts it straight away. This
+// way the SSI doesn't sit idle while the task sets up the next transfer.
+typedef struct
+{
+    SPI_Transaction pTransaction[2];     // Ping-pong descriptors
+    uint32_t ui32Next;                   // Descriptor to use for the next chunk
+    SPI_Transaction * volatile pQueued;  // Chunk waiting for the active one to finish
+    volatile uint32_t ui32Pending;       // Chunks started or queued, but not done (0..2)
+    Semaphore_Struct doneSemStruct;      // Posted every time a chunk is done
+    Semaphore_Handle doneSemHandle;
+}
+tSpiStream;
+static tSpiStream spiStream;
+
+// SPI callback, must be set as transferCallbackFxn when the SPI is opened.
+// Called by the SPI driver when a chunk is done. Starts the queued chunk if there
+// is one, and lets the task know that a descriptor is free.
+void HX8357_spiCallback(SPI_Handle spiHandle, SPI_Transaction *transaction){
+    SPI_Transaction *pQueued = spiStream.pQueued;
+    TRACE_IN(TRACE_SPI_CALLBACK, transaction->count);
+    spiStream.ui32Pending--;
+    if(pQueued != NULL){
+        spiStream.pQueued = NULL;
+        if(!spiTransfer(spiHandle, pQueued)){
+            // Only fails if a transfer is active, which can't be since this one is done.
+            System_abort("HX8357: queued SPI transfer couldn't be started\n");
+        }
+    }
+    Semaphore_post(spiStream.doneSemHandle);
+    TRACE_OUT(TRACE_SPI_CALLBACK, transaction->count);
+}
+
+// Wait until at most ui32MaxPending chunks are not yet done.
+static void spiWaitPending(uint32_t ui32MaxPending){
+    while(spiStream.ui32Pending > ui32MaxPending){
+        Semaphore_pend(spiStream.doneSemHandle, BIOS_WAIT_FOREVER);
+    }
+}
+
+// Queue one chunk (at most SPI_CHUNK_BYTES) for transfer. If the SPI is idle it is
+// started directly, otherwise it's started from the callback when the active chunk
+// is done. Blocks while both descriptors are in use.
+static void spiQueueChunk(SPI_Handle spiHandle, char *pData, uint32_t numData){
+    SPI_Transaction *pTransaction;
+    UInt key;
+
+    spiWaitPending(1);
+    pTransaction = &spiStream.pTransaction[spiStream.ui32Next];
+    spiStream.ui32Next ^= 1;
+    pTransaction->txBuf = (void *) pData;
+    pTransaction->rxBuf = (void *) NULL;
+    pTransaction->count = numData;
+
+    key = Hwi_disable();
+    spiStream.ui32Pending++;
+    if(spiStream.ui32Pending == 1){
+        // Nothing is active, so start the transfer here.
+        Hwi_restore(key);
+        if(!spiTransfer(spiHandle, pTransaction)){
+            System_abort("HX8357: SPI transfer couldn't be started\n");
+        }
+    }
+    else {
+        spiStream.pQueued = pTransaction;
+        Hwi_restore(key);
+    }
+}
+#else
+// Without streaming, the SPI is used in blocking mode and nothing is ever pending.
+static void spiWaitPending(uint32_t ui32MaxPending){
+}
+
+static void spiQueueChunk(SPI_Handle spiHandle, char *pData, uint32_t numData){
     SPI_Transaction transaction;
-    transaction.count = 1; // 1 byte at a time for
-    volatile char cmdBuf = command;
+    transaction.txBuf = (void *) pData;
     transaction.rxBuf = (void *) NULL;
-    transaction.txBuf = (void *) &cmdBuf;
-    // If the command isn't 0xFF, send a command
-    if(command != HX8357_NO_COMMAND){
-        // Drive the D/C low for command.
-        GPIO_write(GPIO_DC_PIN, 0);
-        // Drive manual CS low:
-        GPIO_write(GPIO_CS_PIN, 0);
-        // Send command
-        SPI_transfer(spiHandle, &transaction);
-        // Drive the D/C high for end of command.
-        GPIO_write(GPIO_DC_PIN, 1);
+    transaction.count = numData;
+    if(!spiTransfer(spiHandle, &transaction)){
+        System_abort("HX8357: SPI transfer couldn't be started\n");
     }
-    // Send data if any
-    if(pData != NULL){
-        // The data is maximum 1024 frames, hence if numData is larger that 1024, then we need to
-        // break up the transfer. This is due to the DMA.
-        if(numData < 1024){
-            transaction.txBuf = (void *) pData;
-            transaction.count = numData;
-            if(!SPI_transfer(spiHandle, &transaction)){
-                // TODO: catch error and handle it instead of looping forever.
-                while(1);
-            }
-        }
-        else {
-            uint32_t dataLeft = numData;
-            uint32_t dataWritten = 0;
-            transaction.txBuf = (void *) pData;
-            transaction.count = 1024;
-            while(dataLeft > 0){
-                if(!SPI_transfer(spiHandle, &transaction)){
-                    // TODO: catch error and handle it instead of looping forever.
-                    while(1);
-                }
-                dataWritten += transaction.count;
-                dataLeft -= transaction.count;
-                transaction.txBuf = (void *) &pData[dataWritten];
-                if(dataLeft > 1024){
-                    transaction.count = 1024;
-                }
-                else {
-                    transaction.count = dataLeft;
-                }
-            }
-        }
+}
+#endif
+
+// Queue numData bytes for transfer, broken up into DMA sized chunks. Returns when the
+// last chunk is queued, so the data must be left untouched until spiWaitPending(0)
+// has returned. spiWaitPending(1) is enough for all but the last chunk.
+static void spiWriteQueued(SPI_Handle spiHandle, char *pData, uint32_t numData){
+    while(numData > SPI_CHUNK_BYTES){
+        spiQueueChunk(spiHandle, pData, SPI_CHUNK_BYTES);
+        pData += SPI_CHUNK_BYTES;
+        numData -= SPI_CHUNK_BYTES;
+    }
+    if(numData > 0){
+        spiQueueChunk(spiHandle, pData, numData);
     }
+}
+
+// Initialize the SPI stream. Called by HX8357_init before anything is sent.
+static void spiStreamInit(void){
+#if HX8357_SPI_STREAMING
+    spiStream.ui32Next = 0;
+    spiStream.pQueued = NULL;
+    spiStream.ui32Pending = 0;
+    Semaphore_construct(&spiStream.doneSemStruct, 0, NULL);
+    spiStream.doneSemHandle = Semaphore_handle(&spiStream.doneSemStruct);
+#endif
+}
+
+void sendLcdCommand(SPI_Handle spiHandle, char command, char* pData, uint32_t numData, uint32_t delayUs){
+    // Drive manual CS low:
+    GPIO_write(GPIO_CS_PIN, 0);
+    // Send the command and data
+    sendLcdCommandNoCS(spiHandle, command, pData, numData, 0);
     // Drive manual CS high:
     GPIO_write(GPIO_CS_PIN, 1);
     // Delay if needed.
@@ -73,54 +164,23 @@ void sendLcdCommand(SPI_Handle spiHandle, char command, char* pData, uint32_t nu
     }
 }
 
-// Same function as above but without touching the CS
+// Same function as above but without touching the CS.
+// Returns when all data is sent, so pData can be reused right away.
 void sendLcdCommandNoCS(SPI_Handle spiHandle, char command, char* pData, uint32_t numData, uint32_t delayUs){
-    SPI_Transaction transaction;
-    transaction.count = 1; // 1 byte at a time for
-    transaction.rxBuf = (void *) NULL;
-    transaction.txBuf = (void *) &command;
     // If the command isn't 0xFF, send a command
     if(command != HX8357_NO_COMMAND){
         // Drive the D/C low for command.
         GPIO_write(GPIO_DC_PIN, 0);
-        // Send command
-        SPI_transfer(spiHandle, &transaction);
+        // Send command, which must be out before D/C goes high again.
+        spiWriteQueued(spiHandle, &command, 1);
+        spiWaitPending(0);
         // Drive the D/C high for end of command.
         GPIO_write(GPIO_DC_PIN, 1);
     }
-    // Send data if any
+    // Send data if any. Large transfers are streamed chunk by chunk.
     if(pData != NULL){
-        // The data is maximum 1024 frames, hence if numData is larger that 1024, then we need to
-        // break up the transfer. This is due to the DMA.
-        if(numData < 1024){
-            transaction.txBuf = (void *) pData;
-            transaction.count = numData;
-            if(!SPI_transfer(spiHandle, &transaction)){
-                // TODO: catch error and handle it instead of looping forever.
-                while(1);
-            }
-        }
-        else {
-            uint32_t dataLeft = numData;
-            uint32_t dataWritten = 0;
-            transaction.txBuf = (void *) pData;
-            transaction.count = 1024;
-            while(dataLeft > 0){
-                if(!SPI_transfer(spiHandle, &transaction)){
-                    // TODO: catch error and handle it instead of looping forever.
-                    while(1);
-                }
-                dataWritten += transaction.count;
-                dataLeft -= transaction.count;
-                transaction.txBuf = (void *) &pData[dataWritten];
-                if(dataLeft > 1024){
-                    transaction.count = 1024;
-                }
-                else {
-                    transaction.count = dataLeft;
-                }
-            }
-        }
+        spiWriteQueued(spiHandle, pData, numData);
+        spiWaitPending(0);
     }
     // Delay if needed.
     if(delayUs > 0){
@@ -128,152 +188,556 @@ void sendLcdCommandNoCS(SPI_Handle spiHandle, char command, char* pData, uint32_
     }
 }
 
+// Fill pvBuf with ui32NumPixels pixels of the (translated) color ui32Color, in the
+// byte order used by the screen. This is the fill kernel shared by all drawing
+// functions. pvBuf must be at least 2-byte aligned. The 16-bit pattern is
+// replicated into a 32-bit word so that the bulk of the buffer is written with
+// word stores, 8 pixels per loop iteration.
+void HX8357_fillColor(void *pvBuf, uint32_t ui32Color, uint32_t ui32NumPixels){
+    uint16_t ui16Pixel = HX8357_SWAP16(ui32Color);
+    uint16_t *pui16Buf = (uint16_t *)pvBuf;
+    uint32_t *pui32Buf;
+    uint32_t ui32Pattern;
+
+    // Write one pixel if needed to get to a word boundary.
+    if((((uintptr_t)pui16Buf) & 2) && (ui32NumPixels > 0)){
+        *pui16Buf++ = ui16Pixel;
+        ui32NumPixels--;
+    }
+
+    pui32Buf = (uint32_t *)pui16Buf;
+    ui32Pattern = ((uint32_t)ui16Pixel << 16) | ui16Pixel;
+    while(ui32NumPixels >= 8){
+        pui32Buf[0] = ui32Pattern;
+        pui32Buf[1] = ui32Pattern;
+        pui32Buf[2] = ui32Pattern;
+        pui32Buf[3] = ui32Pattern;
+        pui32Buf += 4;
+        ui32NumPixels -= 8;
+    }
+    while(ui32NumPixels >= 2){
+        *pui32Buf++ = ui32Pattern;
+        ui32NumPixels -= 2;
+    }
+
+    // And the last odd pixel, if any.
+    if(ui32NumPixels > 0){
+        *(uint16_t *)pui32Buf = ui16Pixel;
+    }
+}
+
+// Add the bytes of two words, each byte saturating at 255 (UQADD8). The Cortex-M4
+// does all four in one instruction, the portable version adds the low 7 bits of
+// each byte, works out the carry out of each byte from the top bits, and sets the
+// bytes that carried to 255.
+#if defined(__TI_ARM__)
+#define RGB_UQADD8(a, b) ((uint32_t)_uqadd8((a), (b)))
+#elif defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#define RGB_UQADD8(a, b) ((uint32_t)__uqadd8((a), (b)))
+#else
+static inline uint32_t RGB_UQADD8(uint32_t ui32A, uint32_t ui32B){
+    uint32_t ui32Sum = (ui32A & 0x7F7F7F7F) + (ui32B & 0x7F7F7F7F);
+    uint32_t ui32Carry = ((ui32A & ui32B) | ((ui32A ^ ui32B) & ui32Sum)) & 0x80808080;
+    return (ui32Sum ^ ((ui32A ^ ui32B) & 0x80808080)) | ((ui32Carry >> 7)*0xFF);
+}
+#endif
+
+// 4x4 ordered dither (Bayer) thresholds, 0 to 15, by row and column on the screen
+static const uint8_t pui8Bayer[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5}
+};
+
+// Get the next pixel of 24-bit color from *ppui8In, see HX8357_rgbConvert, add the
+// dither thresholds of all channels in ui32Dither to it with one saturating add, and
+// cut it down to RGB565.
+static inline uint32_t rgbPixelGet(const uint8_t **ppui8In, uint32_t ui32Format, uint32_t ui32Dither){
+    const uint8_t *pui8In = *ppui8In;
+    uint32_t ui32Pixel;
+
+    if(ui32Format == HX8357_RGB_BGR24){
+        ui32Pixel = pui8In[0] | (pui8In[1] << 8) | ((uint32_t)pui8In[2] << 16);
+        *ppui8In = pui8In + 3;
+    }
+    else {
+        ui32Pixel = *(const uint32_t *)pui8In;
+        *ppui8In = pui8In + 4;
+    }
+    ui32Pixel = RGB_UQADD8(ui32Pixel, ui32Dither);
+    return ((ui32Pixel >> 8) & 0xF800) | ((ui32Pixel >> 5) & 0x07E0) | ((ui32Pixel >> 3) & 0x001F);
+}
+
+// Convert ui32Count pixels of 24-bit color, going right from (i32X, i32Y) on the
+// screen, to RGB565 in the byte order used by the screen. The pixels in pvIn are
+// HX8357_RGB_XRGB32 (uint32_t 0x00RRGGBB like GRLIB colors, word aligned) or
+// HX8357_RGB_BGR24 (blue, green and red bytes like BMP files). pui16Out may be the
+// same as pvIn, since no pixel gets longer.
+// Without dithering the colors come out the same as with ColorTranslate. With
+// dithering, a threshold from a 4x4 ordered dither on the screen coordinates is
+// added to each channel before the bits RGB565 can't show are cut off, so that
+// areas of a color in between two RGB565 colors get a mix of both.
+void HX8357_rgbConvert(uint16_t *pui16Out, const void *pvIn, uint32_t ui32Format, uint32_t ui32Count,
+                       int32_t i32X, int32_t i32Y, bool bDither){
+    const uint8_t *pui8In = (const uint8_t *)pvIn;
+    uint32_t pui32Dither[4] = {0, 0, 0, 0};
+    uint32_t ui32Phase = i32X & 3;
+    uint32_t *pui32Out;
+    uint32_t ui32Index, ui32Threshold, ui32Pair;
+
+    if(bDither){
+        // 3 bits of red and blue are lost and 2 of green, so their thresholds go
+        // from 0 to 7 and 0 to 3.
+        for(ui32Index = 0 ; ui32Index < 4 ; ui32Index++){
+            ui32Threshold = pui8Bayer[i32Y & 3][ui32Index];
+            pui32Dither[ui32Index] = ((ui32Threshold >> 1) << 16) | ((ui32Threshold >> 2) << 8) |
+                                     (ui32Threshold >> 1);
+        }
+    }
+
+    // Convert one pixel if needed to get to a word boundary, then two at a time,
+    // swapped together and written with one word store.
+    if((((uintptr_t)pui16Out) & 2) && (ui32Count > 0)){
+        ui32Pair = rgbPixelGet(&pui8In, ui32Format, pui32Dither[ui32Phase]);
+        *pui16Out++ = HX8357_SWAP16(ui32Pair);
+        ui32Phase = (ui32Phase + 1) & 3;
+        ui32Count--;
+    }
+    pui32Out = (uint32_t *)pui16Out;
+    while(ui32Count >= 2){
+        ui32Pair = rgbPixelGet(&pui8In, ui32Format, pui32Dither[ui32Phase]);
+        ui32Pair |= rgbPixelGet(&pui8In, ui32Format, pui32Dither[(ui32Phase + 1) & 3]) << 16;
+        *pui32Out++ = ((ui32Pair >> 8) & 0x00FF00FF) | ((ui32Pair << 8) & 0xFF00FF00);
+        ui32Phase = (ui32Phase + 2) & 3;
+        ui32Count -= 2;
+    }
+
+    // And the last odd pixel, if any.
+    if(ui32Count > 0){
+        ui32Pair = rgbPixelGet(&pui8In, ui32Format, pui32Dither[ui32Phase]);
+        *(uint16_t *)pui32Out = HX8357_SWAP16(ui32Pair);
+    }
+}
+
+// Dither the 24-bit colors of images from now on, see HX8357_rgbConvert. ColorTranslate
+// doesn't know where a color goes, so this only works where the pixels are converted
+// together with their position: 8 bpp images drawn by PixelDrawMultiple (also through
+// the display queue and the frame buffer), images drawn with ImageStream_draw, and
+// gradients.
+void HX8357_ditherSet(tDisplayData *pDisplayData, bool bDither){
+    pDisplayData->bDither = bDither;
+}
 
 // Function to set the address window. Note that sendLcdCommand cannot be used, as it toggles the DC & CS pins
 // CS must be set outside of this function, while DC is set inside this function.
-void setAddressWindow(SPI_Handle spiHandle, uint16_t y, uint16_t x, uint16_t height, uint32_t width){
-    char colAddr[4];
-    colAddr[0] = (x & 0xFF00)>>8;
-    colAddr[1] = (x & 0xFF);
-    colAddr[2] = ((x + width - 1) & 0xFF00)>>8;
-    colAddr[3] = ((x + width - 1) & 0x00FF);
-    char rowAddr[4];
-    rowAddr[0] = (y & 0xFF00)>>8;
-    rowAddr[1] = (y & 0xFF);
-    rowAddr[2] = ((y + height - 1) & 0xFF00)>>8;
-    rowAddr[3] = ((y + height - 1) & 0x00FF);
-    // Set the columns
-    sendLcdCommand(spiHandle, HX8357_CASET, (char*)&colAddr, 4, 0);
-    // Set rows
-    sendLcdCommand(spiHandle, HX8357_PASET, (char*)&rowAddr, 4, 0);
-    // Sent RAMWR:
-    //sendLcdCommand(spiHandle, HX8357_RAMWR, NULL, 0, 0);
+// The last window sent is kept in pDisplayData, and CASET/PASET are only sent if
+// the column/row range actually changed, since the screen keeps them until the next
+// CASET/PASET. RAMWR always starts over at the start of the window.
+void setAddressWindow(tDisplayData *pDisplayData, uint16_t y, uint16_t x, uint16_t height, uint32_t width){
+    SPI_Handle spiHandle = pDisplayData->spiHandle;
+    uint16_t ui16ColEnd = x + width - 1;
+    uint16_t ui16RowEnd = y + height - 1;
+    // Set the columns if needed
+    if(!pDisplayData->bWindowValid ||
+       (pDisplayData->ui16ColStart != x) || (pDisplayData->ui16ColEnd != ui16ColEnd)){
+        char colAddr[4];
+        colAddr[0] = (x & 0xFF00)>>8;
+        colAddr[1] = (x & 0xFF);
+        colAddr[2] = (ui16ColEnd & 0xFF00)>>8;
+        colAddr[3] = (ui16ColEnd & 0x00FF);
+        sendLcdCommandNoCS(spiHandle, HX8357_CASET, (char*)&colAddr, 4, 0);
+        pDisplayData->ui16ColStart = x;
+        pDisplayData->ui16ColEnd = ui16ColEnd;
+    }
+    // Set rows if needed
+    if(!pDisplayData->bWindowValid ||
+       (pDisplayData->ui16RowStart != y) || (pDisplayData->ui16RowEnd != ui16RowEnd)){
+        char rowAddr[4];
+        rowAddr[0] = (y & 0xFF00)>>8;
+        rowAddr[1] = (y & 0xFF);
+        rowAddr[2] = (ui16RowEnd & 0xFF00)>>8;
+        rowAddr[3] = (ui16RowEnd & 0x00FF);
+        sendLcdCommandNoCS(spiHandle, HX8357_PASET, (char*)&rowAddr, 4, 0);
+        pDisplayData->ui16RowStart = y;
+        pDisplayData->ui16RowEnd = ui16RowEnd;
+    }
+    pDisplayData->bWindowValid = true;
+}
+
+// Initialize the driver specific data used by the GRLIB functions.
+// Must be called before the tDisplay struct is handed to GRLIB.
+void HX8357_initDisplayData(tDisplayData *pDisplayData, SPI_Handle spiHandle){
+    pDisplayData->spiHandle = spiHandle;
+    // Nothing is known about the address window on the screen yet.
+    pDisplayData->bWindowValid = false;
+    // The scratch pool starts out empty.
+    pDisplayData->ui32ScratchUsed = 0;
+    pDisplayData->ui32ScratchHighWater = 0;
+    pDisplayData->ui32ScratchShortCount = 0;
+    pDisplayData->bDither = false;
+}
+
+// Set the orientation of the screen, i.e. how x/y of the drawing functions map to the
+// panel. ui8Madctl is HX8357_LANDSCAPE, HX8357_PORTRAIT or any other MADCTL value.
+// The tDisplay width and height must be changed to match. Nothing may be drawing while
+// this is called, so flush GRLIB first when drawing through the queue or frame buffer.
+void HX8357_orientationSet(tDisplayData *pDisplayData, uint8_t ui8Madctl){
+    char madctl = ui8Madctl;
+    sendLcdCommand(pDisplayData->spiHandle, HX8357_MADCTL, &madctl, 1, 0);
+    // The address window on the screen means something else now.
+    pDisplayData->bWindowValid = false;
+}
+
+// Vertical scrolling (VSCRDEF and VSCRSADD). Scrolling works on the
+// lines of the panel, i.e. y in HX8357_PORTRAIT. The ui16Height lines from ui16Top
+// are scrolled, the lines above and below stay where they are.
+// Nothing may be drawing while these are called, same as for HX8357_orientationSet.
+void HX8357_scrollAreaSet(tDisplayData *pDisplayData, uint16_t ui16Top, uint16_t ui16Height){
+    uint16_t ui16Bottom = HX8357_TFTHEIGHT - ui16Top - ui16Height;
+    char scrollDef[6];
+    scrollDef[0] = (ui16Top & 0xFF00)>>8;
+    scrollDef[1] = (ui16Top & 0xFF);
+    scrollDef[2] = (ui16Height & 0xFF00)>>8;
+    scrollDef[3] = (ui16Height & 0xFF);
+    scrollDef[4] = (ui16Bottom & 0xFF00)>>8;
+    scrollDef[5] = (ui16Bottom & 0xFF);
+    sendLcdCommand(pDisplayData->spiHandle, HX8357_VSCRDEF, scrollDef, 6, 0);
+    // The datasheet doesn't say if the address window is kept across VSCRDEF, so it
+    // is sent again.
+    pDisplayData->bWindowValid = false;
+}
+
+// Show screen memory line ui16Line at the top of the scroll area. The lines below it
+// follow, wrapping around from the end of the scroll area to its top. Drawing is
+// not affected, it still goes to the screen memory as if nothing was scrolled.
+void HX8357_scrollStartSet(tDisplayData *pDisplayData, uint16_t ui16Line){
+    char scrollStart[2];
+    scrollStart[0] = (ui16Line & 0xFF00)>>8;
+    scrollStart[1] = (ui16Line & 0xFF);
+    sendLcdCommand(pDisplayData->spiHandle, HX8357_VSCRSADD, scrollStart, 2, 0);
+}
+
+// Borrow a buffer from the scratch pool in pDisplayData. ui32Bytes is the wanted size,
+// and the size actually given (a multiple of 4, possibly less than asked for) is
+// returned in pui32Granted. Returns NULL, with *pui32Granted = 0, if the pool is empty.
+// Buffers are handed out stack-wise, so they must be returned in the reverse order of
+// borrowing. The buffers are 4-byte aligned and live in static memory, so they can be
+// handed to the DMA directly.
+char *HX8357_scratchBorrow(tDisplayData *pDisplayData, uint32_t ui32Bytes, uint32_t *pui32Granted){
+    uint32_t ui32Free = HX8357_SCRATCH_BYTES - pDisplayData->ui32ScratchUsed;
+    char *pBuf;
+
+    // Round up to keep the next buffer aligned.
+    ui32Bytes = (ui32Bytes + 3) & ~3;
+    if(ui32Bytes > ui32Free){
+        ui32Bytes = ui32Free;
+        pDisplayData->ui32ScratchShortCount++;
+    }
+    *pui32Granted = ui32Bytes;
+    if(ui32Bytes == 0){
+        return NULL;
+    }
+    pBuf = (char *)pDisplayData->pui32Scratch + pDisplayData->ui32ScratchUsed;
+    pDisplayData->ui32ScratchUsed += ui32Bytes;
+    if(pDisplayData->ui32ScratchUsed > pDisplayData->ui32ScratchHighWater){
+        pDisplayData->ui32ScratchHighWater = pDisplayData->ui32ScratchUsed;
+    }
+    return pBuf;
+}
+
+// Give a buffer from HX8357_scratchBorrow back to the pool. Anything borrowed after
+// pBuf is given back as well. NULL and buffers not from the pool are ignored.
+void HX8357_scratchReturn(tDisplayData *pDisplayData, char *pBuf){
+    char *pPool = (char *)pDisplayData->pui32Scratch;
+    if((pBuf >= pPool) && (pBuf < pPool + pDisplayData->ui32ScratchUsed)){
+        pDisplayData->ui32ScratchUsed = pBuf - pPool;
+    }
+}
+
+// Init sequence for the screen. Each entry is: command, control byte, parameters,
+// and a delay byte if INIT_DELAY is set in the control byte. The delay is the minimum
+// time in ms before the next command may be sent, counted from this command, or from
+// the start of the sequence if INIT_SINCE_START is set. Delays are only used where
+// the datasheet needs them. HX8357_NO_COMMAND entries only wait.
+#define INIT_DELAY       0x80
+#define INIT_SINCE_START 0x40
+#define INIT_NUM_ARGS    0x3F
+static const uint8_t initSequence[] = {
+    // Soft reset. No command may be sent within 5 ms, and SLPOUT not within 120 ms.
+    HX8357_SWRESET, INIT_DELAY, 5,
+    // SETEXTC, enable the extended commands
+    HX8357D_SETC, 3, 0xFF, 0x83, 0x57,
+    // SETRGB: Enable SDO, EPF (colormapping) = 00, MPU interface for RAM access, internal oscillator.
+    // Rising edge of DOTCLK, active low HSYNC, active low VSYNC, active high enable pin.
+    // Horizontal and vertical blanking period default.
+    HX8357_SETRGB, 4, 0x80, 0x00, 0x06, 0x06,
+    // SETCOM, set to -1.52V.
+    // NOTE: This doesn't really make any sense. Datasheet and adafruits docs doesn't correspond here.
+    // Should be 0x2C according to datasheet, but 0.25 according to adafruit.
+    HX8357D_SETCOM, 1, 0x25,
+    // SETOSC, setting to 75 Hz, idle 60Hz. This is again settings that differ between
+    // adafruit comments and datasheet. According to adafruit it's 70/55 Hz
+    HX8357_SETOSC, 1, 0x68,
+    // SETPANEL, BGR with gate direction swapped. If we want normally black panel,
+    // set bit 1 = 1, see page 224 in datasheet.
+    HX8357_SETPANEL, 1, 0x05,
+    // SETPWR1: Not deep standby, BT, VSPR, VSNR, AP, FS
+    HX8357_SETPWR1, 6, 0x00, 0x15, 0x1C, 0x1C, 0x83, 0xAA,
+    // SETSTBA: OPON normal, OPON idle, STBA x3, GEN
+    HX8357D_SETSTBA, 6, 0x50, 0x50, 0x01, 0x3C, 0x1E, 0x08,
+    // SETCYC: NW, RTN, DIV, DUM, DUM, GDON, GDOFF
+    HX8357D_SETCYC, 7, 0x02, 0x40, 0x00, 0x2A, 0x2A, 0x0D, 0x78,
+    // SETGAMMA
+    HX8357D_SETGAMMA, 34,
+    0x02, 0x0A, 0x11, 0x1d, 0x23, 0x35, 0x41, 0x4b, 0x4b, 0x42, 0x3A, 0x27,
+    0x1B, 0x08, 0x09, 0x03, 0x02, 0x0A, 0x11, 0x1d, 0x23, 0x35, 0x41, 0x4b,
+    0x4b, 0x42, 0x3A, 0x27, 0x1B, 0x08, 0x09, 0x03, 0x00, 0x01,
+    // COLMOD, 16 bit per pixel
+    HX8357_COLMOD, 1, 0x55,
+    // MADCTL, see page 61 and 157. [MY, MX, MV] = [1, 0, 1]
+    HX8357_MADCTL, 1, 1<<7 | 0<<6 | 1<<5,
+    // TEON, TW off
+    HX8357_TEON, 1, 0x00,
+    // TEARLINE
+    HX8357_TEARLINE, 2, 0x00, 0x02,
+    // Wait until 120 ms after the soft reset, then SLPOUT. No command may be sent
+    // within 5 ms after that.
+    HX8357_NO_COMMAND, INIT_DELAY | INIT_SINCE_START, 120,
+    HX8357_SLPOUT, INIT_DELAY, 5,
+    // DISPON, turning on screen.
+    HX8357_DISPON, 0,
+};
+
+// The reset pin is released in main(), before BIOS is started and the clock starts
+// counting. No command may be sent within 5 ms after that.
+#define INIT_RESET_WAIT_US 5000
+
+// Where the init sequence is at, between HX8357_initBegin and HX8357_initFinish.
+// The timing can be read from the debugger as well.
+typedef struct
+{
+    SPI_Handle spiHandle;
+    const uint8_t *pui8Next;    // Next entry in initSequence
+    uint32_t ui32StartUs;       // When the sequence was started
+    uint32_t ui32DeadlineUs;    // The next command may not be sent before this
+    uint32_t ui32BeginUs;       // When HX8357_initBegin was called
+    uint32_t ui32WaitedUs;      // Time spent waiting for deadlines
+    uint32_t ui32DoneUs;        // When the sequence was done
+}
+tInitState;
+static tInitState initState;
+
+// Time since BIOS was started, in us.
+static uint32_t timeNowUs(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+// Send entries from the init sequence until it is done, or until the next entry
+// isn't allowed yet and bWait is false. Returns true when the sequence is done.
+static bool initPlay(bool bWait){
+    const uint8_t *pui8Entry;
+    uint32_t ui32Now;
+    uint32_t ui32NumArgs;
+    uint32_t ui32Delay;
+
+    while(initState.pui8Next < initSequence + sizeof(initSequence)){
+        ui32Now = timeNowUs();
+        if((int32_t)(initState.ui32DeadlineUs - ui32Now) > 0){
+            if(!bWait){
+                return false;
+            }
+            usleep(initState.ui32DeadlineUs - ui32Now);
+            initState.ui32WaitedUs += initState.ui32DeadlineUs - ui32Now;
+            ui32Now = timeNowUs();
+        }
+        pui8Entry = initState.pui8Next;
+        ui32NumArgs = pui8Entry[1] & INIT_NUM_ARGS;
+        if(pui8Entry[0] != HX8357_NO_COMMAND){
+            if(pui8Entry == initSequence){
+                initState.ui32StartUs = ui32Now;
+            }
+            // The parameters are sent straight from flash.
+            sendLcdCommandNoCS(initState.spiHandle, pui8Entry[0],
+                               ui32NumArgs ? (char *)&pui8Entry[2] : NULL, ui32NumArgs, 0);
+        }
+        initState.pui8Next += 2 + ui32NumArgs;
+        if(pui8Entry[1] & INIT_DELAY){
+            ui32Delay = 1000*(*initState.pui8Next++);
+            ui32Delay += (pui8Entry[1] & INIT_SINCE_START) ? initState.ui32StartUs : ui32Now;
+            // Never make the deadline earlier than it already is.
+            if((int32_t)(ui32Delay - initState.ui32DeadlineUs) > 0){
+                initState.ui32DeadlineUs = ui32Delay;
+            }
+        }
+    }
+    return true;
+}
+
+// Start the init of the screen, which must be called after SPI is initialized.
+// Sends as much of the init sequence as possible without waiting, and returns.
+// Other setup can then be done while the screen needs time, before the init is
+// finished with HX8357_initFinish. The SPI must not be used for anything else in
+// between, as CS is kept low for the whole init sequence.
+void HX8357_initBegin(SPI_Handle masterSpi){
+    spiStreamInit();
+    initState.spiHandle = masterSpi;
+    initState.pui8Next = initSequence;
+    initState.ui32BeginUs = timeNowUs();
+    initState.ui32StartUs = initState.ui32BeginUs;
+    // The reset wait is counted from when the clock started, which is only in the
+    // future if the init is started right away.
+    initState.ui32DeadlineUs = initState.ui32BeginUs < INIT_RESET_WAIT_US ?
+                               INIT_RESET_WAIT_US : initState.ui32BeginUs;
+    initState.ui32WaitedUs = 0;
+    GPIO_write(GPIO_CS_PIN, 0);
+    initPlay(false);
+}
+
+// Finish the init of the screen started by HX8357_initBegin. Only waits for as
+// long as the screen still needs, then prints how long the init took.
+void HX8357_initFinish(void){
+    initPlay(true);
+    GPIO_write(GPIO_CS_PIN, 1);
+    initState.ui32DoneUs = timeNowUs();
+    System_printf("HX8357 init done at %d ms: %d ms after begin, %d ms of it waiting\n",
+                  (int)(initState.ui32DoneUs/1000),
+                  (int)((initState.ui32DoneUs - initState.ui32BeginUs)/1000),
+                  (int)(initState.ui32WaitedUs/1000));
 }
 
 // Initialize display function.
 // The init function needs to be called after SPI is initialized
 void HX8357_init(SPI_Handle masterSpi){
-    char pCmdBuf[35] = {0};
-   // send soft reset, then wait 10 ms
-   sendLcdCommand(masterSpi, HX8357_SWRESET, NULL, 0, 10000);
-
-   // Send SETEXTC followed by data given by datasheet, then wait 300 ms
-   pCmdBuf[0] = 0xFF;
-   pCmdBuf[1] = 0x83;
-   pCmdBuf[2] = 0x57;
-   sendLcdCommand(masterSpi, HX8357D_SETC, pCmdBuf, 3, 300000);
-
-   // Send SETRGB command, followed by 4 parameters
-   pCmdBuf[0] = 0x80; // Enable SDO, EPF (colormapping) = 00, MPU interface for RAM access, internal oscillator
-   pCmdBuf[1] = 0x00; // rising edge of DOTCLK, active low HSYNC, active low VSYNC, active high enable pin
-   pCmdBuf[2] = 0x06; // Horizontal blanking period default
-   pCmdBuf[3] = 0x06; // Vertical blanking period default
-   sendLcdCommand(masterSpi, HX8357_SETRGB, pCmdBuf, 4, 0);
-
-   // Send SETCOM command, set to -1.52V.
-   // NOTE: This doesn't really make any sense. Datasheet and adafruits docs doesn't correspond here.
-   pCmdBuf[0] = 0x25; // Should be 0x2C according to datasheet, but 0.25 according to adafruit.
-   sendLcdCommand(masterSpi, HX8357D_SETCOM, pCmdBuf, 1, 0);
-
-   // Send SETOSC command, setting to 75 Hz, idle 60Hz:
-   pCmdBuf[0] = 0x68; // This is again settings that differ between adafruit comments and datasheet. According to adafruit it's 70/55 Hz
-   sendLcdCommand(masterSpi, HX8357_SETOSC, pCmdBuf, 1, 0);
-
-   // Send SETPANEL command, BGR with gate direction swapped
-   pCmdBuf[0] = 0x05; //0x05; //  If we want normally black panel, set bit 1 = 1, see page 224 in datasheet.
-   sendLcdCommand(masterSpi, HX8357_SETPANEL, pCmdBuf, 1, 0);
-
-   // Send SETPWR1 command
-   pCmdBuf[0] = 0x00; // Not deep standby
-   pCmdBuf[1] = 0x15; // BT
-   pCmdBuf[2] = 0x1C; // VSPR
-   pCmdBuf[3] = 0x1C; // VSNR
-   pCmdBuf[4] = 0x83; // AP
-   pCmdBuf[5] = 0xAA; // FS
-   sendLcdCommand(masterSpi, HX8357_SETPWR1, pCmdBuf, 6, 0);
-
-   // Send SETSTBA command
-   pCmdBuf[0] = 0x50; // OPON normal
-   pCmdBuf[1] = 0x50; // OPON idle
-   pCmdBuf[2] = 0x01; // STBA
-   pCmdBuf[3] = 0x3C; // STBA
-   pCmdBuf[4] = 0x1E; // STBA
-   pCmdBuf[5] = 0x08; // GEN
-   sendLcdCommand(masterSpi, HX8357D_SETSTBA, pCmdBuf, 6, 0);
-
-   // Send SETCYC command
-   pCmdBuf[0] = 0x02; // NW 0x02
-   pCmdBuf[1] = 0x40; // RTN
-   pCmdBuf[2] = 0x00; // DIV
-   pCmdBuf[3] = 0x2A; // DUM
-   pCmdBuf[4] = 0x2A; // DUM
-   pCmdBuf[5] = 0x0D; // GDON
-   pCmdBuf[6] = 0x78; // GDOFF
-   sendLcdCommand(masterSpi, HX8357D_SETCYC, pCmdBuf, 7, 0);
-
-   // Send SETGAMMA command
-   pCmdBuf[0] = 0x02;
-   pCmdBuf[1] = 0x0A;
-   pCmdBuf[2] = 0x11;
-   pCmdBuf[3] = 0x1d;
-   pCmdBuf[4] = 0x23;
-   pCmdBuf[5] = 0x35;
-   pCmdBuf[6] = 0x41;
-   pCmdBuf[7] = 0x4b;
-   pCmdBuf[8] = 0x4b;
-   pCmdBuf[9] = 0x42;
-   pCmdBuf[10] = 0x3A;
-   pCmdBuf[11] = 0x27;
-   pCmdBuf[12] = 0x1B;
-   pCmdBuf[13] = 0x08;
-   pCmdBuf[14] = 0x09;
-   pCmdBuf[15] = 0x03;
-   pCmdBuf[16] = 0x02;
-   pCmdBuf[17] = 0x0A;
-   pCmdBuf[18] = 0x11;
-   pCmdBuf[19] = 0x1d;
-   pCmdBuf[20] = 0x23;
-   pCmdBuf[21] = 0x35;
-   pCmdBuf[22] = 0x41;
-   pCmdBuf[23] = 0x4b;
-   pCmdBuf[24] = 0x4b;
-   pCmdBuf[25] = 0x42;
-   pCmdBuf[26] = 0x3A;
-   pCmdBuf[27] = 0x27;
-   pCmdBuf[28] = 0x1B;
-   pCmdBuf[29] = 0x08;
-   pCmdBuf[30] = 0x09;
-   pCmdBuf[31] = 0x03;
-   pCmdBuf[32] = 0x00;
-   pCmdBuf[33] = 0x01;
-   sendLcdCommand(masterSpi, HX8357D_SETGAMMA, pCmdBuf, 34, 0);
-
-   // send COLMOD command:
-   pCmdBuf[0] = 0x55; // 16 bit per pixel
-   sendLcdCommand(masterSpi, HX8357_COLMOD, pCmdBuf, 1, 0);
-
-   // Send MADCTL command, see page 61 and 157
-   uint8_t MV, MX, MY;
-   MX = 0;
-   MY = 1;
-   MV = 1;
-   pCmdBuf[0] = MY<<7 | MX <<6 | MV << 5;//0xC0; // [MV, MX, MY] =
-   sendLcdCommand(masterSpi, HX8357_MADCTL, pCmdBuf, 1, 0);
-
-   // Send TEON command
-   pCmdBuf[0] = 0x00; //TW off
-   sendLcdCommand(masterSpi, HX8357_TEON, pCmdBuf, 1, 0);
-
-   // Send TEARLINE command:
-   pCmdBuf[0] = 0x00;
-   pCmdBuf[1] = 0x02;
-   sendLcdCommand(masterSpi, HX8357_TEARLINE, pCmdBuf, 2, 0);
-
-   // Send SPLOUT command, wait for 150 ms
-   sendLcdCommand(masterSpi, HX8357_SLPOUT, NULL, 0, 150000);
-
-   // Send DISPON, turning on screen. Then delay 50 ms.
-   sendLcdCommand(masterSpi, HX8357_DISPON, NULL, 0, 50000);
+    HX8357_initBegin(masterSpi);
+    HX8357_initFinish();
+}
+
+// Vsync, using the tear effect (TE) output of the screen. TEON in the init sequence
+// makes the screen pulse TE when it starts a new refresh. If TE isn't connected (no
+// pulses show up), the start of each refresh is estimated from the refresh period
+// instead, which keeps the pacing but can't be in phase with the screen. When the
+// pulses come back, they are used again.
+typedef struct
+{
+    Semaphore_Struct teSemStruct;       // Posted on every TE pulse
+    Semaphore_Handle teSemHandle;
+    volatile uint32_t ui32LastTeUs;     // Time of the last TE pulse
+    uint32_t ui32AnchorUs;              // Start of a refresh, for the estimate
+    uint32_t ui32LastPresentUs;         // When HX8357_vsyncWait last returned
+    tFrameStats sStats;
+}
+tVsync;
+static tVsync vsync;
+
+// GPIO callback for the TE pin, in interrupt context.
+static void teCallback(unsigned int index){
+    uint32_t ui32Now = timeNowUs();
+    uint32_t ui32Period = ui32Now - vsync.ui32LastTeUs;
+    // Keep a running average of the period, skipping anything that can't be one
+    // refresh (e.g. the first pulse, or the first after the pulses stopped).
+    if((vsync.sStats.ui32NumTe > 0) && (ui32Period < 2*vsync.sStats.ui32RefreshUs) &&
+       (2*ui32Period > vsync.sStats.ui32RefreshUs)){
+        vsync.sStats.ui32RefreshUs += ((int32_t)(ui32Period - vsync.sStats.ui32RefreshUs))/8;
+        // Two pulses a refresh apart, so TE works (again).
+        if(!vsync.sStats.bTeActive){
+            vsync.ui32AnchorUs = ui32Now;
+            vsync.sStats.bTeActive = true;
+        }
+    }
+    vsync.ui32LastTeUs = ui32Now;
+    vsync.sStats.ui32NumTe++;
+    Semaphore_post(vsync.teSemHandle);
+}
+
+// Set up vsync. Must be called from a task, after the GPIOs are initialized.
+void HX8357_vsyncInit(void){
+    Semaphore_Params semParams;
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&vsync.teSemStruct, 0, &semParams);
+    vsync.teSemHandle = Semaphore_handle(&vsync.teSemStruct);
+
+    memset(&vsync.sStats, 0, sizeof(vsync.sStats));
+    vsync.sStats.ui32RefreshUs = HX8357_REFRESH_US;
+    vsync.sStats.bTeActive = true; // Until proven otherwise
+    vsync.ui32AnchorUs = timeNowUs();
+    vsync.ui32LastPresentUs = vsync.ui32AnchorUs;
+
+    GPIO_setCallback(GPIO_TE_PIN, teCallback);
+    GPIO_enableInt(GPIO_TE_PIN);
+}
+
+// Wait for the start of a refresh, using the TE pulses. Returns false if no pulse
+// shows up within a couple of refresh periods.
+static bool vsyncWaitTe(void){
+    UInt32 ui32Timeout = (2*vsync.sStats.ui32RefreshUs)/Clock_tickPeriod + 1;
+    return Semaphore_pend(vsync.teSemHandle, ui32Timeout);
+}
+
+// Wait for the estimated start of the next refresh.
+static void vsyncWaitEstimate(void){
+    uint32_t ui32Now = timeNowUs();
+    uint32_t ui32Period = vsync.sStats.ui32RefreshUs;
+    // Number of refreshes started since the anchor, rounded down.
+    uint32_t ui32Num = (ui32Now - vsync.ui32AnchorUs)/ui32Period;
+    vsync.ui32AnchorUs += (ui32Num + 1)*ui32Period;
+    usleep(vsync.ui32AnchorUs - ui32Now);
+}
+
+// Wait until the screen starts its ui32Frames:th refresh from now (at least 1), so
+// that large RAMWR bursts can be started right behind the refresh instead of across
+// it. Also keeps track of the frame timing, see HX8357_frameStatsGet.
+void HX8357_vsyncWait(uint32_t ui32Frames){
+    uint32_t ui32Asked = ui32Frames;
+    uint32_t ui32Now;
+    uint32_t ui32FrameUs;
+    uint32_t ui32Refreshes;
+    bool bTe = false;
+
+    while(ui32Frames > 0){
+        // TE can come back while waiting for the estimate, see teCallback.
+        if(vsync.sStats.bTeActive){
+            if(!bTe){
+                // Only pulses from now on count.
+                Semaphore_reset(vsync.teSemHandle, 0);
+                bTe = true;
+            }
+            if(vsyncWaitTe()){
+                ui32Frames--;
+                continue;
+            }
+            // No TE, so estimate from now on, starting from the last pulse if any.
+            vsync.sStats.bTeActive = false;
+            bTe = false;
+            vsync.ui32AnchorUs = vsync.sStats.ui32NumTe ? vsync.ui32LastTeUs : timeNowUs();
+        }
+        vsyncWaitEstimate();
+        ui32Frames--;
+    }
+
+    // Frame timing. A frame that took longer than asked for shows up as missed refreshes.
+    ui32Now = timeNowUs();
+    ui32FrameUs = ui32Now - vsync.ui32LastPresentUs;
+    vsync.ui32LastPresentUs = ui32Now;
+    vsync.sStats.ui32NumFrames++;
+    vsync.sStats.ui32LastFrameUs = ui32FrameUs;
+    if(ui32FrameUs > vsync.sStats.ui32MaxFrameUs){
+        vsync.sStats.ui32MaxFrameUs = ui32FrameUs;
+    }
+    ui32Refreshes = (ui32FrameUs + vsync.sStats.ui32RefreshUs/2)/vsync.sStats.ui32RefreshUs;
+    // The first frame is counted from HX8357_vsyncInit, so it doesn't count.
+    if((vsync.sStats.ui32NumFrames > 1) && (ui32Refreshes > ui32Asked)){
+        vsync.sStats.ui32NumMissed += ui32Refreshes - ui32Asked;
+    }
+}
+
+// Copy the frame timing statistics to psStats.
+void HX8357_frameStatsGet(tFrameStats *psStats){
+    *psStats = vsync.sStats;
 }
 
 // GRLIB functions
@@ -284,6 +748,162 @@ void HX8357_init(SPI_Handle masterSpi){
 // and a way to translate from 24-bit RBG colorspace to whatever format is used by the display.
 // The API prototypes are found in https://www.ti.com/lit/an/spma055/spma055.pdf
 
+// Size of the stack buffer used if the scratch pool is exhausted.
+#define SCRATCH_FALLBACK_BYTES 32
+
+// Fetch entry ui32Index from a 24-bit RGB palette (3 bytes per entry, blue first)
+// and translate it to the screen color format.
+static uint32_t paletteColorGet(void *pvDisplayData, const uint8_t *pui8Palette, uint32_t ui32Index){
+    const uint8_t *pui8Entry = &pui8Palette[ui32Index*3];
+    return ColorTranslate(pvDisplayData, ((uint32_t)pui8Entry[2] << 16) |
+                                         ((uint32_t)pui8Entry[1] << 8) |
+                                         pui8Entry[0]);
+}
+
+// Translate i32Count pixels in one of the GRLIB pixel formats to screen colors, stored
+// in the byte order used by the screen. For 4 bpp, the palette must already be
+// translated into pui16Palette4.
+static void pixelsTranslate(void *pvDisplayData, uint16_t *pui16Out, int32_t i32X0,
+                            int32_t i32Count, int32_t i32BPP, const uint8_t *pui8Data,
+                            const uint8_t *pui8Palette, const uint16_t *pui16Palette4){
+    uint32_t ui32Byte;
+    uint32_t ui32Color;
+
+    switch(i32BPP){
+    case 1:
+        // The palette holds two pre-translated colors.
+        while(i32Count){
+            ui32Byte = *pui8Data++;
+            for(; (i32X0 < 8) && i32Count ; i32X0++, i32Count--){
+                *pui16Out++ = HX8357_SWAP16(((const uint32_t *)pui8Palette)[(ui32Byte >> (7 - i32X0)) & 1]);
+            }
+            i32X0 = 0;
+        }
+        break;
+    case 4:
+        // Two pixels per byte, high nibble first. i32X0 is 1 if the run starts
+        // on the low nibble.
+        while(i32Count){
+            ui32Byte = *pui8Data++;
+            if(i32X0 == 0){
+                *pui16Out++ = HX8357_SWAP16(pui16Palette4[ui32Byte >> 4]);
+                i32Count--;
+            }
+            if(i32Count){
+                *pui16Out++ = HX8357_SWAP16(pui16Palette4[ui32Byte & 0x0F]);
+                i32Count--;
+            }
+            i32X0 = 0;
+        }
+        break;
+    case 8:
+        while(i32Count--){
+            ui32Color = paletteColorGet(pvDisplayData, pui8Palette, *pui8Data++);
+            *pui16Out++ = HX8357_SWAP16(ui32Color);
+        }
+        break;
+    }
+}
+
+// Translate i32Count pixels of an 8 bpp image, going right from (i32X, i32Y) on the
+// screen, with dithering. The palette colors are looked up a few at a time, and
+// converted together by HX8357_rgbConvert.
+static void palette8Dither(uint16_t *pui16Out, int32_t i32X, int32_t i32Y, int32_t i32Count,
+                           const uint8_t *pui8Data, const uint8_t *pui8Palette){
+    uint32_t pui32Colors[16];
+    const uint8_t *pui8Entry;
+    int32_t i32Run, i32Index;
+
+    while(i32Count > 0){
+        i32Run = i32Count < 16 ? i32Count : 16;
+        for(i32Index = 0 ; i32Index < i32Run ; i32Index++){
+            pui8Entry = &pui8Palette[*pui8Data++*3];
+            pui32Colors[i32Index] = ((uint32_t)pui8Entry[2] << 16) | ((uint32_t)pui8Entry[1] << 8) |
+                                    pui8Entry[0];
+        }
+        HX8357_rgbConvert(pui16Out, pui32Colors, HX8357_RGB_XRGB32, i32Run, i32X, i32Y, true);
+        pui16Out += i32Run;
+        i32X += i32Run;
+        i32Count -= i32Run;
+    }
+}
+
+// Translate the 4 bpp palette, which is only 16 entries, once up front instead of
+// once per pixel.
+static void palette4Translate(void *pvDisplayData, const uint8_t *pui8Palette,
+                              uint16_t *pui16Palette4){
+    uint32_t ui32Index;
+    for(ui32Index = 0 ; ui32Index < 16 ; ui32Index++){
+        pui16Palette4[ui32Index] = paletteColorGet(pvDisplayData, pui8Palette, ui32Index);
+    }
+}
+
+// Same as pixelsTranslate, for code that builds pixel data to be drawn later, e.g.
+// with HX8357_pixelsWrite. pui16Out must have room for i32Count pixels. (i32X, i32Y)
+// is where the first pixel goes on the screen, which the dither needs.
+void HX8357_pixelsTranslate(void *pvDisplayData, uint16_t *pui16Out, int32_t i32X,
+                            int32_t i32Y, int32_t i32X0, int32_t i32Count, int32_t i32BPP,
+                            const uint8_t *pui8Data, const uint8_t *pui8Palette){
+    uint16_t pui16Palette4[16];
+    if((i32BPP == 8) && ((tDisplayData *)pvDisplayData)->bDither){
+        palette8Dither(pui16Out, i32X, i32Y, i32Count, pui8Data, pui8Palette);
+        return;
+    }
+    if(i32BPP == 4){
+        palette4Translate(pvDisplayData, pui8Palette, pui16Palette4);
+    }
+    pixelsTranslate(pvDisplayData, pui16Out, i32X0, i32Count, i32BPP, pui8Data,
+                    pui8Palette, pui16Palette4);
+}
+
+// Row buffer for pixels that are built one run at a time. The buffer is split in two
+// halves, so that one half can be filled while the other one is being sent.
+typedef struct
+{
+    uint16_t *pui16Half[2];
+    uint32_t ui32HalfPixels;
+    uint32_t ui32Half;      // The half being filled
+    uint32_t ui32NumInHalf; // Pixels in the half being filled
+}
+tRowBuf;
+
+static void rowBufInit(tRowBuf *psRowBuf, char *pBuf, uint32_t ui32BufBytes){
+    psRowBuf->ui32HalfPixels = ui32BufBytes/4;
+    psRowBuf->pui16Half[0] = (uint16_t *)pBuf;
+    psRowBuf->pui16Half[1] = (uint16_t *)pBuf + psRowBuf->ui32HalfPixels;
+    psRowBuf->ui32Half = 0;
+    psRowBuf->ui32NumInHalf = 0;
+}
+
+// Queue the half being filled for sending and switch to the other half, waiting
+// until that half has been sent. The caller must have CS low and RAMWR already sent.
+static void rowBufSend(SPI_Handle spiHandle, tRowBuf *psRowBuf){
+    spiWriteQueued(spiHandle, (char *)psRowBuf->pui16Half[psRowBuf->ui32Half],
+                   2*psRowBuf->ui32NumInHalf);
+    // Only the half just queued may still be in flight when the other one is reused.
+    spiWaitPending(1);
+    psRowBuf->ui32Half ^= 1;
+    psRowBuf->ui32NumInHalf = 0;
+}
+
+// Send ui32NumPixels pixels of the same (translated) color. The run is built once
+// in pBuf (room for ui32BufPixels pixels) and sent as one burst, or repeatedly if
+// the run is longer than the buffer.
+// The caller must have CS low and RAMWR already sent.
+static void sendColorRun(SPI_Handle spiHandle, char *pBuf, uint32_t ui32BufPixels,
+                         uint32_t ui32Color, uint32_t ui32NumPixels){
+    uint32_t ui32RunPixels = ui32NumPixels < ui32BufPixels ? ui32NumPixels : ui32BufPixels;
+    HX8357_fillColor(pBuf, ui32Color, ui32RunPixels);
+    // The buffer isn't changed while sending, so all of it can be queued back to back.
+    while(ui32NumPixels > 0){
+        spiWriteQueued(spiHandle, pBuf, 2*ui32RunPixels);
+        ui32NumPixels -= ui32RunPixels;
+        if(ui32NumPixels < ui32RunPixels){
+            ui32RunPixels = ui32NumPixels;
+        }
+    }
+    spiWaitPending(0);
+}
 
 // Parameters:
 // pvDisplayData is a pointer to the driver-specific data for this display driver.
@@ -299,17 +919,16 @@ void PixelDraw(void *pvDisplayData, int32_t i32X, int32_t i32Y,
 uint32_t ui32ulValue){
     tDisplayData *pDisplayData = (tDisplayData *)pvDisplayData;
     SPI_Handle spiHandle = pDisplayData->spiHandle;
+    TRACE_IN(TRACE_PIXEL_DRAW, 1);
+    GPIO_write(GPIO_CS_PIN, 0);
     // Set the address window to 1 pixel
-    setAddressWindow(spiHandle, i32Y, i32X, 1, 1);
-    // As the 32 bit value is another bit format than what is accepted by the
-    // screen, we need to rotate the bits. Done here since it's where the
-    // issue is, otherwise we could rotate it in the colorTranslate function,
-    // but that's a bit of a hack...
-    char buf[2];
-    buf[0] = ui32ulValue>>8;
-    buf[1] = (ui32ulValue&0xFF);
-    // Send the color to that address range. All colors are 2 bytes.
-    sendLcdCommand(spiHandle, HX8357_RAMWR, buf/*(char*)&ui32ulValue*/, 2, 0);
+    setAddressWindow(pDisplayData, i32Y, i32X, 1, 1);
+    // Send the color to that address range. All colors are 2 bytes, sent in the
+    // screen byte order.
+    uint16_t ui16Pixel = HX8357_SWAP16(ui32ulValue);
+    sendLcdCommandNoCS(spiHandle, HX8357_RAMWR, (char*)&ui16Pixel, 2, 0);
+    GPIO_write(GPIO_CS_PIN, 1);
+    TRACE_OUT(TRACE_PIXEL_DRAW, 1);
 }
 
 // Parameters:
@@ -333,7 +952,197 @@ void PixelDrawMultiple(void *pvDisplayData, int32_t i32X, int32_t i32Y,
 int32_t i32X0, int32_t i32Count, int32_t i32BPP,
 const uint8_t *pui8Data,
 const uint8_t *pui8Palette){
+    tDisplayData *pDisplayData = (tDisplayData *)pvDisplayData;
+    SPI_Handle spiHandle = pDisplayData->spiHandle;
+    uint16_t pui16Palette4[16];
+    int32_t i32Run;
+    uint32_t pui32LocalBuf[SCRATCH_FALLBACK_BYTES/4];
+    char *pBuf;
+    uint32_t ui32BufBytes;
+    tRowBuf sRowBuf;
+
+    if(i32Count <= 0){
+        return;
+    }
+    if((i32BPP != 1) && (i32BPP != 4) && (i32BPP != 8)){
+        // Unsupported format, nothing sensible can be drawn.
+        return;
+    }
+    TRACE_IN(TRACE_PIXEL_DRAW_MULTIPLE, i32Count);
+
+    if(i32BPP == 4){
+        palette4Translate(pvDisplayData, pui8Palette, pui16Palette4);
+    }
+
+    // Borrow a row buffer, big enough for two halves of the whole run if possible.
+    pBuf = HX8357_scratchBorrow(pDisplayData, 4*i32Count, &ui32BufBytes);
+    if(pBuf == NULL){
+        pBuf = (char *)pui32LocalBuf;
+        ui32BufBytes = sizeof(pui32LocalBuf);
+    }
+    rowBufInit(&sRowBuf, pBuf, ui32BufBytes);
+
+    // Set the address window to the run of pixels, and keep CS low for the
+    // RAMWR command plus all of the pixel data.
+    GPIO_write(GPIO_CS_PIN, 0);
+    setAddressWindow(pDisplayData, i32Y, i32X, 1, i32Count);
+    sendLcdCommandNoCS(spiHandle, HX8357_RAMWR, NULL, 0, 0);
+
+    // Translate one half of the row buffer while the other half is being sent.
+    while(i32Count > 0){
+        i32Run = i32Count;
+        if(i32Run > (int32_t)sRowBuf.ui32HalfPixels){
+            i32Run = (int32_t)sRowBuf.ui32HalfPixels;
+        }
+        if((i32BPP == 8) && pDisplayData->bDither){
+            palette8Dither(sRowBuf.pui16Half[sRowBuf.ui32Half], i32X, i32Y, i32Run, pui8Data,
+                           pui8Palette);
+        }
+        else {
+            pixelsTranslate(pvDisplayData, sRowBuf.pui16Half[sRowBuf.ui32Half], i32X0, i32Run,
+                            i32BPP, pui8Data, pui8Palette, pui16Palette4);
+        }
+        sRowBuf.ui32NumInHalf = i32Run;
+        rowBufSend(spiHandle, &sRowBuf);
+        // Move on to the first pixel after the run.
+        i32X += i32Run;
+        i32X0 += i32Run;
+        pui8Data += (i32X0*i32BPP)/8;
+        i32X0 %= 8/i32BPP;
+        i32Count -= i32Run;
+    }
+    spiWaitPending(0);
+    GPIO_write(GPIO_CS_PIN, 1);
+    HX8357_scratchReturn(pDisplayData, pBuf);
+    TRACE_OUT(TRACE_PIXEL_DRAW_MULTIPLE, 0);
+}
+
+// Draw a horizontal run of i32Count pixels that are already translated and in the
+// byte order used by the screen, e.g. from HX8357_pixelsTranslate.
+// Returns when all pixels are sent, so pui16Pixels can be reused right away.
+void HX8357_pixelsWrite(tDisplayData *pDisplayData, int32_t i32X, int32_t i32Y,
+                        const uint16_t *pui16Pixels, int32_t i32Count){
+    if(i32Count <= 0){
+        return;
+    }
+    GPIO_write(GPIO_CS_PIN, 0);
+    setAddressWindow(pDisplayData, i32Y, i32X, 1, i32Count);
+    sendLcdCommandNoCS(pDisplayData->spiHandle, HX8357_RAMWR, (char *)pui16Pixels, 2*i32Count, 0);
+    GPIO_write(GPIO_CS_PIN, 1);
+}
+
+// Draw the rectangle psRect from pixels that are already translated and in the byte
+// order used by the screen. Row n of the rectangle starts at pui16Pixels + n*ui32Stride.
+// All rows are sent after a single RAMWR, and queued back to back.
+// Returns when all pixels are sent.
+void HX8357_rectWrite(tDisplayData *pDisplayData, const tRectangle *psRect,
+                      const uint16_t *pui16Pixels, uint32_t ui32Stride){
+    SPI_Handle spiHandle = pDisplayData->spiHandle;
+    uint32_t ui32Cols = psRect->i16XMax - psRect->i16XMin + 1;
+    uint32_t ui32Rows = psRect->i16YMax - psRect->i16YMin + 1;
+
+    if((psRect->i16XMax < psRect->i16XMin) || (psRect->i16YMax < psRect->i16YMin)){
+        return;
+    }
+    GPIO_write(GPIO_CS_PIN, 0);
+    setAddressWindow(pDisplayData, psRect->i16YMin, psRect->i16XMin, ui32Rows, ui32Cols);
+    sendLcdCommandNoCS(spiHandle, HX8357_RAMWR, NULL, 0, 0);
+    if(ui32Stride == ui32Cols){
+        // The rows are next to each other, so send them all at once.
+        spiWriteQueued(spiHandle, (char *)pui16Pixels, 2*ui32Cols*ui32Rows);
+    }
+    else {
+        while(ui32Rows--){
+            spiWriteQueued(spiHandle, (char *)pui16Pixels, 2*ui32Cols);
+            pui16Pixels += ui32Stride;
+        }
+    }
+    spiWaitPending(0);
+    GPIO_write(GPIO_CS_PIN, 1);
+}
+
+// Start a RAMWR to the rectangle psRect, for pixel data that comes in pieces, e.g.
+// from a file. The pixels are sent with HX8357_streamWrite, row after row, and
+// HX8357_streamEnd must be called after the last one. Nothing else may be sent to
+// the screen in between.
+void HX8357_streamBegin(tDisplayData *pDisplayData, const tRectangle *psRect){
+    GPIO_write(GPIO_CS_PIN, 0);
+    setAddressWindow(pDisplayData, psRect->i16YMin, psRect->i16XMin,
+                     psRect->i16YMax - psRect->i16YMin + 1, psRect->i16XMax - psRect->i16XMin + 1);
+    sendLcdCommandNoCS(pDisplayData->spiHandle, HX8357_RAMWR, NULL, 0, 0);
+}
+
+// Queue ui32Bytes of pixel data, already in the byte order used by the screen, after
+// HX8357_streamBegin. Returns as soon as the data is queued, so the next piece can be
+// read while this one is sent, and the data must be left untouched until it is sent,
+// see HX8357_streamWait. Returns the number of chunks queued.
+uint32_t HX8357_streamWrite(tDisplayData *pDisplayData, const void *pvData, uint32_t ui32Bytes){
+    spiWriteQueued(pDisplayData->spiHandle, (char *)pvData, ui32Bytes);
+    return (ui32Bytes + SPI_CHUNK_BYTES - 1)/SPI_CHUNK_BYTES;
+}
 
+// Wait until at most the last ui32Chunks chunks queued by HX8357_streamWrite are still
+// being sent. Everything queued before them is sent, and its buffer can be reused.
+void HX8357_streamWait(tDisplayData *pDisplayData, uint32_t ui32Chunks){
+    spiWaitPending(ui32Chunks);
+}
+
+// End the RAMWR started by HX8357_streamBegin, once everything queued is sent.
+void HX8357_streamEnd(tDisplayData *pDisplayData){
+    spiWaitPending(0);
+    GPIO_write(GPIO_CS_PIN, 1);
+}
+
+// Fill ui32Count rectangles with the same (translated) color, e.g. the spans of a
+// shape. Unlike calling RectFill for each of them, it's all done with CS low once,
+// and the color is only written to the scratch buffer once. The rectangles must be
+// on the screen.
+void HX8357_rectsFill(tDisplayData *pDisplayData, const tRectangle *psRects, uint32_t ui32Count,
+                      uint32_t ui32Color){
+    SPI_Handle spiHandle = pDisplayData->spiHandle;
+    uint32_t pui32LocalBuf[SCRATCH_FALLBACK_BYTES/4];
+    uint32_t ui32Index, ui32Cols, ui32MaxCols = 0, ui32NumPixels, ui32RunPixels;
+    uint32_t ui32BufBytes;
+    char *pScreenBuf;
+
+    if(ui32Count == 0){
+        return;
+    }
+    // The buffer is sent for each row of a rectangle, so the widest row is enough.
+    for(ui32Index = 0 ; ui32Index < ui32Count ; ui32Index++){
+        ui32Cols = psRects[ui32Index].i16XMax - psRects[ui32Index].i16XMin + 1;
+        if(ui32Cols > ui32MaxCols){
+            ui32MaxCols = ui32Cols;
+        }
+    }
+    pScreenBuf = HX8357_scratchBorrow(pDisplayData, 2*ui32MaxCols, &ui32BufBytes);
+    if(pScreenBuf == NULL){
+        pScreenBuf = (char *)pui32LocalBuf;
+        ui32BufBytes = sizeof(pui32LocalBuf);
+    }
+    HX8357_fillColor(pScreenBuf, ui32Color, ui32BufBytes/2);
+
+    GPIO_write(GPIO_CS_PIN, 0);
+    for(ui32Index = 0 ; ui32Index < ui32Count ; ui32Index++){
+        ui32Cols = psRects[ui32Index].i16XMax - psRects[ui32Index].i16XMin + 1;
+        ui32NumPixels = ui32Cols*(psRects[ui32Index].i16YMax - psRects[ui32Index].i16YMin + 1);
+        setAddressWindow(pDisplayData, psRects[ui32Index].i16YMin, psRects[ui32Index].i16XMin,
+                         psRects[ui32Index].i16YMax - psRects[ui32Index].i16YMin + 1, ui32Cols);
+        sendLcdCommandNoCS(spiHandle, HX8357_RAMWR, NULL, 0, 0);
+        // The buffer isn't changed, so it can be queued back to back.
+        ui32RunPixels = ui32BufBytes/2;
+        while(ui32NumPixels > 0){
+            if(ui32RunPixels > ui32NumPixels){
+                ui32RunPixels = ui32NumPixels;
+            }
+            spiWriteQueued(spiHandle, pScreenBuf, 2*ui32RunPixels);
+            ui32NumPixels -= ui32RunPixels;
+        }
+        // Everything must be out before D/C goes low for the next window.
+        spiWaitPending(0);
+    }
+    GPIO_write(GPIO_CS_PIN, 1);
+    HX8357_scratchReturn(pDisplayData, pScreenBuf);
 }
 
 // Parameters:
@@ -351,27 +1160,25 @@ void LineDrawH(void *pvDisplayData, int32_t i32X1, int32_t i32X2,
 int32_t i32Y, uint32_t ui32ulValue){
     tDisplayData *pDisplayData = (tDisplayData *)pvDisplayData;
     SPI_Handle spiHandle = pDisplayData->spiHandle;
-    // Set the address window to 1 pixel
-    setAddressWindow(spiHandle, i32Y, i32X1, 1, i32X2-i32X1);
-    // Send the color to that address range. All colors are 2 bytes.
-    int i;
+    uint32_t pui32LocalBuf[SCRATCH_FALLBACK_BYTES/4];
+    char *pBuf;
+    uint32_t ui32BufBytes;
+    TRACE_IN(TRACE_LINE_DRAW_H, i32X2-i32X1+1);
+    // Borrow a buffer for the color run, big enough for the whole line if possible.
+    pBuf = HX8357_scratchBorrow(pDisplayData, 2*(i32X2-i32X1+1), &ui32BufBytes);
+    if(pBuf == NULL){
+        pBuf = (char *)pui32LocalBuf;
+        ui32BufBytes = sizeof(pui32LocalBuf);
+    }
+    // Set the address window to the line. GRLIB coordinates are inclusive.
     GPIO_write(GPIO_CS_PIN, 0);
-
-    // As the 32 bit value is another bit format than what is accepted by the
-    // screen, we need to rotate the bits. Done here since it's where the
-    // issue is, otherwise we could rotate it in the colorTranslate function,
-    // but that's a bit of a hack...
-    char buf[2];
-    buf[0] = ui32ulValue>>8;
-    buf[1] = (ui32ulValue&0xFF);
-
-    // Send the command:
+    setAddressWindow(pDisplayData, i32Y, i32X1, 1, i32X2-i32X1+1);
+    // Send the command, followed by the whole line in one burst.
     sendLcdCommandNoCS(spiHandle, HX8357_RAMWR, NULL, 0, 0);
-
-    for(i = i32X1 ; i <= i32X2 ; i++){
-        sendLcdCommandNoCS(spiHandle, HX8357_NO_COMMAND, buf/*(char*)&ui32ulValue*/, 2, 0);
-    }
+    sendColorRun(spiHandle, pBuf, ui32BufBytes/2, ui32ulValue, i32X2-i32X1+1);
     GPIO_write(GPIO_CS_PIN, 1);
+    HX8357_scratchReturn(pDisplayData, pBuf);
+    TRACE_OUT(TRACE_LINE_DRAW_H, i32X2-i32X1+1);
 }
 // Parameters:
 // pvDisplayData is a pointer to the driver-specific data for this display driver.
@@ -388,25 +1195,25 @@ void LineDrawV(void *pvDisplayData, int32_t i32X, int32_t i32Y1,
 int32_t i32Y2, uint32_t ui32ulValue){
     tDisplayData *pDisplayData = (tDisplayData *)pvDisplayData;
     SPI_Handle spiHandle = pDisplayData->spiHandle;
-    // Set the address window to 1 pixel
-    setAddressWindow(spiHandle, i32Y1, i32X, i32Y2-i32Y1, 1);
-    // Send the color to that address range. All colors are 2 bytes.
-    int i;
+    uint32_t pui32LocalBuf[SCRATCH_FALLBACK_BYTES/4];
+    char *pBuf;
+    uint32_t ui32BufBytes;
+    TRACE_IN(TRACE_LINE_DRAW_V, i32Y2-i32Y1+1);
+    // Borrow a buffer for the color run, big enough for the whole line if possible.
+    pBuf = HX8357_scratchBorrow(pDisplayData, 2*(i32Y2-i32Y1+1), &ui32BufBytes);
+    if(pBuf == NULL){
+        pBuf = (char *)pui32LocalBuf;
+        ui32BufBytes = sizeof(pui32LocalBuf);
+    }
+    // Set the address window to the line. GRLIB coordinates are inclusive.
     GPIO_write(GPIO_CS_PIN, 0);
-    // As the 32 bit value is another bit format than what is accepted by the
-    // screen, we need to rotate the bits. Done here since it's where the
-    // issue is, otherwise we could rotate it in the colorTranslate function,
-    // but that's a bit of a hack...
-    char buf[2];
-    buf[0] = ui32ulValue>>8;
-    buf[1] = (ui32ulValue&0xFF);
-
-    // Send the command:
+    setAddressWindow(pDisplayData, i32Y1, i32X, i32Y2-i32Y1+1, 1);
+    // Send the command, followed by the whole line in one burst.
     sendLcdCommandNoCS(spiHandle, HX8357_RAMWR, NULL, 0, 0);
-    for(i = i32Y1 ; i <= i32Y2 ; i++){
-        sendLcdCommandNoCS(spiHandle, HX8357_NO_COMMAND, buf/*(char*)&ui32ulValue*/, 2, 0);
-    }
+    sendColorRun(spiHandle, pBuf, ui32BufBytes/2, ui32ulValue, i32Y2-i32Y1+1);
     GPIO_write(GPIO_CS_PIN, 1);
+    HX8357_scratchReturn(pDisplayData, pBuf);
+    TRACE_OUT(TRACE_LINE_DRAW_V, i32Y2-i32Y1+1);
 }
 
 // Parameters:
@@ -419,107 +1226,46 @@ int32_t i32Y2, uint32_t ui32ulValue){
 // words, both sXMin and sXMax are drawn, along with sYMin and sYMax).
 // Returns:
 // None.
-
-// DEBUG VARIABLES:
-uint32_t numPixels = 0;
-uint32_t numWritten = 0;
 void RectFill(void *pvDisplayData, const tRectangle *psRect,
 uint32_t ui32ulValue){
     // Get the SPI handle
     tDisplayData *pDisplayData = (tDisplayData *)pvDisplayData;
     SPI_Handle spiHandle = pDisplayData->spiHandle;
-
-    // Try to allocate a temporary screen buffer, because it's a lot faster than writing
-    // on a per-pixel basis.
+    uint32_t pui32LocalBuf[SCRATCH_FALLBACK_BYTES/4];
     char *pScreenBuf;
+    uint32_t ui32BufBytes;
+    // Size of the rectangle. The coordinates are inclusive.
+    int32_t i32Cols = psRect->i16XMax - psRect->i16XMin + 1;
+    int32_t i32Rows = psRect->i16YMax - psRect->i16YMin + 1;
 
-    // Try to allocate all rows, which is num(x_pixels)*num(y_pixels)
-    int n = (psRect->i16YMax) - (psRect->i16YMin);
-    int numPixelsInARow = (psRect->i16XMax) - (psRect->i16XMin)+1;
-
-    // One pixel is 16 bits, so allocate the number of pixels in one row * number of rows * 2
-    pScreenBuf = (char*)malloc(numPixelsInARow*n*2);
-
-    // If this does not work, then reduce the number of rows
-    while((pScreenBuf == NULL) && (n > 1)){
-        n = n>>1; // Divide by two to quickly go through this loop
-        pScreenBuf = (char*)malloc(numPixelsInARow*n*2);
+    if((i32Cols <= 0) || (i32Rows <= 0)){
+        return;
     }
+    TRACE_IN(TRACE_RECT_FILL, i32Rows*i32Cols);
 
-    // Check if pScreenBuf wasn't allocated, in which case just print 1 pixel at a time
-    // This happens if malloc couldn't allocate even one row.
+    // Borrow a temporary screen buffer from the scratch pool, because it's a lot
+    // faster than writing on a per-pixel basis. Ask for the whole rectangle; if
+    // less is given the buffer is just sent several times.
+    pScreenBuf = HX8357_scratchBorrow(pDisplayData, 2*i32Cols*i32Rows, &ui32BufBytes);
     if(pScreenBuf == NULL){
-        n = 0;
-    }
-    else{
-        // If buffer was allocated, then copy the color to all entries.
-        // One pixel is 16 bits, so the size is num(bits)*2
-        // As the 32 bit value is another bit format than what is accepted by the
-        // screen, we need to rotate the bits. Done here since it's where the
-        // issue is, otherwise we could rotate it in the colorTranslate function,
-        // but that's a bit of a hack...
-
-        memset(pScreenBuf, (uint16_t)((ui32ulValue >> 8) | ((ui32ulValue&0xFF) << 8)), numPixelsInARow*n*2);
+        pScreenBuf = (char *)pui32LocalBuf;
+        ui32BufBytes = sizeof(pui32LocalBuf);
     }
 
-    // Set the address window to match the rectangle.
-    setAddressWindow(spiHandle, psRect->i16YMin,
-                     psRect->i16XMin,
-                     psRect->i16YMax-psRect->i16YMin
-                     , psRect->i16XMax-psRect->i16XMin);
-    numPixels = (psRect->i16YMax-psRect->i16YMin)*(psRect->i16XMax-psRect->i16XMin);
-    // Send the color to that address range. All colors are 2 bytes.
-    int x,y;
-
     // Set the CS pin low, as we want to loop several commands in the same CS period.
     GPIO_write(GPIO_CS_PIN, 0);
 
-    // Send the command to write to screen buffer.
-    sendLcdCommandNoCS(spiHandle, HX8357_RAMWR, NULL, 0, 0);
+    // Set the address window to match the rectangle.
+    setAddressWindow(pDisplayData, psRect->i16YMin, psRect->i16XMin, i32Rows, i32Cols);
 
+    // Send the command to write to screen buffer, followed by the color.
+    sendLcdCommandNoCS(spiHandle, HX8357_RAMWR, NULL, 0, 0);
+    sendColorRun(spiHandle, pScreenBuf, ui32BufBytes/2, ui32ulValue, i32Rows*i32Cols);
 
-    if(n > 0){
-        // Loop through the rows and write the entire buffer at once,
-        // looping through the buffer several times if needed.
-        y = psRect->i16YMin;
-        while(y < psRect->i16YMax){
-            sendLcdCommandNoCS(spiHandle, HX8357_NO_COMMAND, pScreenBuf, 2*n*numPixelsInARow, 0);
-            y += n;
-            numWritten += n*numPixelsInARow;
-        }
-        // If the exact number of rows haven't been written, then that means that
-        // y%n != 0, which means that we need to write a shorter burst.
-        if(y != psRect->i16YMax){
-            y -= n;
-            // Write the remainder of the pixels
-            sendLcdCommandNoCS(spiHandle, HX8357_NO_COMMAND, pScreenBuf, 2*numPixelsInARow*(psRect->i16YMax-y), 0);
-        }
-        //y -= n;
-        /*
-        for(y = psRect->i16YMin ; y <= psRect->i16YMax-n ; y += n){
-            sendLcdCommandNoCS(spiHandle, HX8357_NO_COMMAND, pScreenBuf, 2*n*numPixelsInARow, 0);
-        }
-        */
-        // Check if there are rows left not sent due to y_size % n != 0:
-        /*
-        if(y < psRect->i16YMax){
-            // Write the remainder of the pixels
-            sendLcdCommandNoCS(spiHandle, HX8357_NO_COMMAND, pScreenBuf, 2*(n*numPixelsInARow-(psRect->i16YMax-y)), 0);
-            numWritten += (n*numPixelsInARow-(psRect->i16YMax-y));
-        }
-        */
-    }
-    else{
-        // Send the command for every pixel
-        for(x = psRect->i16XMin ; x <= psRect->i16XMax ; x++){
-            for(y = psRect->i16YMin ; y <= psRect->i16YMax ; y++){
-                sendLcdCommandNoCS(spiHandle, HX8357_NO_COMMAND, (char*)&ui32ulValue, 2, 0);
-            }
-        }
-    }
     GPIO_write(GPIO_CS_PIN, 1);
-    // Finally, free the allocated memory
-    free(pScreenBuf);
+    // Finally, give the buffer back to the pool.
+    HX8357_scratchReturn(pDisplayData, pScreenBuf);
+    TRACE_OUT(TRACE_RECT_FILL, i32Rows*i32Cols);
 }
 
 // Parameters:
@@ -532,6 +1278,8 @@ uint32_t ui32ulValue){
 // Returns:
 // Returns the display-driver specific color.
 uint32_t ColorTranslate(void *pvDisplayData, uint32_t ui32ulValue){
+    uint32_t ui32Color;
+    TRACE_IN(TRACE_COLOR_TRANSLATE, ui32ulValue);
     // The input format is: bits [23..16] = R, [15..8] = G, [7..0] = B
     // And the output format is RGB565, meaning [15..11] = R, [10..5] = G, [4..0] = B
 
@@ -539,14 +1287,17 @@ uint32_t ColorTranslate(void *pvDisplayData, uint32_t ui32ulValue){
     // significant bits, but with the risk of losing fidelity.
     // A better way would involve some dithering, but given that the
     // application here aims to show text, not images, the contrast would be high
-    // to begin with. So shifting it is.
+    // to begin with. So shifting it is. Images, where the position of each color
+    // is known, can be dithered instead, see HX8357_rgbConvert.
 
     // This gives:
     // Blue = output[4..0] = (input>>3) & 0x1F
     // Green = output[10..5] = (input>>5) & 0x7E0
-    // Red = output[15..11] = (input>>7) & 0xF800
+    // Red = output[15..11] = (input>>8) & 0xF800
     // RGB order below.
-    return ((ui32ulValue>>7) & 0xF800) | ((ui32ulValue>>5) & 0x7E0) | ((ui32ulValue>>3) & 0x1F);
+    ui32Color = ((ui32ulValue>>8) & 0xF800) | ((ui32ulValue>>5) & 0x7E0) | ((ui32ulValue>>3) & 0x1F);
+    TRACE_OUT(TRACE_COLOR_TRANSLATE, ui32Color);
+    return ui32Color;
 }
 
 // Parameters:
@@ -560,4 +1311,6 @@ uint32_t ColorTranslate(void *pvDisplayData, uint32_t ui32ulValue){
 // None.
 void Flush(void *pvDisplayData){
     // No such flush operation exist, hence, this is left blank.
+    TRACE_IN(TRACE_FLUSH, 0);
+    TRACE_OUT(TRACE_FLUSH, 0);
 }
@@ -43,9 +43,11 @@
 #define HX8357_RAMRD 0x2E ///< Read VRAm
 
 #define HX8357B_PTLAR 0x30   ///< (unknown)
+#define HX8357_VSCRDEF 0x33  ///< Vertical scrolling definition
 #define HX8357_TEON 0x35     ///< Tear enable on
 #define HX8357_TEARLINE 0x44 ///< (unknown)
 #define HX8357_MADCTL 0x36   ///< Memory access control
+#define HX8357_VSCRSADD 0x37 ///< Vertical scrolling start address
 #define HX8357_COLMOD 0x3A   ///< Color mode
 
 #define HX8357_SETOSC 0xB0      ///< Set oscillator
@@ -85,6 +87,16 @@
 
 #define HX8357_NO_COMMAND 0xFF // No command, defined by Oskar
 
+// MADCTL bits, see page 157 in the datasheet
+#define HX8357_MADCTL_MY 0x80 // Row address order
+#define HX8357_MADCTL_MX 0x40 // Column address order
+#define HX8357_MADCTL_MV 0x20 // Row/column exchange
+// Orientations for HX8357_orientationSet. Landscape (480x320) is set by the init.
+// Vertical scrolling always moves the picture along the 480 pixel side of the panel,
+// so it scrolls up and down in portrait (320x480) only.
+#define HX8357_LANDSCAPE (HX8357_MADCTL_MY | HX8357_MADCTL_MV)
+#define HX8357_PORTRAIT  0x00
+
 // Plan is to move this to GFX header (with different prefix), though
 // defines will be kept here for existing code that might be referencing
 // them. Some additional ones are in the ILI9341 lib -- add all in GFX!
@@ -98,13 +110,109 @@
 #define HX8357_YELLOW 0xFFE0  ///< YELLOW color for drawing graphics
 #define HX8357_WHITE 0xFFFF   ///< WHITE color for drawing graphics
 
+// Swap the two bytes of a translated RGB565 color. The screen expects the most
+// significant byte first, so a swapped color stored as a uint16_t in (little endian)
+// memory can be sent to the screen as is.
+#define HX8357_SWAP16(c) ((uint16_t)((((c) >> 8) & 0xFF) | (((c) & 0xFF) << 8)))
+
+// Formats of 24-bit color for HX8357_rgbConvert
+#define HX8357_RGB_XRGB32 0 // uint32_t 0x00RRGGBB, like GRLIB colors
+#define HX8357_RGB_BGR24  1 // Blue, green and red bytes, like BMP files
+
+// Size in bytes of the scratch buffer pool in tDisplayData, which the drawing
+// functions use to build pixel data before it is sent. Can be set at build time,
+// e.g. --define=HX8357_SCRATCH_BYTES=4096. Must be a multiple of 4.
+#ifndef HX8357_SCRATCH_BYTES
+#define HX8357_SCRATCH_BYTES 2048
+#endif
+
+// Stream pixel data to the screen with the SPI in callback mode, so that the next
+// chunk is queued while the current one is sent by the DMA. Requires the SPI to be
+// opened with SPI_MODE_CALLBACK and HX8357_spiCallback as callback. Set to 0 to use
+// the SPI in blocking mode instead.
+#ifndef HX8357_SPI_STREAMING
+#define HX8357_SPI_STREAMING 1
+#endif
+
+// Nominal time between two refreshes of the screen in us, used until the period has been
+// measured on the TE pin. SETOSC in the init sequence sets about 75 Hz.
+#ifndef HX8357_REFRESH_US
+#define HX8357_REFRESH_US 13333
+#endif
+
+// Frame timing statistics, see HX8357_vsyncWait.
+typedef struct
+{
+    bool bTeActive;             // True if TE pulses are used, false if estimated
+    uint32_t ui32NumTe;         // TE pulses seen
+    uint32_t ui32RefreshUs;     // Time between two refreshes, measured if TE is active
+    uint32_t ui32NumFrames;     // Frames presented, i.e. calls to HX8357_vsyncWait
+    uint32_t ui32NumMissed;     // Refreshes missed because a frame took too long
+    uint32_t ui32LastFrameUs;   // Time between the last two frames
+    uint32_t ui32MaxFrameUs;    // Longest time between two frames
+}
+tFrameStats;
+
+// The pvDisplayData must contain the SPI handle in order to
+// send the data from GRLIB to the screen
+typedef struct
+{
+    SPI_Handle spiHandle;
+    // The last address window sent to the screen. Used to skip
+    // CASET/PASET commands that would not change anything.
+    bool bWindowValid;
+    uint16_t ui16ColStart;
+    uint16_t ui16ColEnd;
+    uint16_t ui16RowStart;
+    uint16_t ui16RowEnd;
+    // Scratch buffer pool, see HX8357_scratchBorrow. Statically allocated together
+    // with the display data, and word aligned so that it can be used by the DMA.
+    uint32_t pui32Scratch[HX8357_SCRATCH_BYTES/4];
+    uint32_t ui32ScratchUsed;       // Bytes currently borrowed
+    uint32_t ui32ScratchHighWater;  // Most bytes ever borrowed at the same time
+    uint32_t ui32ScratchShortCount; // Number of times a borrow got less than asked for
+    bool bDither;                   // Dither 24-bit images, see HX8357_ditherSet
+}
+tDisplayData;
+
 /*!
   @brief  Function declarations
 */
 void HX8357_init(SPI_Handle masterSpi); //
-void setAddressWindow(SPI_Handle spiHandle, uint16_t x, uint16_t y, uint16_t width, uint32_t height);
+void HX8357_initBegin(SPI_Handle masterSpi);
+void HX8357_initFinish(void);
+void HX8357_vsyncInit(void);
+void HX8357_vsyncWait(uint32_t ui32Frames);
+void HX8357_frameStatsGet(tFrameStats *psStats);
+void HX8357_initDisplayData(tDisplayData *pDisplayData, SPI_Handle spiHandle);
+void HX8357_orientationSet(tDisplayData *pDisplayData, uint8_t ui8Madctl);
+void HX8357_scrollAreaSet(tDisplayData *pDisplayData, uint16_t ui16Top, uint16_t ui16Height);
+void HX8357_scrollStartSet(tDisplayData *pDisplayData, uint16_t ui16Line);
+void HX8357_fillColor(void *pvBuf, uint32_t ui32Color, uint32_t ui32NumPixels);
+void HX8357_rgbConvert(uint16_t *pui16Out, const void *pvIn, uint32_t ui32Format, uint32_t ui32Count,
+                       int32_t i32X, int32_t i32Y, bool bDither);
+void HX8357_ditherSet(tDisplayData *pDisplayData, bool bDither);
+char *HX8357_scratchBorrow(tDisplayData *pDisplayData, uint32_t ui32Bytes, uint32_t *pui32Granted);
+void HX8357_scratchReturn(tDisplayData *pDisplayData, char *pBuf);
+void HX8357_pixelsTranslate(void *pvDisplayData, uint16_t *pui16Out, int32_t i32X,
+                            int32_t i32Y, int32_t i32X0, int32_t i32Count, int32_t i32BPP,
+                            const uint8_t *pui8Data, const uint8_t *pui8Palette);
+void HX8357_pixelsWrite(tDisplayData *pDisplayData, int32_t i32X, int32_t i32Y,
+                        const uint16_t *pui16Pixels, int32_t i32Count);
+void HX8357_rectWrite(tDisplayData *pDisplayData, const tRectangle *psRect,
+                      const uint16_t *pui16Pixels, uint32_t ui32Stride);
+void HX8357_streamBegin(tDisplayData *pDisplayData, const tRectangle *psRect);
+uint32_t HX8357_streamWrite(tDisplayData *pDisplayData, const void *pvData, uint32_t ui32Bytes);
+void HX8357_streamWait(tDisplayData *pDisplayData, uint32_t ui32Chunks);
+void HX8357_streamEnd(tDisplayData *pDisplayData);
+void HX8357_rectsFill(tDisplayData *pDisplayData, const tRectangle *psRects, uint32_t ui32Count,
+                      uint32_t ui32Color);
+void setAddressWindow(tDisplayData *pDisplayData, uint16_t y, uint16_t x, uint16_t height, uint32_t width);
 void sendLcdCommandNoCS(SPI_Handle spiHandle, char command, char* pData, uint32_t numData, uint32_t delayUs);
 void sendLcdCommand(SPI_Handle spiHandle, char command, char* pData, uint32_t numData, uint32_t delayUs);
+#if HX8357_SPI_STREAMING
+void HX8357_spiCallback(SPI_Handle spiHandle, SPI_Transaction *transaction);
+#endif
 
 // GRLIB specific functions:
 void PixelDraw(void *pvDisplayData, int32_t i32X, int32_t i32Y,
@@ -124,13 +232,4 @@ uint32_t ui32ulValue);
 void Flush(void *pvDisplayData);
 
 
-
-// The pvDisplayData must contain the SPI handle in order to
-// send the data from GRLIB to the screen
-typedef struct
-{
-    SPI_Handle spiHandle;
-}
-tDisplayData;
-
 #endif /* ADAFRUIT_2050_H_ */
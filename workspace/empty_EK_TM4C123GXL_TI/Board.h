@@ -88,6 +88,7 @@ extern "C" {
 #define GPIO_CS_PIN                 EK_TM4C123GXL_PORT_A_PIN_6
 #define GPIO_DC_PIN                 EK_TM4C123GXL_PORT_A_PIN_7
 #define GPIO_SCREEN_RESET           EK_TM4C123GXL_PORT_B_PIN_0
+#define GPIO_TE_PIN                 EK_TM4C123GXL_PORT_E_PIN_2
 /* Board specific I2C addresses */
 #define Board_TMP006_ADDR           (0x40)
 #define Board_RF430CL330_ADDR       (0x28)
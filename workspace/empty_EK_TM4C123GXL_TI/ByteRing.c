@@ -0,0 +1,85 @@
+/*
+ * ByteRing.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include <ti/sysbios/BIOS.h>
+#include "ByteRing.h"
+
+#define INDEX_MASK (BYTERING_SIZE - 1)
+
+// Initialize the ring. Must be called before either side uses it.
+void ByteRing_init(tByteRing *pRing){
+    Semaphore_Params semParams;
+
+    pRing->ui32Head = 0;
+    pRing->ui32Tail = 0;
+    pRing->ui32NumReads = 0;
+    pRing->ui32MaxFill = 0;
+    pRing->ui32NumFull = 0;
+
+    // Binary semaphores, since each side always checks the indexes again after
+    // waking up, so a post too many doesn't matter.
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&pRing->dataSemStruct, 0, &semParams);
+    pRing->dataSemHandle = Semaphore_handle(&pRing->dataSemStruct);
+    Semaphore_construct(&pRing->spaceSemStruct, 0, &semParams);
+    pRing->spaceSemHandle = Semaphore_handle(&pRing->spaceSemStruct);
+}
+
+// Write ui32Length bytes to the ring, from the producer. If the ring is full, waits
+// up to ui32Timeout clock ticks (or BIOS_WAIT_FOREVER) each time for the consumer to
+// make space. Returns the number of bytes written, less than ui32Length on timeout.
+uint32_t ByteRing_write(tByteRing *pRing, const char *pcData, uint32_t ui32Length, UInt32 ui32Timeout){
+    uint32_t ui32Written = 0;
+    uint32_t ui32Head = pRing->ui32Head;
+    uint32_t ui32Fill;
+
+    while(ui32Written < ui32Length){
+        ui32Fill = ui32Head - pRing->ui32Tail;
+        if(ui32Fill == BYTERING_SIZE){
+            pRing->ui32NumFull++;
+            if(!Semaphore_pend(pRing->spaceSemHandle, ui32Timeout)){
+                break;
+            }
+            continue;
+        }
+        // Copy whatever fits, then move the head past it.
+        while((ui32Written < ui32Length) && (ui32Fill < BYTERING_SIZE)){
+            pRing->pui8Buf[ui32Head & INDEX_MASK] = pcData[ui32Written++];
+            ui32Head++;
+            ui32Fill++;
+        }
+        pRing->ui32Head = ui32Head;
+        if(ui32Fill > pRing->ui32MaxFill){
+            pRing->ui32MaxFill = ui32Fill;
+        }
+        Semaphore_post(pRing->dataSemHandle);
+    }
+    return ui32Written;
+}
+
+// Read everything that is in the ring, up to ui32MaxLength bytes, from the consumer.
+// If the ring is empty, waits up to ui32Timeout clock ticks (or BIOS_WAIT_FOREVER) for
+// the producer to write something. Returns the number of bytes read, 0 on timeout.
+uint32_t ByteRing_read(tByteRing *pRing, char *pcData, uint32_t ui32MaxLength, UInt32 ui32Timeout){
+    uint32_t ui32Tail = pRing->ui32Tail;
+    uint32_t ui32Read = 0;
+    uint32_t ui32Fill;
+
+    while((ui32Fill = pRing->ui32Head - ui32Tail) == 0){
+        if(!Semaphore_pend(pRing->dataSemHandle, ui32Timeout)){
+            return 0;
+        }
+    }
+    while((ui32Read < ui32MaxLength) && (ui32Read < ui32Fill)){
+        pcData[ui32Read++] = pRing->pui8Buf[ui32Tail & INDEX_MASK];
+        ui32Tail++;
+    }
+    pRing->ui32Tail = ui32Tail;
+    pRing->ui32NumReads++;
+    Semaphore_post(pRing->spaceSemHandle);
+    return ui32Read;
+}
@@ -0,0 +1,47 @@
+/*
+ * ByteRing.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Byte ring buffer between one producer and one consumer task, e.g. the UART
+ *  task and the screen task. The head is only changed by the producer and the
+ *  tail only by the consumer, so no locking is needed to move bytes. Semaphores
+ *  are only used to wake up a side that waits for data or for space.
+ *
+ */
+
+#ifndef BYTERING_H_
+#define BYTERING_H_
+#include <stdint.h>
+#include <xdc/std.h>
+#include <ti/sysbios/knl/Semaphore.h>
+
+// Size of the ring in bytes. Must be a power of 2.
+#ifndef BYTERING_SIZE
+#define BYTERING_SIZE 256
+#endif
+
+typedef struct
+{
+    volatile uint8_t pui8Buf[BYTERING_SIZE]; // Volatile, so that the bytes are in before the head moves
+    volatile uint32_t ui32Head;     // Bytes written, only changed by the producer
+    volatile uint32_t ui32Tail;     // Bytes read, only changed by the consumer
+    Semaphore_Struct dataSemStruct; // Posted when bytes are written
+    Semaphore_Handle dataSemHandle;
+    Semaphore_Struct spaceSemStruct;// Posted when bytes are read
+    Semaphore_Handle spaceSemHandle;
+    // Statistics, can be read from the debugger.
+    uint32_t ui32NumReads;          // Reads that returned bytes, i.e. batches
+    uint32_t ui32MaxFill;           // Most bytes waiting at the same time
+    uint32_t ui32NumFull;           // Times the producer had to wait for space
+}
+tByteRing;
+
+/*!
+  @brief  Function declarations
+*/
+void ByteRing_init(tByteRing *pRing);
+uint32_t ByteRing_write(tByteRing *pRing, const char *pcData, uint32_t ui32Length, UInt32 ui32Timeout);
+uint32_t ByteRing_read(tByteRing *pRing, char *pcData, uint32_t ui32MaxLength, UInt32 ui32Timeout);
+
+#endif /* BYTERING_H_ */
@@ -0,0 +1,365 @@
+/*
+ * DisplayList.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include <string.h>
+#include "DisplayList.h"
+
+static bool rectsOverlap(const tRectangle *psA, const tRectangle *psB){
+    return (psA->i16XMin <= psB->i16XMax) && (psB->i16XMin <= psA->i16XMax) &&
+           (psA->i16YMin <= psB->i16YMax) && (psB->i16YMin <= psA->i16YMax);
+}
+
+// True if psOuter covers all of psInner
+static bool rectContains(const tRectangle *psOuter, const tRectangle *psInner){
+    return (psOuter->i16XMin <= psInner->i16XMin) && (psOuter->i16XMax >= psInner->i16XMax) &&
+           (psOuter->i16YMin <= psInner->i16YMin) && (psOuter->i16YMax >= psInner->i16YMax);
+}
+
+// Initialize the display list, with no nodes and nothing damaged. Everything is
+// drawn on psDisplay, with ui32Background (a translated color) behind the nodes.
+// Nothing is drawn until a node is set, or DisplayList_damage is called.
+void DisplayList_init(tDisplayList *pList, const tDisplay *psDisplay, uint32_t ui32Background){
+    GrContextInit(&pList->sContext, psDisplay);
+    pList->sContext.ui32Background = ui32Background;
+    pList->ui32Background = ui32Background;
+    memset(pList->psNodes, 0, sizeof(pList->psNodes)); // All DISPLAYLIST_NONE
+    pList->ui32NumDamage = 0;
+    pList->ui32NumUpdates = 0;
+    pList->ui32NumRenders = 0;
+    pList->ui32NumRects = 0;
+    pList->ui32NumPixels = 0;
+    pList->ui32NumMerges = 0;
+}
+
+// Add psRect to the damage, leaving out what is already in there from ui32First on.
+// The part that overlaps a damaged rectangle is cut out, and each of the up to four
+// pieces around it (above, below, left and right) is added on its own, so that no
+// pixel is repainted twice. If the damage is full, everything is merged into one
+// rectangle, which covers all of psWhole, the rectangle first passed in, as well.
+static void damageAdd(tDisplayList *pList, const tRectangle *psRect, uint32_t ui32First,
+                      const tRectangle *psWhole){
+    const tRectangle *psDamage;
+    tRectangle sPiece;
+    uint32_t ui32Index;
+
+    if(pList->bMerged){
+        return;
+    }
+    for(ui32Index = ui32First ; ui32Index < pList->ui32NumDamage ; ui32Index++){
+        psDamage = &pList->psDamage[ui32Index];
+        if(!rectsOverlap(psDamage, psRect)){
+            continue;
+        }
+        if(rectContains(psDamage, psRect)){
+            return;
+        }
+        sPiece = *psRect;
+        if(psRect->i16YMin < psDamage->i16YMin){
+            sPiece.i16YMax = psDamage->i16YMin - 1;
+            damageAdd(pList, &sPiece, ui32Index + 1, psWhole);
+        }
+        if(psRect->i16YMax > psDamage->i16YMax){
+            sPiece.i16YMin = psDamage->i16YMax + 1;
+            sPiece.i16YMax = psRect->i16YMax;
+            damageAdd(pList, &sPiece, ui32Index + 1, psWhole);
+        }
+        // The left and right pieces only take the rows next to the damage.
+        sPiece.i16YMin = psRect->i16YMin > psDamage->i16YMin ? psRect->i16YMin : psDamage->i16YMin;
+        sPiece.i16YMax = psRect->i16YMax < psDamage->i16YMax ? psRect->i16YMax : psDamage->i16YMax;
+        if(psRect->i16XMin < psDamage->i16XMin){
+            sPiece.i16XMin = psRect->i16XMin;
+            sPiece.i16XMax = psDamage->i16XMin - 1;
+            damageAdd(pList, &sPiece, ui32Index + 1, psWhole);
+        }
+        if(psRect->i16XMax > psDamage->i16XMax){
+            sPiece.i16XMin = psDamage->i16XMax + 1;
+            sPiece.i16XMax = psRect->i16XMax;
+            damageAdd(pList, &sPiece, ui32Index + 1, psWhole);
+        }
+        return;
+    }
+    if(pList->ui32NumDamage < DISPLAYLIST_DAMAGE){
+        pList->psDamage[pList->ui32NumDamage++] = *psRect;
+        return;
+    }
+    // No room, so merge everything, including psWhole, into one rectangle.
+    sPiece = *psWhole;
+    for(ui32Index = 0 ; ui32Index < pList->ui32NumDamage ; ui32Index++){
+        psDamage = &pList->psDamage[ui32Index];
+        sPiece.i16XMin = sPiece.i16XMin < psDamage->i16XMin ? sPiece.i16XMin : psDamage->i16XMin;
+        sPiece.i16YMin = sPiece.i16YMin < psDamage->i16YMin ? sPiece.i16YMin : psDamage->i16YMin;
+        sPiece.i16XMax = sPiece.i16XMax > psDamage->i16XMax ? sPiece.i16XMax : psDamage->i16XMax;
+        sPiece.i16YMax = sPiece.i16YMax > psDamage->i16YMax ? sPiece.i16YMax : psDamage->i16YMax;
+    }
+    pList->psDamage[0] = sPiece;
+    pList->ui32NumDamage = 1;
+    pList->bMerged = true;
+    pList->ui32NumMerges++;
+}
+
+// Mark psRect as damaged, so that it is repainted by the next DisplayList_render.
+// Also used for repainting everything the first time.
+void DisplayList_damage(tDisplayList *pList, const tRectangle *psRect){
+    tRectangle sRect = *psRect;
+
+    // Only the part on the screen
+    if(sRect.i16XMin < 0){
+        sRect.i16XMin = 0;
+    }
+    if(sRect.i16YMin < 0){
+        sRect.i16YMin = 0;
+    }
+    if(sRect.i16XMax >= GrContextDpyWidthGet(&pList->sContext)){
+        sRect.i16XMax = GrContextDpyWidthGet(&pList->sContext) - 1;
+    }
+    if(sRect.i16YMax >= GrContextDpyHeightGet(&pList->sContext)){
+        sRect.i16YMax = GrContextDpyHeightGet(&pList->sContext) - 1;
+    }
+    if((sRect.i16XMin > sRect.i16XMax) || (sRect.i16YMin > sRect.i16YMax)){
+        return;
+    }
+    pList->bMerged = false;
+    damageAdd(pList, &sRect, 0, &sRect);
+}
+
+// Replace node ui16Id with psNew. Nothing is damaged if the node doesn't change.
+// The new bounds are damaged before the old ones, so that what the node covers now
+// stays one rectangle and only the trail it leaves behind is cut into pieces.
+static void nodeSet(tDisplayList *pList, uint16_t ui16Id, const tDisplayListNode *psNew){
+    tDisplayListNode *psNode;
+
+    if(ui16Id >= DISPLAYLIST_NODES){
+        return;
+    }
+    psNode = &pList->psNodes[ui16Id];
+    if((psNode->ui8Type == psNew->ui8Type) && (psNode->ui32Color == psNew->ui32Color) &&
+       (memcmp(&psNode->sBounds, &psNew->sBounds, sizeof(tRectangle)) == 0) &&
+       (psNode->i16X1 == psNew->i16X1) && (psNode->i16Y1 == psNew->i16Y1) &&
+       (psNode->i16X2 == psNew->i16X2) && (psNode->i16Y2 == psNew->i16Y2) &&
+       (psNode->psFont == psNew->psFont) && (psNode->pui8Image == psNew->pui8Image) &&
+       (psNode->ui8TextLength == psNew->ui8TextLength) &&
+       (memcmp(psNode->pcText, psNew->pcText, psNew->ui8TextLength) == 0)){
+        return;
+    }
+    if(psNew->ui8Type != DISPLAYLIST_NONE){
+        DisplayList_damage(pList, &psNew->sBounds);
+    }
+    if(psNode->ui8Type != DISPLAYLIST_NONE){
+        DisplayList_damage(pList, &psNode->sBounds);
+    }
+    *psNode = *psNew;
+    pList->ui32NumUpdates++;
+}
+
+// A node of ui8Type with everything else cleared, so that nodes can be compared.
+static void nodeClear(tDisplayListNode *psNode, uint8_t ui8Type, uint32_t ui32Color){
+    memset(psNode, 0, sizeof(tDisplayListNode));
+    psNode->ui8Type = ui8Type;
+    psNode->ui32Color = ui32Color;
+}
+
+// Set node ui16Id to a rectangle filled with ui32Color (translated). The rectangle
+// is inclusive, like for GrRectFill.
+void DisplayList_rectSet(tDisplayList *pList, uint16_t ui16Id, const tRectangle *psRect,
+                         uint32_t ui32Color){
+    tDisplayListNode sNode;
+
+    nodeClear(&sNode, DISPLAYLIST_RECT, ui32Color);
+    sNode.sBounds = *psRect;
+    nodeSet(pList, ui16Id, &sNode);
+}
+
+// Set node ui16Id to a line from (i16X1, i16Y1) to (i16X2, i16Y2), both included.
+void DisplayList_lineSet(tDisplayList *pList, uint16_t ui16Id, int16_t i16X1, int16_t i16Y1,
+                         int16_t i16X2, int16_t i16Y2, uint32_t ui32Color){
+    tDisplayListNode sNode;
+
+    nodeClear(&sNode, DISPLAYLIST_LINE, ui32Color);
+    sNode.i16X1 = i16X1;
+    sNode.i16Y1 = i16Y1;
+    sNode.i16X2 = i16X2;
+    sNode.i16Y2 = i16Y2;
+    sNode.sBounds.i16XMin = i16X1 < i16X2 ? i16X1 : i16X2;
+    sNode.sBounds.i16XMax = i16X1 < i16X2 ? i16X2 : i16X1;
+    sNode.sBounds.i16YMin = i16Y1 < i16Y2 ? i16Y1 : i16Y2;
+    sNode.sBounds.i16YMax = i16Y1 < i16Y2 ? i16Y2 : i16Y1;
+    nodeSet(pList, ui16Id, &sNode);
+}
+
+// Set node ui16Id to i32Length characters of pcText (or up to the end of the string
+// if -1), in psFont with the top left corner at (i16X, i16Y). Text longer than
+// DISPLAYLIST_TEXT_CHARS is cut off.
+void DisplayList_textSet(tDisplayList *pList, uint16_t ui16Id, const tFont *psFont,
+                         const char *pcText, int32_t i32Length, int16_t i16X, int16_t i16Y,
+                         uint32_t ui32Color){
+    tDisplayListNode sNode;
+
+    if(i32Length < 0){
+        i32Length = strlen(pcText);
+    }
+    if(i32Length > DISPLAYLIST_TEXT_CHARS){
+        i32Length = DISPLAYLIST_TEXT_CHARS;
+    }
+    if(i32Length == 0){
+        // Nothing to draw, but the old text still has to be cleared.
+        DisplayList_remove(pList, ui16Id);
+        return;
+    }
+    nodeClear(&sNode, DISPLAYLIST_TEXT, ui32Color);
+    memcpy(sNode.pcText, pcText, i32Length);
+    sNode.ui8TextLength = i32Length;
+    sNode.psFont = psFont;
+    sNode.i16X1 = i16X;
+    sNode.i16Y1 = i16Y;
+    GrContextFontSet(&pList->sContext, psFont);
+    sNode.sBounds.i16XMin = i16X;
+    sNode.sBounds.i16YMin = i16Y;
+    sNode.sBounds.i16XMax = i16X + GrStringWidthGet(&pList->sContext, sNode.pcText, i32Length) - 1;
+    sNode.sBounds.i16YMax = i16Y + GrFontHeightGet(psFont) - 1;
+    nodeSet(pList, ui16Id, &sNode);
+}
+
+// Set node ui16Id to a GRLIB image with the top left corner at (i16X, i16Y). 1 bpp
+// images are drawn in ui32Color on the background, the others with their own palette.
+// The image isn't copied, and must not change.
+void DisplayList_imageSet(tDisplayList *pList, uint16_t ui16Id, const uint8_t *pui8Image,
+                          int16_t i16X, int16_t i16Y, uint32_t ui32Color){
+    tDisplayListNode sNode;
+
+    nodeClear(&sNode, DISPLAYLIST_IMAGE, ui32Color);
+    sNode.pui8Image = pui8Image;
+    sNode.i16X1 = i16X;
+    sNode.i16Y1 = i16Y;
+    // The image starts with the format, then the width and height, 16 bits each,
+    // least significant byte first.
+    sNode.sBounds.i16XMin = i16X;
+    sNode.sBounds.i16YMin = i16Y;
+    sNode.sBounds.i16XMax = i16X + (pui8Image[1] | (pui8Image[2] << 8)) - 1;
+    sNode.sBounds.i16YMax = i16Y + (pui8Image[3] | (pui8Image[4] << 8)) - 1;
+    nodeSet(pList, ui16Id, &sNode);
+}
+
+// Remove node ui16Id, which clears what it covered.
+void DisplayList_remove(tDisplayList *pList, uint16_t ui16Id){
+    tDisplayListNode sNode;
+
+    nodeClear(&sNode, DISPLAYLIST_NONE, 0);
+    nodeSet(pList, ui16Id, &sNode);
+}
+
+// Draw the part of a line inside psClip. The whole line is stepped through, the same
+// way every time, so that the pixels match wherever the line is cut.
+static void lineDraw(const tDisplay *psDisplay, const tDisplayListNode *psNode,
+                     const tRectangle *psClip){
+    int32_t i32X = psNode->i16X1, i32Y = psNode->i16Y1;
+    int32_t i32DX = psNode->i16X2 - psNode->i16X1;
+    int32_t i32DY = psNode->i16Y2 - psNode->i16Y1;
+    int32_t i32StepX = i32DX < 0 ? -1 : 1;
+    int32_t i32StepY = i32DY < 0 ? -1 : 1;
+    int32_t i32Error, i32Error2;
+
+    i32DX = i32DX < 0 ? -i32DX : i32DX;
+    i32DY = i32DY < 0 ? -i32DY : i32DY;
+    i32Error = i32DX - i32DY;
+    while(1){
+        if((i32X >= psClip->i16XMin) && (i32X <= psClip->i16XMax) &&
+           (i32Y >= psClip->i16YMin) && (i32Y <= psClip->i16YMax)){
+            psDisplay->pfnPixelDraw(psDisplay->pvDisplayData, i32X, i32Y, psNode->ui32Color);
+        }
+        if((i32X == psNode->i16X2) && (i32Y == psNode->i16Y2)){
+            break;
+        }
+        i32Error2 = 2*i32Error;
+        if(i32Error2 > -i32DY){
+            i32Error -= i32DY;
+            i32X += i32StepX;
+        }
+        if(i32Error2 < i32DX){
+            i32Error += i32DX;
+            i32Y += i32StepY;
+        }
+    }
+}
+
+// Draw the part of psNode inside psClip, which the node overlaps.
+static void nodeDraw(tDisplayList *pList, const tDisplayListNode *psNode, const tRectangle *psClip){
+    const tDisplay *psDisplay = pList->sContext.psDisplay;
+    tRectangle sRect;
+
+    // Rectangles, and lines that are straight up or across, are filled where they
+    // overlap the clip.
+    if((psNode->ui8Type == DISPLAYLIST_RECT) ||
+       ((psNode->ui8Type == DISPLAYLIST_LINE) &&
+        ((psNode->i16X1 == psNode->i16X2) || (psNode->i16Y1 == psNode->i16Y2)))){
+        sRect.i16XMin = psNode->sBounds.i16XMin > psClip->i16XMin ? psNode->sBounds.i16XMin : psClip->i16XMin;
+        sRect.i16YMin = psNode->sBounds.i16YMin > psClip->i16YMin ? psNode->sBounds.i16YMin : psClip->i16YMin;
+        sRect.i16XMax = psNode->sBounds.i16XMax < psClip->i16XMax ? psNode->sBounds.i16XMax : psClip->i16XMax;
+        sRect.i16YMax = psNode->sBounds.i16YMax < psClip->i16YMax ? psNode->sBounds.i16YMax : psClip->i16YMax;
+        psDisplay->pfnRectFill(psDisplay->pvDisplayData, &sRect, psNode->ui32Color);
+    }
+    else if(psNode->ui8Type == DISPLAYLIST_LINE){
+        lineDraw(psDisplay, psNode, psClip);
+    }
+    else if(psNode->ui8Type == DISPLAYLIST_TEXT){
+        // GRLIB clips text and images to the clip region of the context.
+        GrContextFontSet(&pList->sContext, psNode->psFont);
+        pList->sContext.ui32Foreground = psNode->ui32Color;
+        GrStringDraw(&pList->sContext, psNode->pcText, psNode->ui8TextLength,
+                     psNode->i16X1, psNode->i16Y1, false);
+    }
+    else if(psNode->ui8Type == DISPLAYLIST_IMAGE){
+        pList->sContext.ui32Foreground = psNode->ui32Color;
+        GrImageDraw(&pList->sContext, psNode->pui8Image, psNode->i16X1, psNode->i16Y1);
+    }
+}
+
+// Repaint psRect: the background, then every node that overlaps it, from the lowest
+// ID up. If a rectangle node covers all of psRect, nothing below it shows, so the
+// painting starts with that node instead.
+static void damageRepaint(tDisplayList *pList, tRectangle *psRect){
+    const tDisplay *psDisplay = pList->sContext.psDisplay;
+    const tDisplayListNode *psNode;
+    uint32_t ui32First = DISPLAYLIST_NODES;
+    uint32_t ui32Id;
+
+    while(ui32First > 0){
+        psNode = &pList->psNodes[ui32First - 1];
+        if((psNode->ui8Type == DISPLAYLIST_RECT) && rectContains(&psNode->sBounds, psRect)){
+            break;
+        }
+        ui32First--;
+    }
+    if(ui32First == 0){
+        psDisplay->pfnRectFill(psDisplay->pvDisplayData, psRect, pList->ui32Background);
+    }
+    else {
+        ui32First--;
+    }
+    GrContextClipRegionSet(&pList->sContext, psRect);
+    for(ui32Id = ui32First ; ui32Id < DISPLAYLIST_NODES ; ui32Id++){
+        psNode = &pList->psNodes[ui32Id];
+        if((psNode->ui8Type != DISPLAYLIST_NONE) && rectsOverlap(&psNode->sBounds, psRect)){
+            nodeDraw(pList, psNode, psRect);
+        }
+    }
+    pList->ui32NumRects++;
+    pList->ui32NumPixels += (psRect->i16XMax - psRect->i16XMin + 1)*(psRect->i16YMax - psRect->i16YMin + 1);
+}
+
+// Repaint everything damaged since the last render. Like the other drawing, it is
+// only sure to be on the screen after a flush.
+void DisplayList_render(tDisplayList *pList){
+    uint32_t ui32Index;
+
+    if(pList->ui32NumDamage == 0){
+        return;
+    }
+    for(ui32Index = 0 ; ui32Index < pList->ui32NumDamage ; ui32Index++){
+        damageRepaint(pList, &pList->psDamage[ui32Index]);
+    }
+    pList->ui32NumDamage = 0;
+    pList->ui32NumRenders++;
+}
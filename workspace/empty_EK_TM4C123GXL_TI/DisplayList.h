@@ -0,0 +1,93 @@
+/*
+ * DisplayList.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Retained display list on top of a GRLIB tDisplay. Instead of drawing, the
+ *  application sets nodes (rectangles, lines, text and images), each with a
+ *  fixed ID. When a node changes, the parts of the screen it covered before and
+ *  covers now are marked as damaged, and DisplayList_render repaints only those:
+ *  the background and every node that overlaps, clipped to the damage. Nodes
+ *  with a higher ID are drawn on top.
+ *
+ */
+
+#ifndef DISPLAYLIST_H_
+#define DISPLAYLIST_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <grlib/grlib.h>
+
+// Number of nodes, i.e. the highest ID + 1
+#ifndef DISPLAYLIST_NODES
+#define DISPLAYLIST_NODES 16
+#endif
+
+// Number of damaged rectangles that are kept apart. When more are needed, they are
+// all merged into the rectangle around them.
+#ifndef DISPLAYLIST_DAMAGE
+#define DISPLAYLIST_DAMAGE 16
+#endif
+
+// Longest text in a text node. The text is copied, so that the caller's buffer can
+// be reused.
+#ifndef DISPLAYLIST_TEXT_CHARS
+#define DISPLAYLIST_TEXT_CHARS 24
+#endif
+
+// Node types
+#define DISPLAYLIST_NONE  0 // Not in use
+#define DISPLAYLIST_RECT  1 // Filled rectangle
+#define DISPLAYLIST_LINE  2 // Line, one pixel wide
+#define DISPLAYLIST_TEXT  3 // Text, drawn without background
+#define DISPLAYLIST_IMAGE 4 // GRLIB image
+
+typedef struct
+{
+    uint8_t ui8Type;
+    tRectangle sBounds;         // Everything the node covers on the screen
+    uint32_t ui32Color;         // Translated color, the foreground for text and 1 bpp images
+    // LINE: the end points. TEXT and IMAGE: i16X1, i16Y1 is the top left corner.
+    int16_t i16X1, i16Y1, i16X2, i16Y2;
+    const tFont *psFont;        // TEXT
+    char pcText[DISPLAYLIST_TEXT_CHARS]; // TEXT
+    uint8_t ui8TextLength;      // TEXT
+    const uint8_t *pui8Image;   // IMAGE
+}
+tDisplayListNode;
+
+typedef struct
+{
+    tContext sContext;          // Used for drawing, clipped to the damage being repainted
+    uint32_t ui32Background;    // Translated color behind all nodes
+    tDisplayListNode psNodes[DISPLAYLIST_NODES];
+    tRectangle psDamage[DISPLAYLIST_DAMAGE]; // Parts of the screen to repaint, not overlapping
+    uint32_t ui32NumDamage;
+    bool bMerged;               // The damage was merged while a rectangle was being added
+    // Statistics, can be read from the debugger.
+    uint32_t ui32NumUpdates;    // Node changes that damaged the screen
+    uint32_t ui32NumRenders;    // Renders that repainted something
+    uint32_t ui32NumRects;      // Damaged rectangles repainted
+    uint32_t ui32NumPixels;     // Pixels repainted
+    uint32_t ui32NumMerges;     // Times the damage was merged, see DISPLAYLIST_DAMAGE
+}
+tDisplayList;
+
+/*!
+  @brief  Function declarations
+*/
+void DisplayList_init(tDisplayList *pList, const tDisplay *psDisplay, uint32_t ui32Background);
+void DisplayList_rectSet(tDisplayList *pList, uint16_t ui16Id, const tRectangle *psRect,
+                         uint32_t ui32Color);
+void DisplayList_lineSet(tDisplayList *pList, uint16_t ui16Id, int16_t i16X1, int16_t i16Y1,
+                         int16_t i16X2, int16_t i16Y2, uint32_t ui32Color);
+void DisplayList_textSet(tDisplayList *pList, uint16_t ui16Id, const tFont *psFont,
+                         const char *pcText, int32_t i32Length, int16_t i16X, int16_t i16Y,
+                         uint32_t ui32Color);
+void DisplayList_imageSet(tDisplayList *pList, uint16_t ui16Id, const uint8_t *pui8Image,
+                          int16_t i16X, int16_t i16Y, uint32_t ui32Color);
+void DisplayList_remove(tDisplayList *pList, uint16_t ui16Id);
+void DisplayList_damage(tDisplayList *pList, const tRectangle *psRect);
+void DisplayList_render(tDisplayList *pList);
+
+#endif /* DISPLAYLIST_H_ */
@@ -0,0 +1,291 @@
+/*
+ * DisplayQueue.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include <xdc/std.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include "DisplayQueue.h"
+
+#define CMD_INDEX_MASK (DISPLAYQUEUE_ENTRIES - 1)
+
+// Initialize the queue. Must be called before the render task is started, e.g. in
+// main() before BIOS_start. pDisplayData must be initialized (HX8357_initDisplayData)
+// before the first command is put in the queue.
+void DisplayQueue_init(tDisplayQueue *pQueue, tDisplayData *pDisplayData){
+    Semaphore_Params semParams;
+
+    pQueue->pDisplayData = pDisplayData;
+    pQueue->ui32CmdHead = 0;
+    pQueue->ui32CmdTail = 0;
+    pQueue->ui32PayloadHead = 0;
+    pQueue->ui32PayloadReleased = 0;
+    pQueue->ui32FenceNext = 1;
+    pQueue->ui32FenceDone = 0;
+    pQueue->ui32NumQueued = 0;
+    pQueue->ui32NumCoalesced = 0;
+    pQueue->ui32MaxDepth = 0;
+
+    // Counting semaphores for the commands in the queue and the free entries
+    Semaphore_Params_init(&semParams);
+    Semaphore_construct(&pQueue->cmdSemStruct, 0, &semParams);
+    pQueue->cmdSemHandle = Semaphore_handle(&pQueue->cmdSemStruct);
+    Semaphore_construct(&pQueue->freeSemStruct, DISPLAYQUEUE_ENTRIES, &semParams);
+    pQueue->freeSemHandle = Semaphore_handle(&pQueue->freeSemStruct);
+
+    // Binary semaphores to wake up the producer. The producer always checks
+    // the state again after waking up, so a post too many doesn't matter.
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&pQueue->payloadSemStruct, 0, &semParams);
+    pQueue->payloadSemHandle = Semaphore_handle(&pQueue->payloadSemStruct);
+    Semaphore_construct(&pQueue->fenceSemStruct, 0, &semParams);
+    pQueue->fenceSemHandle = Semaphore_handle(&pQueue->fenceSemStruct);
+}
+
+// Try to merge a fill into the last command in the queue, which works if the last
+// command is a fill of the same color, and the two rectangles together make up a
+// rectangle. This only works as long as the render task hasn't taken the last command
+// yet. Returns true if the fill was merged.
+static bool rectCoalesce(tDisplayQueue *pQueue, const tRectangle *psRect, uint32_t ui32Color){
+    tRectangle *psLast;
+    bool bMerged = false;
+    UInt key;
+
+    // The render task must not take the command while it is changed.
+    key = Task_disable();
+    if(pQueue->ui32CmdHead != pQueue->ui32CmdTail){
+        tDisplayCmd *pLast = &pQueue->pCmds[(pQueue->ui32CmdHead - 1) & CMD_INDEX_MASK];
+        psLast = &pLast->sRect;
+        if((pLast->ui8Type == DISPLAYQUEUE_CMD_RECT) && (pLast->ui32Value == ui32Color)){
+            if((psRect->i16XMin == psLast->i16XMin) && (psRect->i16XMax == psLast->i16XMax)){
+                // Same columns, merge if the rows are next to each other.
+                if(psRect->i16YMin == psLast->i16YMax + 1){
+                    psLast->i16YMax = psRect->i16YMax;
+                    bMerged = true;
+                }
+                else if(psRect->i16YMax + 1 == psLast->i16YMin){
+                    psLast->i16YMin = psRect->i16YMin;
+                    bMerged = true;
+                }
+            }
+            else if((psRect->i16YMin == psLast->i16YMin) && (psRect->i16YMax == psLast->i16YMax)){
+                // Same rows, merge if the columns are next to each other.
+                if(psRect->i16XMin == psLast->i16XMax + 1){
+                    psLast->i16XMax = psRect->i16XMax;
+                    bMerged = true;
+                }
+                else if(psRect->i16XMax + 1 == psLast->i16XMin){
+                    psLast->i16XMin = psRect->i16XMin;
+                    bMerged = true;
+                }
+            }
+        }
+    }
+    Task_restore(key);
+    if(bMerged){
+        pQueue->ui32NumCoalesced++;
+    }
+    return bMerged;
+}
+
+// Put a command in the queue, waiting for a free entry if the queue is full.
+static void cmdPut(tDisplayQueue *pQueue, const tDisplayCmd *pCmd){
+    uint32_t ui32Depth;
+
+    Semaphore_pend(pQueue->freeSemHandle, BIOS_WAIT_FOREVER);
+    pQueue->pCmds[pQueue->ui32CmdHead & CMD_INDEX_MASK] = *pCmd;
+    // The render task only looks at the entry once the head has moved past it.
+    pQueue->ui32CmdHead++;
+    Semaphore_post(pQueue->cmdSemHandle);
+
+    pQueue->ui32NumQueued++;
+    ui32Depth = pQueue->ui32CmdHead - pQueue->ui32CmdTail;
+    if(ui32Depth > pQueue->ui32MaxDepth){
+        pQueue->ui32MaxDepth = ui32Depth;
+    }
+}
+
+// Put a fill in the queue, or merge it into the last command.
+static void rectPut(tDisplayQueue *pQueue, int16_t i16XMin, int16_t i16YMin,
+                    int16_t i16XMax, int16_t i16YMax, uint32_t ui32Color){
+    tDisplayCmd sCmd;
+
+    if((i16XMax < i16XMin) || (i16YMax < i16YMin)){
+        return;
+    }
+    sCmd.ui8Type = DISPLAYQUEUE_CMD_RECT;
+    sCmd.sRect.i16XMin = i16XMin;
+    sCmd.sRect.i16YMin = i16YMin;
+    sCmd.sRect.i16XMax = i16XMax;
+    sCmd.sRect.i16YMax = i16YMax;
+    sCmd.ui32Value = ui32Color;
+    sCmd.ui16PayloadUsed = 0;
+    if(!rectCoalesce(pQueue, &sCmd.sRect, ui32Color)){
+        cmdPut(pQueue, &sCmd);
+    }
+}
+
+// Allocate ui32Pixels contiguous pixels in the payload buffer, waiting until the
+// render task has given back enough. ui32Pixels must be at most half the buffer.
+// Returns the index of the first pixel, and the number of pixels that must be given
+// back when drawn (including any pixels skipped at the end of the buffer) in
+// pui32Used.
+static uint32_t payloadAlloc(tDisplayQueue *pQueue, uint32_t ui32Pixels, uint32_t *pui32Used){
+    uint32_t ui32Index = pQueue->ui32PayloadHead % DISPLAYQUEUE_PAYLOAD_PIXELS;
+    uint32_t ui32Used = ui32Pixels;
+
+    // The pixels must be contiguous, so skip the end of the buffer if they don't fit.
+    if(ui32Index + ui32Pixels > DISPLAYQUEUE_PAYLOAD_PIXELS){
+        ui32Used += DISPLAYQUEUE_PAYLOAD_PIXELS - ui32Index;
+        ui32Index = 0;
+    }
+    while(DISPLAYQUEUE_PAYLOAD_PIXELS - (pQueue->ui32PayloadHead - pQueue->ui32PayloadReleased) < ui32Used){
+        Semaphore_pend(pQueue->payloadSemHandle, BIOS_WAIT_FOREVER);
+    }
+    pQueue->ui32PayloadHead += ui32Used;
+    *pui32Used = ui32Used;
+    return ui32Index;
+}
+
+// The render task. Takes commands from the queue given in arg0, and draws them on
+// the screen. Should run at a higher priority than the producer, so that the screen
+// is kept busy whenever there is something in the queue.
+void DisplayQueue_renderTask(UArg arg0, UArg arg1){
+    tDisplayQueue *pQueue = (tDisplayQueue *)arg0;
+    tDisplayCmd sCmd;
+    UInt key;
+
+    while(1){
+        Semaphore_pend(pQueue->cmdSemHandle, BIOS_WAIT_FOREVER);
+        // Take a copy of the command, so that the entry can be reused right away.
+        key = Task_disable();
+        sCmd = pQueue->pCmds[pQueue->ui32CmdTail & CMD_INDEX_MASK];
+        pQueue->ui32CmdTail++;
+        Task_restore(key);
+        Semaphore_post(pQueue->freeSemHandle);
+
+        switch(sCmd.ui8Type){
+        case DISPLAYQUEUE_CMD_RECT:
+            RectFill(pQueue->pDisplayData, &sCmd.sRect, sCmd.ui32Value);
+            break;
+        case DISPLAYQUEUE_CMD_PIXELS:
+            HX8357_pixelsWrite(pQueue->pDisplayData, sCmd.sRect.i16XMin, sCmd.sRect.i16YMin,
+                               &pQueue->pui16Payload[sCmd.ui32Value],
+                               sCmd.sRect.i16XMax - sCmd.sRect.i16XMin + 1);
+            pQueue->ui32PayloadReleased += sCmd.ui16PayloadUsed;
+            Semaphore_post(pQueue->payloadSemHandle);
+            break;
+        case DISPLAYQUEUE_CMD_FENCE:
+            pQueue->ui32FenceDone = sCmd.ui32Value;
+            Semaphore_post(pQueue->fenceSemHandle);
+            break;
+        }
+    }
+}
+
+// Put a fence in the queue and return its number. The fence is passed when everything
+// queued before it has been drawn, see DisplayQueue_fencePassed/DisplayQueue_fenceWait.
+uint32_t DisplayQueue_fenceInsert(tDisplayQueue *pQueue){
+    tDisplayCmd sCmd;
+    sCmd.ui8Type = DISPLAYQUEUE_CMD_FENCE;
+    sCmd.ui32Value = pQueue->ui32FenceNext++;
+    sCmd.ui16PayloadUsed = 0;
+    cmdPut(pQueue, &sCmd);
+    return sCmd.ui32Value;
+}
+
+// Returns true if the render task has passed fence ui32Fence. Doesn't block.
+bool DisplayQueue_fencePassed(tDisplayQueue *pQueue, uint32_t ui32Fence){
+    // Fence numbers wrap around, so compare the difference.
+    return (int32_t)(pQueue->ui32FenceDone - ui32Fence) >= 0;
+}
+
+// Block until the render task has passed fence ui32Fence.
+void DisplayQueue_fenceWait(tDisplayQueue *pQueue, uint32_t ui32Fence){
+    while(!DisplayQueue_fencePassed(pQueue, ui32Fence)){
+        Semaphore_pend(pQueue->fenceSemHandle, BIOS_WAIT_FOREVER);
+    }
+}
+
+// Block until everything in the queue has been drawn.
+void DisplayQueue_sync(tDisplayQueue *pQueue){
+    DisplayQueue_fenceWait(pQueue, DisplayQueue_fenceInsert(pQueue));
+}
+
+// GRLIB functions
+// These have the same parameters as the ones in ADAFRUIT_2050.c, but pvDisplayData is
+// the tDisplayQueue. All of them return as soon as the command is in the queue.
+// Pixels and lines are queued as fills, so that they can be merged with each other.
+
+void QueuedPixelDraw(void *pvDisplayData, int32_t i32X, int32_t i32Y,
+uint32_t ui32ulValue){
+    rectPut((tDisplayQueue *)pvDisplayData, i32X, i32Y, i32X, i32Y, ui32ulValue);
+}
+
+// The pixels are translated right away, as GRLIB may reuse pui8Data as soon as this
+// returns.
+void QueuedPixelDrawMultiple(void *pvDisplayData, int32_t i32X, int32_t i32Y,
+int32_t i32X0, int32_t i32Count, int32_t i32BPP,
+const uint8_t *pui8Data,
+const uint8_t *pui8Palette){
+    tDisplayQueue *pQueue = (tDisplayQueue *)pvDisplayData;
+    tDisplayCmd sCmd;
+    int32_t i32Run;
+    uint32_t ui32Used;
+
+    if((i32BPP != 1) && (i32BPP != 4) && (i32BPP != 8)){
+        // Unsupported format, nothing sensible can be drawn.
+        return;
+    }
+    sCmd.ui8Type = DISPLAYQUEUE_CMD_PIXELS;
+    while(i32Count > 0){
+        i32Run = i32Count;
+        if(i32Run > DISPLAYQUEUE_PAYLOAD_PIXELS/2){
+            i32Run = DISPLAYQUEUE_PAYLOAD_PIXELS/2;
+        }
+        sCmd.ui32Value = payloadAlloc(pQueue, i32Run, &ui32Used);
+        sCmd.ui16PayloadUsed = ui32Used;
+        HX8357_pixelsTranslate(pQueue->pDisplayData, &pQueue->pui16Payload[sCmd.ui32Value],
+                               i32X, i32Y, i32X0, i32Run, i32BPP, pui8Data, pui8Palette);
+        sCmd.sRect.i16XMin = i32X;
+        sCmd.sRect.i16YMin = i32Y;
+        sCmd.sRect.i16XMax = i32X + i32Run - 1;
+        sCmd.sRect.i16YMax = i32Y;
+        cmdPut(pQueue, &sCmd);
+        // Move on to the first pixel after the run.
+        i32X += i32Run;
+        i32X0 += i32Run;
+        pui8Data += (i32X0*i32BPP)/8;
+        i32X0 %= 8/i32BPP;
+        i32Count -= i32Run;
+    }
+}
+
+void QueuedLineDrawH(void *pvDisplayData, int32_t i32X1, int32_t i32X2,
+int32_t i32Y, uint32_t ui32ulValue){
+    rectPut((tDisplayQueue *)pvDisplayData, i32X1, i32Y, i32X2, i32Y, ui32ulValue);
+}
+
+void QueuedLineDrawV(void *pvDisplayData, int32_t i32X, int32_t i32Y1,
+int32_t i32Y2, uint32_t ui32ulValue){
+    rectPut((tDisplayQueue *)pvDisplayData, i32X, i32Y1, i32X, i32Y2, ui32ulValue);
+}
+
+void QueuedRectFill(void *pvDisplayData, const tRectangle *psRect,
+uint32_t ui32ulValue){
+    rectPut((tDisplayQueue *)pvDisplayData, psRect->i16XMin, psRect->i16YMin,
+            psRect->i16XMax, psRect->i16YMax, ui32ulValue);
+}
+
+uint32_t QueuedColorTranslate(void *pvDisplayData,
+uint32_t ui32ulValue){
+    return ColorTranslate(((tDisplayQueue *)pvDisplayData)->pDisplayData, ui32ulValue);
+}
+
+// Flush blocks until everything queued so far is on the screen.
+void QueuedFlush(void *pvDisplayData){
+    DisplayQueue_sync((tDisplayQueue *)pvDisplayData);
+}
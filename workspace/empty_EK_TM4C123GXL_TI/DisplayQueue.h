@@ -0,0 +1,105 @@
+/*
+ * DisplayQueue.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Draw command queue in front of the HX8357 GRLIB functions. The GRLIB
+ *  functions in here only put a command in the queue and return, and a
+ *  render task takes the commands from the queue and draws them on the screen.
+ *
+ */
+
+#ifndef DISPLAYQUEUE_H_
+#define DISPLAYQUEUE_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <xdc/std.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+
+// Number of commands that fit in the queue. Must be a power of 2.
+#ifndef DISPLAYQUEUE_ENTRIES
+#define DISPLAYQUEUE_ENTRIES 32
+#endif
+
+// Number of translated pixels that can be waiting in the queue, for PixelDrawMultiple.
+// Longer runs are split up into several commands. Must be a power of 2.
+#ifndef DISPLAYQUEUE_PAYLOAD_PIXELS
+#define DISPLAYQUEUE_PAYLOAD_PIXELS 512
+#endif
+
+// Command types
+#define DISPLAYQUEUE_CMD_RECT   0 // Fill a rectangle, also used for pixels and lines
+#define DISPLAYQUEUE_CMD_PIXELS 1 // Draw translated pixels from the payload buffer
+#define DISPLAYQUEUE_CMD_FENCE  2 // Mark a fence as passed
+
+typedef struct
+{
+    uint8_t ui8Type;
+    // RECT: the (inclusive) rectangle.
+    // PIXELS: i16XMin, i16YMin is the first pixel, i16XMax the last.
+    tRectangle sRect;
+    // RECT: the translated color. PIXELS: index of the first pixel in the payload
+    // buffer. FENCE: the fence number.
+    uint32_t ui32Value;
+    // PIXELS: number of payload pixels to give back when drawn.
+    uint16_t ui16PayloadUsed;
+}
+tDisplayCmd;
+
+// The queue is meant for one producer (the task using GRLIB) and the render task.
+typedef struct
+{
+    tDisplayData *pDisplayData;     // The screen the commands are drawn on
+    tDisplayCmd pCmds[DISPLAYQUEUE_ENTRIES];
+    uint32_t ui32CmdHead;           // Commands put in the queue, only changed by the producer
+    volatile uint32_t ui32CmdTail;  // Commands taken from the queue, only changed by the render task
+    uint16_t pui16Payload[DISPLAYQUEUE_PAYLOAD_PIXELS];
+    uint32_t ui32PayloadHead;               // Pixels allocated, only changed by the producer
+    volatile uint32_t ui32PayloadReleased;  // Pixels drawn, only changed by the render task
+    uint32_t ui32FenceNext;         // Number of the next fence
+    volatile uint32_t ui32FenceDone;// Number of the last fence passed by the render task
+    Semaphore_Struct cmdSemStruct;  // Counts commands in the queue
+    Semaphore_Handle cmdSemHandle;
+    Semaphore_Struct freeSemStruct; // Counts free entries in the queue
+    Semaphore_Handle freeSemHandle;
+    Semaphore_Struct payloadSemStruct; // Posted when payload pixels are given back
+    Semaphore_Handle payloadSemHandle;
+    Semaphore_Struct fenceSemStruct;   // Posted when a fence is passed
+    Semaphore_Handle fenceSemHandle;
+    // Statistics, can be read from the debugger.
+    uint32_t ui32NumQueued;         // Commands put in the queue
+    uint32_t ui32NumCoalesced;      // Fills merged into the previous command instead
+    uint32_t ui32MaxDepth;          // Most commands waiting at the same time
+}
+tDisplayQueue;
+
+/*!
+  @brief  Function declarations
+*/
+void DisplayQueue_init(tDisplayQueue *pQueue, tDisplayData *pDisplayData);
+void DisplayQueue_renderTask(UArg arg0, UArg arg1);
+uint32_t DisplayQueue_fenceInsert(tDisplayQueue *pQueue);
+bool DisplayQueue_fencePassed(tDisplayQueue *pQueue, uint32_t ui32Fence);
+void DisplayQueue_fenceWait(tDisplayQueue *pQueue, uint32_t ui32Fence);
+void DisplayQueue_sync(tDisplayQueue *pQueue);
+
+// GRLIB specific functions, pvDisplayData is the tDisplayQueue:
+void QueuedPixelDraw(void *pvDisplayData, int32_t i32X, int32_t i32Y,
+uint32_t ui32ulValue);
+void QueuedPixelDrawMultiple(void *pvDisplayData, int32_t i32X, int32_t i32Y,
+int32_t i32X0, int32_t i32Count, int32_t i32BPP,
+const uint8_t *pui8Data,
+const uint8_t *pui8Palette);
+void QueuedLineDrawH(void *pvDisplayData, int32_t i32X1, int32_t i32X2,
+int32_t i32Y, uint32_t ui32ulValue);
+void QueuedLineDrawV(void *pvDisplayData, int32_t i32X, int32_t i32Y1,
+int32_t i32Y2, uint32_t ui32ulValue);
+void QueuedRectFill(void *pvDisplayData, const tRectangle *psRect,
+uint32_t ui32ulValue);
+uint32_t QueuedColorTranslate(void *pvDisplayData,
+uint32_t ui32ulValue);
+void QueuedFlush(void *pvDisplayData);
+
+#endif /* DISPLAYQUEUE_H_ */
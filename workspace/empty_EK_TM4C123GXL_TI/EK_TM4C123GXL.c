@@ -159,6 +159,9 @@ GPIO_PinConfig gpioPinConfigs[] = {
     GPIOTiva_PF_4 | GPIO_CFG_IN_PU | GPIO_CFG_IN_INT_RISING,
     /* EK_TM4C123GXL_GPIO_SW2 */
     GPIOTiva_PF_0 | GPIO_CFG_IN_PU | GPIO_CFG_IN_INT_RISING,
+    // Added by Oskar: TE from the screen. Pulled down, so that it stays quiet if
+    // it isn't connected.
+    GPIOTiva_PE_2 | GPIO_CFG_IN_PD | GPIO_CFG_IN_INT_RISING,
 
     /* Output pins */
     /* EK_TM4C123GXL_LED_RED */
@@ -183,7 +186,8 @@ GPIO_PinConfig gpioPinConfigs[] = {
  */
 GPIO_CallbackFxn gpioCallbackFunctions[] = {
     NULL,  /* EK_TM4C123GXL_GPIO_SW1 */
-    NULL   /* EK_TM4C123GXL_GPIO_SW2 */
+    NULL,  /* EK_TM4C123GXL_GPIO_SW2 */
+    NULL   /* Screen TE, set by HX8357_vsyncInit */
 };
 
 /* The device-specific GPIO_config structure */
@@ -395,8 +399,9 @@ const SDSPITiva_HWAttrs sdspiTivaHWattrs[EK_TM4C123GXL_SDSPICOUNT] = {
         .pinMISO = GPIO_PIN_6,
         .portMOSI = GPIO_PORTB_BASE,
         .pinMOSI = GPIO_PIN_7,
-        .portCS = GPIO_PORTA_BASE,
-        .pinCS = GPIO_PIN_5,
+        /* PA5 is the MOSI of the screen SPI, so the SD card CS is on PE3 */
+        .portCS = GPIO_PORTE_BASE,
+        .pinCS = GPIO_PIN_3,
     }
 };
 
@@ -426,8 +431,8 @@ void EK_TM4C123GXL_initSDSPI(void)
             GPIO_PIN_6,
             GPIO_STRENGTH_4MA, GPIO_PIN_TYPE_STD_WPU);
 
-    GPIOPadConfigSet(GPIO_PORTA_BASE,
-            GPIO_PIN_5,
+    GPIOPadConfigSet(GPIO_PORTE_BASE,
+            GPIO_PIN_3,
             GPIO_STRENGTH_4MA, GPIO_PIN_TYPE_STD);
 
     GPIOPinConfigure(GPIO_PB4_SSI2CLK);
@@ -60,6 +60,7 @@ extern "C" {
 typedef enum EK_TM4C123GXL_GPIOName {
     EK_TM4C123GXL_SW1 = 0,
     EK_TM4C123GXL_SW2,
+    EK_TM4C123GXL_PORT_E_PIN_2, // Added by Oskar, screen TE
     EK_TM4C123GXL_LED_RED,
     EK_TM4C123GXL_LED_BLUE,
     EK_TM4C123GXL_LED_GREEN,
@@ -0,0 +1,243 @@
+/*
+ * Fills.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include <string.h>
+#include "Fills.h"
+
+// Size of the stack buffer used if the scratch pool is exhausted.
+#define FILLS_FALLBACK_BYTES 64
+
+// Makes ui32Count pixels from (i32X, i32Y) to the right, in the byte order used by
+// the screen.
+typedef void (*tFillsRowFxn)(const void *pvArg, int32_t i32X, int32_t i32Y, uint32_t ui32Count,
+                             uint16_t *pui16Pixels);
+
+// A gradient over ui32Length pixels. At position i, a channel going from c0 to c1 is
+// (c0*(n - 1) + (n - 1)/2 + (c1 - c0)*i)/(n - 1) rounded down, with n the length,
+// i.e. the exact blend rounded to the nearest. Each channel is stepped without
+// dividing, by keeping the remainder.
+typedef struct
+{
+    int32_t pi32Value[3];       // Red, green and blue
+    int32_t pi32Rem[3];
+    int32_t pi32Step[3];
+    int32_t pi32RemStep[3];
+    int32_t i32Den;             // n - 1, at least 1
+}
+tFillsRamp;
+
+typedef struct
+{
+    uint32_t ui32Color0;        // 24-bit colors
+    uint32_t ui32Color1;
+    int32_t i32Start;           // Coordinate where the gradient starts
+    int32_t i32Length;
+    bool bDither;
+}
+tFillsGradient;
+
+typedef struct
+{
+    const uint8_t *pui8Pattern;
+    uint16_t pui16Colors[2];    // Clear and set bits, in the byte order used by the screen
+}
+tFillsPattern;
+
+// Set up the ramp at position i32Pos of the gradient.
+static void rampInit(tFillsRamp *psRamp, const tFillsGradient *psGradient, int32_t i32Pos){
+    int32_t i32Den = (psGradient->i32Length > 1) ? psGradient->i32Length - 1 : 1;
+    int32_t i32Channel, i32Shift, i32Color0, i32Delta, i32Num;
+
+    psRamp->i32Den = i32Den;
+    for(i32Channel = 0 ; i32Channel < 3 ; i32Channel++){
+        i32Shift = 16 - 8*i32Channel;
+        i32Color0 = (psGradient->ui32Color0 >> i32Shift) & 0xFF;
+        i32Delta = (int32_t)((psGradient->ui32Color1 >> i32Shift) & 0xFF) - i32Color0;
+        // Never negative, since i32Pos is inside the gradient.
+        i32Num = i32Color0*i32Den + i32Den/2 + i32Delta*i32Pos;
+        psRamp->pi32Value[i32Channel] = i32Num/i32Den;
+        psRamp->pi32Rem[i32Channel] = i32Num % i32Den;
+        // Rounded down, for a negative delta as well, so that the remainder step isn't negative.
+        psRamp->pi32Step[i32Channel] = (i32Delta >= 0) ? i32Delta/i32Den : -((i32Den - 1 - i32Delta)/i32Den);
+        psRamp->pi32RemStep[i32Channel] = i32Delta - psRamp->pi32Step[i32Channel]*i32Den;
+    }
+}
+
+// The 24-bit color at the current position of the ramp, moving it on by one.
+static inline uint32_t rampNext(tFillsRamp *psRamp){
+    uint32_t ui32Color = (psRamp->pi32Value[0] << 16) | (psRamp->pi32Value[1] << 8) | psRamp->pi32Value[2];
+    uint32_t ui32Channel;
+
+    for(ui32Channel = 0 ; ui32Channel < 3 ; ui32Channel++){
+        psRamp->pi32Value[ui32Channel] += psRamp->pi32Step[ui32Channel];
+        psRamp->pi32Rem[ui32Channel] += psRamp->pi32RemStep[ui32Channel];
+        if(psRamp->pi32Rem[ui32Channel] >= psRamp->i32Den){
+            psRamp->pi32Rem[ui32Channel] -= psRamp->i32Den;
+            psRamp->pi32Value[ui32Channel]++;
+        }
+    }
+    return ui32Color;
+}
+
+// Repeat the first ui32Period pixels of pui16Pixels up to ui32Count pixels, copying
+// twice as much each time.
+static void pixelsRepeat(uint16_t *pui16Pixels, uint32_t ui32Period, uint32_t ui32Count){
+    uint32_t ui32Done = ui32Period;
+    uint32_t ui32Copy;
+
+    while(ui32Done < ui32Count){
+        ui32Copy = (ui32Count - ui32Done < ui32Done) ? ui32Count - ui32Done : ui32Done;
+        memcpy(&pui16Pixels[ui32Done], pui16Pixels, 2*ui32Copy);
+        ui32Done += ui32Copy;
+    }
+}
+
+// Rows of a gradient from left to right. The colors are made 16 at a time and
+// converted together.
+static void gradientRowH(const void *pvArg, int32_t i32X, int32_t i32Y, uint32_t ui32Count,
+                         uint16_t *pui16Pixels){
+    const tFillsGradient *psGradient = (const tFillsGradient *)pvArg;
+    uint32_t pui32Colors[16];
+    uint32_t ui32Run, ui32Index;
+    tFillsRamp sRamp;
+
+    rampInit(&sRamp, psGradient, i32X - psGradient->i32Start);
+    while(ui32Count > 0){
+        ui32Run = ui32Count < 16 ? ui32Count : 16;
+        for(ui32Index = 0 ; ui32Index < ui32Run ; ui32Index++){
+            pui32Colors[ui32Index] = rampNext(&sRamp);
+        }
+        HX8357_rgbConvert(pui16Pixels, pui32Colors, HX8357_RGB_XRGB32, ui32Run, i32X, i32Y,
+                          psGradient->bDither);
+        pui16Pixels += ui32Run;
+        i32X += ui32Run;
+        ui32Count -= ui32Run;
+    }
+}
+
+// Rows of a gradient from top to bottom. A row is one color, which the dither
+// turns into a pattern that repeats every 4 pixels.
+static void gradientRowV(const void *pvArg, int32_t i32X, int32_t i32Y, uint32_t ui32Count,
+                         uint16_t *pui16Pixels){
+    const tFillsGradient *psGradient = (const tFillsGradient *)pvArg;
+    uint32_t pui32Colors[4];
+    uint32_t ui32Period = ui32Count < 4 ? ui32Count : 4;
+    tFillsRamp sRamp;
+
+    rampInit(&sRamp, psGradient, i32Y - psGradient->i32Start);
+    pui32Colors[0] = rampNext(&sRamp);
+    pui32Colors[1] = pui32Colors[0];
+    pui32Colors[2] = pui32Colors[0];
+    pui32Colors[3] = pui32Colors[0];
+    HX8357_rgbConvert(pui16Pixels, pui32Colors, HX8357_RGB_XRGB32, ui32Period, i32X, i32Y,
+                      psGradient->bDither);
+    pixelsRepeat(pui16Pixels, ui32Period, ui32Count);
+}
+
+// Rows of a pattern, which repeat every 8 pixels.
+static void patternRow(const void *pvArg, int32_t i32X, int32_t i32Y, uint32_t ui32Count,
+                       uint16_t *pui16Pixels){
+    const tFillsPattern *psPattern = (const tFillsPattern *)pvArg;
+    uint32_t ui32Bits = psPattern->pui8Pattern[i32Y & 7];
+    uint32_t ui32Period = ui32Count < 8 ? ui32Count : 8;
+    uint32_t ui32Index;
+
+    for(ui32Index = 0 ; ui32Index < ui32Period ; ui32Index++){
+        pui16Pixels[ui32Index] = psPattern->pui16Colors[(ui32Bits >> (7 - ((i32X + ui32Index) & 7))) & 1];
+    }
+    pixelsRepeat(pui16Pixels, ui32Period, ui32Count);
+}
+
+// Fill the part of psRect inside the clip region of pContext with the pixels made
+// by pfnRow. Rows that are wider than half of the buffer are made in pieces.
+static void rectStream(tDisplayData *pDisplayData, const tContext *pContext, const tRectangle *psRect,
+                       tFillsRowFxn pfnRow, const void *pvArg){
+    const tRectangle *psClip = &pContext->sClipRegion;
+    uint32_t pui32LocalBuf[FILLS_FALLBACK_BYTES/4];
+    uint32_t pui32After[2] = {0, 0}; // Chunks queued after each half
+    uint32_t ui32BufBytes, ui32HalfPixels, ui32Count;
+    uint32_t ui32Half = 0;
+    uint16_t *pui16Half[2];
+    tRectangle sRect;
+    int32_t i32X, i32Y;
+    char *pBuf;
+
+    sRect.i16XMin = psRect->i16XMin > psClip->i16XMin ? psRect->i16XMin : psClip->i16XMin;
+    sRect.i16XMax = psRect->i16XMax < psClip->i16XMax ? psRect->i16XMax : psClip->i16XMax;
+    sRect.i16YMin = psRect->i16YMin > psClip->i16YMin ? psRect->i16YMin : psClip->i16YMin;
+    sRect.i16YMax = psRect->i16YMax < psClip->i16YMax ? psRect->i16YMax : psClip->i16YMax;
+    if((sRect.i16XMin > sRect.i16XMax) || (sRect.i16YMin > sRect.i16YMax)){
+        return;
+    }
+
+    // Two rows, if the pool has room. Each half is an even number of pixels, so that
+    // both are word aligned, and at least two, so a fill one pixel wide (which gets
+    // 4 bytes) uses the stack buffer.
+    pBuf = HX8357_scratchBorrow(pDisplayData, 4*(sRect.i16XMax - sRect.i16XMin + 1), &ui32BufBytes);
+    if((pBuf != NULL) && (ui32BufBytes < 8)){
+        HX8357_scratchReturn(pDisplayData, pBuf);
+        pBuf = NULL;
+    }
+    if(pBuf == NULL){
+        pBuf = (char *)pui32LocalBuf;
+        ui32BufBytes = sizeof(pui32LocalBuf);
+    }
+    ui32HalfPixels = (ui32BufBytes/4) & ~1;
+    pui16Half[0] = (uint16_t *)pBuf;
+    pui16Half[1] = (uint16_t *)pBuf + ui32HalfPixels;
+
+    HX8357_streamBegin(pDisplayData, &sRect);
+    for(i32Y = sRect.i16YMin ; i32Y <= sRect.i16YMax ; i32Y++){
+        for(i32X = sRect.i16XMin ; i32X <= sRect.i16XMax ; i32X += ui32Count){
+            ui32Count = sRect.i16XMax - i32X + 1;
+            if(ui32Count > ui32HalfPixels){
+                ui32Count = ui32HalfPixels;
+            }
+            // Everything queued before the half was last queued must be sent.
+            HX8357_streamWait(pDisplayData, pui32After[ui32Half]);
+            pfnRow(pvArg, i32X, i32Y, ui32Count, pui16Half[ui32Half]);
+            pui32After[ui32Half] = 0;
+            pui32After[ui32Half ^ 1] += HX8357_streamWrite(pDisplayData, pui16Half[ui32Half], 2*ui32Count);
+            ui32Half ^= 1;
+        }
+    }
+    HX8357_streamEnd(pDisplayData);
+    HX8357_scratchReturn(pDisplayData, pBuf);
+}
+
+// Fill psRect with a gradient from the 24-bit color ui32Color0 to ui32Color1, from
+// left to right or top to bottom (FILLS_LEFT_TO_RIGHT or FILLS_TOP_TO_BOTTOM). The
+// first and last column or row are the two colors.
+void Fills_gradientFill(tDisplayData *pDisplayData, const tContext *pContext, const tRectangle *psRect,
+                        uint32_t ui32Color0, uint32_t ui32Color1, uint32_t ui32Direction){
+    tFillsGradient sGradient;
+
+    sGradient.ui32Color0 = ui32Color0;
+    sGradient.ui32Color1 = ui32Color1;
+    sGradient.bDither = pDisplayData->bDither;
+    if(ui32Direction == FILLS_TOP_TO_BOTTOM){
+        sGradient.i32Start = psRect->i16YMin;
+        sGradient.i32Length = psRect->i16YMax - psRect->i16YMin + 1;
+        rectStream(pDisplayData, pContext, psRect, gradientRowV, &sGradient);
+    }
+    else {
+        sGradient.i32Start = psRect->i16XMin;
+        sGradient.i32Length = psRect->i16XMax - psRect->i16XMin + 1;
+        rectStream(pDisplayData, pContext, psRect, gradientRowH, &sGradient);
+    }
+}
+
+// Fill psRect with the 8x8 pattern pui8Pattern, in the foreground and background
+// of the context.
+void Fills_patternFill(tDisplayData *pDisplayData, const tContext *pContext, const tRectangle *psRect,
+                       const uint8_t *pui8Pattern){
+    tFillsPattern sPattern;
+
+    sPattern.pui8Pattern = pui8Pattern;
+    sPattern.pui16Colors[0] = HX8357_SWAP16(pContext->ui32Background);
+    sPattern.pui16Colors[1] = HX8357_SWAP16(pContext->ui32Foreground);
+    rectStream(pDisplayData, pContext, psRect, patternRow, &sPattern);
+}
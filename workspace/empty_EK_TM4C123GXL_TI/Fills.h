@@ -0,0 +1,44 @@
+/*
+ * Fills.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Rectangles filled with a linear gradient or a repeating 8x8 pattern, e.g. the
+ *  backgrounds of dashboards. With GRLIB these take a LineDrawH or LineDrawV for
+ *  every row or column of a gradient, and one for every run of a pattern, each
+ *  with its own address window. Here the pixels are made a row at a time in one
+ *  half of a buffer from the scratch pool while the other half is sent, and the
+ *  whole rectangle is one RAMWR.
+ *
+ *  Gradients go between two 24-bit colors, and are dithered the same way as
+ *  images if that is turned on with HX8357_ditherSet. A pattern is 8 bytes, one per
+ *  row, with the leftmost pixel in the most significant bit. Set bits are drawn in
+ *  the foreground of the context and clear bits in its background. Patterns line
+ *  up with the screen, not with the rectangle, so that fills next to each other
+ *  join up.
+ *
+ *  Everything is clipped to the clip region of the context, and drawn straight to
+ *  the screen through pDisplayData, so anything drawn through the display queue
+ *  or the frame buffer must be flushed first.
+ *
+ */
+
+#ifndef FILLS_H_
+#define FILLS_H_
+#include <stdint.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+
+// Directions of a gradient, from the first color to the second
+#define FILLS_LEFT_TO_RIGHT 0
+#define FILLS_TOP_TO_BOTTOM 1
+
+/*!
+  @brief  Function declarations
+*/
+void Fills_gradientFill(tDisplayData *pDisplayData, const tContext *pContext, const tRectangle *psRect,
+                        uint32_t ui32Color0, uint32_t ui32Color1, uint32_t ui32Direction);
+void Fills_patternFill(tDisplayData *pDisplayData, const tContext *pContext, const tRectangle *psRect,
+                       const uint8_t *pui8Pattern);
+
+#endif /* FILLS_H_ */
@@ -0,0 +1,249 @@
+/*
+ * FrameBuffer.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include <stdbool.h>
+#include "FrameBuffer.h"
+
+// Initialize the frame buffer. pDisplayData must be initialized (HX8357_initDisplayData)
+// before anything is drawn. ui16Width and ui16Height is the size of the screen.
+void FrameBuffer_init(tFrameBuffer *pFb, tDisplayData *pDisplayData,
+                      uint16_t ui16Width, uint16_t ui16Height){
+    pFb->pDisplayData = pDisplayData;
+    pFb->ui16Width = ui16Width;
+    pFb->ui16Height = ui16Height;
+    pFb->i16X = 0;
+    pFb->i16Y = 0;
+    pFb->ui32NumDirty = 0;
+    pFb->ui32NumMerged = 0;
+    pFb->ui32NumBursts = 0;
+    pFb->ui32NumDirect = 0;
+}
+
+// Returns true if the two rectangles share at least one pixel.
+static bool rectOverlap(const tRectangle *psA, const tRectangle *psB){
+    return (psA->i16XMin <= psB->i16XMax) && (psB->i16XMin <= psA->i16XMax) &&
+           (psA->i16YMin <= psB->i16YMax) && (psB->i16YMin <= psA->i16YMax);
+}
+
+// Merge psB into psA, if the two together make up exactly one rectangle. Nothing else
+// can be merged, as the pixels in between are not valid in the buffer.
+// Returns true if merged.
+static bool rectMerge(tRectangle *psA, const tRectangle *psB){
+    if((psA->i16XMin >= psB->i16XMin) && (psA->i16XMax <= psB->i16XMax) &&
+       (psA->i16YMin >= psB->i16YMin) && (psA->i16YMax <= psB->i16YMax)){
+        // A is inside B
+        *psA = *psB;
+        return true;
+    }
+    if((psB->i16XMin >= psA->i16XMin) && (psB->i16XMax <= psA->i16XMax) &&
+       (psB->i16YMin >= psA->i16YMin) && (psB->i16YMax <= psA->i16YMax)){
+        // B is inside A
+        return true;
+    }
+    if((psA->i16XMin == psB->i16XMin) && (psA->i16XMax == psB->i16XMax) &&
+       (psA->i16YMin <= psB->i16YMax + 1) && (psB->i16YMin <= psA->i16YMax + 1)){
+        // Same columns, and the rows overlap or are next to each other
+        if(psB->i16YMin < psA->i16YMin){
+            psA->i16YMin = psB->i16YMin;
+        }
+        if(psB->i16YMax > psA->i16YMax){
+            psA->i16YMax = psB->i16YMax;
+        }
+        return true;
+    }
+    if((psA->i16YMin == psB->i16YMin) && (psA->i16YMax == psB->i16YMax) &&
+       (psA->i16XMin <= psB->i16XMax + 1) && (psB->i16XMin <= psA->i16XMax + 1)){
+        // Same rows, and the columns overlap or are next to each other
+        if(psB->i16XMin < psA->i16XMin){
+            psA->i16XMin = psB->i16XMin;
+        }
+        if(psB->i16XMax > psA->i16XMax){
+            psA->i16XMax = psB->i16XMax;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Pointer to the pixel at screen coordinate (i32X, i32Y), which must be inside the band.
+static uint16_t *fbPixel(tFrameBuffer *pFb, int32_t i32X, int32_t i32Y){
+    return &pFb->pui16Pixels[(i32Y - pFb->i16Y)*FRAMEBUFFER_COLS + (i32X - pFb->i16X)];
+}
+
+// Send all dirty rectangles to the screen, one RAMWR burst each.
+static void dirtyFlush(tFrameBuffer *pFb){
+    uint32_t ui32Index;
+    tRectangle *psRect;
+    for(ui32Index = 0 ; ui32Index < pFb->ui32NumDirty ; ui32Index++){
+        psRect = &pFb->psDirty[ui32Index];
+        HX8357_rectWrite(pFb->pDisplayData, psRect,
+                         fbPixel(pFb, psRect->i16XMin, psRect->i16YMin), FRAMEBUFFER_COLS);
+    }
+    pFb->ui32NumBursts += pFb->ui32NumDirty;
+    pFb->ui32NumDirty = 0;
+}
+
+// Add a rectangle that has been drawn in the buffer to the dirty list.
+static void dirtyAdd(tFrameBuffer *pFb, const tRectangle *psRect){
+    tRectangle sRect = *psRect;
+    uint32_t ui32Index = 0;
+
+    // Merge with everything it can be merged with. A merge makes the rectangle
+    // bigger, so start over after each one.
+    while(ui32Index < pFb->ui32NumDirty){
+        if(rectMerge(&sRect, &pFb->psDirty[ui32Index])){
+            pFb->ui32NumDirty--;
+            pFb->psDirty[ui32Index] = pFb->psDirty[pFb->ui32NumDirty];
+            pFb->ui32NumMerged++;
+            ui32Index = 0;
+        }
+        else {
+            ui32Index++;
+        }
+    }
+    if(pFb->ui32NumDirty == FRAMEBUFFER_DIRTY_MAX){
+        dirtyFlush(pFb);
+    }
+    pFb->psDirty[pFb->ui32NumDirty++] = sRect;
+}
+
+// Get ready to draw psRect. Returns true if it is to be drawn in the buffer, which
+// is then moved there if needed. Returns false if it is too big for the buffer and
+// must be drawn directly on the screen.
+static bool fbPrepare(tFrameBuffer *pFb, const tRectangle *psRect){
+    tRectangle sBand;
+    uint32_t ui32Index;
+
+    if((psRect->i16XMax - psRect->i16XMin + 1 > FRAMEBUFFER_COLS) ||
+       (psRect->i16YMax - psRect->i16YMin + 1 > FRAMEBUFFER_ROWS)){
+        // Whatever is drawn directly must not be overwritten by an older dirty
+        // rectangle later on, so flush first if they overlap.
+        for(ui32Index = 0 ; ui32Index < pFb->ui32NumDirty ; ui32Index++){
+            if(rectOverlap(psRect, &pFb->psDirty[ui32Index])){
+                dirtyFlush(pFb);
+                break;
+            }
+        }
+        pFb->ui32NumDirect++;
+        return false;
+    }
+
+    sBand.i16XMin = pFb->i16X;
+    sBand.i16XMax = pFb->i16X + FRAMEBUFFER_COLS - 1;
+    sBand.i16YMin = pFb->i16Y;
+    sBand.i16YMax = pFb->i16Y + FRAMEBUFFER_ROWS - 1;
+    if((psRect->i16XMin < sBand.i16XMin) || (psRect->i16XMax > sBand.i16XMax) ||
+       (psRect->i16YMin < sBand.i16YMin) || (psRect->i16YMax > sBand.i16YMax)){
+        // Outside of the band, so flush and move the band, keeping it on the screen.
+        dirtyFlush(pFb);
+        pFb->i16X = psRect->i16XMin;
+        if(pFb->i16X > pFb->ui16Width - FRAMEBUFFER_COLS){
+            pFb->i16X = pFb->ui16Width - FRAMEBUFFER_COLS;
+        }
+        pFb->i16Y = psRect->i16YMin;
+        if(pFb->i16Y > pFb->ui16Height - FRAMEBUFFER_ROWS){
+            pFb->i16Y = pFb->ui16Height - FRAMEBUFFER_ROWS;
+        }
+    }
+    return true;
+}
+
+// Fill psRect with the (translated) color, in the buffer if it fits, otherwise directly.
+static void fbRectFill(tFrameBuffer *pFb, const tRectangle *psRect, uint32_t ui32Color){
+    uint32_t ui32Cols = psRect->i16XMax - psRect->i16XMin + 1;
+    int32_t i32Y;
+
+    if((psRect->i16XMax < psRect->i16XMin) || (psRect->i16YMax < psRect->i16YMin)){
+        return;
+    }
+    if(!fbPrepare(pFb, psRect)){
+        RectFill(pFb->pDisplayData, psRect, ui32Color);
+        return;
+    }
+    if(ui32Cols == FRAMEBUFFER_COLS){
+        // Whole rows of the band are next to each other in the buffer.
+        HX8357_fillColor(fbPixel(pFb, psRect->i16XMin, psRect->i16YMin), ui32Color,
+                         ui32Cols*(psRect->i16YMax - psRect->i16YMin + 1));
+    }
+    else {
+        for(i32Y = psRect->i16YMin ; i32Y <= psRect->i16YMax ; i32Y++){
+            HX8357_fillColor(fbPixel(pFb, psRect->i16XMin, i32Y), ui32Color, ui32Cols);
+        }
+    }
+    dirtyAdd(pFb, psRect);
+}
+
+// GRLIB functions
+// These have the same parameters as the ones in ADAFRUIT_2050.c, but pvDisplayData is
+// the tFrameBuffer. Nothing drawn in the band shows up on the screen until FbFlush.
+
+void FbPixelDraw(void *pvDisplayData, int32_t i32X, int32_t i32Y,
+uint32_t ui32ulValue){
+    tRectangle sRect;
+    sRect.i16XMin = sRect.i16XMax = i32X;
+    sRect.i16YMin = sRect.i16YMax = i32Y;
+    fbRectFill((tFrameBuffer *)pvDisplayData, &sRect, ui32ulValue);
+}
+
+void FbPixelDrawMultiple(void *pvDisplayData, int32_t i32X, int32_t i32Y,
+int32_t i32X0, int32_t i32Count, int32_t i32BPP,
+const uint8_t *pui8Data,
+const uint8_t *pui8Palette){
+    tFrameBuffer *pFb = (tFrameBuffer *)pvDisplayData;
+    tRectangle sRect;
+
+    if(i32Count <= 0){
+        return;
+    }
+    if((i32BPP != 1) && (i32BPP != 4) && (i32BPP != 8)){
+        // Unsupported format, nothing sensible can be drawn.
+        return;
+    }
+    sRect.i16XMin = i32X;
+    sRect.i16XMax = i32X + i32Count - 1;
+    sRect.i16YMin = sRect.i16YMax = i32Y;
+    if(!fbPrepare(pFb, &sRect)){
+        PixelDrawMultiple(pFb->pDisplayData, i32X, i32Y, i32X0, i32Count, i32BPP,
+                          pui8Data, pui8Palette);
+        return;
+    }
+    HX8357_pixelsTranslate(pFb->pDisplayData, fbPixel(pFb, i32X, i32Y), i32X, i32Y, i32X0,
+                           i32Count, i32BPP, pui8Data, pui8Palette);
+    dirtyAdd(pFb, &sRect);
+}
+
+void FbLineDrawH(void *pvDisplayData, int32_t i32X1, int32_t i32X2,
+int32_t i32Y, uint32_t ui32ulValue){
+    tRectangle sRect;
+    sRect.i16XMin = i32X1;
+    sRect.i16XMax = i32X2;
+    sRect.i16YMin = sRect.i16YMax = i32Y;
+    fbRectFill((tFrameBuffer *)pvDisplayData, &sRect, ui32ulValue);
+}
+
+void FbLineDrawV(void *pvDisplayData, int32_t i32X, int32_t i32Y1,
+int32_t i32Y2, uint32_t ui32ulValue){
+    tRectangle sRect;
+    sRect.i16XMin = sRect.i16XMax = i32X;
+    sRect.i16YMin = i32Y1;
+    sRect.i16YMax = i32Y2;
+    fbRectFill((tFrameBuffer *)pvDisplayData, &sRect, ui32ulValue);
+}
+
+void FbRectFill(void *pvDisplayData, const tRectangle *psRect,
+uint32_t ui32ulValue){
+    fbRectFill((tFrameBuffer *)pvDisplayData, psRect, ui32ulValue);
+}
+
+uint32_t FbColorTranslate(void *pvDisplayData,
+uint32_t ui32ulValue){
+    return ColorTranslate(((tFrameBuffer *)pvDisplayData)->pDisplayData, ui32ulValue);
+}
+
+// Send the dirty rectangles in the band to the screen.
+void FbFlush(void *pvDisplayData){
+    dirtyFlush((tFrameBuffer *)pvDisplayData);
+}
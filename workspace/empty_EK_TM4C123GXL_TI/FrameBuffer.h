@@ -0,0 +1,78 @@
+/*
+ * FrameBuffer.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Off-screen buffer in front of the HX8357 GRLIB functions. The whole screen
+ *  doesn't fit in the SRAM, so the buffer only covers a band (or tile) of the
+ *  screen at a time. Drawing inside the band only changes the buffer, and the
+ *  changed (dirty) rectangles are sent to the screen on Flush, or when the band
+ *  has to move somewhere else.
+ *
+ */
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+#include <stdint.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+
+// Size of the band in pixels. The default is a horizontal band over the whole width
+// of the screen, which takes 480*8*2 = 7680 bytes of SRAM. Set FRAMEBUFFER_COLS to
+// less than the screen width to get a tile that moves in both directions.
+#ifndef FRAMEBUFFER_COLS
+#define FRAMEBUFFER_COLS 480
+#endif
+#ifndef FRAMEBUFFER_ROWS
+#define FRAMEBUFFER_ROWS 8
+#endif
+
+// Number of dirty rectangles kept track of. If a new one can't be merged and the list
+// is full, the band is flushed.
+#ifndef FRAMEBUFFER_DIRTY_MAX
+#define FRAMEBUFFER_DIRTY_MAX 4
+#endif
+
+typedef struct
+{
+    tDisplayData *pDisplayData; // The screen the buffer is flushed to
+    uint16_t ui16Width;         // Size of the screen
+    uint16_t ui16Height;
+    int16_t i16X;               // Where the band currently is on the screen
+    int16_t i16Y;
+    // The pixels of the band, in the byte order used by the screen. Only the pixels
+    // inside the dirty rectangles are valid, as nothing can be read from the screen.
+    uint16_t pui16Pixels[FRAMEBUFFER_COLS*FRAMEBUFFER_ROWS];
+    tRectangle psDirty[FRAMEBUFFER_DIRTY_MAX]; // In screen coordinates
+    uint32_t ui32NumDirty;
+    // Statistics, can be read from the debugger.
+    uint32_t ui32NumMerged;     // Dirty rectangles merged into another one
+    uint32_t ui32NumBursts;     // Dirty rectangles sent to the screen
+    uint32_t ui32NumDirect;     // Primitives too big for the band, drawn directly
+}
+tFrameBuffer;
+
+/*!
+  @brief  Function declarations
+*/
+void FrameBuffer_init(tFrameBuffer *pFb, tDisplayData *pDisplayData,
+                      uint16_t ui16Width, uint16_t ui16Height);
+
+// GRLIB specific functions, pvDisplayData is the tFrameBuffer:
+void FbPixelDraw(void *pvDisplayData, int32_t i32X, int32_t i32Y,
+uint32_t ui32ulValue);
+void FbPixelDrawMultiple(void *pvDisplayData, int32_t i32X, int32_t i32Y,
+int32_t i32X0, int32_t i32Count, int32_t i32BPP,
+const uint8_t *pui8Data,
+const uint8_t *pui8Palette);
+void FbLineDrawH(void *pvDisplayData, int32_t i32X1, int32_t i32X2,
+int32_t i32Y, uint32_t ui32ulValue);
+void FbLineDrawV(void *pvDisplayData, int32_t i32X, int32_t i32Y1,
+int32_t i32Y2, uint32_t ui32ulValue);
+void FbRectFill(void *pvDisplayData, const tRectangle *psRect,
+uint32_t ui32ulValue);
+uint32_t FbColorTranslate(void *pvDisplayData,
+uint32_t ui32ulValue);
+void FbFlush(void *pvDisplayData);
+
+#endif /* FRAMEBUFFER_H_ */
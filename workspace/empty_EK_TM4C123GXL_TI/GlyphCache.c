@@ -0,0 +1,421 @@
+/*
+ * GlyphCache.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include <stdbool.h>
+#include <string.h>
+#include "GlyphCache.h"
+
+// Most characters in a run sent with one RAMWR
+#define GLYPHCACHE_RUN_CHARS 32
+
+// Initialize the glyph cache. Glyphs are sent to the screen in pDisplayData, which
+// must be initialized (HX8357_initDisplayData) before anything is drawn.
+void GlyphCache_init(tGlyphCache *pCache, tDisplayData *pDisplayData){
+    uint32_t ui32Index;
+    pCache->pDisplayData = pDisplayData;
+    pCache->psFont = NULL;
+    pCache->psAaFont = NULL;
+    pCache->ui32Foreground = 0;
+    pCache->ui32Background = 0;
+    pCache->pui16Ramp = NULL;
+    pCache->ui32Clock = 0;
+    for(ui32Index = 0 ; ui32Index < GLYPHCACHE_ENTRIES ; ui32Index++){
+        pCache->psCells[ui32Index].ui8Width = 0;
+    }
+    for(ui32Index = 0 ; ui32Index < GLYPHCACHE_RAMPS ; ui32Index++){
+        pCache->psRamps[ui32Index].ui32LastUse = 0;
+    }
+    pCache->ui32NumHits = 0;
+    pCache->ui32NumMisses = 0;
+    pCache->ui32NumFallbacks = 0;
+    pCache->ui32NumRamps = 0;
+    pCache->ui32NumRuns = 0;
+}
+
+// Get the ramp from the current background to the current foreground, working it
+// out in the least recently used entry if it isn't kept. Each channel of entry n is
+// (n*foreground + (15 - n)*background)/15, rounded, so entry 0 is the background and
+// entry 15 the foreground.
+static const uint16_t *glyphRampGet(tGlyphCache *pCache){
+    uint32_t ui32Foreground = pCache->ui32Foreground;
+    uint32_t ui32Background = pCache->ui32Background;
+    tGlyphRamp *psRamp = &pCache->psRamps[0];
+    tGlyphRamp *psEntry;
+    uint32_t ui32Index, ui32Red, ui32Green, ui32Blue;
+    uint16_t ui16Color;
+
+    pCache->ui32Clock++;
+    for(ui32Index = 0 ; ui32Index < GLYPHCACHE_RAMPS ; ui32Index++){
+        psEntry = &pCache->psRamps[ui32Index];
+        if((psEntry->ui32LastUse != 0) && (psEntry->ui32Foreground == ui32Foreground) &&
+           (psEntry->ui32Background == ui32Background)){
+            psEntry->ui32LastUse = pCache->ui32Clock;
+            return psEntry->pui16Colors;
+        }
+        // Empty entries have the lowest use, so they are taken first.
+        if(psEntry->ui32LastUse < psRamp->ui32LastUse){
+            psRamp = psEntry;
+        }
+    }
+    psRamp->ui32Foreground = ui32Foreground;
+    psRamp->ui32Background = ui32Background;
+    psRamp->ui32LastUse = pCache->ui32Clock;
+    for(ui32Index = 0 ; ui32Index < GLYPHCACHE_RAMP_LEVELS ; ui32Index++){
+        ui32Red = (((ui32Foreground >> 11) & 0x1F)*ui32Index +
+                   ((ui32Background >> 11) & 0x1F)*(15 - ui32Index) + 7)/15;
+        ui32Green = (((ui32Foreground >> 5) & 0x3F)*ui32Index +
+                     ((ui32Background >> 5) & 0x3F)*(15 - ui32Index) + 7)/15;
+        ui32Blue = ((ui32Foreground & 0x1F)*ui32Index + (ui32Background & 0x1F)*(15 - ui32Index) + 7)/15;
+        ui16Color = (ui32Red << 11) | (ui32Green << 5) | ui32Blue;
+        psRamp->pui16Colors[ui32Index] = HX8357_SWAP16(ui16Color);
+    }
+    pCache->ui32NumRamps++;
+    return psRamp->pui16Colors;
+}
+
+// Clear the cache if the cells were rasterised with another font or other colors.
+// One of the fonts is NULL.
+static void glyphCacheSet(tGlyphCache *pCache, const tFont *psFont, const tGlyphAaFont *psAaFont,
+                          uint32_t ui32Foreground, uint32_t ui32Background){
+    uint32_t ui32Index;
+
+    if((psFont == pCache->psFont) && (psAaFont == pCache->psAaFont) &&
+       (ui32Foreground == pCache->ui32Foreground) && (ui32Background == pCache->ui32Background)){
+        return;
+    }
+    pCache->psFont = psFont;
+    pCache->psAaFont = psAaFont;
+    pCache->ui32Foreground = ui32Foreground;
+    pCache->ui32Background = ui32Background;
+    pCache->pui16Ramp = (psAaFont != NULL) ? glyphRampGet(pCache) : NULL;
+    for(ui32Index = 0 ; ui32Index < GLYPHCACHE_ENTRIES ; ui32Index++){
+        pCache->psCells[ui32Index].ui8Width = 0;
+    }
+}
+
+// Rasterise a GRLIB glyph into a cell of ui32Width*ui32Height pixels, which must
+// already be filled with the background. The glyph data is a stream of pixels that
+// goes row by row, so the position in the cell just moves on and wraps to the next
+// row by itself. Compressed (pixel RLE) data is made up of:
+//  - a byte with the number of off pixels in the high nibble and on pixels in the low
+//  - a 0 byte followed by the number of bytes of literal pixels, 1 bit per pixel
+// Uncompressed data is literal pixels only.
+static void glyphRasterise(uint16_t *pui16Cell, const uint8_t *pui8Glyph, uint32_t ui32Width,
+                           uint32_t ui32Height, bool bCompressed, uint16_t ui16Foreground){
+    uint32_t ui32NumPixels = ui32Width*ui32Height;
+    uint32_t ui32Pos = 0;
+    uint32_t ui32Index = 2; // The size and width come first
+    uint32_t ui32Bits, ui32Bit, ui32On;
+
+    while((ui32Index < pui8Glyph[0]) && (ui32Pos < ui32NumPixels)){
+        if(bCompressed && (pui8Glyph[ui32Index] != 0)){
+            ui32Pos += pui8Glyph[ui32Index] >> 4;
+            ui32On = pui8Glyph[ui32Index] & 0x0F;
+            while(ui32On-- && (ui32Pos < ui32NumPixels)){
+                pui16Cell[ui32Pos++] = ui16Foreground;
+            }
+            ui32Index++;
+            continue;
+        }
+        if(bCompressed){
+            ui32Bits = (pui8Glyph[ui32Index + 1] & 0x7F)*8;
+            ui32Index += 2;
+        }
+        else {
+            ui32Bits = (pui8Glyph[0] - ui32Index)*8;
+        }
+        for(ui32Bit = 0 ; (ui32Bit < ui32Bits) && (ui32Pos < ui32NumPixels) ; ui32Bit++, ui32Pos++){
+            if(pui8Glyph[ui32Index + ui32Bit/8] & (0x80 >> (ui32Bit & 7))){
+                pui16Cell[ui32Pos] = ui16Foreground;
+            }
+        }
+        ui32Index += ui32Bits/8;
+    }
+}
+
+// Rasterise an anti-aliased glyph into a cell of ui32NumPixels pixels. pui8Data is
+// the coverage of the pixels, after the width. Every pixel is one lookup in the ramp.
+static void glyphAaRasterise(uint16_t *pui16Cell, const uint8_t *pui8Data, uint32_t ui32NumPixels,
+                             uint32_t ui32Bpp, const uint16_t *pui16Ramp){
+    uint32_t ui32Pos;
+    uint8_t ui8Byte;
+
+    if(ui32Bpp == 4){
+        for(ui32Pos = 0 ; ui32Pos + 1 < ui32NumPixels ; ui32Pos += 2){
+            ui8Byte = *pui8Data++;
+            pui16Cell[ui32Pos] = pui16Ramp[ui8Byte >> 4];
+            pui16Cell[ui32Pos + 1] = pui16Ramp[ui8Byte & 0x0F];
+        }
+        if(ui32Pos < ui32NumPixels){
+            pui16Cell[ui32Pos] = pui16Ramp[*pui8Data >> 4];
+        }
+    }
+    else {
+        for(ui32Pos = 0 ; ui32Pos < ui32NumPixels ; ui32Pos++){
+            pui16Cell[ui32Pos] = pui16Ramp[5*((pui8Data[ui32Pos/4] >> (6 - 2*(ui32Pos & 3))) & 0x03)];
+        }
+    }
+}
+
+// Get the cell of ui8Char, rasterising it into the least recently used cell if it
+// isn't in the cache. pui8Glyph is the glyph in the current font, and is ui32Width
+// pixels wide.
+static tGlyphCell *glyphCellGet(tGlyphCache *pCache, uint8_t ui8Char, const uint8_t *pui8Glyph,
+                                uint32_t ui32Width){
+    const tFont *psFont = pCache->psFont;
+    const tGlyphAaFont *psAaFont = pCache->psAaFont;
+    tGlyphCell *psCell = NULL;
+    tGlyphCell *psEntry;
+    uint32_t ui32Index;
+
+    pCache->ui32Clock++;
+    for(ui32Index = 0 ; ui32Index < GLYPHCACHE_ENTRIES ; ui32Index++){
+        psEntry = &pCache->psCells[ui32Index];
+        if((psEntry->ui8Width != 0) && (psEntry->ui8Char == ui8Char)){
+            psEntry->ui32LastUse = pCache->ui32Clock;
+            pCache->ui32NumHits++;
+            return psEntry;
+        }
+        // Keep track of the cell to replace: an empty one, or the least recently used.
+        if((psCell == NULL) || ((psCell->ui8Width != 0) &&
+           ((psEntry->ui8Width == 0) || (psEntry->ui32LastUse < psCell->ui32LastUse)))){
+            psCell = psEntry;
+        }
+    }
+    psCell->ui8Char = ui8Char;
+    psCell->ui8Width = ui32Width;
+    psCell->ui32LastUse = pCache->ui32Clock;
+    if(psAaFont != NULL){
+        glyphAaRasterise(psCell->pui16Pixels, pui8Glyph + 1, ui32Width*psAaFont->ui8Height,
+                         psAaFont->ui8Bpp, pCache->pui16Ramp);
+    }
+    else {
+        HX8357_fillColor(psCell->pui16Pixels, pCache->ui32Background, ui32Width*psFont->ui8Height);
+        glyphRasterise(psCell->pui16Pixels, pui8Glyph, ui32Width, psFont->ui8Height,
+                       psFont->ui8Format == FONT_FMT_PIXEL_RLE, HX8357_SWAP16(pCache->ui32Foreground));
+    }
+    pCache->ui32NumMisses++;
+    return psCell;
+}
+
+// Send the ui32Count cells in ppsCells side by side, as the rectangle psRect, with one
+// address window and RAMWR. The rows are put together in a buffer from the scratch
+// pool, two halves of as many rows as fit. If not even one row fits, or there is
+// only one cell, each cell is sent on its own.
+static void runDraw(tGlyphCache *pCache, tGlyphCell **ppsCells, uint32_t ui32Count,
+                    const tRectangle *psRect){
+    tDisplayData *pDisplayData = pCache->pDisplayData;
+    uint32_t ui32Width = psRect->i16XMax - psRect->i16XMin + 1;
+    uint32_t ui32Height = psRect->i16YMax - psRect->i16YMin + 1;
+    uint32_t pui32After[2] = {0, 0}; // Chunks queued after each half
+    uint32_t ui32BufBytes, ui32HalfRows, ui32Rows, ui32Row, ui32Index, ui32Cell;
+    uint32_t ui32Half = 0;
+    uint16_t *pui16Half[2];
+    uint16_t *pui16Out;
+    tRectangle sRect;
+    char *pBuf;
+
+    pBuf = HX8357_scratchBorrow(pDisplayData, 4*ui32Width*ui32Height, &ui32BufBytes);
+    ui32HalfRows = ui32BufBytes/(4*ui32Width);
+    if((ui32Count == 1) || (ui32HalfRows == 0)){
+        HX8357_scratchReturn(pDisplayData, pBuf);
+        sRect = *psRect;
+        for(ui32Cell = 0 ; ui32Cell < ui32Count ; ui32Cell++){
+            sRect.i16XMax = sRect.i16XMin + ppsCells[ui32Cell]->ui8Width - 1;
+            HX8357_rectWrite(pDisplayData, &sRect, ppsCells[ui32Cell]->pui16Pixels,
+                             ppsCells[ui32Cell]->ui8Width);
+            sRect.i16XMin = sRect.i16XMax + 1;
+        }
+        pCache->ui32NumRuns += ui32Count;
+        return;
+    }
+    pui16Half[0] = (uint16_t *)pBuf;
+    pui16Half[1] = (uint16_t *)pBuf + ui32HalfRows*ui32Width;
+
+    HX8357_streamBegin(pDisplayData, psRect);
+    for(ui32Row = 0 ; ui32Row < ui32Height ; ui32Row += ui32Rows){
+        ui32Rows = ui32Height - ui32Row;
+        if(ui32Rows > ui32HalfRows){
+            ui32Rows = ui32HalfRows;
+        }
+        // Everything queued before the half was last queued must be sent.
+        HX8357_streamWait(pDisplayData, pui32After[ui32Half]);
+        pui16Out = pui16Half[ui32Half];
+        for(ui32Index = ui32Row ; ui32Index < ui32Row + ui32Rows ; ui32Index++){
+            for(ui32Cell = 0 ; ui32Cell < ui32Count ; ui32Cell++){
+                memcpy(pui16Out, ppsCells[ui32Cell]->pui16Pixels + ui32Index*ppsCells[ui32Cell]->ui8Width,
+                       2*ppsCells[ui32Cell]->ui8Width);
+                pui16Out += ppsCells[ui32Cell]->ui8Width;
+            }
+        }
+        pui32After[ui32Half] = 0;
+        pui32After[ui32Half ^ 1] += HX8357_streamWrite(pDisplayData, pui16Half[ui32Half],
+                                                       2*ui32Rows*ui32Width);
+        ui32Half ^= 1;
+    }
+    HX8357_streamEnd(pDisplayData);
+    HX8357_scratchReturn(pDisplayData, pBuf);
+    pCache->ui32NumRuns++;
+}
+
+// Draw a string like GrStringDraw with bOpaque set, i.e. with the background of the
+// context behind the characters. i32Length is the number of characters, or -1 for a
+// zero terminated string. Characters that are (partly) outside of the clipping region,
+// or too big for a cell, and fonts other than the classic tFont, are left to GRLIB.
+// Anything drawn through the context before is flushed first, so it doesn't matter
+// if GRLIB draws through the display queue or the frame buffer.
+// The other characters are sent in runs, each with one address window and RAMWR. A
+// run ends before a character left to GRLIB, or one that would make it more than
+// GLYPHCACHE_ENTRIES different characters, as the cells of a run must all be kept
+// until it is sent, or too wide for two of its rows to fit in the scratch pool.
+void GlyphCache_stringDraw(tGlyphCache *pCache, const tContext *pContext, const char *pcString,
+                           int32_t i32Length, int32_t i32X, int32_t i32Y){
+    const tFont *psFont = pContext->psFont;
+    const tDisplay *psDisplay = pContext->psDisplay;
+    const uint8_t *pui8Glyph;
+    tGlyphCell *ppsRun[GLYPHCACHE_RUN_CHARS];
+    uint8_t pui8Chars[GLYPHCACHE_ENTRIES]; // The different characters in the run
+    uint32_t ui32Count, ui32NumChars, ui32Index;
+    tRectangle sRect;
+    bool bFlushed = false;
+    char cChar;
+
+    if((psFont->ui8Format != FONT_FMT_UNCOMPRESSED) && (psFont->ui8Format != FONT_FMT_PIXEL_RLE)){
+        GrStringDraw(pContext, pcString, i32Length, i32X, i32Y, true);
+        pCache->ui32NumFallbacks++;
+        return;
+    }
+    glyphCacheSet(pCache, psFont, NULL, pContext->ui32Foreground, pContext->ui32Background);
+
+    sRect.i16YMin = i32Y;
+    sRect.i16YMax = i32Y + psFont->ui8Height - 1;
+    while(i32Length && *pcString){
+        ui32Count = 0;
+        ui32NumChars = 0;
+        sRect.i16XMin = i32X;
+        while(i32Length && *pcString && (ui32Count < GLYPHCACHE_RUN_CHARS)){
+            cChar = *pcString;
+            if((cChar < ' ') || (cChar > '~')){
+                // Not in the font
+                cChar = ' ';
+            }
+            pui8Glyph = psFont->pui8Data + psFont->pui16Offset[cChar - ' '];
+            if((pui8Glyph[1]*psFont->ui8Height > GLYPHCACHE_CELL_PIXELS) ||
+               (i32X < pContext->sClipRegion.i16XMin) || (i32X + pui8Glyph[1] - 1 > pContext->sClipRegion.i16XMax) ||
+               (sRect.i16YMin < pContext->sClipRegion.i16YMin) || (sRect.i16YMax > pContext->sClipRegion.i16YMax)){
+                break;
+            }
+            if((ui32Count > 0) && (i32X + pui8Glyph[1] - sRect.i16XMin > HX8357_SCRATCH_BYTES/4)){
+                // Two rows of the run must fit in the scratch pool.
+                break;
+            }
+            if(pui8Glyph[1] != 0){
+                for(ui32Index = 0 ; ui32Index < ui32NumChars ; ui32Index++){
+                    if(pui8Chars[ui32Index] == (uint8_t)cChar){
+                        break;
+                    }
+                }
+                if(ui32Index == ui32NumChars){
+                    if(ui32NumChars == GLYPHCACHE_ENTRIES){
+                        break;
+                    }
+                    pui8Chars[ui32NumChars++] = cChar;
+                }
+                ppsRun[ui32Count++] = glyphCellGet(pCache, cChar, pui8Glyph, pui8Glyph[1]);
+            }
+            i32X += pui8Glyph[1];
+            pcString++;
+            i32Length--;
+        }
+        if(ui32Count > 0){
+            if(!bFlushed){
+                psDisplay->pfnFlush(psDisplay->pvDisplayData);
+                bFlushed = true;
+            }
+            sRect.i16XMax = i32X - 1;
+            runDraw(pCache, ppsRun, ui32Count, &sRect);
+        }
+        else if(i32Length && *pcString){
+            // Nothing could go in the run, so the character is left to GRLIB.
+            cChar = *pcString++;
+            i32Length--;
+            if((cChar < ' ') || (cChar > '~')){
+                cChar = ' ';
+            }
+            GrStringDraw(pContext, &cChar, 1, i32X, i32Y, true);
+            pCache->ui32NumFallbacks++;
+            bFlushed = false;
+            i32X += psFont->pui8Data[psFont->pui16Offset[cChar - ' '] + 1];
+        }
+    }
+}
+
+// Draw a string in the anti-aliased font psFont, blended from the background to the
+// foreground of the context. Otherwise like GlyphCache_stringDraw, but everything is
+// drawn here: characters that are partly outside of the clipping region are cut to
+// it. Characters too big for a cell are left out.
+void GlyphCache_aaStringDraw(tGlyphCache *pCache, const tContext *pContext,
+                             const tGlyphAaFont *psFont, const char *pcString, int32_t i32Length,
+                             int32_t i32X, int32_t i32Y){
+    const tRectangle *psClip = &pContext->sClipRegion;
+    const tDisplay *psDisplay = pContext->psDisplay;
+    const uint8_t *pui8Glyph;
+    tGlyphCell *psCell;
+    tRectangle sRect;
+    bool bFlushed = false;
+    int32_t i32Left, i32Top;
+    uint32_t ui32Width;
+    char cChar;
+
+    glyphCacheSet(pCache, NULL, psFont, pContext->ui32Foreground, pContext->ui32Background);
+    while(i32Length-- && *pcString){
+        cChar = *pcString++;
+        if((cChar < ' ') || (cChar > '~')){
+            // Not in the font
+            cChar = ' ';
+        }
+        pui8Glyph = psFont->pui8Data + psFont->pui16Offset[cChar - ' '];
+        ui32Width = pui8Glyph[0];
+        // The part of the glyph inside the clipping region
+        i32Left = (i32X < psClip->i16XMin) ? psClip->i16XMin - i32X : 0;
+        i32Top = (i32Y < psClip->i16YMin) ? psClip->i16YMin - i32Y : 0;
+        sRect.i16XMin = i32X + i32Left;
+        sRect.i16XMax = (i32X + (int32_t)ui32Width - 1 > psClip->i16XMax) ?
+                        psClip->i16XMax : i32X + (int32_t)ui32Width - 1;
+        sRect.i16YMin = i32Y + i32Top;
+        sRect.i16YMax = (i32Y + psFont->ui8Height - 1 > psClip->i16YMax) ?
+                        psClip->i16YMax : i32Y + psFont->ui8Height - 1;
+        if(ui32Width*psFont->ui8Height > GLYPHCACHE_CELL_PIXELS){
+            pCache->ui32NumFallbacks++;
+        }
+        else if((sRect.i16XMin <= sRect.i16XMax) && (sRect.i16YMin <= sRect.i16YMax)){
+            psCell = glyphCellGet(pCache, cChar, pui8Glyph, ui32Width);
+            if(!bFlushed){
+                psDisplay->pfnFlush(psDisplay->pvDisplayData);
+                bFlushed = true;
+            }
+            HX8357_rectWrite(pCache->pDisplayData, &sRect,
+                             psCell->pui16Pixels + i32Top*ui32Width + i32Left, ui32Width);
+        }
+        i32X += ui32Width;
+    }
+}
+
+// Width in pixels of a string in the anti-aliased font psFont, like GrStringWidthGet.
+int32_t GlyphCache_aaStringWidthGet(const tGlyphAaFont *psFont, const char *pcString,
+                                    int32_t i32Length){
+    int32_t i32Width = 0;
+    char cChar;
+
+    while(i32Length-- && *pcString){
+        cChar = *pcString++;
+        if((cChar < ' ') || (cChar > '~')){
+            cChar = ' ';
+        }
+        i32Width += psFont->pui8Data[psFont->pui16Offset[cChar - ' ']];
+    }
+    return i32Width;
+}
@@ -0,0 +1,118 @@
+/*
+ * GlyphCache.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Text renderer for the HX8357 that draws each character as one block of pixels.
+ *  GRLIB draws a glyph as a lot of short lines, each of which needs its own
+ *  address window and RAMWR. Here the glyph is rasterised into a cell of screen
+ *  colors (foreground and background) instead, and sent with a single address
+ *  window and one RAMWR burst. The last few cells are kept, so that common
+ *  characters don't have to be rasterised again. Characters next to each other
+ *  whose cells are all kept at once are sent together, row by row, in one RAMWR.
+ *
+ *  Anti-aliased fonts (tGlyphAaFont, made with tools/fontaa) are drawn the same
+ *  way. Each pixel of such a glyph is a coverage of 2 or 4 bits, and the color of
+ *  every coverage is looked up in a ramp from the background to the foreground,
+ *  worked out once per pair of colors. The last few ramps are kept, so switching
+ *  between a few colors doesn't work them out again either.
+ *
+ */
+
+#ifndef GLYPHCACHE_H_
+#define GLYPHCACHE_H_
+#include <stdint.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+
+// Number of glyphs kept. The least recently used one is replaced. A run of text
+// with up to this many different characters is sent in one RAMWR.
+#ifndef GLYPHCACHE_ENTRIES
+#define GLYPHCACHE_ENTRIES 4
+#endif
+
+// Pixels in a cell, i.e. the largest width*height of a glyph that can be cached.
+// Takes 2 bytes per pixel for every entry. g_sFontCmtt38 needs about 900.
+#ifndef GLYPHCACHE_CELL_PIXELS
+#define GLYPHCACHE_CELL_PIXELS 1024
+#endif
+
+// Number of blend ramps kept, i.e. pairs of foreground and background colors that
+// anti-aliased text can switch between without working out the ramp again.
+#ifndef GLYPHCACHE_RAMPS
+#define GLYPHCACHE_RAMPS 2
+#endif
+
+// Coverage levels in a ramp, enough for 4 bits per pixel. A 2 bpp coverage c uses
+// entry 5*c.
+#define GLYPHCACHE_RAMP_LEVELS 16
+
+// An anti-aliased font, laid out like tFont. Each glyph in pui8Data is its width,
+// followed by the coverage of each pixel, row by row from the top left, ui8Bpp bits
+// per pixel with the first pixel in the most significant bits. Rows aren't padded,
+// only the end of the glyph is. A coverage of 0 is the background, and 3 or 15
+// the foreground.
+typedef struct
+{
+    uint8_t ui8Bpp;             // 2 or 4
+    uint8_t ui8Height;
+    uint8_t ui8Baseline;
+    uint8_t ui8MaxWidth;
+    uint16_t pui16Offset[95];   // Of the glyphs of ' ' to '~' in pui8Data
+    const uint8_t *pui8Data;
+}
+tGlyphAaFont;
+
+typedef struct
+{
+    uint32_t ui32Foreground;    // Translated colors the ramp goes between
+    uint32_t ui32Background;
+    uint32_t ui32LastUse;       // 0 if the entry is empty
+    uint16_t pui16Colors[GLYPHCACHE_RAMP_LEVELS]; // In the byte order used by the screen
+}
+tGlyphRamp;
+
+typedef struct
+{
+    uint8_t ui8Char;            // Character in the cell
+    uint8_t ui8Width;           // Width of the glyph, 0 if the entry is empty
+    uint32_t ui32LastUse;       // For finding the least recently used entry
+    uint16_t pui16Pixels[GLYPHCACHE_CELL_PIXELS]; // In the byte order used by the screen
+}
+tGlyphCell;
+
+typedef struct
+{
+    tDisplayData *pDisplayData; // The screen the glyphs are sent to
+    // What the cells were rasterised with. The cache is cleared when any of them changes.
+    const tFont *psFont;
+    const tGlyphAaFont *psAaFont; // Only one of the fonts is set
+    uint32_t ui32Foreground;
+    uint32_t ui32Background;
+    const uint16_t *pui16Ramp;  // Colors of the coverages, with an anti-aliased font
+    uint32_t ui32Clock;         // Incremented on every use of a cell or ramp
+    tGlyphCell psCells[GLYPHCACHE_ENTRIES];
+    tGlyphRamp psRamps[GLYPHCACHE_RAMPS];
+    // Statistics, can be read from the debugger.
+    uint32_t ui32NumHits;       // Characters drawn from a cached cell
+    uint32_t ui32NumMisses;     // Characters rasterised into a cell
+    uint32_t ui32NumFallbacks;  // Characters drawn by GRLIB (clipped, or font not supported),
+                                // and anti-aliased ones too big for a cell, which aren't drawn
+    uint32_t ui32NumRamps;      // Ramps worked out
+    uint32_t ui32NumRuns;       // Runs of characters sent with one address window and RAMWR
+}
+tGlyphCache;
+
+/*!
+  @brief  Function declarations
+*/
+void GlyphCache_init(tGlyphCache *pCache, tDisplayData *pDisplayData);
+void GlyphCache_stringDraw(tGlyphCache *pCache, const tContext *pContext, const char *pcString,
+                           int32_t i32Length, int32_t i32X, int32_t i32Y);
+void GlyphCache_aaStringDraw(tGlyphCache *pCache, const tContext *pContext,
+                             const tGlyphAaFont *psFont, const char *pcString, int32_t i32Length,
+                             int32_t i32X, int32_t i32Y);
+int32_t GlyphCache_aaStringWidthGet(const tGlyphAaFont *psFont, const char *pcString,
+                                    int32_t i32Length);
+
+#endif /* GLYPHCACHE_H_ */
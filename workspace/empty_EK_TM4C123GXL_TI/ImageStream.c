@@ -0,0 +1,164 @@
+/*
+ * ImageStream.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include "ImageStream.h"
+
+// BMP file header (14 bytes), BITMAPINFOHEADER (40 bytes) and the three color masks
+// that follow it for BI_BITFIELDS. Newer headers are longer, but start the same way,
+// and have the masks in the same place.
+#define BMP_HEADER_BYTES 66
+#define BMP_BI_RGB       0
+#define BMP_BI_BITFIELDS 3
+
+static uint32_t le16Get(const uint8_t *pui8Data){
+    return pui8Data[0] | (pui8Data[1] << 8);
+}
+
+static uint32_t le32Get(const uint8_t *pui8Data){
+    return pui8Data[0] | (pui8Data[1] << 8) | (pui8Data[2] << 16) | ((uint32_t)pui8Data[3] << 24);
+}
+
+static void statsClear(tImageStream *pStream, tImageStreamRead pfnRead, void *pvSource){
+    pStream->pfnRead = pfnRead;
+    pStream->pvSource = pvSource;
+    pStream->ui32NumReads = 0;
+    pStream->ui32NumBytes = 0;
+}
+
+// Open a BMP image, read through pfnRead with pvSource. Returns false if the header
+// can't be read, or the format isn't supported (see ImageStream.h), or a row doesn't
+// fit in IMAGESTREAM_BUF_BYTES.
+bool ImageStream_open(tImageStream *pStream, tImageStreamRead pfnRead, void *pvSource){
+    uint8_t *pui8Header = (uint8_t *)pStream->pui32Buf[0];
+    uint32_t ui32HeaderBytes, ui32Bpp, ui32Compression, ui32Width;
+    int32_t i32Height;
+
+    statsClear(pStream, pfnRead, pvSource);
+    ui32HeaderBytes = pfnRead(pvSource, 0, pui8Header, BMP_HEADER_BYTES);
+    if((ui32HeaderBytes < 54) || (pui8Header[0] != 'B') || (pui8Header[1] != 'M')){
+        return false;
+    }
+    pStream->ui32DataOffset = le32Get(&pui8Header[10]);
+    ui32Width = le32Get(&pui8Header[18]);
+    i32Height = (int32_t)le32Get(&pui8Header[22]);
+    ui32Bpp = le16Get(&pui8Header[28]);
+    ui32Compression = le32Get(&pui8Header[30]);
+
+    if((ui32Bpp == 24) && (ui32Compression == BMP_BI_RGB)){
+        pStream->ui8Format = IMAGESTREAM_BMP24;
+    }
+    else if((ui32Bpp == 16) && (ui32Compression == BMP_BI_BITFIELDS) &&
+            (ui32HeaderBytes == BMP_HEADER_BYTES) &&
+            (le32Get(&pui8Header[54]) == 0xF800) && (le32Get(&pui8Header[58]) == 0x07E0) &&
+            (le32Get(&pui8Header[62]) == 0x001F)){
+        pStream->ui8Format = IMAGESTREAM_BMP16;
+    }
+    else {
+        return false;
+    }
+    // A positive height means that the rows are stored from the bottom up.
+    pStream->bBottomUp = i32Height > 0;
+    if(i32Height < 0){
+        i32Height = -i32Height;
+    }
+    // Rows are padded to a multiple of 4 bytes.
+    pStream->ui32Stride = (ui32Width*ui32Bpp/8 + 3) & ~3;
+    if((ui32Width == 0) || (i32Height == 0) || (i32Height > 0xFFFF) ||
+       (pStream->ui32Stride > IMAGESTREAM_BUF_BYTES)){
+        return false;
+    }
+    pStream->ui16Width = ui32Width;
+    pStream->ui16Height = i32Height;
+    return true;
+}
+
+// Open a raw RGB565 image of ui16Width*ui16Height pixels, read through pfnRead with
+// pvSource. Returns false if a row doesn't fit in IMAGESTREAM_BUF_BYTES.
+bool ImageStream_openRaw(tImageStream *pStream, tImageStreamRead pfnRead, void *pvSource,
+                         uint16_t ui16Width, uint16_t ui16Height){
+    statsClear(pStream, pfnRead, pvSource);
+    pStream->ui8Format = IMAGESTREAM_RAW565;
+    pStream->ui16Width = ui16Width;
+    pStream->ui16Height = ui16Height;
+    pStream->bBottomUp = false;
+    pStream->ui32DataOffset = 0;
+    pStream->ui32Stride = 2*ui16Width;
+    return (ui16Width > 0) && (ui16Height > 0) && (pStream->ui32Stride <= IMAGESTREAM_BUF_BYTES);
+}
+
+// Convert a row of ui32Width pixels in place to RGB565 in the byte order used by the
+// screen. No pixel gets longer, so going from the start never overwrites a pixel
+// that hasn't been converted yet. The row goes right from (i32X, i32Y) on the screen,
+// which is where 24-bit pixels are dithered from if bDither is set.
+static void rowConvert(uint8_t ui8Format, uint8_t *pui8Row, uint32_t ui32Width, int32_t i32X,
+                       int32_t i32Y, bool bDither){
+    uint8_t *pui8Out = pui8Row;
+    uint8_t ui8Blue;
+
+    if(ui8Format == IMAGESTREAM_BMP24){
+        HX8357_rgbConvert((uint16_t *)pui8Row, pui8Row, HX8357_RGB_BGR24, ui32Width, i32X, i32Y, bDither);
+    }
+    else if(ui8Format == IMAGESTREAM_BMP16){
+        while(ui32Width--){
+            ui8Blue = pui8Out[0]; // The low byte, with blue and some of green
+            pui8Out[0] = pui8Out[1];
+            pui8Out[1] = ui8Blue;
+            pui8Out += 2;
+        }
+    }
+}
+
+// Draw the opened image with its top left corner at (i32X, i32Y). The image must fit
+// on the screen. Anything drawn through the display queue must be flushed first,
+// since this writes straight to the screen. Returns false if the image couldn't be
+// read to the end, in which case the rest of it is left as it was on the screen.
+// 24-bit images are dithered if that is turned on with HX8357_ditherSet.
+bool ImageStream_draw(tImageStream *pStream, tDisplayData *pDisplayData, int32_t i32X, int32_t i32Y){
+    uint32_t ui32RowsPerBuf = IMAGESTREAM_BUF_BYTES/pStream->ui32Stride;
+    uint32_t ui32Row = 0, ui32Rows, ui32FileRow, ui32Bytes, ui32Index, ui32Chunks;
+    uint32_t ui32Buf = 0;
+    uint8_t *pui8Buf, *pui8Row;
+    tRectangle sRect;
+    bool bOk = true;
+
+    sRect.i16XMin = i32X;
+    sRect.i16YMin = i32Y;
+    sRect.i16XMax = i32X + pStream->ui16Width - 1;
+    sRect.i16YMax = i32Y + pStream->ui16Height - 1;
+    HX8357_streamBegin(pDisplayData, &sRect);
+    while(ui32Row < pStream->ui16Height){
+        ui32Rows = pStream->ui16Height - ui32Row;
+        if(ui32Rows > ui32RowsPerBuf){
+            ui32Rows = ui32RowsPerBuf;
+        }
+        // The rows are read in one go. In a bottom-up image they are next to each
+        // other as well, just further up in the file and in reverse order.
+        ui32FileRow = pStream->bBottomUp ? pStream->ui16Height - ui32Row - ui32Rows : ui32Row;
+        ui32Bytes = ui32Rows*pStream->ui32Stride;
+        pui8Buf = (uint8_t *)pStream->pui32Buf[ui32Buf];
+        pStream->ui32NumReads++;
+        if(pStream->pfnRead(pStream->pvSource, pStream->ui32DataOffset + ui32FileRow*pStream->ui32Stride,
+                            pui8Buf, ui32Bytes) != ui32Bytes){
+            bOk = false;
+            break;
+        }
+        pStream->ui32NumBytes += ui32Bytes;
+        ui32Chunks = 0;
+        for(ui32Index = 0 ; ui32Index < ui32Rows ; ui32Index++){
+            pui8Row = pui8Buf + (pStream->bBottomUp ? ui32Rows - 1 - ui32Index : ui32Index)*pStream->ui32Stride;
+            rowConvert(pStream->ui8Format, pui8Row, pStream->ui16Width, i32X, i32Y + ui32Row + ui32Index,
+                       pDisplayData->bDither);
+            ui32Chunks += HX8357_streamWrite(pDisplayData, pui8Row, 2*pStream->ui16Width);
+        }
+        // The next rows go in the other buffer, so everything in it must be sent.
+        // This buffer is still being sent while they are read.
+        ui32Buf ^= 1;
+        HX8357_streamWait(pDisplayData, ui32Chunks);
+        ui32Row += ui32Rows;
+    }
+    HX8357_streamEnd(pDisplayData);
+    return bOk;
+}
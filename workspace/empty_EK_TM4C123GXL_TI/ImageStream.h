@@ -0,0 +1,71 @@
+/*
+ * ImageStream.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Draws images that are too large for flash, e.g. from the SD card, by reading
+ *  them a few rows at a time. The rows go in two buffers in turn: while the rows
+ *  in one buffer are sent to the screen by the SPI DMA, the next rows are read
+ *  into the other one. The whole image is sent with one address window and one
+ *  RAMWR.
+ *
+ *  The image is read through a read function, so that it can come from anywhere
+ *  (FatFs on the target, a file on the PC for the emulator). Supported formats:
+ *   - BMP, 24 bits per pixel uncompressed, or 16 bits per pixel RGB565 (BI_BITFIELDS),
+ *     top-down or bottom-up
+ *   - raw RGB565, rows from the top, each pixel with the most significant byte
+ *     first (the byte order used by the screen), without any header
+ *
+ */
+
+#ifndef IMAGESTREAM_H_
+#define IMAGESTREAM_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+
+// Size of each of the two row buffers in bytes. A row of the image, as stored in
+// the file, must fit in one buffer, e.g. 1440 bytes for 480 pixels at 24 bits.
+// Must be a multiple of 4.
+#ifndef IMAGESTREAM_BUF_BYTES
+#define IMAGESTREAM_BUF_BYTES 2048
+#endif
+
+// Image formats
+#define IMAGESTREAM_RAW565 0 // Raw RGB565, screen byte order
+#define IMAGESTREAM_BMP24  1 // BMP, blue, green and red bytes
+#define IMAGESTREAM_BMP16  2 // BMP, RGB565 with the least significant byte first
+
+// Reads up to ui32Count bytes from ui32Offset in the image into pvBuf. Returns the
+// number of bytes read, which is less than ui32Count only at the end of the image
+// or on errors.
+typedef uint32_t (*tImageStreamRead)(void *pvSource, uint32_t ui32Offset, void *pvBuf,
+                                     uint32_t ui32Count);
+
+typedef struct
+{
+    tImageStreamRead pfnRead;
+    void *pvSource;             // Passed to pfnRead
+    uint8_t ui8Format;
+    uint16_t ui16Width;
+    uint16_t ui16Height;
+    bool bBottomUp;             // The last row comes first in the file, as in most BMPs
+    uint32_t ui32DataOffset;    // Where the pixels start in the file
+    uint32_t ui32Stride;        // Bytes per row in the file
+    uint32_t pui32Buf[2][IMAGESTREAM_BUF_BYTES/4];
+    // Statistics, can be read from the debugger.
+    uint32_t ui32NumReads;      // Calls to pfnRead for pixel data
+    uint32_t ui32NumBytes;      // Bytes of pixel data read
+}
+tImageStream;
+
+/*!
+  @brief  Function declarations
+*/
+bool ImageStream_open(tImageStream *pStream, tImageStreamRead pfnRead, void *pvSource);
+bool ImageStream_openRaw(tImageStream *pStream, tImageStreamRead pfnRead, void *pvSource,
+                         uint16_t ui16Width, uint16_t ui16Height);
+bool ImageStream_draw(tImageStream *pStream, tDisplayData *pDisplayData, int32_t i32X, int32_t i32Y);
+
+#endif /* IMAGESTREAM_H_ */
@@ -0,0 +1,132 @@
+/*
+ * RleImage.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include <string.h>
+#include "RleImage.h"
+
+// Start the next packet.
+static void packetNext(tRleImage *pRle){
+    uint8_t ui8Byte = *pRle->pui8Data++;
+    pRle->ui8Type = ui8Byte & RLEIMAGE_TYPE_M;
+    pRle->ui32Left = (ui8Byte & RLEIMAGE_COUNT_M) + 1;
+    if(pRle->ui8Type == RLEIMAGE_LONG_RUN){
+        pRle->ui32Left = (((ui8Byte & RLEIMAGE_COUNT_M) << 8) | *pRle->pui8Data++) + 1;
+        pRle->ui8Type = RLEIMAGE_RUN;
+    }
+    if(pRle->ui8Type == RLEIMAGE_RUN){
+        // Kept in the byte order of the screen, like the rows
+        memcpy(&pRle->ui16Color, pRle->pui8Data, 2);
+        pRle->pui8Data += 2;
+    }
+    pRle->ui32NumPackets++;
+}
+
+// Send row ui32Row of the row buffers. ui32After counts, for each row buffer, the
+// chunks that have been queued after it, see HX8357_streamWait.
+static void rowSend(tRleImage *pRle, tDisplayData *pDisplayData, uint32_t ui32Row,
+                    uint32_t ui32Width, uint32_t *pui32After){
+    uint32_t ui32Chunks = HX8357_streamWrite(pDisplayData, pRle->pui16Row[ui32Row], 2*ui32Width);
+    pui32After[ui32Row] = 0;
+    pui32After[ui32Row ^ 1] += ui32Chunks;
+}
+
+// Draw the image pui8Image with its top left corner at (i32X, i32Y). The image
+// must fit on the screen. Anything drawn through the display queue must be flushed
+// first, since this writes straight to the screen. Returns false if the image isn't
+// in the format in RleImage.h, or is wider than RLEIMAGE_MAX_WIDTH. A copy packet on
+// the first row is found while drawing, so part of the row may be drawn then.
+bool RleImage_draw(tRleImage *pRle, tDisplayData *pDisplayData, const uint8_t *pui8Image,
+                   int32_t i32X, int32_t i32Y){
+    uint32_t ui32Width = RLEIMAGE_WIDTH(pui8Image);
+    uint32_t ui32Height = RLEIMAGE_HEIGHT(pui8Image);
+    uint32_t ui32Row = 0, ui32Rows, ui32Col, ui32Count, ui32Index;
+    uint32_t pui32After[2] = {0, 0};
+    uint32_t ui32Cur = 0; // Row buffer being decompressed into, the other one has the row above
+    uint16_t *pui16Row;
+    tRectangle sRect;
+
+    if((pui8Image[0] != RLEIMAGE_FORMAT) || (ui32Width == 0) || (ui32Width > RLEIMAGE_MAX_WIDTH) ||
+       (ui32Height == 0)){
+        return false;
+    }
+    pRle->pui8Data = pui8Image + RLEIMAGE_HEADER_SIZE;
+    pRle->ui32Left = 0;
+
+    sRect.i16XMin = i32X;
+    sRect.i16YMin = i32Y;
+    sRect.i16XMax = i32X + ui32Width - 1;
+    sRect.i16YMax = i32Y + ui32Height - 1;
+    HX8357_streamBegin(pDisplayData, &sRect);
+    while(ui32Row < ui32Height){
+        if(pRle->ui32Left == 0){
+            packetNext(pRle);
+        }
+        // Wait until the row buffer has been sent, before it is written again.
+        HX8357_streamWait(pDisplayData, pui32After[ui32Cur]);
+        pui16Row = pRle->pui16Row[ui32Cur];
+
+        if((pRle->ui8Type == RLEIMAGE_RUN) && (pRle->ui32Left >= ui32Width)){
+            // A run covering whole rows: one row of the color, sent for each of them.
+            ui32Rows = pRle->ui32Left/ui32Width;
+            if(ui32Rows > ui32Height - ui32Row){
+                ui32Rows = ui32Height - ui32Row;
+            }
+            for(ui32Col = 0 ; ui32Col < ui32Width ; ui32Col++){
+                pui16Row[ui32Col] = pRle->ui16Color;
+            }
+            for(ui32Index = 0 ; ui32Index < ui32Rows ; ui32Index++){
+                rowSend(pRle, pDisplayData, ui32Cur, ui32Width, pui32After);
+            }
+            pRle->ui32Left -= ui32Rows*ui32Width;
+            pRle->ui32NumRows++;
+            pRle->ui32NumFillRows += ui32Rows - 1;
+            ui32Row += ui32Rows;
+            ui32Cur ^= 1;
+            continue;
+        }
+
+        ui32Col = 0;
+        while(1){
+            ui32Count = ui32Width - ui32Col;
+            if(ui32Count > pRle->ui32Left){
+                ui32Count = pRle->ui32Left;
+            }
+            switch(pRle->ui8Type){
+            case RLEIMAGE_LITERAL:
+                memcpy(&pui16Row[ui32Col], pRle->pui8Data, 2*ui32Count);
+                pRle->pui8Data += 2*ui32Count;
+                break;
+            case RLEIMAGE_RUN:
+                for(ui32Index = 0 ; ui32Index < ui32Count ; ui32Index++){
+                    pui16Row[ui32Col + ui32Index] = pRle->ui16Color;
+                }
+                break;
+            default:
+                // The row above is in the other row buffer. It may still be being
+                // sent, but it is only read. The first row has none, the other
+                // buffer would still hold a row of an earlier image.
+                if(ui32Row == 0){
+                    HX8357_streamEnd(pDisplayData);
+                    return false;
+                }
+                memcpy(&pui16Row[ui32Col], &pRle->pui16Row[ui32Cur ^ 1][ui32Col], 2*ui32Count);
+                break;
+            }
+            ui32Col += ui32Count;
+            pRle->ui32Left -= ui32Count;
+            if(ui32Col == ui32Width){
+                break;
+            }
+            packetNext(pRle);
+        }
+        rowSend(pRle, pDisplayData, ui32Cur, ui32Width, pui32After);
+        pRle->ui32NumRows++;
+        ui32Row++;
+        ui32Cur ^= 1;
+    }
+    HX8357_streamEnd(pDisplayData);
+    return true;
+}
@@ -0,0 +1,79 @@
+/*
+ * RleImage.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Compressed RGB565 images, made on the PC with tools/img2rle, and drawn by
+ *  decompressing straight into one RAMWR. A full screen of RGB565 is 300 kB,
+ *  more than the flash, but screens made of flat colors, gradients and repeated
+ *  rows compress to a few kB.
+ *
+ *  Format: a 5 byte header, the format byte RLEIMAGE_FORMAT followed by the
+ *  width and height, least significant byte first like GRLIB images. Then
+ *  packets, covering the pixels row after row from the top left. A packet can go
+ *  on into the next row. Each packet starts with a byte, where the top two bits
+ *  are the type and the low 6 bits the number of pixels - 1:
+ *   - RLEIMAGE_LITERAL: 1-64 pixels follow, 2 bytes each
+ *   - RLEIMAGE_RUN: 1-64 pixels of the color that follows, 2 bytes
+ *   - RLEIMAGE_COPY: 1-64 pixels that are the same as in the row above
+ *   - RLEIMAGE_LONG_RUN: the low 6 bits and the next byte are the number of
+ *     pixels - 1 (up to 16384), of the color that follows, 2 bytes
+ *  Colors are RGB565 with the most significant byte first, the byte order used
+ *  by the screen.
+ *
+ *  Only two rows are decompressed at a time. While one is sent by the SPI DMA,
+ *  the next is decompressed into the other one. A run that covers whole rows is
+ *  decompressed once, and that row is sent again for each row it covers.
+ *
+ */
+
+#ifndef RLEIMAGE_H_
+#define RLEIMAGE_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+
+// Widest image that can be drawn, in pixels. Each of the two row buffers is this
+// many pixels.
+#ifndef RLEIMAGE_MAX_WIDTH
+#define RLEIMAGE_MAX_WIDTH 480
+#endif
+
+#define RLEIMAGE_FORMAT      0x52 // 'R'
+#define RLEIMAGE_HEADER_SIZE 5
+
+// Packet types, in the top two bits of the first byte
+#define RLEIMAGE_LITERAL  0x00
+#define RLEIMAGE_RUN      0x40
+#define RLEIMAGE_COPY     0x80
+#define RLEIMAGE_LONG_RUN 0xC0
+#define RLEIMAGE_TYPE_M   0xC0
+#define RLEIMAGE_COUNT_M  0x3F
+
+// Size of an image, from its header
+#define RLEIMAGE_WIDTH(pui8Image)  ((pui8Image)[1] | ((pui8Image)[2] << 8))
+#define RLEIMAGE_HEIGHT(pui8Image) ((pui8Image)[3] | ((pui8Image)[4] << 8))
+
+typedef struct
+{
+    uint16_t pui16Row[2][RLEIMAGE_MAX_WIDTH]; // Screen byte order
+    // Decompression state: the next packet, and what is left of the current one
+    const uint8_t *pui8Data;
+    uint8_t ui8Type;
+    uint32_t ui32Left;
+    uint16_t ui16Color;
+    // Statistics, can be read from the debugger.
+    uint32_t ui32NumPackets;    // Packets decompressed
+    uint32_t ui32NumRows;       // Rows decompressed and sent
+    uint32_t ui32NumFillRows;   // Rows sent again for a run covering them, not decompressed
+}
+tRleImage;
+
+/*!
+  @brief  Function declarations
+*/
+bool RleImage_draw(tRleImage *pRle, tDisplayData *pDisplayData, const uint8_t *pui8Image,
+                   int32_t i32X, int32_t i32Y);
+
+#endif /* RLEIMAGE_H_ */
@@ -0,0 +1,457 @@
+/*
+ * Shapes.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include "Shapes.h"
+
+// Larger than any coordinate, for rows that aren't limited on one side
+#define SHAPES_UNLIMITED 0x7FFF
+
+// The spans of the shape being drawn
+typedef struct
+{
+    tDisplayData *pDisplayData;
+    const tRectangle *psClip;
+    uint32_t ui32Color;
+    tRectangle psOpen[SHAPES_OPEN];     // Can still grow by a row up or down
+    uint32_t ui32NumOpen;
+    tRectangle psDone[SHAPES_BATCH];    // Waiting to be filled
+    uint32_t ui32NumDone;
+}
+tSpans;
+
+// sin of 0-90 degrees, times 16384
+static const uint16_t pui16Sine[91] = {
+        0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,  2845,  3126,
+     3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,  5604,  5872,  6138,  6402,
+     6664,  6924,  7182,  7438,  7692,  7943,  8192,  8438,  8682,  8923,  9162,  9397,
+     9630,  9860, 10087, 10311, 10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982,
+    12176, 12365, 12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+    14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296, 15396, 15491,
+    15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083, 16135, 16182, 16225, 16262,
+    16294, 16322, 16344, 16362, 16374, 16382, 16384,
+};
+
+static void spansBegin(tSpans *pSpans, tDisplayData *pDisplayData, const tContext *pContext){
+    pSpans->pDisplayData = pDisplayData;
+    pSpans->psClip = &pContext->sClipRegion;
+    pSpans->ui32Color = pContext->ui32Foreground;
+    pSpans->ui32NumOpen = 0;
+    pSpans->ui32NumDone = 0;
+}
+
+// Move open rectangle ui32Open to the ones waiting to be filled, and fill them if
+// there are SHAPES_BATCH. The last open rectangle takes its place.
+static void rectDone(tSpans *pSpans, uint32_t ui32Open){
+    pSpans->psDone[pSpans->ui32NumDone++] = pSpans->psOpen[ui32Open];
+    pSpans->psOpen[ui32Open] = pSpans->psOpen[--pSpans->ui32NumOpen];
+    if(pSpans->ui32NumDone == SHAPES_BATCH){
+        HX8357_rectsFill(pSpans->pDisplayData, pSpans->psDone, pSpans->ui32NumDone, pSpans->ui32Color);
+        pSpans->ui32NumDone = 0;
+    }
+}
+
+// Add the span from i32X1 to i32X2 on row i32Y. Spans must come row after row, up
+// or down, but a row can have several.
+static void spanAdd(tSpans *pSpans, int32_t i32Y, int32_t i32X1, int32_t i32X2){
+    const tRectangle *psClip = pSpans->psClip;
+    tRectangle *psRect;
+    uint32_t ui32Index = 0;
+
+    if(i32X1 < psClip->i16XMin){
+        i32X1 = psClip->i16XMin;
+    }
+    if(i32X2 > psClip->i16XMax){
+        i32X2 = psClip->i16XMax;
+    }
+    if((i32X1 > i32X2) || (i32Y < psClip->i16YMin) || (i32Y > psClip->i16YMax)){
+        return;
+    }
+    while(ui32Index < pSpans->ui32NumOpen){
+        psRect = &pSpans->psOpen[ui32Index];
+        if((psRect->i16XMin == i32X1) && (psRect->i16XMax == i32X2)){
+            if(psRect->i16YMax == i32Y - 1){
+                psRect->i16YMax = i32Y;
+                return;
+            }
+            if(psRect->i16YMin == i32Y + 1){
+                psRect->i16YMin = i32Y;
+                return;
+            }
+        }
+        // The rows have moved on from this one, so it won't grow any more.
+        if((psRect->i16YMax < i32Y - 1) || (psRect->i16YMin > i32Y + 1)){
+            rectDone(pSpans, ui32Index);
+            continue;
+        }
+        ui32Index++;
+    }
+    if(pSpans->ui32NumOpen == SHAPES_OPEN){
+        rectDone(pSpans, 0);
+    }
+    psRect = &pSpans->psOpen[pSpans->ui32NumOpen++];
+    psRect->i16XMin = i32X1;
+    psRect->i16XMax = i32X2;
+    psRect->i16YMin = i32Y;
+    psRect->i16YMax = i32Y;
+}
+
+static void spansEnd(tSpans *pSpans){
+    while(pSpans->ui32NumOpen > 0){
+        rectDone(pSpans, 0);
+    }
+    HX8357_rectsFill(pSpans->pDisplayData, pSpans->psDone, pSpans->ui32NumDone, pSpans->ui32Color);
+}
+
+// Half the width of each row of a filled circle of radius i32Radius, from the middle
+// row out, worked out the same way as GrCircleFill does. -1 for rows it leaves out.
+static void circleRows(int32_t i32Radius, int16_t *pi16Half){
+    int32_t i32A, i32B = i32Radius, i32D = 3 - 2*i32Radius;
+
+    for(i32A = 0 ; i32A <= i32Radius ; i32A++){
+        pi16Half[i32A] = -1;
+    }
+    for(i32A = 0 ; i32A <= i32B ; i32A++){
+        if(pi16Half[i32A] < i32B){
+            pi16Half[i32A] = i32B;
+        }
+        if((i32D >= 0) && (i32A != i32B)){
+            if(pi16Half[i32B] < i32A){
+                pi16Half[i32B] = i32A;
+            }
+            i32D += 4*(i32A - i32B) + 10;
+            i32B--;
+        }
+        else {
+            i32D += 4*i32A + 6;
+        }
+    }
+}
+
+static int32_t radiusLimit(int32_t i32Radius){
+    return i32Radius > SHAPES_MAX_RADIUS ? SHAPES_MAX_RADIUS : i32Radius;
+}
+
+// Fill a circle, the same as GrCircleFill.
+void Shapes_circleFill(tDisplayData *pDisplayData, const tContext *pContext, int32_t i32X,
+                       int32_t i32Y, int32_t i32Radius){
+    int16_t pi16Half[SHAPES_MAX_RADIUS + 1];
+    int32_t i32Row, i32Dy;
+    tSpans sSpans;
+
+    i32Radius = radiusLimit(i32Radius);
+    if(i32Radius < 0){
+        return;
+    }
+    circleRows(i32Radius, pi16Half);
+    spansBegin(&sSpans, pDisplayData, pContext);
+    for(i32Row = i32Y - i32Radius ; i32Row <= i32Y + i32Radius ; i32Row++){
+        i32Dy = i32Row < i32Y ? i32Y - i32Row : i32Row - i32Y;
+        if(pi16Half[i32Dy] >= 0){
+            spanAdd(&sSpans, i32Row, i32X - pi16Half[i32Dy], i32X + pi16Half[i32Dy]);
+        }
+    }
+    spansEnd(&sSpans);
+}
+
+// Fill a rectangle with rounded corners of radius i32Radius. The same as filling the
+// rectangle without the corners with GrRectFill, and the corners with GrCircleFill.
+void Shapes_roundRectFill(tDisplayData *pDisplayData, const tContext *pContext,
+                          const tRectangle *psRect, int32_t i32Radius){
+    int16_t pi16Half[SHAPES_MAX_RADIUS + 1];
+    int32_t i32Row, i32Dy, i32Half;
+    tSpans sSpans;
+
+    // The corners can't be larger than half the rectangle.
+    if(i32Radius > (psRect->i16XMax - psRect->i16XMin)/2){
+        i32Radius = (psRect->i16XMax - psRect->i16XMin)/2;
+    }
+    if(i32Radius > (psRect->i16YMax - psRect->i16YMin)/2){
+        i32Radius = (psRect->i16YMax - psRect->i16YMin)/2;
+    }
+    i32Radius = radiusLimit(i32Radius);
+    if(i32Radius < 0){
+        return;
+    }
+    circleRows(i32Radius, pi16Half);
+    spansBegin(&sSpans, pDisplayData, pContext);
+    for(i32Row = psRect->i16YMin ; i32Row <= psRect->i16YMax ; i32Row++){
+        i32Dy = 0;
+        if(i32Row < psRect->i16YMin + i32Radius){
+            i32Dy = psRect->i16YMin + i32Radius - i32Row;
+        }
+        else if(i32Row > psRect->i16YMax - i32Radius){
+            i32Dy = i32Row - (psRect->i16YMax - i32Radius);
+        }
+        i32Half = pi16Half[i32Dy] < 0 ? 0 : pi16Half[i32Dy];
+        spanAdd(&sSpans, i32Row, psRect->i16XMin + i32Radius - i32Half,
+                psRect->i16XMax - i32Radius + i32Half);
+    }
+    spansEnd(&sSpans);
+}
+
+// sin of i32Angle degrees, times 16384
+static int32_t sinGet(int32_t i32Angle){
+    i32Angle %= 360;
+    if(i32Angle < 0){
+        i32Angle += 360;
+    }
+    if(i32Angle <= 90){
+        return pui16Sine[i32Angle];
+    }
+    if(i32Angle <= 180){
+        return pui16Sine[180 - i32Angle];
+    }
+    if(i32Angle <= 270){
+        return -pui16Sine[i32Angle - 180];
+    }
+    return -pui16Sine[360 - i32Angle];
+}
+
+// Rounds down, unlike /. i32D must be positive.
+static int32_t divFloor(int32_t i32N, int32_t i32D){
+    return i32N >= 0 ? i32N/i32D : -((-i32N + i32D - 1)/i32D);
+}
+
+// Limit [*pi32Lo, *pi32Hi] to the x where i32A*x <= i32B.
+static void rowLimit(int32_t i32A, int32_t i32B, int32_t *pi32Lo, int32_t *pi32Hi){
+    int32_t i32Limit;
+    if(i32A > 0){
+        i32Limit = divFloor(i32B, i32A);
+        if(i32Limit < *pi32Hi){
+            *pi32Hi = i32Limit;
+        }
+    }
+    else if(i32A < 0){
+        i32Limit = -divFloor(i32B, -i32A);
+        if(i32Limit > *pi32Lo){
+            *pi32Lo = i32Limit;
+        }
+    }
+    else if(i32B < 0){
+        *pi32Lo = 1;
+        *pi32Hi = 0;
+    }
+}
+
+// Add the part of the span from i32X + i32X1 to i32X + i32X2 that is inside
+// [i32Lo, i32Hi] (relative to i32X), or outside of it if bOutside.
+static void spanAddLimited(tSpans *pSpans, int32_t i32Y, int32_t i32X, int32_t i32X1, int32_t i32X2,
+                           int32_t i32Lo, int32_t i32Hi, bool bOutside){
+    if(!bOutside){
+        spanAdd(pSpans, i32Y, i32X + (i32X1 > i32Lo ? i32X1 : i32Lo), i32X + (i32X2 < i32Hi ? i32X2 : i32Hi));
+    }
+    else if(i32Lo > i32Hi){
+        spanAdd(pSpans, i32Y, i32X + i32X1, i32X + i32X2);
+    }
+    else {
+        spanAdd(pSpans, i32Y, i32X + i32X1, i32X + (i32X2 < i32Lo - 1 ? i32X2 : i32Lo - 1));
+        spanAdd(pSpans, i32Y, i32X + (i32X1 > i32Hi + 1 ? i32X1 : i32Hi + 1), i32X + i32X2);
+    }
+}
+
+// Fill the part of a ring from i32Start to i32End degrees. 0 degrees is to the right,
+// and the angle goes clockwise, as seen on the screen. The ring is i32Width pixels
+// wide, inside the circle of radius i32Radius, i.e. the pixels of
+// Shapes_circleFill(i32Radius) that aren't in Shapes_circleFill(i32Radius - i32Width).
+// With i32Width > i32Radius there is no hole, and the arc is a slice of the circle.
+void Shapes_arcFill(tDisplayData *pDisplayData, const tContext *pContext, int32_t i32X,
+                    int32_t i32Y, int32_t i32Radius, int32_t i32Width, int32_t i32Start,
+                    int32_t i32End){
+    int16_t pi16Outer[SHAPES_MAX_RADIUS + 1], pi16Inner[SHAPES_MAX_RADIUS + 1];
+    int32_t i32Inner, i32Sweep, i32Row, i32Dy, i32AbsDy, i32Lo, i32Hi;
+    int32_t i32StartX, i32StartY, i32EndX, i32EndY;
+    bool bOutside;
+    tSpans sSpans;
+
+    i32Radius = radiusLimit(i32Radius);
+    i32Inner = i32Radius - i32Width;
+    i32Sweep = i32End - i32Start;
+    if((i32Radius < 0) || (i32Width <= 0) || (i32Sweep <= 0)){
+        return;
+    }
+    circleRows(i32Radius, pi16Outer);
+    if(i32Inner >= 0){
+        circleRows(i32Inner, pi16Inner);
+    }
+    // A pixel is in a slice of at most 180 degrees if it is clockwise of the start and
+    // counterclockwise of the end. A larger slice is everything outside of the rest.
+    bOutside = i32Sweep > 180;
+    if(bOutside){
+        i32Start = i32End;
+        i32End = i32Start + 360 - i32Sweep;
+    }
+    i32StartX = sinGet(i32Start + 90);
+    i32StartY = sinGet(i32Start);
+    i32EndX = sinGet(i32End + 90);
+    i32EndY = sinGet(i32End);
+
+    spansBegin(&sSpans, pDisplayData, pContext);
+    for(i32Row = i32Y - i32Radius ; i32Row <= i32Y + i32Radius ; i32Row++){
+        i32Dy = i32Row - i32Y;
+        i32AbsDy = i32Dy < 0 ? -i32Dy : i32Dy;
+        if(pi16Outer[i32AbsDy] < 0){
+            continue;
+        }
+        if(i32Sweep >= 360){
+            // The whole ring: nothing to leave out
+            i32Lo = 1;
+            i32Hi = 0;
+        }
+        else {
+            i32Lo = -SHAPES_UNLIMITED;
+            i32Hi = SHAPES_UNLIMITED;
+            rowLimit(i32StartY, i32StartX*i32Dy, &i32Lo, &i32Hi);
+            rowLimit(-i32EndY, -i32EndX*i32Dy, &i32Lo, &i32Hi);
+        }
+        if((i32Inner >= 0) && (i32AbsDy <= i32Inner) && (pi16Inner[i32AbsDy] >= 0)){
+            spanAddLimited(&sSpans, i32Row, i32X, -pi16Outer[i32AbsDy], -pi16Inner[i32AbsDy] - 1,
+                           i32Lo, i32Hi, bOutside || (i32Sweep >= 360));
+            spanAddLimited(&sSpans, i32Row, i32X, pi16Inner[i32AbsDy] + 1, pi16Outer[i32AbsDy],
+                           i32Lo, i32Hi, bOutside || (i32Sweep >= 360));
+        }
+        else {
+            spanAddLimited(&sSpans, i32Row, i32X, -pi16Outer[i32AbsDy], pi16Outer[i32AbsDy],
+                           i32Lo, i32Hi, bOutside || (i32Sweep >= 360));
+        }
+    }
+    spansEnd(&sSpans);
+}
+
+// Square root, rounded down
+static uint32_t sqrtGet(uint64_t ui64Value){
+    uint64_t ui64Root = 0, ui64Bit = 1ULL << 62;
+    while(ui64Bit > ui64Value){
+        ui64Bit >>= 2;
+    }
+    while(ui64Bit != 0){
+        if(ui64Value >= ui64Root + ui64Bit){
+            ui64Value -= ui64Root + ui64Bit;
+            ui64Root = (ui64Root >> 1) + ui64Bit;
+        }
+        else {
+            ui64Root >>= 1;
+        }
+        ui64Bit >>= 2;
+    }
+    return ui64Root;
+}
+
+// A one pixel wide line, the same pixels as GrLineDraw. Each run of pixels on a row
+// is one span.
+static void lineThin(tSpans *pSpans, int32_t i32X1, int32_t i32Y1, int32_t i32X2, int32_t i32Y2){
+    int32_t i32DeltaX, i32DeltaY, i32Error, i32YStep, i32Swap, i32RunStart;
+    bool bSteep;
+
+    bSteep = (i32Y2 > i32Y1 ? i32Y2 - i32Y1 : i32Y1 - i32Y2) > (i32X2 > i32X1 ? i32X2 - i32X1 : i32X1 - i32X2);
+    if(bSteep){
+        i32Swap = i32X1; i32X1 = i32Y1; i32Y1 = i32Swap;
+        i32Swap = i32X2; i32X2 = i32Y2; i32Y2 = i32Swap;
+    }
+    if(i32X1 > i32X2){
+        i32Swap = i32X1; i32X1 = i32X2; i32X2 = i32Swap;
+        i32Swap = i32Y1; i32Y1 = i32Y2; i32Y2 = i32Swap;
+    }
+    i32DeltaX = i32X2 - i32X1;
+    i32DeltaY = i32Y2 > i32Y1 ? i32Y2 - i32Y1 : i32Y1 - i32Y2;
+    i32Error = -i32DeltaX/2;
+    i32YStep = i32Y1 < i32Y2 ? 1 : -1;
+    for(i32RunStart = i32X1 ; i32X1 <= i32X2 ; i32X1++){
+        i32Error += i32DeltaY;
+        if(bSteep){
+            spanAdd(pSpans, i32X1, i32Y1, i32Y1);
+        }
+        else if((i32Error > 0) || (i32X1 == i32X2)){
+            // The line moves to the next row after this pixel.
+            spanAdd(pSpans, i32Y1, i32RunStart, i32X1);
+            i32RunStart = i32X1 + 1;
+        }
+        if(i32Error > 0){
+            i32Y1 += i32YStep;
+            i32Error -= i32DeltaX;
+        }
+    }
+}
+
+// Fill the convex polygon with the four corners in pi32X/pi32Y, in 1/256 pixels, with
+// the middle of pixel (x, y) at (256x, 256y). Every pixel with its middle inside or
+// on the edge is filled.
+static void quadFill(tSpans *pSpans, const int32_t *pi32X, const int32_t *pi32Y){
+    int32_t i32Top = pi32Y[0], i32Bottom = pi32Y[0], i32Row, i32RowY, i32Left, i32Right, i32Cross;
+    uint32_t ui32Index, ui32Next;
+
+    for(ui32Index = 1 ; ui32Index < 4 ; ui32Index++){
+        if(pi32Y[ui32Index] < i32Top){
+            i32Top = pi32Y[ui32Index];
+        }
+        if(pi32Y[ui32Index] > i32Bottom){
+            i32Bottom = pi32Y[ui32Index];
+        }
+    }
+    for(i32Row = -divFloor(-i32Top, 256) ; i32Row <= divFloor(i32Bottom, 256) ; i32Row++){
+        i32RowY = 256*i32Row;
+        i32Left = SHAPES_UNLIMITED*256;
+        i32Right = -SHAPES_UNLIMITED*256;
+        for(ui32Index = 0 ; ui32Index < 4 ; ui32Index++){
+            ui32Next = (ui32Index + 1) & 3;
+            if((pi32Y[ui32Index] == pi32Y[ui32Next]) ||
+               (i32RowY < (pi32Y[ui32Index] < pi32Y[ui32Next] ? pi32Y[ui32Index] : pi32Y[ui32Next])) ||
+               (i32RowY > (pi32Y[ui32Index] > pi32Y[ui32Next] ? pi32Y[ui32Index] : pi32Y[ui32Next]))){
+                continue;
+            }
+            // Where the edge crosses the row
+            i32Cross = pi32X[ui32Index] + (int32_t)((int64_t)(i32RowY - pi32Y[ui32Index])*
+                       (pi32X[ui32Next] - pi32X[ui32Index])/(pi32Y[ui32Next] - pi32Y[ui32Index]));
+            if(i32Cross < i32Left){
+                i32Left = i32Cross;
+            }
+            if(i32Cross > i32Right){
+                i32Right = i32Cross;
+            }
+        }
+        if(i32Left <= i32Right){
+            spanAdd(pSpans, i32Row, -divFloor(-i32Left, 256), divFloor(i32Right, 256));
+        }
+    }
+}
+
+// Draw a line ui32Width pixels wide, with square ends at the end points. Lines one
+// pixel wide are the same as with GrLineDraw.
+void Shapes_lineDraw(tDisplayData *pDisplayData, const tContext *pContext, int32_t i32X1,
+                     int32_t i32Y1, int32_t i32X2, int32_t i32Y2, uint32_t ui32Width){
+    int32_t pi32X[4], pi32Y[4];
+    int32_t i32Dx = i32X2 - i32X1, i32Dy = i32Y2 - i32Y1, i32OffsetX, i32OffsetY;
+    uint32_t ui32Length;
+    tSpans sSpans;
+
+    if(ui32Width <= 1){
+        spansBegin(&sSpans, pDisplayData, pContext);
+        lineThin(&sSpans, i32X1, i32Y1, i32X2, i32Y2);
+        spansEnd(&sSpans);
+        return;
+    }
+    if((i32Dx == 0) && (i32Dy == 0)){
+        Shapes_circleFill(pDisplayData, pContext, i32X1, i32Y1, ui32Width/2);
+        return;
+    }
+    if(ui32Width > 2*SHAPES_MAX_RADIUS){
+        ui32Width = 2*SHAPES_MAX_RADIUS;
+    }
+    // Length in 1/64 pixels, and half the width across the line in 1/256 pixels
+    ui32Length = sqrtGet(((int64_t)i32Dx*i32Dx + (int64_t)i32Dy*i32Dy)*4096);
+    i32OffsetX = -(int64_t)i32Dy*ui32Width*8192/(int64_t)ui32Length;
+    i32OffsetY = (int64_t)i32Dx*ui32Width*8192/(int64_t)ui32Length;
+    pi32X[0] = 256*i32X1 + i32OffsetX;
+    pi32Y[0] = 256*i32Y1 + i32OffsetY;
+    pi32X[1] = 256*i32X2 + i32OffsetX;
+    pi32Y[1] = 256*i32Y2 + i32OffsetY;
+    pi32X[2] = 256*i32X2 - i32OffsetX;
+    pi32Y[2] = 256*i32Y2 - i32OffsetY;
+    pi32X[3] = 256*i32X1 - i32OffsetX;
+    pi32Y[3] = 256*i32Y1 - i32OffsetY;
+    spansBegin(&sSpans, pDisplayData, pContext);
+    quadFill(&sSpans, pi32X, pi32Y);
+    spansEnd(&sSpans);
+}
@@ -0,0 +1,59 @@
+/*
+ * Shapes.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Filled circles, arcs, lines of any width and rounded rectangles, drawn as
+ *  horizontal spans. GRLIB draws a filled circle with one LineDrawH per row and
+ *  a sloped line with one PixelDraw per pixel, each with its own CS session and
+ *  address window. Here the spans of a shape are collected first: spans on
+ *  consecutive rows with the same columns become one rectangle, and the
+ *  rectangles are filled with HX8357_rectsFill, many at a time with CS low once.
+ *
+ *  Circles and rounded rectangles come out the same as with GrCircleFill and
+ *  GrRectFill/GrCircleFill, and so do one pixel wide lines inside the clip region
+ *  (GrLineDraw moves the end points of a line that crosses it).
+ *
+ *  The color is the foreground of the context, and the shapes are clipped to
+ *  its clip region. Everything is drawn straight to the screen through
+ *  pDisplayData, so anything drawn through the display queue or the frame
+ *  buffer must be flushed first.
+ *
+ */
+
+#ifndef SHAPES_H_
+#define SHAPES_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+
+// Largest radius of circles, arcs and rounded corners. Larger radii are cut down
+// to this. The width of each row is worked out first, 2 bytes per row on the stack.
+#ifndef SHAPES_MAX_RADIUS
+#define SHAPES_MAX_RADIUS 240
+#endif
+
+// Rectangles that are still growing by a row, and finished rectangles waiting to be
+// filled, kept on the stack while a shape is drawn.
+#ifndef SHAPES_OPEN
+#define SHAPES_OPEN 4
+#endif
+#ifndef SHAPES_BATCH
+#define SHAPES_BATCH 16
+#endif
+
+/*!
+  @brief  Function declarations
+*/
+void Shapes_circleFill(tDisplayData *pDisplayData, const tContext *pContext, int32_t i32X,
+                       int32_t i32Y, int32_t i32Radius);
+void Shapes_arcFill(tDisplayData *pDisplayData, const tContext *pContext, int32_t i32X,
+                    int32_t i32Y, int32_t i32Radius, int32_t i32Width, int32_t i32Start,
+                    int32_t i32End);
+void Shapes_lineDraw(tDisplayData *pDisplayData, const tContext *pContext, int32_t i32X1,
+                     int32_t i32Y1, int32_t i32X2, int32_t i32Y2, uint32_t ui32Width);
+void Shapes_roundRectFill(tDisplayData *pDisplayData, const tContext *pContext,
+                          const tRectangle *psRect, int32_t i32Radius);
+
+#endif /* SHAPES_H_ */
@@ -0,0 +1,295 @@
+/*
+ * Sprites.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include <string.h>
+#include "Sprites.h"
+
+static bool rectsOverlap(const tRectangle *psA, const tRectangle *psB){
+    return (psA->i16XMin <= psB->i16XMax) && (psB->i16XMin <= psA->i16XMax) &&
+           (psA->i16YMin <= psB->i16YMax) && (psB->i16YMin <= psA->i16YMax);
+}
+
+static void boundsGet(const tSprite *psSprite, tRectangle *psRect){
+    psRect->i16XMin = psSprite->i16X;
+    psRect->i16YMin = psSprite->i16Y;
+    psRect->i16XMax = psSprite->i16X + psSprite->ui16Width - 1;
+    psRect->i16YMax = psSprite->i16Y + psSprite->ui16Height - 1;
+}
+
+// i32Value modulo ui32Size, also for negative values
+static uint32_t modGet(int32_t i32Value, uint32_t ui32Size){
+    int32_t i32Mod = i32Value % (int32_t)ui32Size;
+    return (uint32_t)(i32Mod < 0 ? i32Mod + (int32_t)ui32Size : i32Mod);
+}
+
+// Initialize the sprites, all hidden, on a screen of ui16Width x ui16Height with
+// ui32Background (a translated color) behind them. Nothing is drawn, the screen must
+// already show the background.
+void Sprites_init(tSprites *pSprites, tDisplayData *pDisplayData, uint16_t ui16Width,
+                  uint16_t ui16Height, uint32_t ui32Background){
+    pSprites->pDisplayData = pDisplayData;
+    pSprites->ui16Width = ui16Width;
+    pSprites->ui16Height = ui16Height;
+    pSprites->ui32Background = ui32Background;
+    pSprites->pfnBackground = NULL;
+    pSprites->pvBackgroundArg = NULL;
+    memset(pSprites->psSprites, 0, sizeof(pSprites->psSprites));
+    pSprites->ui32NumMoves = 0;
+    pSprites->ui32NumPixels = 0;
+    pSprites->ui32NumBackground = 0;
+    pSprites->ui32NumRestored = 0;
+}
+
+// Make the background with pfnBackground instead of the color, NULL to go back to the
+// color. It isn't drawn, so this should be done before any sprite is shown, or with
+// the screen already showing the new background.
+void Sprites_backgroundSet(tSprites *pSprites, tSpritesBackgroundFxn pfnBackground, void *pvArg){
+    pSprites->pfnBackground = pfnBackground;
+    pSprites->pvBackgroundArg = pvArg;
+}
+
+static void backgroundGet(tSprites *pSprites, int32_t i32X, int32_t i32Y, uint32_t ui32Count,
+                          uint16_t *pui16Pixels){
+    if(pSprites->pfnBackground != NULL){
+        pSprites->pfnBackground(pSprites->pvBackgroundArg, i32X, i32Y, ui32Count, pui16Pixels);
+    }
+    else {
+        HX8357_fillColor(pui16Pixels, pSprites->ui32Background, ui32Count);
+    }
+    pSprites->ui32NumBackground += ui32Count;
+}
+
+// Copy ui32Count pixels of the save-under, from screen pixel (i32X, i32Y) to the
+// right, to pui16Pixels, or the other way if bSave. The pixels must be inside the
+// sprite, so the row wraps around at most once.
+static void saveUnderCopy(tSprite *psSprite, int32_t i32X, int32_t i32Y, uint32_t ui32Count,
+                          uint16_t *pui16Pixels, bool bSave){
+    uint16_t *pui16Row = &psSprite->pui16SaveUnder[modGet(i32Y, psSprite->ui16Height)*psSprite->ui16Width];
+    uint32_t ui32Col = modGet(i32X, psSprite->ui16Width);
+    uint32_t ui32Part;
+
+    while(ui32Count > 0){
+        ui32Part = psSprite->ui16Width - ui32Col;
+        if(ui32Part > ui32Count){
+            ui32Part = ui32Count;
+        }
+        if(bSave){
+            memcpy(&pui16Row[ui32Col], pui16Pixels, 2*ui32Part);
+        }
+        else {
+            memcpy(pui16Pixels, &pui16Row[ui32Col], 2*ui32Part);
+        }
+        pui16Pixels += ui32Part;
+        ui32Count -= ui32Part;
+        ui32Col = 0;
+    }
+}
+
+// The background of row i32Y from i32X1 to i32X2. The part inside psOld, where
+// psSprite was, comes from its save-under if it has one.
+static void rowBackground(tSprites *pSprites, tSprite *psSprite, const tRectangle *psOld,
+                          int32_t i32Y, int32_t i32X1, int32_t i32X2, uint16_t *pui16Row){
+    int32_t i32From = i32X2 + 1, i32To = i32X2;
+
+    if((psOld != NULL) && (psSprite->pui16SaveUnder != NULL) &&
+       (i32Y >= psOld->i16YMin) && (i32Y <= psOld->i16YMax)){
+        i32From = psOld->i16XMin > i32X1 ? psOld->i16XMin : i32X1;
+        i32To = psOld->i16XMax < i32X2 ? psOld->i16XMax : i32X2;
+    }
+    if(i32From > i32To){
+        backgroundGet(pSprites, i32X1, i32Y, i32X2 - i32X1 + 1, pui16Row);
+        return;
+    }
+    if(i32From > i32X1){
+        backgroundGet(pSprites, i32X1, i32Y, i32From - i32X1, pui16Row);
+    }
+    saveUnderCopy(psSprite, i32From, i32Y, i32To - i32From + 1, &pui16Row[i32From - i32X1], false);
+    pSprites->ui32NumRestored += i32To - i32From + 1;
+    if(i32To < i32X2){
+        backgroundGet(pSprites, i32To + 1, i32Y, i32X2 - i32To, &pui16Row[i32To + 1 - i32X1]);
+    }
+}
+
+// Save the background of row i32Y inside psNew, from pui16Row which starts at i32X1
+// and ends at i32X2.
+static void rowSave(tSprite *psSprite, const tRectangle *psNew, int32_t i32Y, int32_t i32X1,
+                    int32_t i32X2, uint16_t *pui16Row){
+    int32_t i32From = psNew->i16XMin > i32X1 ? psNew->i16XMin : i32X1;
+    int32_t i32To = psNew->i16XMax < i32X2 ? psNew->i16XMax : i32X2;
+
+    if((psSprite->pui16SaveUnder == NULL) || (i32Y < psNew->i16YMin) || (i32Y > psNew->i16YMax) ||
+       (i32From > i32To)){
+        return;
+    }
+    saveUnderCopy(psSprite, i32From, i32Y, i32To - i32From + 1, &pui16Row[i32From - i32X1], true);
+}
+
+// Draw the visible sprites on row i32Y, from i32X1 to i32X2, in ID order.
+static void rowSprites(tSprites *pSprites, int32_t i32Y, int32_t i32X1, int32_t i32X2,
+                       uint16_t *pui16Row){
+    const tSprite *psSprite;
+    const uint16_t *pui16Bitmap;
+    int32_t i32From, i32To, i32X;
+    uint32_t ui32Id;
+    uint16_t ui16Color;
+
+    for(ui32Id = 0 ; ui32Id < SPRITES_COUNT ; ui32Id++){
+        psSprite = &pSprites->psSprites[ui32Id];
+        if(!psSprite->bVisible || (i32Y < psSprite->i16Y) || (i32Y >= psSprite->i16Y + psSprite->ui16Height)){
+            continue;
+        }
+        i32From = psSprite->i16X > i32X1 ? psSprite->i16X : i32X1;
+        i32To = psSprite->i16X + psSprite->ui16Width - 1;
+        if(i32To > i32X2){
+            i32To = i32X2;
+        }
+        pui16Bitmap = &psSprite->pui16Bitmap[(i32Y - psSprite->i16Y)*psSprite->ui16Width];
+        for(i32X = i32From ; i32X <= i32To ; i32X++){
+            ui16Color = pui16Bitmap[i32X - psSprite->i16X];
+            if(ui16Color != psSprite->ui16Key){
+                pui16Row[i32X - i32X1] = HX8357_SWAP16(ui16Color);
+            }
+        }
+    }
+}
+
+// Put psRect together row by row and send it as one RAMWR. psSprite has moved from
+// psOld to psNew, either of which can be NULL, and its position is already the new
+// one: the background it leaves is taken from its save-under, and the background it
+// moves onto is saved there.
+static void rectDraw(tSprites *pSprites, const tRectangle *psRect, tSprite *psSprite,
+                     const tRectangle *psOld, const tRectangle *psNew){
+    tDisplayData *pDisplayData = pSprites->pDisplayData;
+    tRectangle sRect = *psRect;
+    uint32_t pui32After[2] = {0, 0};
+    uint32_t ui32Cur = 0, ui32Chunks;
+    int32_t i32Y, i32Width;
+    bool bDefer;
+
+    if(sRect.i16XMin < 0){
+        sRect.i16XMin = 0;
+    }
+    if(sRect.i16YMin < 0){
+        sRect.i16YMin = 0;
+    }
+    if(sRect.i16XMax > pSprites->ui16Width - 1){
+        sRect.i16XMax = pSprites->ui16Width - 1;
+    }
+    if(sRect.i16YMax > pSprites->ui16Height - 1){
+        sRect.i16YMax = pSprites->ui16Height - 1;
+    }
+    if((sRect.i16XMin > sRect.i16XMax) || (sRect.i16YMin > sRect.i16YMax)){
+        return;
+    }
+    i32Width = sRect.i16XMax - sRect.i16XMin + 1;
+    // The save-under is kept by screen position modulo the size of the sprite. When
+    // the sprite moves up, the rows it moves onto share save-under rows with the rows
+    // it leaves at the bottom, which are only restored further down. They are saved
+    // when everything has been restored.
+    bDefer = (psOld != NULL) && (psNew != NULL) && (psNew->i16YMin < psOld->i16YMin);
+
+    HX8357_streamBegin(pDisplayData, &sRect);
+    for(i32Y = sRect.i16YMin ; i32Y <= sRect.i16YMax ; i32Y++){
+        // Wait until the row buffer has been sent, before it is written again.
+        HX8357_streamWait(pDisplayData, pui32After[ui32Cur]);
+        rowBackground(pSprites, psSprite, psOld, i32Y, sRect.i16XMin, sRect.i16XMax,
+                      pSprites->pui16Row[ui32Cur]);
+        if((psNew != NULL) && !(bDefer && (i32Y < psOld->i16YMin))){
+            rowSave(psSprite, psNew, i32Y, sRect.i16XMin, sRect.i16XMax, pSprites->pui16Row[ui32Cur]);
+        }
+        rowSprites(pSprites, i32Y, sRect.i16XMin, sRect.i16XMax, pSprites->pui16Row[ui32Cur]);
+        ui32Chunks = HX8357_streamWrite(pDisplayData, pSprites->pui16Row[ui32Cur], 2*i32Width);
+        pui32After[ui32Cur] = 0;
+        pui32After[ui32Cur ^ 1] += ui32Chunks;
+        ui32Cur ^= 1;
+    }
+    HX8357_streamEnd(pDisplayData);
+    pSprites->ui32NumPixels += i32Width*(sRect.i16YMax - sRect.i16YMin + 1);
+
+    if(bDefer && (psSprite->pui16SaveUnder != NULL)){
+        for(i32Y = sRect.i16YMin ; (i32Y < psOld->i16YMin) && (i32Y <= sRect.i16YMax) ; i32Y++){
+            rowBackground(pSprites, psSprite, NULL, i32Y, sRect.i16XMin, sRect.i16XMax, pSprites->pui16Row[0]);
+            rowSave(psSprite, psNew, i32Y, sRect.i16XMin, sRect.i16XMax, pSprites->pui16Row[0]);
+        }
+    }
+}
+
+// Set sprite ui16Id to pui16Bitmap, ui16Width x ui16Height RGB565 pixels where the
+// color ui16Key isn't drawn. pui16SaveUnder is ui16Width*ui16Height pixels, or NULL.
+// The sprite is hidden first if it is visible, and is shown by Sprites_move. Returns
+// false if the sprite is wider than SPRITES_MAX_WIDTH.
+bool Sprites_set(tSprites *pSprites, uint16_t ui16Id, const uint16_t *pui16Bitmap,
+                 uint16_t ui16Width, uint16_t ui16Height, uint16_t ui16Key,
+                 uint16_t *pui16SaveUnder){
+    tSprite *psSprite;
+
+    if((ui16Id >= SPRITES_COUNT) || (ui16Width == 0) || (ui16Width > SPRITES_MAX_WIDTH) ||
+       (ui16Height == 0)){
+        return false;
+    }
+    Sprites_hide(pSprites, ui16Id);
+    psSprite = &pSprites->psSprites[ui16Id];
+    psSprite->pui16Bitmap = pui16Bitmap;
+    psSprite->ui16Width = ui16Width;
+    psSprite->ui16Height = ui16Height;
+    psSprite->ui16Key = ui16Key;
+    psSprite->pui16SaveUnder = pui16SaveUnder;
+    return true;
+}
+
+// Move sprite ui16Id so that its top left corner is at (i16X, i16Y), and show it if
+// it is hidden. It can be partly outside of the screen.
+void Sprites_move(tSprites *pSprites, uint16_t ui16Id, int16_t i16X, int16_t i16Y){
+    tSprite *psSprite;
+    tRectangle sOld, sNew, sUnion;
+    bool bWasVisible;
+
+    if((ui16Id >= SPRITES_COUNT) || (pSprites->psSprites[ui16Id].pui16Bitmap == NULL)){
+        return;
+    }
+    psSprite = &pSprites->psSprites[ui16Id];
+    bWasVisible = psSprite->bVisible;
+    if(bWasVisible && (psSprite->i16X == i16X) && (psSprite->i16Y == i16Y)){
+        return;
+    }
+    boundsGet(psSprite, &sOld);
+    psSprite->i16X = i16X;
+    psSprite->i16Y = i16Y;
+    psSprite->bVisible = true;
+    boundsGet(psSprite, &sNew);
+
+    if(!bWasVisible){
+        rectDraw(pSprites, &sNew, psSprite, NULL, &sNew);
+    }
+    else if(rectsOverlap(&sOld, &sNew)){
+        // One RAMWR for the rectangle around both positions
+        sUnion.i16XMin = sOld.i16XMin < sNew.i16XMin ? sOld.i16XMin : sNew.i16XMin;
+        sUnion.i16YMin = sOld.i16YMin < sNew.i16YMin ? sOld.i16YMin : sNew.i16YMin;
+        sUnion.i16XMax = sOld.i16XMax > sNew.i16XMax ? sOld.i16XMax : sNew.i16XMax;
+        sUnion.i16YMax = sOld.i16YMax > sNew.i16YMax ? sOld.i16YMax : sNew.i16YMax;
+        rectDraw(pSprites, &sUnion, psSprite, &sOld, &sNew);
+    }
+    else {
+        rectDraw(pSprites, &sOld, psSprite, &sOld, NULL);
+        rectDraw(pSprites, &sNew, psSprite, NULL, &sNew);
+    }
+    pSprites->ui32NumMoves++;
+}
+
+// Hide sprite ui16Id, putting back what was behind it.
+void Sprites_hide(tSprites *pSprites, uint16_t ui16Id){
+    tSprite *psSprite;
+    tRectangle sOld;
+
+    if((ui16Id >= SPRITES_COUNT) || !pSprites->psSprites[ui16Id].bVisible){
+        return;
+    }
+    psSprite = &pSprites->psSprites[ui16Id];
+    boundsGet(psSprite, &sOld);
+    psSprite->bVisible = false;
+    rectDraw(pSprites, &sOld, psSprite, &sOld, NULL);
+    pSprites->ui32NumMoves++;
+}
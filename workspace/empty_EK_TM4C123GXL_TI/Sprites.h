@@ -0,0 +1,94 @@
+/*
+ * Sprites.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  A fixed number of sprites: RGB565 bitmaps that move over a background, with
+ *  one color (the key) left transparent. Nothing can be read from the screen, so
+ *  what is behind the sprites comes from the background, a color or a function
+ *  that makes rows of it, e.g. from an image.
+ *
+ *  When a sprite moves, the rectangle around its old and new position is put
+ *  together row by row off-screen (the background, with every visible sprite
+ *  that overlaps drawn on top, in ID order) and sent as one RAMWR. Only the two
+ *  positions are sent if they don't overlap.
+ *
+ *  A sprite can have a save-under buffer, where the background it covers is
+ *  kept. The pixels it leaves are then restored from the buffer, and only the
+ *  pixels it moves onto are asked from the background, which saves time when the
+ *  background function is slow.
+ *
+ *  Everything is drawn straight to the screen through pDisplayData, so anything
+ *  drawn through the display queue or the frame buffer must be flushed first.
+ *
+ */
+
+#ifndef SPRITES_H_
+#define SPRITES_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+
+// Number of sprites, i.e. the highest ID + 1
+#ifndef SPRITES_COUNT
+#define SPRITES_COUNT 4
+#endif
+
+// Widest sprite, in pixels. A move can cover up to twice this, and each of the two
+// row buffers is that many pixels.
+#ifndef SPRITES_MAX_WIDTH
+#define SPRITES_MAX_WIDTH 64
+#endif
+
+// Makes ui32Count pixels of the background, from (i32X, i32Y) to the right, in the
+// byte order used by the screen.
+typedef void (*tSpritesBackgroundFxn)(void *pvArg, int32_t i32X, int32_t i32Y,
+                                      uint32_t ui32Count, uint16_t *pui16Pixels);
+
+typedef struct
+{
+    const uint16_t *pui16Bitmap; // RGB565, row after row
+    uint16_t ui16Width;
+    uint16_t ui16Height;
+    uint16_t ui16Key;           // RGB565 color of the pixels that aren't drawn
+    // ui16Width*ui16Height pixels, or NULL. Pixel (x, y) of the screen is kept at
+    // row y modulo the height and column x modulo the width.
+    uint16_t *pui16SaveUnder;
+    int16_t i16X;               // Top left corner on the screen
+    int16_t i16Y;
+    bool bVisible;
+}
+tSprite;
+
+typedef struct
+{
+    tDisplayData *pDisplayData;
+    uint16_t ui16Width;         // Size of the screen
+    uint16_t ui16Height;
+    uint32_t ui32Background;    // Translated color, if there is no background function
+    tSpritesBackgroundFxn pfnBackground;
+    void *pvBackgroundArg;
+    tSprite psSprites[SPRITES_COUNT];
+    uint16_t pui16Row[2][2*SPRITES_MAX_WIDTH]; // Screen byte order
+    // Statistics, can be read from the debugger.
+    uint32_t ui32NumMoves;      // Moves, shows and hides
+    uint32_t ui32NumPixels;     // Pixels sent
+    uint32_t ui32NumBackground; // Pixels asked from the background
+    uint32_t ui32NumRestored;   // Pixels restored from a save-under
+}
+tSprites;
+
+/*!
+  @brief  Function declarations
+*/
+void Sprites_init(tSprites *pSprites, tDisplayData *pDisplayData, uint16_t ui16Width,
+                  uint16_t ui16Height, uint32_t ui32Background);
+void Sprites_backgroundSet(tSprites *pSprites, tSpritesBackgroundFxn pfnBackground, void *pvArg);
+bool Sprites_set(tSprites *pSprites, uint16_t ui16Id, const uint16_t *pui16Bitmap,
+                 uint16_t ui16Width, uint16_t ui16Height, uint16_t ui16Key,
+                 uint16_t *pui16SaveUnder);
+void Sprites_move(tSprites *pSprites, uint16_t ui16Id, int16_t i16X, int16_t i16Y);
+void Sprites_hide(tSprites *pSprites, uint16_t ui16Id);
+
+#endif /* SPRITES_H_ */
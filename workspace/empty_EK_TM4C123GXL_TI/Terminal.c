@@ -0,0 +1,139 @@
+/*
+ * Terminal.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include "Terminal.h"
+
+// Backspace, as sent by most terminal programs
+#define TERMINAL_DEL 0x7F
+#define TERMINAL_BS  0x08
+
+// Fill the columns from ui16Col to the end of the text line ui16Line with the background.
+static void lineClear(tTerminal *pTerminal, uint16_t ui16Line, uint16_t ui16Col){
+    const tDisplay *psDisplay = pTerminal->pContext->psDisplay;
+    tRectangle sRect;
+    sRect.i16XMin = ui16Col*pTerminal->ui16CharWidth;
+    sRect.i16XMax = psDisplay->ui16Width - 1;
+    sRect.i16YMin = pTerminal->ui16Top + ui16Line*pTerminal->ui16LineHeight;
+    sRect.i16YMax = sRect.i16YMin + pTerminal->ui16LineHeight - 1;
+    psDisplay->pfnRectFill(psDisplay->pvDisplayData, &sRect, pTerminal->pContext->ui32Background);
+}
+
+// Initialize the terminal, and clear and set up the scroll area. The text goes in
+// ui16NumLines lines from screen line ui16Top, which must fit on the screen. The font
+// and colors are taken from pContext, which must not be changed afterwards.
+// The screen must already be in HX8357_PORTRAIT.
+void Terminal_init(tTerminal *pTerminal, const tContext *pContext, tGlyphCache *pCache,
+                   tDisplayData *pDisplayData, uint16_t ui16Top, uint16_t ui16NumLines){
+    const tDisplay *psDisplay = pContext->psDisplay;
+    uint16_t ui16Line;
+
+    pTerminal->pContext = pContext;
+    pTerminal->pCache = pCache;
+    pTerminal->pDisplayData = pDisplayData;
+    pTerminal->ui16Top = ui16Top;
+    pTerminal->ui16LineHeight = pContext->psFont->ui8Height;
+    pTerminal->ui16CharWidth = pContext->psFont->ui8MaxWidth;
+    pTerminal->ui16NumLines = ui16NumLines;
+    pTerminal->ui16NumCols = psDisplay->ui16Width/pTerminal->ui16CharWidth;
+    pTerminal->ui16FirstLine = 0;
+    pTerminal->ui16Line = 0;
+    pTerminal->ui16Col = 0;
+    pTerminal->bLastCr = false;
+    pTerminal->ui32NumChars = 0;
+    pTerminal->ui32NumDraws = 0;
+    pTerminal->ui32NumScrolls = 0;
+
+    for(ui16Line = 0 ; ui16Line < ui16NumLines ; ui16Line++){
+        lineClear(pTerminal, ui16Line, 0);
+    }
+    psDisplay->pfnFlush(psDisplay->pvDisplayData);
+    HX8357_scrollAreaSet(pDisplayData, ui16Top, ui16NumLines*pTerminal->ui16LineHeight);
+    HX8357_scrollStartSet(pDisplayData, ui16Top);
+}
+
+// Move the cursor to the start of the next line. If the cursor is on the bottom
+// line, the screen is scrolled up one line: the top line, which is the one that
+// comes into view at the bottom, is cleared and the scroll start moves past it.
+static void lineFeed(tTerminal *pTerminal){
+    const tDisplay *psDisplay = pTerminal->pContext->psDisplay;
+    uint16_t ui16Next = pTerminal->ui16Line + 1;
+
+    if(ui16Next == pTerminal->ui16NumLines){
+        ui16Next = 0;
+    }
+    if(ui16Next == pTerminal->ui16FirstLine){
+        lineClear(pTerminal, ui16Next, 0);
+        // The clear must be on the screen before it is scrolled into view.
+        psDisplay->pfnFlush(psDisplay->pvDisplayData);
+        pTerminal->ui16FirstLine++;
+        if(pTerminal->ui16FirstLine == pTerminal->ui16NumLines){
+            pTerminal->ui16FirstLine = 0;
+        }
+        HX8357_scrollStartSet(pTerminal->pDisplayData,
+                              pTerminal->ui16Top + pTerminal->ui16FirstLine*pTerminal->ui16LineHeight);
+        pTerminal->ui32NumScrolls++;
+    }
+    pTerminal->ui16Line = ui16Next;
+    pTerminal->ui16Col = 0;
+}
+
+// Erase the character before the cursor, going back to the end of the line above if
+// the cursor is at the start of a line. Stops at the top of the screen.
+static void backspace(tTerminal *pTerminal){
+    if(pTerminal->ui16Col == 0){
+        if(pTerminal->ui16Line == pTerminal->ui16FirstLine){
+            return;
+        }
+        pTerminal->ui16Line = (pTerminal->ui16Line == 0 ? pTerminal->ui16NumLines : pTerminal->ui16Line) - 1;
+        pTerminal->ui16Col = pTerminal->ui16NumCols;
+    }
+    pTerminal->ui16Col--;
+    lineClear(pTerminal, pTerminal->ui16Line, pTerminal->ui16Col);
+}
+
+// Write ui32Length characters at the cursor. CR and LF (or CR LF) start a new line,
+// DEL and BS erase the last character, and lines that are too long wrap around.
+// Other control characters are ignored. Printable characters that go on the same
+// line are drawn together, with one GlyphCache_stringDraw.
+void Terminal_write(tTerminal *pTerminal, const char *pcText, uint32_t ui32Length){
+    uint32_t ui32Run;
+    char cChar;
+    bool bLastCr;
+
+    while(ui32Length > 0){
+        cChar = *pcText;
+        if((cChar >= ' ') && (cChar <= '~')){
+            ui32Run = 1;
+            while((ui32Run < ui32Length) && (pTerminal->ui16Col + ui32Run < pTerminal->ui16NumCols) &&
+                  (pcText[ui32Run] >= ' ') && (pcText[ui32Run] <= '~')){
+                ui32Run++;
+            }
+            GlyphCache_stringDraw(pTerminal->pCache, pTerminal->pContext, pcText, ui32Run,
+                                  pTerminal->ui16Col*pTerminal->ui16CharWidth,
+                                  pTerminal->ui16Top + pTerminal->ui16Line*pTerminal->ui16LineHeight);
+            pTerminal->ui32NumChars += ui32Run;
+            pTerminal->ui32NumDraws++;
+            pTerminal->bLastCr = false;
+            pcText += ui32Run;
+            ui32Length -= ui32Run;
+            pTerminal->ui16Col += ui32Run;
+            if(pTerminal->ui16Col == pTerminal->ui16NumCols){
+                lineFeed(pTerminal);
+            }
+            continue;
+        }
+        pcText++;
+        ui32Length--;
+        bLastCr = pTerminal->bLastCr;
+        pTerminal->bLastCr = (cChar == '\r');
+        if((cChar == '\r') || ((cChar == '\n') && !bLastCr)){
+            lineFeed(pTerminal);
+        }
+        else if((cChar == TERMINAL_DEL) || (cChar == TERMINAL_BS)){
+            backspace(pTerminal);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * Terminal.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Text terminal that scrolls with the vertical scrolling of the HX8357. The
+ *  screen memory holds a ring of text lines, and on a line feed the scroll start
+ *  is moved down one line instead of redrawing the screen. Only the line that
+ *  comes into view at the bottom is cleared, the rest is a few bytes of commands.
+ *
+ *  The screen must be in HX8357_PORTRAIT, as that is the only orientation where
+ *  the screen scrolls up and down. Text is drawn through the glyph cache.
+ *
+ */
+
+#ifndef TERMINAL_H_
+#define TERMINAL_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include <grlib/grlib.h>
+#include "ADAFRUIT_2050.h"
+#include "GlyphCache.h"
+
+typedef struct
+{
+    const tContext *pContext;   // Font, colors, and the tDisplay drawn through
+    tGlyphCache *pCache;
+    tDisplayData *pDisplayData; // For the scroll commands
+    uint16_t ui16Top;           // First screen line of the text
+    uint16_t ui16LineHeight;    // Height of a text line, in pixels
+    uint16_t ui16CharWidth;     // Width of a character, in pixels
+    uint16_t ui16NumLines;      // Text lines in the ring
+    uint16_t ui16NumCols;       // Characters per text line
+    uint16_t ui16FirstLine;     // Text line shown at the top
+    uint16_t ui16Line;          // Text line of the cursor
+    uint16_t ui16Col;           // Column of the cursor
+    bool bLastCr;               // Last character was a CR, so a LF right after it is skipped
+    // Statistics, can be read from the debugger.
+    uint32_t ui32NumChars;      // Characters drawn
+    uint32_t ui32NumDraws;      // GlyphCache_stringDraw calls, one per run of characters on a line
+    uint32_t ui32NumScrolls;    // Line feeds that scrolled the screen
+}
+tTerminal;
+
+/*!
+  @brief  Function declarations
+*/
+void Terminal_init(tTerminal *pTerminal, const tContext *pContext, tGlyphCache *pCache,
+                   tDisplayData *pDisplayData, uint16_t ui16Top, uint16_t ui16NumLines);
+void Terminal_write(tTerminal *pTerminal, const char *pcText, uint32_t ui32Length);
+
+#endif /* TERMINAL_H_ */
@@ -0,0 +1,170 @@
+/*
+ * Trace.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include <stdbool.h>
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include "Trace.h"
+
+#if HX8357_TRACE
+
+#if defined(__TI_ARM__) || defined(__ARM_ARCH_7EM__)
+// Cortex-M4 debug registers for the cycle counter
+#define DEMCR           (*(volatile uint32_t *)0xE000EDFC)
+#define DEMCR_TRCENA    0x01000000
+#define DWT_CTRL        (*(volatile uint32_t *)0xE0001000)
+#define DWT_CTRL_CYCCNTENA 0x00000001
+#define DWT_CYCCNT      (*(volatile uint32_t *)0xE0001004)
+
+static void timeInit(void){
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+
+uint32_t Trace_timeGet(void){
+    return DWT_CYCCNT;
+}
+#else
+#include <time.h>
+
+static void timeInit(void){
+}
+
+uint32_t Trace_timeGet(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec*1000000000ull + ts.tv_nsec);
+}
+#endif
+
+static const char *eventNames[TRACE_NUM_EVENTS] = {
+    "PixelDraw", "PixelDrawMultiple", "LineDrawH", "LineDrawV", "RectFill",
+    "ColorTranslate", "Flush", "SPI_transfer", "SPI_callback"
+};
+
+static struct
+{
+    tTraceRecord psRecords[TRACE_RECORDS];
+    volatile uint32_t ui32Next;     // Total number of records, the next one goes in ui32Next % TRACE_RECORDS
+    volatile bool bEnabled;
+}
+trace;
+
+// Start the timestamp counter and clear the trace. Recording starts right away.
+void Trace_init(void){
+    timeInit();
+    trace.ui32Next = 0;
+    trace.bEnabled = true;
+}
+
+// Record an event. Can be called from tasks and interrupts. Only taking a record
+// is done with interrupts disabled, which is a couple of instructions, so nothing
+// ever waits for the trace.
+void Trace_record(tTraceEvent event, uint32_t ui32Exit, uint32_t ui32Arg){
+    tTraceRecord *psRecord;
+    uint32_t ui32Time = Trace_timeGet();
+    UInt key;
+
+    if(!trace.bEnabled){
+        return;
+    }
+    key = Hwi_disable();
+    psRecord = &trace.psRecords[trace.ui32Next++ & (TRACE_RECORDS - 1)];
+    Hwi_restore(key);
+    psRecord->ui32Time = ui32Time;
+    psRecord->ui16Event = event;
+    psRecord->ui16Exit = ui32Exit;
+    psRecord->ui32Arg = ui32Arg;
+}
+
+// Write the trace as text with pfnWrite, oldest record first, followed by the number
+// of calls and the total and longest time per event. Times are in timestamp ticks,
+// and the time of an exit is since the last entry of the same event. Exits whose
+// entry has been overwritten are listed without a time.
+// Recording is paused while dumping, and starts over afterwards.
+void Trace_dump(tTraceWriteFxn pfnWrite, void *pvArg){
+    uint32_t pui32LastEnter[TRACE_NUM_EVENTS];
+    bool pbEntered[TRACE_NUM_EVENTS];
+    uint32_t pui32NumCalls[TRACE_NUM_EVENTS] = {0};
+    uint32_t pui32Total[TRACE_NUM_EVENTS] = {0};
+    uint32_t pui32Max[TRACE_NUM_EVENTS] = {0};
+    char pcLine[80];
+    uint32_t ui32Index, ui32First, ui32Time;
+    tTraceRecord *psRecord;
+    Int i32Length;
+
+    trace.bEnabled = false;
+    ui32First = trace.ui32Next > TRACE_RECORDS ? trace.ui32Next - TRACE_RECORDS : 0;
+
+    i32Length = System_snprintf(pcLine, sizeof(pcLine), "trace: %u records, %u Hz\r\n",
+                                trace.ui32Next - ui32First, TRACE_CLOCK_HZ);
+    pfnWrite(pvArg, pcLine, i32Length);
+    for(ui32Index = 0 ; ui32Index < TRACE_NUM_EVENTS ; ui32Index++){
+        pbEntered[ui32Index] = false;
+    }
+    for(ui32Index = ui32First ; ui32Index != trace.ui32Next ; ui32Index++){
+        psRecord = &trace.psRecords[ui32Index & (TRACE_RECORDS - 1)];
+        if(psRecord->ui16Event >= TRACE_NUM_EVENTS){
+            continue;
+        }
+        if(psRecord->ui16Exit == TRACE_ENTER){
+            pui32LastEnter[psRecord->ui16Event] = psRecord->ui32Time;
+            pbEntered[psRecord->ui16Event] = true;
+            i32Length = System_snprintf(pcLine, sizeof(pcLine), "%u > %s %u\r\n",
+                                        psRecord->ui32Time, eventNames[psRecord->ui16Event],
+                                        psRecord->ui32Arg);
+        }
+        else if(!pbEntered[psRecord->ui16Event]){
+            i32Length = System_snprintf(pcLine, sizeof(pcLine), "%u < %s %u\r\n",
+                                        psRecord->ui32Time, eventNames[psRecord->ui16Event],
+                                        psRecord->ui32Arg);
+        }
+        else {
+            pbEntered[psRecord->ui16Event] = false;
+            ui32Time = psRecord->ui32Time - pui32LastEnter[psRecord->ui16Event];
+            pui32NumCalls[psRecord->ui16Event]++;
+            pui32Total[psRecord->ui16Event] += ui32Time;
+            if(ui32Time > pui32Max[psRecord->ui16Event]){
+                pui32Max[psRecord->ui16Event] = ui32Time;
+            }
+            i32Length = System_snprintf(pcLine, sizeof(pcLine), "%u < %s %u +%u\r\n",
+                                        psRecord->ui32Time, eventNames[psRecord->ui16Event],
+                                        psRecord->ui32Arg, ui32Time);
+        }
+        pfnWrite(pvArg, pcLine, i32Length);
+    }
+    for(ui32Index = 0 ; ui32Index < TRACE_NUM_EVENTS ; ui32Index++){
+        if(pui32NumCalls[ui32Index] == 0){
+            continue;
+        }
+        i32Length = System_snprintf(pcLine, sizeof(pcLine), "%s: %u calls, %u total, %u max\r\n",
+                                    eventNames[ui32Index], pui32NumCalls[ui32Index],
+                                    pui32Total[ui32Index], pui32Max[ui32Index]);
+        pfnWrite(pvArg, pcLine, i32Length);
+    }
+
+    trace.ui32Next = 0;
+    trace.bEnabled = true;
+}
+
+#else
+// Tracing is disabled, these are only here so that calls from the application
+// still link.
+void Trace_init(void){
+}
+
+void Trace_record(tTraceEvent event, uint32_t ui32Exit, uint32_t ui32Arg){
+}
+
+uint32_t Trace_timeGet(void){
+    return 0;
+}
+
+void Trace_dump(tTraceWriteFxn pfnWrite, void *pvArg){
+}
+#endif
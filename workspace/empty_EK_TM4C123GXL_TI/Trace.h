@@ -0,0 +1,86 @@
+/*
+ * Trace.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  Timestamped trace of the display driver. Entry and exit of the GRLIB functions
+ *  and of every SPI transfer are recorded in a ring buffer, which can be written
+ *  out afterwards, e.g. over UART0. On the target the time is taken from the
+ *  DWT cycle counter, on a PC (see tools/hx8357_emu) from clock_gettime.
+ *
+ *  Enable with --define=HX8357_TRACE=1. When disabled, the TRACE_ macros are
+ *  empty and nothing is recorded.
+ *
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+#include <stdint.h>
+
+#ifndef HX8357_TRACE
+#define HX8357_TRACE 0
+#endif
+
+// Number of records in the ring buffer, 12 bytes each. Must be a power of 2.
+// When full, the oldest records are overwritten.
+#ifndef TRACE_RECORDS
+#define TRACE_RECORDS 256
+#endif
+
+// Frequency of the timestamps in Hz
+#ifndef TRACE_CLOCK_HZ
+#if defined(__TI_ARM__) || defined(__ARM_ARCH_7EM__)
+#define TRACE_CLOCK_HZ 80000000 // CPU clock, set up in the board file
+#else
+#define TRACE_CLOCK_HZ 1000000000
+#endif
+#endif
+
+// What is traced
+typedef enum
+{
+    TRACE_PIXEL_DRAW,
+    TRACE_PIXEL_DRAW_MULTIPLE,
+    TRACE_LINE_DRAW_H,
+    TRACE_LINE_DRAW_V,
+    TRACE_RECT_FILL,
+    TRACE_COLOR_TRANSLATE,
+    TRACE_FLUSH,
+    TRACE_SPI_TRANSFER,     // Call to SPI_transfer, i.e. until the transfer is started in callback mode
+    TRACE_SPI_CALLBACK,     // The SPI callback, when a transfer is done
+    TRACE_NUM_EVENTS
+}
+tTraceEvent;
+
+#define TRACE_ENTER 0
+#define TRACE_EXIT  1
+
+typedef struct
+{
+    uint32_t ui32Time;  // Timestamp, in 1/TRACE_CLOCK_HZ s. Wraps around.
+    uint16_t ui16Event; // tTraceEvent
+    uint16_t ui16Exit;  // TRACE_ENTER or TRACE_EXIT
+    uint32_t ui32Arg;   // Pixels or bytes, depending on the event
+}
+tTraceRecord;
+
+// Called by Trace_dump for every line of text to write.
+typedef void (*tTraceWriteFxn)(void *pvArg, const char *pcText, uint32_t ui32Length);
+
+#if HX8357_TRACE
+#define TRACE_IN(event, arg)  Trace_record((event), TRACE_ENTER, (arg))
+#define TRACE_OUT(event, arg) Trace_record((event), TRACE_EXIT, (arg))
+#else
+#define TRACE_IN(event, arg)
+#define TRACE_OUT(event, arg)
+#endif
+
+/*!
+  @brief  Function declarations
+*/
+void Trace_init(void);
+void Trace_record(tTraceEvent event, uint32_t ui32Exit, uint32_t ui32Arg);
+uint32_t Trace_timeGet(void);
+void Trace_dump(tTraceWriteFxn pfnWrite, void *pvArg);
+
+#endif /* TRACE_H_ */
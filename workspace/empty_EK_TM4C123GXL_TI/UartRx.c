@@ -0,0 +1,104 @@
+/*
+ * UartRx.c
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <xdc/std.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <driverlib/uart.h>
+#include "UartRx.h"
+
+// The UartRx in use, for the callback
+static tUartRx *uartRx;
+
+// UART read callback, called when the buffer is full, or with what has come in so
+// far when the read is cancelled by the idle clock. The bytes go in the ring, and
+// anything that doesn't fit is dropped, as there is no waiting in here.
+static void readCallback(UART_Handle handle, void *pvBuf, size_t count){
+    tUartRx *pRx = uartRx;
+    uint32_t ui32Written;
+
+    if(count > 0){
+        ui32Written = ByteRing_write(pRx->pRing, pvBuf, count, BIOS_NO_WAIT);
+        pRx->ui32NumDropped += count - ui32Written;
+        pRx->ui32NumBytes += count;
+        pRx->ui32NumBuffers++;
+        if(count == UARTRX_BUF_BYTES){
+            pRx->bFilled = true;
+        }
+        else {
+            pRx->ui32NumIdle++;
+        }
+    }
+    // The overrun flag stays set until cleared, so this counts the times it was
+    // seen rather than the bytes lost.
+    if(UARTRxErrorGet(pRx->ui32Base) & UART_RXERROR_OVERRUN){
+        pRx->ui32NumOverruns++;
+        UARTRxErrorClear(pRx->ui32Base);
+    }
+    UART_read(handle, pRx->pcBuf, UARTRX_BUF_BYTES);
+}
+
+// Hand on what has come in if no buffer has filled up since the last time, i.e. if
+// the line has been idle (or slow) for a while.
+static void idleClockFxn(UArg arg0){
+    tUartRx *pRx = (tUartRx *)arg0;
+    UInt key;
+
+    if(pRx->bFilled){
+        pRx->bFilled = false;
+        return;
+    }
+    // The callback is called from here, and must not be called from the UART
+    // interrupt at the same time.
+    key = Hwi_disable();
+    UART_readCancel(pRx->uart);
+    Hwi_restore(key);
+}
+
+// Open UART index (with base address ui32Base, e.g. UART0_BASE) at ui32BaudRate, and
+// start receiving into pRing, which must be initialized. Must be called from a task.
+// Returns the UART handle, which can be used for writing, or NULL if it couldn't be
+// opened.
+UART_Handle UartRx_open(tUartRx *pRx, unsigned int index, uint32_t ui32Base,
+                        uint32_t ui32BaudRate, tByteRing *pRing){
+    UART_Params uartParams;
+    Clock_Params clockParams;
+
+    pRx->ui32Base = ui32Base;
+    pRx->pRing = pRing;
+    pRx->bFilled = false;
+    pRx->ui32NumBytes = 0;
+    pRx->ui32NumBuffers = 0;
+    pRx->ui32NumIdle = 0;
+    pRx->ui32NumDropped = 0;
+    pRx->ui32NumOverruns = 0;
+    uartRx = pRx;
+
+    // Binary data, no echo, and reads only end when the buffer is full (or cancelled).
+    UART_Params_init(&uartParams);
+    uartParams.writeDataMode = UART_DATA_BINARY;
+    uartParams.readDataMode = UART_DATA_BINARY;
+    uartParams.readReturnMode = UART_RETURN_FULL;
+    uartParams.readEcho = UART_ECHO_OFF;
+    uartParams.baudRate = ui32BaudRate;
+    uartParams.readMode = UART_MODE_CALLBACK;
+    uartParams.readCallback = readCallback;
+    pRx->uart = UART_open(index, &uartParams);
+    if(pRx->uart == NULL){
+        return NULL;
+    }
+    UART_read(pRx->uart, pRx->pcBuf, UARTRX_BUF_BYTES);
+
+    Clock_Params_init(&clockParams);
+    clockParams.period = UARTRX_IDLE_TICKS;
+    clockParams.startFlag = true;
+    clockParams.arg = (UArg)pRx;
+    Clock_construct(&pRx->idleClockStruct, idleClockFxn, UARTRX_IDLE_TICKS, &clockParams);
+    pRx->idleClockHandle = Clock_handle(&pRx->idleClockStruct);
+    return pRx->uart;
+}
@@ -0,0 +1,64 @@
+/*
+ * UartRx.h
+ *
+ *  Created on: 17 okt. 2026
+ *      Author: Oskar von Heideken
+ *  UART receive path into a byte ring (ByteRing.h). The UART is read in callback
+ *  mode into a buffer, which the callback copies to the ring before it starts the
+ *  next read. Meanwhile the UART FIFO holds whatever comes in. A clock cuts the
+ *  read short when no buffer has filled up for a while (idle line), so that a few
+ *  characters don't have to wait for a full buffer. Works the same with the
+ *  interrupt driven and the uDMA UART driver, see TI_DRIVERS_UART_DMA in
+ *  EK_TM4C123GXL.c.
+ *
+ *  Only one UartRx can be used, since the UART callback doesn't say which one
+ *  it belongs to.
+ *
+ */
+
+#ifndef UARTRX_H_
+#define UARTRX_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <xdc/std.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/drivers/UART.h>
+#include "ByteRing.h"
+
+// Size of the receive buffer in bytes. A larger buffer means fewer callbacks at high
+// baud rates.
+#ifndef UARTRX_BUF_BYTES
+#define UARTRX_BUF_BYTES 64
+#endif
+
+// Clock ticks (1 ms) without a full buffer before the bytes that have come in are
+// handed on anyway.
+#ifndef UARTRX_IDLE_TICKS
+#define UARTRX_IDLE_TICKS 2
+#endif
+
+typedef struct
+{
+    UART_Handle uart;
+    uint32_t ui32Base;          // Base address of the UART, for the error flags
+    tByteRing *pRing;           // Where the received bytes go
+    char pcBuf[UARTRX_BUF_BYTES];
+    volatile bool bFilled;      // A buffer filled up since the last idle check
+    Clock_Struct idleClockStruct;
+    Clock_Handle idleClockHandle;
+    // Statistics, can be read from the debugger.
+    uint32_t ui32NumBytes;      // Bytes received
+    uint32_t ui32NumBuffers;    // Buffers handed on, full or cut short
+    uint32_t ui32NumIdle;       // Buffers cut short by the idle clock
+    uint32_t ui32NumDropped;    // Bytes dropped because the ring was full
+    uint32_t ui32NumOverruns;   // Overruns seen in the UART, i.e. bytes lost in the FIFO
+}
+tUartRx;
+
+/*!
+  @brief  Function declarations
+*/
+UART_Handle UartRx_open(tUartRx *pRx, unsigned int index, uint32_t ui32Base,
+                        uint32_t ui32BaudRate, tByteRing *pRing);
+
+#endif /* UARTRX_H_ */
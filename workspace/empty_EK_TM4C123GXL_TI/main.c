@@ -43,30 +43,65 @@
 #include <ti/sysbios/BIOS.h>
 #include <ti/sysbios/knl/Task.h>
 #include <ti/sysbios/knl/Semaphore.h>
-#include <ti/sysbios/knl/Mailbox.h>
 
 /* POSIX header files */
 #include <pthread.h>
 #include <semaphore.h>
 #include <unistd.h>
+#include <time.h>
 
 /* TI-RTOS Header files */
 #include <ti/drivers/GPIO.h>
 #include <ti/drivers/PWM.h>
+#include <ti/drivers/SDSPI.h>
 #include <ti/drivers/SPI.h>
 #include <ti/drivers/UART.h>
+#include <ti/mw/fatfs/ff.h>
 
 /* TI driverlib functions */
 #include <driverlib/sysctl.h> // Used for PWM
 #include <driverlib/gpio.h>    // used for PWM
 #include <driverlib/pin_map.h> // used for PWm
-#include <inc/hw_memmap.h>     // Used for PWM
+#include <inc/hw_memmap.h>     // Used for PWM and UartRx
 
 /* Board Header file */
 #include "Board.h"
 
 // Display driver:
 #include "ADAFRUIT_2050.h"
+#include "ByteRing.h"
+#include "DisplayList.h"
+#include "DisplayQueue.h"
+#include "FrameBuffer.h"
+#include "GlyphCache.h"
+#include "ImageStream.h"
+#include "Sprites.h"
+#include "Terminal.h"
+#include "Trace.h"
+#include "UartRx.h"
+
+// Draw through the display queue, so that drawing returns right away and the
+// render task sends the pixels to the screen. Comment out to draw directly.
+#define USE_DISPLAY_QUEUE
+// Draw in an off-screen band, which is sent to the screen on GrFlush. Needs
+// FRAMEBUFFER_COLS*FRAMEBUFFER_ROWS*2 bytes of SRAM, see FrameBuffer.h.
+//#define USE_FRAME_BUFFER
+
+#if defined(USE_DISPLAY_QUEUE) && defined(USE_FRAME_BUFFER)
+#error "USE_DISPLAY_QUEUE and USE_FRAME_BUFFER can't be used at the same time"
+#endif
+// Run UART_SCREEN_TEST as a terminal in portrait, which scrolls the screen up on a
+// new line instead of starting over at the top, see Terminal.h.
+//#define USE_SCROLL_TERMINAL
+
+// Size of the screen in the orientation used
+#ifdef USE_SCROLL_TERMINAL
+#define SCREEN_WIDTH  HX8357_TFTWIDTH
+#define SCREEN_HEIGHT HX8357_TFTHEIGHT
+#else
+#define SCREEN_WIDTH  480
+#define SCREEN_HEIGHT 320
+#endif
 
 // TI GRLIB
 #include <grlib/grlib.h>
@@ -74,19 +109,23 @@
 // Task related items
 #define MAINTASKSTACKSIZE   10000
 #define UARTTASKSTACKSIZE   2048
+#define RENDERTASKSTACKSIZE 1024
 Task_Struct task0Struct; // Main task
 Task_Struct task1Struct; // UART task
 Char task0Stack[MAINTASKSTACKSIZE];
 Char task1Stack[UARTTASKSTACKSIZE];
+#ifdef USE_DISPLAY_QUEUE
+Task_Struct task2Struct; // Render task
+Char task2Stack[RENDERTASKSTACKSIZE];
+#endif
 
 // Semaphores
 // Semaphores for letting the UART task know that there is data waiting
 Semaphore_Struct uartReadSemStruct;
 Semaphore_Handle uartReadSemHandle;
 
-// Mailboxes
-// Mailbox between UART and screen threads
-Mailbox_Handle uartMailBoxHandle;
+// Ring buffer between the UART and screen threads
+tByteRing uartRing;
 
 #define PWM_PERIOD 255
 // Initialize the PWM module. Pin is PB5
@@ -136,6 +175,12 @@ SPI_Handle initSpi(void){
     SPI_Params_init(&spiParams);
     spiParams.bitRate = 20000000;
     spiParams.mode = SPI_MASTER;
+#if HX8357_SPI_STREAMING
+    // The screen driver queues the next transfer while the DMA sends the current
+    // one, so the SPI must be used in callback mode.
+    spiParams.transferMode = SPI_MODE_CALLBACK;
+    spiParams.transferCallbackFxn = HX8357_spiCallback;
+#endif
     // Initialize SPI handle as default master
     masterSpi = SPI_open(Board_SPI0, &spiParams);
     if (masterSpi == NULL) {
@@ -167,26 +212,87 @@ PWM_Handle pwm0;
 SPI_Handle spi;
 tDisplay display;
 tDisplayData displayData;
+#ifdef USE_DISPLAY_QUEUE
+tDisplayQueue displayQueue;
+#endif
+#ifdef USE_FRAME_BUFFER
+tFrameBuffer frameBuffer;
+#endif
+UART_Handle uart0 = NULL; // Opened by the UART task
+
+#if HX8357_TRACE
+// Write the driver trace on UART0.
+void traceWrite(void *pvArg, const char *pcText, uint32_t ui32Length){
+    UART_write((UART_Handle)pvArg, pcText, ui32Length);
+}
+#endif
+
+// Read function for ImageStream, reading from a FatFs file.
+uint32_t fatfsRead(void *pvSource, uint32_t ui32Offset, void *pvBuf, uint32_t ui32Count){
+    FIL *pFile = (FIL *)pvSource;
+    UINT uiRead;
+    // The rows are read in order, except in bottom-up BMPs, so only seek when needed.
+    if((f_tell(pFile) != ui32Offset) && (f_lseek(pFile, ui32Offset) != FR_OK)){
+        return 0;
+    }
+    if(f_read(pFile, pvBuf, ui32Count, &uiRead) != FR_OK){
+        return 0;
+    }
+    return uiRead;
+}
+
+// Background for the sprites of SPRITE_TEST, a checkerboard of 20x20 squares.
+void checkerRow(void *pvArg, int32_t i32X, int32_t i32Y, uint32_t ui32Count, uint16_t *pui16Pixels){
+    uint16_t ui16Color;
+    while(ui32Count--){
+        ui16Color = ((i32X/20 + i32Y/20) & 1) ? 0x2945 : 0x5AEB;
+        *pui16Pixels++ = HX8357_SWAP16(ui16Color);
+        i32X++;
+    }
+}
+
 Void taskFxn(UArg arg0, UArg arg1)
 {
+    // Start the driver trace (if enabled with HX8357_TRACE) before the screen is used.
+    Trace_init();
     // Init SPI and PWM (needs to be set in a task)
     PWM_Handle pwm0 = initPWM();
     //setBacklight(pwm0, 0); // sets backlight to 0%
     SPI_Handle spi = initSpi();
+    // Start the init of the screen. The screen needs some time after the reset,
+    // which is spent on the rest of the setup below instead of sleeping.
+    HX8357_initBegin(spi);
     // Set the backlight strength:
     setBacklight(pwm0, 10); // sets backlight to 10%
-    // Sleep for a small amount of time in order for the display to boot:
-    usleep(100000); // Sleep for 10 ms
 
-    // Init the screen
-    HX8357_init(spi);
-
-    displayData.spiHandle = spi;
+    HX8357_initDisplayData(&displayData, spi);
     // Populate the GRLIB tDisplay variable
     display.i32Size = 0; // The size of this structure
+    display.ui16Width = SCREEN_WIDTH; // 480 pixels wide, in landscape
+    display.ui16Height = SCREEN_HEIGHT; // 320 pixels high, in landscape
+#ifdef USE_DISPLAY_QUEUE
+    // Everything drawn is put in the display queue, and drawn by the render task.
+    display.pvDisplayData = &displayQueue; // A pointer to display driver-specific data.
+    display.pfnPixelDraw = &QueuedPixelDraw;
+    display.pfnPixelDrawMultiple = &QueuedPixelDrawMultiple;
+    display.pfnLineDrawV = &QueuedLineDrawV;
+    display.pfnLineDrawH = &QueuedLineDrawH;
+    display.pfnRectFill = &QueuedRectFill;
+    display.pfnColorTranslate = &QueuedColorTranslate;
+    display.pfnFlush = &QueuedFlush; // Waits until everything queued is drawn
+#elif defined(USE_FRAME_BUFFER)
+    // Everything drawn ends up in the frame buffer band, until flushed.
+    FrameBuffer_init(&frameBuffer, &displayData, SCREEN_WIDTH, SCREEN_HEIGHT);
+    display.pvDisplayData = &frameBuffer; // A pointer to display driver-specific data.
+    display.pfnPixelDraw = &FbPixelDraw;
+    display.pfnPixelDrawMultiple = &FbPixelDrawMultiple;
+    display.pfnLineDrawV = &FbLineDrawV;
+    display.pfnLineDrawH = &FbLineDrawH;
+    display.pfnRectFill = &FbRectFill;
+    display.pfnColorTranslate = &FbColorTranslate;
+    display.pfnFlush = &FbFlush; // Sends the dirty parts of the band to the screen
+#else
     display.pvDisplayData = &displayData; // A pointer to display driver-specific data.
-    display.ui16Width = 480; // 480 pixels wide
-    display.ui16Height = 320; // 320 pixels high
     display.pfnPixelDraw = &PixelDraw; // A pointer to the function to draw a pixel on this display
     display.pfnPixelDrawMultiple = &PixelDrawMultiple; //A pointer to the function to draw multiple pixels on this display.
     display.pfnLineDrawV = &LineDrawV; // A pointer to the function to draw a vertical line on this display
@@ -194,6 +300,7 @@ Void taskFxn(UArg arg0, UArg arg1)
     display.pfnRectFill = &RectFill; // A pointer to the function to draw a filled rectangle on this display
     display.pfnColorTranslate = &ColorTranslate; // A pointer to the function to translate 24-bit RGB colors to display-specific colors
     display.pfnFlush = &Flush; // A pointer to the function to flush any cached drawing operations on this display.
+#endif
 
     // Initialize GRLIB:
     tContext grlibContext;
@@ -207,8 +314,13 @@ Void taskFxn(UArg arg0, UArg arg1)
     tGrLibDefaults grlibDefaults;
     GrLibInit(&grlibDefaults);
 
-    // Sleep for 1 ms
-    usleep(1000);
+    // Finish the init of the screen, waiting only for whatever time is left.
+    HX8357_initFinish();
+    HX8357_vsyncInit();
+#ifdef USE_SCROLL_TERMINAL
+    // The init sets landscape, but the screen only scrolls up and down in portrait.
+    HX8357_orientationSet(&displayData, HX8357_PORTRAIT);
+#endif
 
 #define BLACKOUT_SCREEN
 //#define PIXELDRAW_TEST
@@ -217,23 +329,31 @@ Void taskFxn(UArg arg0, UArg arg1)
 #define DRAW_RECTANGLE_TEST
 //#define TEXT_TEST
 //#define UART_SCREEN_TEST
+//#define IMAGE_TEST
+//#define SPRITE_TEST
     uint16_t color = HX8357_BLACK;
 #ifdef BLACKOUT_SCREEN
 
     tRectangle rect;
     rect.i16XMin = 0;
-    rect.i16XMax = 480; // 480 is the entire screen
+    rect.i16XMax = SCREEN_WIDTH-1; // The entire screen, coordinates are inclusive
     rect.i16YMin = 0;
-    rect.i16YMax = 320; // 320 is the entire screen
-    RectFill(display.pvDisplayData, &rect, color);
+    rect.i16YMax = SCREEN_HEIGHT-1;
+    display.pfnRectFill(display.pvDisplayData, &rect, color);
+    display.pfnFlush(display.pvDisplayData);
 #endif
+    // Startup timing report, the clock starts when BIOS is started.
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    System_printf("First frame at %d ms\n", (int)(ts.tv_sec*1000 + ts.tv_nsec/1000000));
+    System_flush();
     do{
 #ifdef PIXELDRAW_TEST
         // PixelDraw test:
         color = HX8357_BLUE;
         int col;
         for(col = 0 ; col < 480 ; col++){
-            PixelDraw(display.pvDisplayData, 50, col, color);
+            display.pfnPixelDraw(display.pvDisplayData, 50, col, color);
 
         }
 
@@ -241,16 +361,25 @@ Void taskFxn(UArg arg0, UArg arg1)
 
 #ifdef LINEDRAWH_TEST
         color = HX8357_YELLOW;
-        LineDrawH(display.pvDisplayData, 100, 380, 100, color);
+        display.pfnLineDrawH(display.pvDisplayData, 100, 380, 100, color);
 #endif
 
 #ifdef LINEDRAWV_TEST
         color = HX8357_YELLOW;
-        LineDrawV(display.pvDisplayData, 100, 100, 220, color);
+        display.pfnLineDrawV(display.pvDisplayData, 100, 100, 220, color);
 #endif
 
 #ifdef DRAW_RECTANGLE_TEST
-        tRectangle rect, lastRect, diffRect;
+        // The rectangle and a frame counter are nodes in a display list, which works
+        // out what to repaint when they change, including the trail the rectangle
+        // leaves behind. The rectangle is drawn over the counter.
+#define COUNTER_NODE 0
+#define RECTANGLE_NODE 1
+        static tDisplayList displayList;
+        DisplayList_init(&displayList, &display, HX8357_BLACK);
+        char frameText[12];
+        uint32_t frame = 0;
+        tRectangle rect;
         int16_t x_start = 0;//480-50-5;
         int16_t y_start = 0;//320-50-2;
         int16_t x_size = 50;
@@ -297,93 +426,28 @@ Void taskFxn(UArg arg0, UArg arg1)
                 }
             }
 
-            // Save the last rectangle
-            lastRect.i16XMin = rect.i16XMin;
-            lastRect.i16XMax = rect.i16XMax;
-            lastRect.i16YMin = rect.i16YMin;
-            lastRect.i16YMax = rect.i16YMax;
-            //lastRect = rect;
-
-            // Draw the new rectangle
+            // Move the rectangle
             rect.i16XMin = x_start;
             rect.i16XMax = x_start+x_size;
             rect.i16YMin = y_start;
             rect.i16YMax = y_start+y_size;
-            RectFill(display.pvDisplayData, &rect, color);
+            DisplayList_rectSet(&displayList, RECTANGLE_NODE, &rect, color);
 
             // Change the color
             color+=5;
 
+            // Count the frame in the bottom left corner
+            sprintf(frameText, "%u", (unsigned int)frame++);
+            DisplayList_textSet(&displayList, COUNTER_NODE, &g_sFontCmtt38, frameText, -1,
+                                0, SCREEN_HEIGHT - GrFontHeightGet(&g_sFontCmtt38), HX8357_WHITE);
 
-            // remove the trail by setting it to black.
-            // First, remove the last rectangle diff in x-axis
-            if (rect.i16XMin <= lastRect.i16XMin){
-                // If the current x start value is less than the previous x start value,
-                // then the rectangle is moving in negative direction (i.e. to the left).
-                // Therefore, the rectangle that needs to be removed is on the right hand
-                // side of the current rectangle, starting with the current max value +1
-                // and ending with the last max value plus the speed
-                diffRect.i16XMin = rect.i16XMax;
-                diffRect.i16XMax = lastRect.i16XMax;
-            }
-            else{
-                // Otherwise, the old rectangle that needs to be removed is on the left hand side.
-                diffRect.i16XMin = lastRect.i16XMin;
-                diffRect.i16XMax = rect.i16XMin;
-            }
-
-            if (rect.i16YMin <= lastRect.i16YMin){
-                // If the current Y start value is smaller than the last,
-                // that means that the rectangle is moving in a negative Y-direction (i.e. down).
-                // Therefore, the span should be this rectangles minimum and last rectagles maximum
-                diffRect.i16YMin = rect.i16YMin;
-                diffRect.i16YMax = lastRect.i16YMax;
-            }
-            else{
-                // Otherwise, the last values should be the last rectangle start values,
-                // plus the speed.
-                diffRect.i16YMin = lastRect.i16YMin;
-                diffRect.i16YMax = lastRect.i16YMax+y_speed;
-            }
-            // Fill the trail on the x-axis with black:
-            RectFill(display.pvDisplayData, &diffRect, HX8357_BLACK);
-
-            // Then remove the trailing y-axis part:
-            if (rect.i16YMin <= lastRect.i16YMin){
-                // If the current Y start value is less than the previous Y start value,
-                // then the rectangle is moving in negative direction.
-                // Therefore, the rectangle that needs to be cleared is on the top
-                // side of the current rectangle, starting with the current max value +1
-                // and ending with the last max value plus the speed
-                diffRect.i16YMin = rect.i16YMax;
-                diffRect.i16YMax = lastRect.i16YMax;
-            }
-            else{
-                // Otherwise, the old rectangle that needs to be removed is on the bottom side.
-                diffRect.i16YMin = lastRect.i16YMin;
-                diffRect.i16YMax = rect.i16YMin;
-            }
-
-            if (rect.i16XMin <= lastRect.i16XMin){
-                // If the current X start value is smaller than the last,
-                // that means that the rectangle is moving in a negative X-direction.
-                // Therefore, the start value should be the last rectangles end-value
-                // minus the speed:
-                diffRect.i16XMin = rect.i16XMin;
-                diffRect.i16XMax = lastRect.i16XMax;
-            }
-            else{
-                // Otherwise, the last values should be the last rectangle start values,
-                // plus the speed.
-                diffRect.i16XMin = lastRect.i16XMin;
-                diffRect.i16XMax = lastRect.i16XMax+x_speed;
-            }
-
-            // Fill the trail with black:
-            RectFill(display.pvDisplayData, &diffRect, HX8357_BLACK);
+            // Repaint what changed, and make sure it is on the screen.
+            DisplayList_render(&displayList);
+            display.pfnFlush(display.pvDisplayData);
 
-            // Wait for 50 ms
-            usleep(50000);
+            // Wait for the 3rd refresh of the screen from now (about 40 ms), so that
+            // the next frame is drawn right behind a refresh.
+            HX8357_vsyncWait(3);
         }
 
 #endif
@@ -397,109 +461,200 @@ Void taskFxn(UArg arg0, UArg arg1)
         }
 
 #endif
+#ifdef IMAGE_TEST
+        // Draw splash.bmp from the SD card in the middle of the screen. The SD card
+        // is read a few rows at a time, while the rows before are sent to the screen.
+        static tImageStream imageStream; // The row buffers are too large for the stack
+        static FIL imageFile;
+        SDSPI_Params sdspiParams;
+        SDSPI_Handle sdspi;
+        SDSPI_Params_init(&sdspiParams);
+        sdspi = SDSPI_open(Board_SDSPI0, 0, &sdspiParams); // Drive 0
+        if(sdspi == NULL){
+            System_abort("Error opening the SD card");
+        }
+        if(f_open(&imageFile, "0:splash.bmp", FA_READ) == FR_OK){
+            if(ImageStream_open(&imageStream, fatfsRead, &imageFile) &&
+               (imageStream.ui16Width <= SCREEN_WIDTH) && (imageStream.ui16Height <= SCREEN_HEIGHT)){
+                // The image is written straight to the screen, after what was drawn before.
+                // A 24-bit photo is dithered, so that its gradients don't turn into bands.
+                display.pfnFlush(display.pvDisplayData);
+                HX8357_ditherSet(&displayData, true);
+                ImageStream_draw(&imageStream, &displayData, (SCREEN_WIDTH - imageStream.ui16Width)/2,
+                                 (SCREEN_HEIGHT - imageStream.ui16Height)/2);
+            }
+            else {
+                System_printf("splash.bmp isn't supported, or too large\n");
+            }
+            f_close(&imageFile);
+        }
+        else {
+            System_printf("No splash.bmp on the SD card\n");
+        }
+        SDSPI_close(sdspi);
+#endif
+#ifdef SPRITE_TEST
+        // A ball bouncing over a checkerboard. Only the rectangle around where it was
+        // and where it is now is sent, put together off-screen, and what it covers is
+        // kept in its save-under.
+#define BALL_SIZE 50
+#define BALL_KEY  0xF81F // Pixels with this color aren't drawn
+        static tSprites sprites;
+        static uint16_t ballBitmap[BALL_SIZE*BALL_SIZE];
+        static uint16_t ballSaveUnder[BALL_SIZE*BALL_SIZE];
+        uint16_t checkerBuf[2][SCREEN_WIDTH];
+        uint32_t checkerChunks[2] = {0, 0};
+        int32_t spriteRow, spriteCol, spriteDist;
+        int16_t ballX = 0, ballY = 0, ballSpeedX = 5, ballSpeedY = 4;
+        tRectangle screenRect;
+        for(spriteRow = 0 ; spriteRow < BALL_SIZE ; spriteRow++){
+            for(spriteCol = 0 ; spriteCol < BALL_SIZE ; spriteCol++){
+                // Twice the distance from the middle, squared
+                spriteDist = (2*spriteCol + 1 - BALL_SIZE)*(2*spriteCol + 1 - BALL_SIZE) +
+                             (2*spriteRow + 1 - BALL_SIZE)*(2*spriteRow + 1 - BALL_SIZE);
+                ballBitmap[spriteRow*BALL_SIZE + spriteCol] = (spriteDist <= BALL_SIZE*BALL_SIZE) ?
+                                                              (0xF800 | ((63 - spriteRow) << 5)) : BALL_KEY;
+            }
+        }
+        // Draw the checkerboard, straight to the screen after what was drawn before.
+        display.pfnFlush(display.pvDisplayData);
+        screenRect.i16XMin = 0;
+        screenRect.i16XMax = SCREEN_WIDTH-1;
+        screenRect.i16YMin = 0;
+        screenRect.i16YMax = SCREEN_HEIGHT-1;
+        HX8357_streamBegin(&displayData, &screenRect);
+        for(spriteRow = 0 ; spriteRow < SCREEN_HEIGHT ; spriteRow++){
+            HX8357_streamWait(&displayData, checkerChunks[spriteRow & 1]);
+            checkerRow(NULL, 0, spriteRow, SCREEN_WIDTH, checkerBuf[spriteRow & 1]);
+            checkerChunks[spriteRow & 1] = 0;
+            checkerChunks[(spriteRow & 1) ^ 1] += HX8357_streamWrite(&displayData, checkerBuf[spriteRow & 1],
+                                                                     2*SCREEN_WIDTH);
+        }
+        HX8357_streamEnd(&displayData);
+
+        Sprites_init(&sprites, &displayData, SCREEN_WIDTH, SCREEN_HEIGHT, HX8357_BLACK);
+        Sprites_backgroundSet(&sprites, checkerRow, NULL);
+        Sprites_set(&sprites, 0, ballBitmap, BALL_SIZE, BALL_SIZE, BALL_KEY, ballSaveUnder);
+        while(1){
+            if((ballX + ballSpeedX < 0) || (ballX + ballSpeedX + BALL_SIZE > SCREEN_WIDTH)){
+                ballSpeedX = -ballSpeedX;
+            }
+            if((ballY + ballSpeedY < 0) || (ballY + ballSpeedY + BALL_SIZE > SCREEN_HEIGHT)){
+                ballSpeedY = -ballSpeedY;
+            }
+            ballX += ballSpeedX;
+            ballY += ballSpeedY;
+            Sprites_move(&sprites, 0, ballX, ballY);
+            // One move per refresh of the screen
+            HX8357_vsyncWait(1);
+        }
+#endif
 #ifdef UART_SCREEN_TEST
-        char uartInputBuf;
+        // Characters are drawn through the glyph cache, one RAMWR burst each.
+        static tGlyphCache glyphCache;
+        GlyphCache_init(&glyphCache, &displayData);
+        // Characters from the UART task, as many as have come in since the last batch
+        char uartInputBuf[64];
+        uint32_t uartCount, uartIndex;
+#ifdef USE_SCROLL_TERMINAL
+        // As many lines of text as fit, the rest of the screen at the bottom isn't used.
+        static tTerminal terminal;
+        Terminal_init(&terminal, &grlibContext, &glyphCache, &displayData, 0,
+                      SCREEN_HEIGHT/grlibContext.psFont->ui8Height);
+        while(1){
+            uartCount = ByteRing_read(&uartRing, uartInputBuf, sizeof(uartInputBuf), BIOS_WAIT_FOREVER);
+            Terminal_write(&terminal, uartInputBuf, uartCount);
+            GrFlush(&grlibContext);
+        }
+#else
         uint16_t x,y;
         x = y = 0;
         uint16_t charCounter = 0; // Character counter
 #define Y_INCREASE 40
 #define X_INCREASE 20
         while(1){
-            Mailbox_pend(uartMailBoxHandle, &uartInputBuf, BIOS_WAIT_FOREVER);
-            if(uartInputBuf != 0x7F){
-                GrStringDraw(&grlibContext, &uartInputBuf, 1, x, y, false);
-                charCounter++;
-                x += X_INCREASE;
-                if(x >= 480-X_INCREASE*2){
-                    y += Y_INCREASE;
-                    x = 0;
-                }
-                if(y >= 320-Y_INCREASE-1){
-                    y = 0;
-                    x = 0;
+            // Take everything that has come in, and draw it in one go. The counter
+            // is only drawn once per batch.
+            uartCount = ByteRing_read(&uartRing, uartInputBuf, sizeof(uartInputBuf), BIOS_WAIT_FOREVER);
+            for(uartIndex = 0 ; uartIndex < uartCount ; uartIndex++){
+                if(uartInputBuf[uartIndex] != 0x7F){
+                    GlyphCache_stringDraw(&glyphCache, &grlibContext, &uartInputBuf[uartIndex], 1, x, y);
+                    charCounter++;
+                    x += X_INCREASE;
+                    if(x >= 480-X_INCREASE*2){
+                        y += Y_INCREASE;
+                        x = 0;
+                    }
+                    if(y >= 320-Y_INCREASE-1){
+                        y = 0;
+                        x = 0;
+                    }
                 }
-            }
-            else{
-                // Handle backspace
-                // Calculate where the backspace should be done:
-                if(charCounter > 0){
-                    tRectangle rect;
-                    if(x < X_INCREASE){
-                        if(y < Y_INCREASE){
-                            y = 320 - Y_INCREASE*2;
+                else{
+                    // Handle backspace
+                    // Calculate where the backspace should be done:
+                    if(charCounter > 0){
+                        tRectangle rect;
+                        if(x < X_INCREASE){
+                            if(y < Y_INCREASE){
+                                y = 320 - Y_INCREASE*2;
+                            }
+                            else{
+                                y -= Y_INCREASE;
+                            }
+
+                            x = 480 - X_INCREASE*3;
                         }
                         else{
-                            y -= Y_INCREASE;
+                            x -= X_INCREASE;
                         }
-
-                        x = 480 - X_INCREASE*3;
-                    }
-                    else{
-                        x -= X_INCREASE;
+                        rect.i16XMin = x;
+                        rect.i16XMax = x + X_INCREASE - 1;
+                        rect.i16YMin = y;
+                        rect.i16YMax = y + Y_INCREASE - 1;
+                        display.pfnRectFill(display.pvDisplayData, &rect, HX8357_BLACK);
+                        charCounter--;
                     }
-                    rect.i16XMin = x;
-                    rect.i16XMax = x + X_INCREASE;
-                    rect.i16YMin = y;
-                    rect.i16YMax = y + Y_INCREASE;
-                    RectFill(display.pvDisplayData, &rect, HX8357_BLACK);
-                    charCounter--;
                 }
             }
             tRectangle rect;
             rect.i16XMin = 0;
-            rect.i16XMax = 4*X_INCREASE;
+            rect.i16XMax = 4*X_INCREASE - 1;
             rect.i16YMin = 200;
-            rect.i16YMax = 200 + 2*Y_INCREASE;
-            RectFill(display.pvDisplayData, &rect, HX8357_BLACK);
+            rect.i16YMax = 200 + 2*Y_INCREASE - 1;
+            display.pfnRectFill(display.pvDisplayData, &rect, HX8357_BLACK);
             char numChars[3];
             sprintf(numChars, "%i", charCounter);
-            GrStringDraw(&grlibContext, numChars, 3, 0, 200, false);
+            GlyphCache_stringDraw(&glyphCache, &grlibContext, numChars, 3, 0, 200);
+            GrFlush(&grlibContext);
 
         }
-
 #endif
 
+#endif
 
+        // Make sure everything drawn is on the screen.
+        display.pfnFlush(display.pvDisplayData);
     } while(0);
+#if HX8357_TRACE
+    // Send what the driver did over UART0.
+    if(uart0 != NULL){
+        Trace_dump(traceWrite, uart0);
+    }
+#endif
 
 }
 
 char uartTmpBuf[50];
+tUartRx uartRx; // Received bytes, buffers, drops and overruns can be read from the debugger
 void uartFxn(UArg arg0, UArg arg1)
 {
-    UART_Handle uart;
-    UART_Params uartParams;
-    uint16_t tmpCount = 0;
-    /* Create a UART with data processing off. */
-    UART_Params_init(&uartParams);
-    uartParams.writeDataMode = UART_DATA_BINARY;
-    uartParams.readDataMode = UART_DATA_BINARY;
-    uartParams.readReturnMode = UART_RETURN_NEWLINE;
-    uartParams.readEcho = UART_ECHO_OFF;
-    uartParams.baudRate = arg0;
-    uartParams.readMode = UART_MODE_BLOCKING;//UART_MODE_CALLBACK;
-    uartParams.readCallback = NULL; //&uartReadCallback;
-    uart = UART_open(Board_UART0, &uartParams);
-
-    if (uart == NULL) {
+    // Receive in callback mode, straight into the ring buffer to the screen task.
+    // Everything is done in the UART callback from now on, see UartRx.c.
+    uart0 = UartRx_open(&uartRx, Board_UART0, UART0_BASE, arg0, &uartRing);
+    if (uart0 == NULL) {
         System_abort("Error opening the UART");
     }
-
-    char readBuf;
-    while(1){
-        // Read one character at a time
-        UART_read(uart, &readBuf, 1);
-        if(readBuf != 0x7F){
-            tmpCount++;
-        }
-        else {
-            tmpCount--;
-        }
-        // Send the read character to the screen task in a mailbox event:
-        Mailbox_post(uartMailBoxHandle, &readBuf, BIOS_WAIT_FOREVER);
-
-    }
-
 }
 
 /*
@@ -513,12 +668,15 @@ void uartFxn(UArg arg0, UArg arg1)
 // SPI CS (SPI hardware CS) : PA3
 // GPIO CS (Software controlled CS) : PA6
 // SPI DC (data/command pin for screen) : PA7
+// SD card (IMAGE_TEST) : SSI2 on PB4 (CLK), PB6 (MISO), PB7 (MOSI), CS on PE3
 int main(void)
 {
     Task_Params mainTaskParams;
     Task_Params uartTaskParams;
+#ifdef USE_DISPLAY_QUEUE
+    Task_Params renderTaskParams;
+#endif
     Semaphore_Params uartSemParams;
-    Mailbox_Params mailboxParams;
 
     /* Call board init functions */
     Board_initGeneral();
@@ -528,7 +686,9 @@ int main(void)
 
 
     // Board_initI2C();
-    // Board_initSDSPI();
+#ifdef IMAGE_TEST
+    Board_initSDSPI();
+#endif
     Board_initSPI();
 
 
@@ -555,16 +715,27 @@ int main(void)
     uartTaskParams.stack = &task1Stack;
     Task_construct(&task1Struct, (Task_FuncPtr)uartFxn, &uartTaskParams, NULL);
 
+#ifdef USE_DISPLAY_QUEUE
+    // Set up the display queue, and construct the render task draining it.
+    // The render task runs at a higher priority than the main task, so that the
+    // screen is kept busy while the main task waits for something else.
+    DisplayQueue_init(&displayQueue, &displayData);
+    Task_Params_init(&renderTaskParams);
+    renderTaskParams.arg0 = (UArg)&displayQueue;
+    renderTaskParams.priority = 2;
+    renderTaskParams.stackSize = RENDERTASKSTACKSIZE;
+    renderTaskParams.stack = &task2Stack;
+    Task_construct(&task2Struct, (Task_FuncPtr)DisplayQueue_renderTask, &renderTaskParams, NULL);
+#endif
+
     // Construct semaphores
     Semaphore_Params_init(&uartSemParams);
     Semaphore_construct(&uartReadSemStruct, 1, &uartSemParams);
     uartReadSemHandle = Semaphore_handle(&uartReadSemStruct);
 
 
-    // Construct mailbox between UART thread and screen thread
-    Mailbox_Params_init(&mailboxParams);
-    // Create a mailbox of size 1 byte, 1 buffer.
-    uartMailBoxHandle =  Mailbox_create(1, 1, &mailboxParams, NULL);
+    // Set up the ring buffer between the UART thread and the screen thread
+    ByteRing_init(&uartRing);
 
     System_printf("Starting the example\nSystem provider is set to SysMin. "
                   "Halt the target to view any SysMin contents in ROV.\n");